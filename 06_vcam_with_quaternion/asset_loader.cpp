@@ -0,0 +1,291 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Two queues under one mutex: assets waiting for a loader thread, and assets   |
+| loaded and waiting for the GL thread. A handle is on at most one of them, so |
+| one next pointer does for both. Everything a loader thread and the GL thread |
+| both look at is only touched with the lock held; the load and upload steps   |
+| themselves run without it.                                                   |
+\******************************************************************************/
+#include "asset_loader.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct asset_handle {
+	asset_load_fn load;
+	asset_upload_fn upload;
+	void* ctx;
+	asset_state state;
+	// the handle was freed while loading, so skip the upload
+	bool abandoned;
+	asset_handle* next;
+};
+
+// a FIFO of handles, linked through next
+struct asset_queue {
+	asset_handle* head;
+	asset_handle* tail;
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+// signalled when something is queued, or the threads should stop
+static pthread_cond_t g_work_cond = PTHREAD_COND_INITIALIZER;
+// signalled when a load step finishes
+static pthread_cond_t g_done_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t g_threads[ASSET_LOADER_THREADS];
+static int g_thread_count = 0;
+static bool g_quit = false;
+static asset_queue g_waiting = { NULL, NULL };
+static asset_queue g_loaded = { NULL, NULL };
+
+static void push (asset_queue& q, asset_handle* h) {
+	h->next = NULL;
+	if (q.tail) {
+		q.tail->next = h;
+	} else {
+		q.head = h;
+	}
+	q.tail = h;
+}
+
+static asset_handle* pop (asset_queue& q) {
+	asset_handle* h = q.head;
+	if (h) {
+		q.head = h->next;
+		if (!q.head) {
+			q.tail = NULL;
+		}
+		h->next = NULL;
+	}
+	return h;
+}
+
+// takes h out of q, wherever it is. nothing happens if it isn't there
+static void unlink (asset_queue& q, asset_handle* h) {
+	asset_handle* prev = NULL;
+	for (asset_handle* at = q.head; at; prev = at, at = at->next) {
+		if (at != h) {
+			continue;
+		}
+		if (prev) {
+			prev->next = h->next;
+		} else {
+			q.head = h->next;
+		}
+		if (q.tail == h) {
+			q.tail = prev;
+		}
+		h->next = NULL;
+		return;
+	}
+}
+
+static void* loader_main (void*) {
+	pthread_mutex_lock (&g_lock);
+	while (true) {
+		while (!g_quit && !g_waiting.head) {
+			pthread_cond_wait (&g_work_cond, &g_lock);
+		}
+		if (g_quit) {
+			break;
+		}
+		asset_handle* h = pop (g_waiting);
+		h->state = ASSET_LOADING;
+		pthread_mutex_unlock (&g_lock);
+		bool ok = h->load (h->ctx);
+		pthread_mutex_lock (&g_lock);
+		if (!ok) {
+			h->state = ASSET_FAILED;
+		} else if (h->upload && !h->abandoned) {
+			h->state = ASSET_LOADED;
+			push (g_loaded, h);
+		} else {
+			h->state = ASSET_READY;
+		}
+		pthread_cond_broadcast (&g_done_cond);
+	}
+	pthread_mutex_unlock (&g_lock);
+	return NULL;
+}
+
+// with g_lock held
+static void start_loader_threads () {
+	while (g_thread_count < ASSET_LOADER_THREADS) {
+		if (0 != pthread_create (&g_threads[g_thread_count], NULL, loader_main,
+			NULL)) {
+			fprintf (stderr, "ERROR: could not start asset loader thread\n");
+			break;
+		}
+		g_thread_count++;
+	}
+}
+
+asset_handle* load_asset_async (asset_load_fn load, asset_upload_fn upload,
+	void* ctx) {
+	asset_handle* h = (asset_handle*)malloc (sizeof (asset_handle));
+	if (!h) {
+		fprintf (stderr, "ERROR: out of memory queueing asset\n");
+		return NULL;
+	}
+	h->load = load;
+	h->upload = upload;
+	h->ctx = ctx;
+	h->state = ASSET_QUEUED;
+	h->abandoned = false;
+	h->next = NULL;
+	pthread_mutex_lock (&g_lock);
+	start_loader_threads ();
+	if (0 == g_thread_count) {
+		// no threads, so load it here. it still uploads from the pump
+		h->state = ASSET_LOADING;
+		pthread_mutex_unlock (&g_lock);
+		bool ok = load (ctx);
+		pthread_mutex_lock (&g_lock);
+		h->state = !ok ? ASSET_FAILED : upload ? ASSET_LOADED : ASSET_READY;
+		if (ASSET_LOADED == h->state) {
+			push (g_loaded, h);
+		}
+	} else {
+		push (g_waiting, h);
+		pthread_cond_signal (&g_work_cond);
+	}
+	pthread_mutex_unlock (&g_lock);
+	return h;
+}
+
+asset_state asset_status (const asset_handle* handle) {
+	pthread_mutex_lock (&g_lock);
+	asset_state state = handle->state;
+	pthread_mutex_unlock (&g_lock);
+	return state;
+}
+
+bool asset_done (const asset_handle* handle) {
+	asset_state state = asset_status (handle);
+	return ASSET_READY == state || ASSET_FAILED == state;
+}
+
+static double now_ms () {
+	timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e3 + t.tv_nsec * 1e-6;
+}
+
+int pump_asset_uploads (double budget_ms) {
+	double start = now_ms ();
+	int count = 0;
+	do {
+		pthread_mutex_lock (&g_lock);
+		asset_handle* h = pop (g_loaded);
+		pthread_mutex_unlock (&g_lock);
+		if (!h) {
+			break;
+		}
+		// only this thread looks at a handle after it leaves g_loaded
+		bool ok = h->upload (h->ctx);
+		pthread_mutex_lock (&g_lock);
+		h->state = ok ? ASSET_READY : ASSET_FAILED;
+		pthread_mutex_unlock (&g_lock);
+		count++;
+	} while (now_ms () - start < budget_ms);
+	return count;
+}
+
+asset_state wait_asset_loaded (asset_handle* handle) {
+	pthread_mutex_lock (&g_lock);
+	while (ASSET_QUEUED == handle->state || ASSET_LOADING == handle->state) {
+		pthread_cond_wait (&g_done_cond, &g_lock);
+	}
+	asset_state state = handle->state;
+	pthread_mutex_unlock (&g_lock);
+	return state;
+}
+
+void free_asset_handle (asset_handle* handle) {
+	if (!handle) {
+		return;
+	}
+	pthread_mutex_lock (&g_lock);
+	if (ASSET_QUEUED == handle->state) {
+		unlink (g_waiting, handle);
+	}
+	handle->abandoned = true;
+	while (ASSET_LOADING == handle->state) {
+		pthread_cond_wait (&g_done_cond, &g_lock);
+	}
+	unlink (g_loaded, handle);
+	pthread_mutex_unlock (&g_lock);
+	free (handle);
+}
+
+void stop_asset_loader () {
+	pthread_mutex_lock (&g_lock);
+	for (asset_handle* h = pop (g_waiting); h; h = pop (g_waiting)) {
+		h->state = ASSET_FAILED;
+	}
+	g_quit = true;
+	pthread_cond_broadcast (&g_work_cond);
+	pthread_cond_broadcast (&g_done_cond);
+	int count = g_thread_count;
+	pthread_mutex_unlock (&g_lock);
+	for (int i = 0; i < count; i++) {
+		pthread_join (g_threads[i], NULL);
+	}
+	pthread_mutex_lock (&g_lock);
+	g_thread_count = 0;
+	g_quit = false;
+	pthread_mutex_unlock (&g_lock);
+}
+
+/*------------------------------------TEXT------------------------------------*/
+bool load_text_asset (void* ctx) {
+	text_asset& asset = *(text_asset*)ctx;
+	asset.text = NULL;
+	asset.length = 0;
+	FILE* file = fopen (asset.file_name, "rb");
+	if (!file) {
+		fprintf (stderr, "ERROR: opening file for reading: %s\n", asset.file_name);
+		return false;
+	}
+	long length = -1;
+	if (0 == fseek (file, 0, SEEK_END)) {
+		length = ftell (file);
+	}
+	if (length < 0 || 0 != fseek (file, 0, SEEK_SET)) {
+		fprintf (stderr, "ERROR: could not get the size of %s\n", asset.file_name);
+		fclose (file);
+		return false;
+	}
+	char* text = (char*)malloc ((size_t)length + 1);
+	if (!text) {
+		fprintf (stderr, "ERROR: out of memory reading %s\n", asset.file_name);
+		fclose (file);
+		return false;
+	}
+	size_t cnt = fread (text, 1, (size_t)length, file);
+	bool failed = ferror (file) != 0;
+	fclose (file);
+	if (failed) {
+		fprintf (stderr, "ERROR: reading file %s\n", asset.file_name);
+		free (text);
+		return false;
+	}
+	text[cnt] = 0;
+	asset.text = text;
+	asset.length = cnt;
+	return true;
+}
+
+void free_text_asset (text_asset& asset) {
+	free (asset.text);
+	asset.text = NULL;
+	asset.length = 0;
+}
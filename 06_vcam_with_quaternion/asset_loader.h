@@ -0,0 +1,78 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Loads assets in the background so the first frame doesn't wait for them.     |
+| An asset is two steps: a load step that reads and parses on a loader thread, |
+| and an upload step that the GL thread runs from pump_asset_uploads() once a  |
+| frame, since only that thread may touch GL. load_asset_async() gives back a  |
+| handle that can be polled, like a coroutine that suspends between the two    |
+| steps. The loader threads are separate from thread_pool.h's workers, so a    |
+| load can still use parallel_for.                                             |
+\******************************************************************************/
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include <stddef.h>
+
+// threads reading and parsing. mostly waiting on the disk, so not cpu count
+#define ASSET_LOADER_THREADS 2
+
+enum asset_state {
+	ASSET_QUEUED, // waiting for a loader thread
+	ASSET_LOADING, // load step running
+	ASSET_LOADED, // waiting for pump_asset_uploads()
+	ASSET_READY, // both steps done
+	ASSET_FAILED // a step returned false, or it was cancelled
+};
+
+// the load step, on a loader thread. no GL calls. false if it failed
+typedef bool (*asset_load_fn) (void* ctx);
+// the upload step, on the GL thread. false if it failed
+typedef bool (*asset_upload_fn) (void* ctx);
+
+struct asset_handle;
+
+/* queues an asset. load runs on a loader thread, then upload (if not NULL) on
+the thread calling pump_asset_uploads(). assets load in the order queued, and
+upload in the order their loads finish. ctx must live until the handle is
+freed. NULL if out of memory */
+asset_handle* load_asset_async (asset_load_fn load, asset_upload_fn upload,
+	void* ctx);
+asset_state asset_status (const asset_handle* handle);
+// true once the asset is READY or FAILED
+bool asset_done (const asset_handle* handle);
+
+/* runs the upload step of loaded assets until about budget_ms has gone, always
+at least one if there is one waiting. call it once a frame on the GL thread.
+returns how many it ran */
+int pump_asset_uploads (double budget_ms);
+
+/* blocks until the load step has finished, for code without a frame loop.
+returns LOADED, READY or FAILED */
+asset_state wait_asset_loaded (asset_handle* handle);
+
+/* frees a handle. a queued asset is cancelled. one that is loading is waited
+for; its upload step is skipped */
+void free_asset_handle (asset_handle* handle);
+
+/* cancels everything queued, waits for the loads running and stops the loader
+threads. they start again if anything else is queued */
+void stop_asset_loader ();
+
+// a whole file read into memory, for shaders and the like
+struct text_asset {
+	const char* file_name;
+	// malloc'd and 0-terminated once loaded. free with free_text_asset()
+	char* text;
+	size_t length;
+};
+// an asset_load_fn for a text_asset
+bool load_text_asset (void* ctx);
+void free_text_asset (text_asset& asset);
+
+#endif
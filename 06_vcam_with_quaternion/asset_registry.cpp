@@ -0,0 +1,289 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| The assets are a flat array searched by path, which is fine for the handful  |
+| a scene has: lookups only happen in acquire_asset(), drawing goes through    |
+| the reference. LRU is a frame number per asset, and eviction scans for the   |
+| oldest, which is also fine at this size. While an asset has a load or upload |
+| in flight, its data belongs to the asset loader and nothing here touches it. |
+\******************************************************************************/
+#include "asset_registry.h"
+#include "asset_loader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct registry_asset {
+	char* path;
+	const asset_type* type;
+	void* data;
+	int refs;
+	// frame it was last used or acquired, for LRU
+	unsigned int last_used;
+	bool cpu;
+	bool gpu;
+	bool failed;
+	// a load or upload in flight, or NULL
+	asset_handle* handle;
+	// what sizes() said last, so the totals can be kept up to date
+	size_t cpu_bytes;
+	size_t gpu_bytes;
+};
+
+static registry_asset** g_assets = NULL;
+static int g_count = 0;
+static int g_capacity = 0;
+static unsigned int g_frame = 0;
+static asset_registry_stats g_stats;
+
+void init_asset_registry (size_t cpu_budget, size_t gpu_budget) {
+	memset (&g_stats, 0, sizeof (g_stats));
+	set_asset_budgets (cpu_budget, gpu_budget);
+}
+
+void set_asset_budgets (size_t cpu_budget, size_t gpu_budget) {
+	g_stats.cpu_budget = cpu_budget;
+	g_stats.gpu_budget = gpu_budget;
+}
+
+// re-reads an asset's sizes into the totals
+static void resize (registry_asset* a) {
+	g_stats.cpu_bytes -= a->cpu_bytes;
+	g_stats.gpu_bytes -= a->gpu_bytes;
+	a->cpu_bytes = a->gpu_bytes = 0;
+	if (a->cpu || a->gpu) {
+		a->type->sizes (a->data, &a->cpu_bytes, &a->gpu_bytes);
+	}
+	g_stats.cpu_bytes += a->cpu_bytes;
+	g_stats.gpu_bytes += a->gpu_bytes;
+}
+
+/*--------------------------------LOADING-------------------------------------*/
+// the two steps handed to the asset loader
+static bool load_step (void* ctx) {
+	registry_asset* a = (registry_asset*)ctx;
+	return a->type->load (a->path, a->data);
+}
+
+static bool upload_step (void* ctx) {
+	registry_asset* a = (registry_asset*)ctx;
+	return a->type->upload (a->data);
+}
+
+// the load step of a re-upload: the CPU copy is still there
+static bool already_loaded (void*) {
+	return true;
+}
+
+static void start_load (registry_asset* a) {
+	if (a->cpu) {
+		a->handle = load_asset_async (already_loaded, upload_step, a);
+	} else {
+		a->handle = load_asset_async (load_step, upload_step, a);
+		g_stats.loads++;
+	}
+	if (!a->handle) {
+		a->failed = true;
+	}
+}
+
+// takes the result of a finished load or upload
+static void finish_load (registry_asset* a) {
+	asset_state state = asset_status (a->handle);
+	free_asset_handle (a->handle);
+	a->handle = NULL;
+	if (ASSET_READY == state) {
+		a->cpu = a->gpu = true;
+		g_stats.uploads++;
+	} else {
+		fprintf (stderr, "ERROR: could not load %s %s\n", a->type->name, a->path);
+		a->failed = true;
+		if (!a->cpu) {
+			a->type->unload (a->data);
+		}
+	}
+	resize (a);
+}
+
+/*--------------------------------EVICTION------------------------------------*/
+enum eviction {
+	EVICT_SHADOW, // a CPU copy that has been uploaded
+	EVICT_CPU, // any CPU copy of an asset nothing refers to
+	EVICT_GPU // a GPU copy of an asset nothing refers to
+};
+
+static registry_asset* least_recent (eviction kind) {
+	registry_asset* best = NULL;
+	for (int i = 0; i < g_count; i++) {
+		registry_asset* a = g_assets[i];
+		bool fits = false;
+		if (!a->handle) {
+			switch (kind) {
+				case EVICT_SHADOW: fits = a->cpu && a->gpu; break;
+				case EVICT_CPU: fits = a->cpu && 0 == a->refs; break;
+				case EVICT_GPU: fits = a->gpu && 0 == a->refs; break;
+			}
+		}
+		if (fits && (!best || a->last_used < best->last_used)) {
+			best = a;
+		}
+	}
+	return best;
+}
+
+static void drop_copy (registry_asset* a, bool cpu) {
+	if (cpu) {
+		a->type->drop_cpu (a->data);
+		a->cpu = false;
+	} else {
+		a->type->drop_gpu (a->data);
+		a->gpu = false;
+	}
+	if (!a->cpu && !a->gpu) {
+		a->type->unload (a->data);
+	}
+	resize (a);
+}
+
+static void evict () {
+	while (g_stats.cpu_bytes > g_stats.cpu_budget) {
+		registry_asset* a = least_recent (EVICT_SHADOW);
+		if (!a) {
+			a = least_recent (EVICT_CPU);
+		}
+		if (!a) {
+			break;
+		}
+		drop_copy (a, true);
+		g_stats.cpu_evictions++;
+	}
+	while (g_stats.gpu_bytes > g_stats.gpu_budget) {
+		registry_asset* a = least_recent (EVICT_GPU);
+		if (!a) {
+			break;
+		}
+		drop_copy (a, false);
+		g_stats.gpu_evictions++;
+	}
+}
+
+/*------------------------------------API-------------------------------------*/
+registry_asset* acquire_asset (const char* path, const asset_type* type) {
+	registry_asset* a = NULL;
+	for (int i = 0; i < g_count && !a; i++) {
+		if (0 == strcmp (g_assets[i]->path, path)) {
+			a = g_assets[i];
+		}
+	}
+	if (a && a->type != type) {
+		fprintf (stderr, "ERROR: %s is already a %s, not a %s\n", path,
+			a->type->name, type->name);
+		return NULL;
+	}
+	if (!a) {
+		if (g_count == g_capacity) {
+			int capacity = g_capacity ? g_capacity * 2 : 16;
+			registry_asset** grown = (registry_asset**)realloc (g_assets,
+				capacity * sizeof (registry_asset*));
+			if (!grown) {
+				fprintf (stderr, "ERROR: out of memory acquiring %s\n", path);
+				return NULL;
+			}
+			g_assets = grown;
+			g_capacity = capacity;
+		}
+		a = (registry_asset*)calloc (1, sizeof (registry_asset));
+		char* path_copy = (char*)malloc (strlen (path) + 1);
+		void* data = calloc (1, type->data_size + 1);
+		if (!a || !path_copy || !data) {
+			fprintf (stderr, "ERROR: out of memory acquiring %s\n", path);
+			free (a);
+			free (path_copy);
+			free (data);
+			return NULL;
+		}
+		strcpy (path_copy, path);
+		a->path = path_copy;
+		a->type = type;
+		a->data = data;
+		g_assets[g_count++] = a;
+		g_stats.assets = g_count;
+	}
+	a->refs++;
+	a->last_used = g_frame;
+	a->failed = false;
+	if (!a->gpu && !a->handle) {
+		start_load (a);
+	}
+	return a;
+}
+
+void release_asset (registry_asset* asset) {
+	if (asset && asset->refs > 0) {
+		asset->refs--;
+	}
+}
+
+void* use_asset (registry_asset* asset) {
+	asset->last_used = g_frame;
+	if (asset->gpu) {
+		return asset->data;
+	}
+	if (!asset->handle && !asset->failed) {
+		start_load (asset);
+	}
+	return NULL;
+}
+
+bool asset_failed (const registry_asset* asset) {
+	return asset->failed;
+}
+
+bool asset_cpu_resident (const registry_asset* asset) {
+	return asset->cpu;
+}
+
+bool asset_gpu_resident (const registry_asset* asset) {
+	return asset->gpu;
+}
+
+void update_asset_registry (double upload_budget_ms) {
+	pump_asset_uploads (upload_budget_ms);
+	for (int i = 0; i < g_count; i++) {
+		registry_asset* a = g_assets[i];
+		if (a->handle && asset_done (a->handle)) {
+			finish_load (a);
+		}
+	}
+	evict ();
+	g_frame++;
+}
+
+asset_registry_stats get_asset_registry_stats () {
+	return g_stats;
+}
+
+void free_asset_registry () {
+	for (int i = 0; i < g_count; i++) {
+		registry_asset* a = g_assets[i];
+		// waits for a load in progress, and skips its upload
+		free_asset_handle (a->handle);
+		if (a->gpu) {
+			a->type->drop_gpu (a->data);
+		}
+		a->type->unload (a->data);
+		free (a->data);
+		free (a->path);
+		free (a);
+	}
+	free (g_assets);
+	g_assets = NULL;
+	g_count = g_capacity = 0;
+	size_t cpu_budget = g_stats.cpu_budget, gpu_budget = g_stats.gpu_budget;
+	init_asset_registry (cpu_budget, gpu_budget);
+}
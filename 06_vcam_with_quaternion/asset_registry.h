@@ -0,0 +1,86 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Keeps loaded assets within a CPU and a GPU memory budget. Assets are looked  |
+| up by path and reference counted. Each one can have a CPU copy (what was     |
+| parsed from disk) and a GPU copy (what was uploaded from it). Once uploaded, |
+| the CPU copy is only a shadow, so it's the first thing to go when over       |
+| budget, least recently used first. After that, assets nothing refers to lose |
+| their copies, again least recently used first. An evicted asset is loaded    |
+| and uploaded again, through asset_loader.h, the next time it's used.         |
+| The registry itself is only used from the GL thread.                         |
+\******************************************************************************/
+#ifndef _ASSET_REGISTRY_H_
+#define _ASSET_REGISTRY_H_
+
+#include <stddef.h>
+
+/* how one kind of asset is loaded, uploaded and dropped. data is a zeroed
+block of data_size bytes per asset */
+struct asset_type {
+	const char* name;
+	size_t data_size;
+	// on a loader thread: read path into the CPU copy. no GL. false if it failed
+	bool (*load) (const char* path, void* data);
+	// on the GL thread: make the GPU copy from the CPU copy. false if it failed
+	bool (*upload) (void* data);
+	/* frees the CPU copy. anything the GPU copy needs to be drawn, e.g. its
+	bounds, must stay */
+	void (*drop_cpu) (void* data);
+	// frees the GPU copy
+	void (*drop_gpu) (void* data);
+	/* frees whatever is left once both copies are gone and zeroes data, ready
+	for the next load */
+	void (*unload) (void* data);
+	// bytes each copy uses now, 0 for one that isn't there
+	void (*sizes) (const void* data, size_t* cpu_bytes, size_t* gpu_bytes);
+};
+
+struct registry_asset;
+
+struct asset_registry_stats {
+	size_t cpu_bytes;
+	size_t gpu_bytes;
+	size_t cpu_budget;
+	size_t gpu_budget;
+	int assets;
+	int loads; // loads started from disk, including reloads
+	int uploads; // GPU copies made
+	int cpu_evictions; // CPU copies dropped to stay in budget
+	int gpu_evictions; // GPU copies dropped to stay in budget
+};
+
+void init_asset_registry (size_t cpu_budget, size_t gpu_budget);
+void set_asset_budgets (size_t cpu_budget, size_t gpu_budget);
+/* drops every asset, waiting for any still loading. references are no longer
+valid afterwards */
+void free_asset_registry ();
+
+/* a reference to the asset at path, starting its load if it isn't resident.
+the same path always gives the same asset, so type must match. NULL if out
+of memory */
+registry_asset* acquire_asset (const char* path, const asset_type* type);
+/* drops a reference. the asset stays resident, but can be evicted once
+nothing refers to it */
+void release_asset (registry_asset* asset);
+
+/* the asset's data if its GPU copy is there, marking it as used this frame.
+otherwise NULL, and it's (re)loaded or (re)uploaded in the background */
+void* use_asset (registry_asset* asset);
+// true if its last load or upload failed. it isn't retried until reacquired
+bool asset_failed (const registry_asset* asset);
+bool asset_cpu_resident (const registry_asset* asset);
+bool asset_gpu_resident (const registry_asset* asset);
+
+/* once a frame on the GL thread: runs waiting uploads for about
+upload_budget_ms (see pump_asset_uploads()), then evicts until both budgets
+are met or nothing else can go */
+void update_asset_registry (double upload_budget_ms);
+asset_registry_stats get_asset_registry_stats ();
+
+#endif
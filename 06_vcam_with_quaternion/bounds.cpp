@@ -0,0 +1,619 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Bounding volumes. The point kernels read 4 packed xyz points (3 registers)   |
+| at a time and shuffle them into x, y and z registers, 2 or 4 of those side   |
+| by side in the wider levels. min and max are exact, and the distances are a  |
+| mul and two adds in a fixed order, so every level finds the same answer.     |
+| Arvo's box transform is a mul, a min/max and an add per matrix element, done |
+| in the same order everywhere.                                                |
+\******************************************************************************/
+#include "bounds.h"
+#include "maths_simd.h"
+#include <float.h>
+#include <math.h>
+#if MATHS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* sqrt of a squared distance, nudged up a few ulps so rounding in the
+distance or the sqrt can't leave a point just outside */
+static float radius_from_sq (float dist_sq) {
+	return sqrtf (dist_sq) * (1.0f + 4.0f * FLT_EPSILON);
+}
+
+/*-------------------------------SCALAR KERNELS-------------------------------*/
+/* lo and hi hold the box so far, and each kernel carries on from them, so a
+kernel can hand its tail to a smaller one */
+typedef void (*box_fn) (const float* p, size_t begin, size_t end, float* lo,
+	float* hi);
+// returns the largest of best and the squared distances from c
+typedef float (*dist_fn) (const float* p, size_t begin, size_t end,
+	const float* c, float best);
+typedef void (*transform_fn) (const mat4& m, const const_aabb_soa& in,
+	aabb_soa& out, size_t begin, size_t end);
+
+// the same comparisons _mm_min_ps and _mm_max_ps make
+static inline float min_of (float a, float b) {
+	return a < b ? a : b;
+}
+
+static inline float max_of (float a, float b) {
+	return a > b ? a : b;
+}
+
+static void box_scalar (const float* p, size_t begin, size_t end, float* lo,
+	float* hi) {
+	for (size_t i = begin; i < end; i++) {
+		for (int k = 0; k < 3; k++) {
+			lo[k] = min_of (lo[k], p[i * 3 + k]);
+			hi[k] = max_of (hi[k], p[i * 3 + k]);
+		}
+	}
+}
+
+static float dist_scalar (const float* p, size_t begin, size_t end,
+	const float* c, float best) {
+	for (size_t i = begin; i < end; i++) {
+		float dx = p[i * 3] - c[0];
+		float dy = p[i * 3 + 1] - c[1];
+		float dz = p[i * 3 + 2] - c[2];
+		best = max_of (best, dx * dx + dy * dy + dz * dz);
+	}
+	return best;
+}
+
+/* Arvo for one output axis: the translation, plus for each input axis the
+smaller (or bigger) of the matrix element times the old min and max */
+static inline void arvo_row (const mat4& m, int row, const float* lo,
+	const float* hi, float* new_lo, float* new_hi) {
+	float l = m.m[12 + row], h = m.m[12 + row];
+	for (int col = 0; col < 3; col++) {
+		float a = m.m[col * 4 + row] * lo[col];
+		float b = m.m[col * 4 + row] * hi[col];
+		l = l + min_of (a, b);
+		h = h + max_of (a, b);
+	}
+	*new_lo = l;
+	*new_hi = h;
+}
+
+static void transform_scalar (const mat4& m, const const_aabb_soa& in,
+	aabb_soa& out, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		// read the whole box first, out may be in
+		float lo[3], hi[3];
+		for (int k = 0; k < 3; k++) {
+			lo[k] = in.min[k][i];
+			hi[k] = in.max[k][i];
+		}
+		for (int row = 0; row < 3; row++) {
+			arvo_row (m, row, lo, hi, out.min[row] + i, out.max[row] + i);
+		}
+	}
+}
+
+#if MATHS_SIMD_X86
+/*-------------------------------SSE4.1 KERNELS-------------------------------*/
+/* a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3 into x, y and z. the
+shuffles work within 128-bit lanes, so the wider levels use the same ones */
+#define DEINTERLEAVE(shuffle, T, a, b, c, x, y, z) do { \
+	T x2y2x3y3 = shuffle (b, c, _MM_SHUFFLE (2, 1, 3, 2)); \
+	T y0z0y1z1 = shuffle (a, b, _MM_SHUFFLE (1, 0, 2, 1)); \
+	x = shuffle (a, x2y2x3y3, _MM_SHUFFLE (2, 0, 3, 0)); \
+	y = shuffle (y0z0y1z1, x2y2x3y3, _MM_SHUFFLE (3, 1, 2, 0)); \
+	z = shuffle (y0z0y1z1, c, _MM_SHUFFLE (3, 0, 3, 1)); \
+} while (0)
+
+__attribute__ ((target ("sse4.1")))
+static void box_sse41 (const float* p, size_t begin, size_t end, float* lo,
+	float* hi) {
+	size_t i = begin;
+	if (i + 4 <= end) {
+		__m128 lx = _mm_set1_ps (lo[0]), hx = _mm_set1_ps (hi[0]);
+		__m128 ly = _mm_set1_ps (lo[1]), hy = _mm_set1_ps (hi[1]);
+		__m128 lz = _mm_set1_ps (lo[2]), hz = _mm_set1_ps (hi[2]);
+		for (; i + 4 <= end; i += 4) {
+			__m128 a = _mm_loadu_ps (p + i * 3);
+			__m128 b = _mm_loadu_ps (p + i * 3 + 4);
+			__m128 c = _mm_loadu_ps (p + i * 3 + 8);
+			__m128 x, y, z;
+			DEINTERLEAVE (_mm_shuffle_ps, __m128, a, b, c, x, y, z);
+			lx = _mm_min_ps (lx, x);
+			ly = _mm_min_ps (ly, y);
+			lz = _mm_min_ps (lz, z);
+			hx = _mm_max_ps (hx, x);
+			hy = _mm_max_ps (hy, y);
+			hz = _mm_max_ps (hz, z);
+		}
+		float l[3][4], h[3][4];
+		_mm_storeu_ps (l[0], lx);
+		_mm_storeu_ps (l[1], ly);
+		_mm_storeu_ps (l[2], lz);
+		_mm_storeu_ps (h[0], hx);
+		_mm_storeu_ps (h[1], hy);
+		_mm_storeu_ps (h[2], hz);
+		for (int k = 0; k < 3; k++) {
+			for (int j = 0; j < 4; j++) {
+				lo[k] = min_of (lo[k], l[k][j]);
+				hi[k] = max_of (hi[k], h[k][j]);
+			}
+		}
+	}
+	box_scalar (p, i, end, lo, hi);
+}
+
+__attribute__ ((target ("sse4.1")))
+static float dist_sse41 (const float* p, size_t begin, size_t end,
+	const float* c, float best) {
+	size_t i = begin;
+	if (i + 4 <= end) {
+		const __m128 cx = _mm_set1_ps (c[0]);
+		const __m128 cy = _mm_set1_ps (c[1]);
+		const __m128 cz = _mm_set1_ps (c[2]);
+		__m128 most = _mm_set1_ps (best);
+		for (; i + 4 <= end; i += 4) {
+			__m128 a = _mm_loadu_ps (p + i * 3);
+			__m128 b = _mm_loadu_ps (p + i * 3 + 4);
+			__m128 cc = _mm_loadu_ps (p + i * 3 + 8);
+			__m128 x, y, z;
+			DEINTERLEAVE (_mm_shuffle_ps, __m128, a, b, cc, x, y, z);
+			__m128 dx = _mm_sub_ps (x, cx);
+			__m128 dy = _mm_sub_ps (y, cy);
+			__m128 dz = _mm_sub_ps (z, cz);
+			__m128 d = _mm_add_ps (_mm_add_ps (_mm_mul_ps (dx, dx),
+				_mm_mul_ps (dy, dy)), _mm_mul_ps (dz, dz));
+			most = _mm_max_ps (most, d);
+		}
+		float m[4];
+		_mm_storeu_ps (m, most);
+		for (int j = 0; j < 4; j++) {
+			best = max_of (best, m[j]);
+		}
+	}
+	return dist_scalar (p, i, end, c, best);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void transform_sse41 (const mat4& m, const const_aabb_soa& in,
+	aabb_soa& out, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 lo[3], hi[3];
+		for (int k = 0; k < 3; k++) {
+			lo[k] = _mm_loadu_ps (in.min[k] + i);
+			hi[k] = _mm_loadu_ps (in.max[k] + i);
+		}
+		for (int row = 0; row < 3; row++) {
+			__m128 new_lo = _mm_set1_ps (m.m[12 + row]), new_hi = new_lo;
+			for (int col = 0; col < 3; col++) {
+				__m128 e = _mm_set1_ps (m.m[col * 4 + row]);
+				__m128 a = _mm_mul_ps (e, lo[col]);
+				__m128 b = _mm_mul_ps (e, hi[col]);
+				new_lo = _mm_add_ps (new_lo, _mm_min_ps (a, b));
+				new_hi = _mm_add_ps (new_hi, _mm_max_ps (a, b));
+			}
+			_mm_storeu_ps (out.min[row] + i, new_lo);
+			_mm_storeu_ps (out.max[row] + i, new_hi);
+		}
+	}
+	transform_scalar (m, in, out, i, end);
+}
+
+/*---------------------------------AVX2 KERNELS-------------------------------*/
+// points i..i+3 in the low lanes, i+4..i+7 in the high ones
+#define LOAD_POINTS_256(p, a, b, c) do { \
+	a = _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm_loadu_ps (p)), \
+		_mm_loadu_ps ((p) + 12), 1); \
+	b = _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm_loadu_ps ((p) + 4)), \
+		_mm_loadu_ps ((p) + 16), 1); \
+	c = _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm_loadu_ps ((p) + 8)), \
+		_mm_loadu_ps ((p) + 20), 1); \
+} while (0)
+
+__attribute__ ((target ("avx2")))
+static void box_avx2 (const float* p, size_t begin, size_t end, float* lo,
+	float* hi) {
+	size_t i = begin;
+	if (i + 8 <= end) {
+		__m256 lx = _mm256_set1_ps (lo[0]), hx = _mm256_set1_ps (hi[0]);
+		__m256 ly = _mm256_set1_ps (lo[1]), hy = _mm256_set1_ps (hi[1]);
+		__m256 lz = _mm256_set1_ps (lo[2]), hz = _mm256_set1_ps (hi[2]);
+		for (; i + 8 <= end; i += 8) {
+			__m256 a, b, c, x, y, z;
+			LOAD_POINTS_256 (p + i * 3, a, b, c);
+			DEINTERLEAVE (_mm256_shuffle_ps, __m256, a, b, c, x, y, z);
+			lx = _mm256_min_ps (lx, x);
+			ly = _mm256_min_ps (ly, y);
+			lz = _mm256_min_ps (lz, z);
+			hx = _mm256_max_ps (hx, x);
+			hy = _mm256_max_ps (hy, y);
+			hz = _mm256_max_ps (hz, z);
+		}
+		float l[3][8], h[3][8];
+		_mm256_storeu_ps (l[0], lx);
+		_mm256_storeu_ps (l[1], ly);
+		_mm256_storeu_ps (l[2], lz);
+		_mm256_storeu_ps (h[0], hx);
+		_mm256_storeu_ps (h[1], hy);
+		_mm256_storeu_ps (h[2], hz);
+		for (int k = 0; k < 3; k++) {
+			for (int j = 0; j < 8; j++) {
+				lo[k] = min_of (lo[k], l[k][j]);
+				hi[k] = max_of (hi[k], h[k][j]);
+			}
+		}
+	}
+	box_sse41 (p, i, end, lo, hi);
+}
+
+__attribute__ ((target ("avx2")))
+static float dist_avx2 (const float* p, size_t begin, size_t end,
+	const float* c, float best) {
+	size_t i = begin;
+	if (i + 8 <= end) {
+		const __m256 cx = _mm256_set1_ps (c[0]);
+		const __m256 cy = _mm256_set1_ps (c[1]);
+		const __m256 cz = _mm256_set1_ps (c[2]);
+		__m256 most = _mm256_set1_ps (best);
+		for (; i + 8 <= end; i += 8) {
+			__m256 a, b, cc, x, y, z;
+			LOAD_POINTS_256 (p + i * 3, a, b, cc);
+			DEINTERLEAVE (_mm256_shuffle_ps, __m256, a, b, cc, x, y, z);
+			__m256 dx = _mm256_sub_ps (x, cx);
+			__m256 dy = _mm256_sub_ps (y, cy);
+			__m256 dz = _mm256_sub_ps (z, cz);
+			__m256 d = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (dx, dx),
+				_mm256_mul_ps (dy, dy)), _mm256_mul_ps (dz, dz));
+			most = _mm256_max_ps (most, d);
+		}
+		float m[8];
+		_mm256_storeu_ps (m, most);
+		for (int j = 0; j < 8; j++) {
+			best = max_of (best, m[j]);
+		}
+	}
+	return dist_sse41 (p, i, end, c, best);
+}
+
+__attribute__ ((target ("avx2")))
+static void transform_avx2 (const mat4& m, const const_aabb_soa& in,
+	aabb_soa& out, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 lo[3], hi[3];
+		for (int k = 0; k < 3; k++) {
+			lo[k] = _mm256_loadu_ps (in.min[k] + i);
+			hi[k] = _mm256_loadu_ps (in.max[k] + i);
+		}
+		for (int row = 0; row < 3; row++) {
+			__m256 new_lo = _mm256_set1_ps (m.m[12 + row]), new_hi = new_lo;
+			for (int col = 0; col < 3; col++) {
+				__m256 e = _mm256_set1_ps (m.m[col * 4 + row]);
+				__m256 a = _mm256_mul_ps (e, lo[col]);
+				__m256 b = _mm256_mul_ps (e, hi[col]);
+				new_lo = _mm256_add_ps (new_lo, _mm256_min_ps (a, b));
+				new_hi = _mm256_add_ps (new_hi, _mm256_max_ps (a, b));
+			}
+			_mm256_storeu_ps (out.min[row] + i, new_lo);
+			_mm256_storeu_ps (out.max[row] + i, new_hi);
+		}
+	}
+	transform_sse41 (m, in, out, i, end);
+}
+
+/*-------------------------------AVX-512 KERNELS------------------------------*/
+/* 16 points, 4 to each 128-bit lane. fp-contract=off stops gcc fusing the
+distances and the transform into FMAs, which would round differently to the
+other levels. the maskz forms stop gcc 12 warning about its own undefined
+vectors, as in frustum.cpp */
+#define LOAD_POINTS_512(p, v, o) do { \
+	v = _mm512_insertf32x4 (_mm512_setzero_ps (), _mm_loadu_ps ((p) + (o)), 0); \
+	v = _mm512_insertf32x4 (v, _mm_loadu_ps ((p) + (o) + 12), 1); \
+	v = _mm512_insertf32x4 (v, _mm_loadu_ps ((p) + (o) + 24), 2); \
+	v = _mm512_insertf32x4 (v, _mm_loadu_ps ((p) + (o) + 36), 3); \
+} while (0)
+
+__attribute__ ((target ("avx512f")))
+static void box_avx512 (const float* p, size_t begin, size_t end, float* lo,
+	float* hi) {
+	size_t i = begin;
+	if (i + 16 <= end) {
+		__m512 lx = _mm512_set1_ps (lo[0]), hx = _mm512_set1_ps (hi[0]);
+		__m512 ly = _mm512_set1_ps (lo[1]), hy = _mm512_set1_ps (hi[1]);
+		__m512 lz = _mm512_set1_ps (lo[2]), hz = _mm512_set1_ps (hi[2]);
+		for (; i + 16 <= end; i += 16) {
+			__m512 a, b, c, x, y, z;
+			LOAD_POINTS_512 (p + i * 3, a, 0);
+			LOAD_POINTS_512 (p + i * 3, b, 4);
+			LOAD_POINTS_512 (p + i * 3, c, 8);
+			DEINTERLEAVE (_mm512_shuffle_ps, __m512, a, b, c, x, y, z);
+			lx = _mm512_maskz_min_ps (0xFFFF, lx, x);
+			ly = _mm512_maskz_min_ps (0xFFFF, ly, y);
+			lz = _mm512_maskz_min_ps (0xFFFF, lz, z);
+			hx = _mm512_maskz_max_ps (0xFFFF, hx, x);
+			hy = _mm512_maskz_max_ps (0xFFFF, hy, y);
+			hz = _mm512_maskz_max_ps (0xFFFF, hz, z);
+		}
+		float l[3][16], h[3][16];
+		_mm512_storeu_ps (l[0], lx);
+		_mm512_storeu_ps (l[1], ly);
+		_mm512_storeu_ps (l[2], lz);
+		_mm512_storeu_ps (h[0], hx);
+		_mm512_storeu_ps (h[1], hy);
+		_mm512_storeu_ps (h[2], hz);
+		for (int k = 0; k < 3; k++) {
+			for (int j = 0; j < 16; j++) {
+				lo[k] = min_of (lo[k], l[k][j]);
+				hi[k] = max_of (hi[k], h[k][j]);
+			}
+		}
+	}
+	box_avx2 (p, i, end, lo, hi);
+}
+
+__attribute__ ((target ("avx512f"), optimize ("fp-contract=off")))
+static float dist_avx512 (const float* p, size_t begin, size_t end,
+	const float* c, float best) {
+	size_t i = begin;
+	if (i + 16 <= end) {
+		const __m512 cx = _mm512_set1_ps (c[0]);
+		const __m512 cy = _mm512_set1_ps (c[1]);
+		const __m512 cz = _mm512_set1_ps (c[2]);
+		__m512 most = _mm512_set1_ps (best);
+		for (; i + 16 <= end; i += 16) {
+			__m512 a, b, cc, x, y, z;
+			LOAD_POINTS_512 (p + i * 3, a, 0);
+			LOAD_POINTS_512 (p + i * 3, b, 4);
+			LOAD_POINTS_512 (p + i * 3, cc, 8);
+			DEINTERLEAVE (_mm512_shuffle_ps, __m512, a, b, cc, x, y, z);
+			__m512 dx = _mm512_sub_ps (x, cx);
+			__m512 dy = _mm512_sub_ps (y, cy);
+			__m512 dz = _mm512_sub_ps (z, cz);
+			__m512 d = _mm512_add_ps (_mm512_add_ps (_mm512_mul_ps (dx, dx),
+				_mm512_mul_ps (dy, dy)), _mm512_mul_ps (dz, dz));
+			most = _mm512_maskz_max_ps (0xFFFF, most, d);
+		}
+		float m[16];
+		_mm512_storeu_ps (m, most);
+		for (int j = 0; j < 16; j++) {
+			best = max_of (best, m[j]);
+		}
+	}
+	return dist_avx2 (p, i, end, c, best);
+}
+
+__attribute__ ((target ("avx512f"), optimize ("fp-contract=off")))
+static void transform_avx512 (const mat4& m, const const_aabb_soa& in,
+	aabb_soa& out, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 16 <= end; i += 16) {
+		__m512 lo[3], hi[3];
+		for (int k = 0; k < 3; k++) {
+			lo[k] = _mm512_loadu_ps (in.min[k] + i);
+			hi[k] = _mm512_loadu_ps (in.max[k] + i);
+		}
+		for (int row = 0; row < 3; row++) {
+			__m512 new_lo = _mm512_set1_ps (m.m[12 + row]), new_hi = new_lo;
+			for (int col = 0; col < 3; col++) {
+				__m512 e = _mm512_set1_ps (m.m[col * 4 + row]);
+				__m512 a = _mm512_mul_ps (e, lo[col]);
+				__m512 b = _mm512_mul_ps (e, hi[col]);
+				new_lo = _mm512_add_ps (new_lo, _mm512_maskz_min_ps (0xFFFF, a, b));
+				new_hi = _mm512_add_ps (new_hi, _mm512_maskz_max_ps (0xFFFF, a, b));
+			}
+			_mm512_storeu_ps (out.min[row] + i, new_lo);
+			_mm512_storeu_ps (out.max[row] + i, new_hi);
+		}
+	}
+	transform_avx2 (m, in, out, i, end);
+}
+#endif
+
+/*----------------------------------DISPATCH----------------------------------*/
+static box_fn pick_box () {
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		case SIMD_AVX512: return box_avx512;
+		case SIMD_AVX2: return box_avx2;
+		case SIMD_SSE41: return box_sse41;
+		default: break;
+	}
+#endif
+	return box_scalar;
+}
+
+static dist_fn pick_dist () {
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		case SIMD_AVX512: return dist_avx512;
+		case SIMD_AVX2: return dist_avx2;
+		case SIMD_SSE41: return dist_sse41;
+		default: break;
+	}
+#endif
+	return dist_scalar;
+}
+
+static transform_fn pick_transform () {
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		case SIMD_AVX512: return transform_avx512;
+		case SIMD_AVX2: return transform_avx2;
+		case SIMD_SSE41: return transform_sse41;
+		default: break;
+	}
+#endif
+	return transform_scalar;
+}
+
+/*--------------------------------BUILDING------------------------------------*/
+aabb empty_aabb () {
+	aabb b;
+	b.min = vec3 (FLT_MAX, FLT_MAX, FLT_MAX);
+	b.max = vec3 (-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	return b;
+}
+
+bool aabb_is_empty (const aabb& b) {
+	return b.min.v[0] > b.max.v[0] || b.min.v[1] > b.max.v[1] ||
+		b.min.v[2] > b.max.v[2];
+}
+
+bounding_sphere empty_sphere () {
+	bounding_sphere s;
+	s.centre = vec3 (0.0f, 0.0f, 0.0f);
+	s.radius = -1.0f;
+	return s;
+}
+
+aabb aabb_from_points (const float* points, size_t count) {
+	aabb b = empty_aabb ();
+	pick_box () (points, 0, count, b.min.v, b.max.v);
+	// -0 and 0 tie, and which one wins depends on the level. always say 0
+	for (int k = 0; k < 3 && count > 0; k++) {
+		b.min.v[k] += 0.0f;
+		b.max.v[k] += 0.0f;
+	}
+	return b;
+}
+
+float max_point_distance (const float* points, size_t count,
+	const vec3& centre) {
+	if (0 == count) {
+		return 0.0f;
+	}
+	return radius_from_sq (pick_dist () (points, 0, count, centre.v, 0.0f));
+}
+
+bounding_sphere sphere_from_points (const float* points, size_t count) {
+	if (0 == count) {
+		return empty_sphere ();
+	}
+	aabb b = aabb_from_points (points, count);
+	bounding_sphere s;
+	for (int k = 0; k < 3; k++) {
+		s.centre.v[k] = (b.min.v[k] + b.max.v[k]) * 0.5f;
+	}
+	s.radius = max_point_distance (points, count, s.centre);
+	return s;
+}
+
+/*--------------------------------COMBINING-----------------------------------*/
+aabb aabb_merge (const aabb& a, const aabb& b) {
+	aabb r;
+	for (int k = 0; k < 3; k++) {
+		r.min.v[k] = min_of (a.min.v[k], b.min.v[k]);
+		r.max.v[k] = max_of (a.max.v[k], b.max.v[k]);
+	}
+	return r;
+}
+
+aabb aabb_add_point (const aabb& b, const vec3& p) {
+	aabb r;
+	for (int k = 0; k < 3; k++) {
+		r.min.v[k] = min_of (b.min.v[k], p.v[k]);
+		r.max.v[k] = max_of (b.max.v[k], p.v[k]);
+	}
+	return r;
+}
+
+bounding_sphere sphere_merge (const bounding_sphere& a,
+	const bounding_sphere& b) {
+	if (a.radius < 0.0f) {
+		return b;
+	}
+	if (b.radius < 0.0f) {
+		return a;
+	}
+	vec3 d = b.centre - a.centre;
+	float dist = length (d);
+	// one inside the other
+	if (dist + b.radius <= a.radius) {
+		return a;
+	}
+	if (dist + a.radius <= b.radius) {
+		return b;
+	}
+	// the new diameter runs from the far side of a to the far side of b
+	bounding_sphere s;
+	s.radius = (dist + a.radius + b.radius) * 0.5f;
+	s.centre = a.centre + d * ((s.radius - a.radius) / dist);
+	s.radius *= 1.0f + 4.0f * FLT_EPSILON;
+	return s;
+}
+
+aabb aabb_from_sphere (const bounding_sphere& s) {
+	if (s.radius < 0.0f) {
+		return empty_aabb ();
+	}
+	aabb b;
+	b.min = s.centre - s.radius;
+	b.max = s.centre + s.radius;
+	return b;
+}
+
+bounding_sphere sphere_from_aabb (const aabb& b) {
+	if (aabb_is_empty (b)) {
+		return empty_sphere ();
+	}
+	bounding_sphere s;
+	s.centre = (b.min + b.max) * 0.5f;
+	vec3 half = (b.max - b.min) * 0.5f;
+	s.radius = radius_from_sq (dot (half, half));
+	return s;
+}
+
+/*-------------------------------TRANSFORMING---------------------------------*/
+aabb aabb_transform (const aabb& b, const mat4& m) {
+	if (aabb_is_empty (b)) {
+		return b;
+	}
+	aabb r;
+	for (int row = 0; row < 3; row++) {
+		arvo_row (m, row, b.min.v, b.max.v, &r.min.v[row], &r.max.v[row]);
+	}
+	return r;
+}
+
+bounding_sphere sphere_transform (const bounding_sphere& s, const mat4& m) {
+	if (s.radius < 0.0f) {
+		return s;
+	}
+	bounding_sphere r;
+	for (int row = 0; row < 3; row++) {
+		r.centre.v[row] = m.m[row] * s.centre.v[0] + m.m[4 + row] * s.centre.v[1] +
+			m.m[8 + row] * s.centre.v[2] + m.m[12 + row];
+	}
+	// longest of the matrix's 3 axes
+	float scale_sq = 0.0f;
+	for (int col = 0; col < 3; col++) {
+		const float* a = m.m + col * 4;
+		scale_sq = max_of (scale_sq, a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+	}
+	r.radius = s.radius * radius_from_sq (scale_sq);
+	return r;
+}
+
+const_aabb_soa::const_aabb_soa () {
+	for (int k = 0; k < 3; k++) {
+		min[k] = max[k] = NULL;
+	}
+}
+
+const_aabb_soa::const_aabb_soa (const aabb_soa& b) {
+	for (int k = 0; k < 3; k++) {
+		min[k] = b.min[k];
+		max[k] = b.max[k];
+	}
+}
+
+void transform_aabbs (const mat4& m, const const_aabb_soa& in, aabb_soa& out,
+	size_t n) {
+	pick_transform () (m, in, out, 0, n);
+}
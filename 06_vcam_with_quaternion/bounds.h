@@ -0,0 +1,86 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Bounding volumes. Boxes (aabb) and spheres, built from the packed xyz point  |
+| arrays the obj loader gives you, merged, and moved by a mat4. Boxes go from  |
+| model to world space by Arvo's method ("Transforming Axis-Aligned Bounding   |
+| Boxes", Graphics Gems 1990): each new extent is a sum of the smaller and the |
+| bigger of matrix * old extent, so there's no need to transform 8 corners.    |
+| The result is exactly the box around the transformed box, for any affine     |
+| matrix (not a projection).                                                   |
+| Kernels use the CPU dispatch from maths_simd.h and every level gives the     |
+| same bits. Each call is one pass over its arrays, so, like frustum culling,  |
+| none of this uses the thread pool.                                           |
+\******************************************************************************/
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+#include "maths_funcs.h"
+#include <stddef.h>
+
+// an empty box has min > max, so merging anything into it gives that thing
+struct aabb {
+	vec3 min;
+	vec3 max;
+};
+
+// an empty sphere has a negative radius
+struct bounding_sphere {
+	vec3 centre;
+	float radius;
+};
+
+aabb empty_aabb ();
+bool aabb_is_empty (const aabb& b);
+bounding_sphere empty_sphere ();
+
+/* the box around count points, packed x, y, z as in obj_mesh::points. empty if
+count is 0. the points have to be finite */
+aabb aabb_from_points (const float* points, size_t count);
+/* the largest distance from centre to any of count points, rounded up so
+every point is inside a sphere of that radius */
+float max_point_distance (const float* points, size_t count,
+	const vec3& centre);
+/* a sphere centred on the points' box, reaching the furthest point. two
+passes. within sqrt(3) of the smallest sphere, and usually much closer */
+bounding_sphere sphere_from_points (const float* points, size_t count);
+
+aabb aabb_merge (const aabb& a, const aabb& b);
+aabb aabb_add_point (const aabb& b, const vec3& p);
+// the smallest sphere around both
+bounding_sphere sphere_merge (const bounding_sphere& a,
+	const bounding_sphere& b);
+aabb aabb_from_sphere (const bounding_sphere& s);
+bounding_sphere sphere_from_aabb (const aabb& b);
+
+// box around box b after affine matrix m. empty stays empty
+aabb aabb_transform (const aabb& b, const mat4& m);
+/* sphere s after affine matrix m. the radius is scaled by the longest axis of
+m, so a non-uniform scale gives a sphere around the ellipsoid */
+bounding_sphere sphere_transform (const bounding_sphere& s, const mat4& m);
+
+// n boxes, SoA: min[0] is the array of min x, max[2] of max z, and so on
+struct aabb_soa {
+	float* min[3];
+	float* max[3];
+};
+
+// read-only view of the same thing, so inputs can be passed as const
+struct const_aabb_soa {
+	const_aabb_soa ();
+	const_aabb_soa (const aabb_soa& b);
+	const float* min[3];
+	const float* max[3];
+};
+
+/* aabb_transform() on n boxes at once, e.g. to put a scene's model-space boxes
+into world space for cull_aabbs(). out may be the same arrays as in */
+void transform_aabbs (const mat4& m, const const_aabb_soa& in, aabb_soa& out,
+	size_t n);
+
+#endif
@@ -0,0 +1,382 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Float sin/cos/atan2. sin and cos reduce x to r in [-pi/4, pi/4] plus a       |
+| quadrant, subtracting pi/2 in three pieces (Cody-Waite) so r stays exact,    |
+| then run both Cephes polynomials and pick/negate by quadrant. atan2 folds    |
+| everything into atan (a) for a in [0, tan (pi/8)] and unfolds the angle.     |
+| The SIMD kernels do exactly the same float operations in the same order, so  |
+| every level gives the same bits.                                             |
+\******************************************************************************/
+#include "fast_trig.h"
+#include "maths_simd.h"
+#include "thread_pool.h"
+#include <string.h>
+#include <math.h>
+#if MATHS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define TWO_OVER_PI 0.636619772367581343f
+/* 1.5 * 2^23. adding it rounds a float to the nearest integer, which then sits
+in the low mantissa bits, so we get the quadrant without floor() or an int
+conversion that could overflow */
+#define ROUND_MAGIC 12582912.0f
+// pi/2 in three parts. the first two have few enough bits that q * part is
+// exact for the q we'll see with |x| <= 8192
+#define PIO2_1 1.5703125f
+#define PIO2_2 4.837512969970703125e-4f
+#define PIO2_3 7.54978995489188216e-8f
+// sin (r) = r + r^3 * (S1 + S2 r^2 + S3 r^4)
+#define SIN_1 -1.6666654611e-1f
+#define SIN_2 8.3321608736e-3f
+#define SIN_3 -1.9515295891e-4f
+// cos (r) = 1 - r^2 / 2 + r^4 * (C1 + C2 r^2 + C3 r^4)
+#define COS_1 4.166664568298827e-2f
+#define COS_2 -1.388731625493765e-3f
+#define COS_3 2.443315711809948e-5f
+// atan (a) = a + a^3 * (P0 + P1 a^2 + P2 a^4 + P3 a^6), for |a| <= tan (pi/8)
+#define ATAN_0 -3.33329491539e-1f
+#define ATAN_1 1.99777106478e-1f
+#define ATAN_2 -1.38776856032e-1f
+#define ATAN_3 8.05374449538e-2f
+#define TAN_PI_8 0.414213562373095f
+#define PI_4 0.785398163397448f
+#define PI_2 1.570796326794897f
+#define PI_1 3.141592653589793f
+
+/*----------------------------------SCALAR------------------------------------*/
+void fast_sincosf (float x, float* s, float* c) {
+	// nearest multiple of pi/2, and which quadrant that is, 0-3
+	float shifted = x * TWO_OVER_PI + ROUND_MAGIC;
+	float q = shifted - ROUND_MAGIC;
+	float r = x - q * PIO2_1 - q * PIO2_2 - q * PIO2_3;
+	float z = r * r;
+	float ps = r + ((SIN_3 * z + SIN_2) * z + SIN_1) * z * r;
+	float pc = ((COS_3 * z + COS_2) * z + COS_1) * z * z - 0.5f * z + 1.0f;
+	unsigned int qi;
+	memcpy (&qi, &shifted, sizeof (qi));
+	/* odd quadrants swap sin and cos. sin is negative in 2 and 3, cos in 1 and
+	2. done on the bits like the simd version, because branching on a random
+	quadrant costs more than the polynomials */
+	unsigned int bs, bc;
+	memcpy (&bs, &ps, sizeof (bs));
+	memcpy (&bc, &pc, sizeof (bc));
+	unsigned int swap = 0u - (qi & 1);
+	unsigned int rs = (bs & ~swap) | (bc & swap);
+	unsigned int rc = (bc & ~swap) | (bs & swap);
+	rs ^= (qi & 2) << 30;
+	rc ^= ((qi + 1) & 2) << 30;
+	memcpy (s, &rs, sizeof (rs));
+	memcpy (c, &rc, sizeof (rc));
+}
+
+float fast_sinf (float x) {
+	float s, c;
+	fast_sincosf (x, &s, &c);
+	return s;
+}
+
+float fast_cosf (float x) {
+	float s, c;
+	fast_sincosf (x, &s, &c);
+	return c;
+}
+
+float fast_tanf (float x) {
+	float s, c;
+	fast_sincosf (x, &s, &c);
+	return s / c;
+}
+
+float fast_atan2f (float y, float x) {
+	float ax = fabsf (x);
+	float ay = fabsf (y);
+	// a = the smaller over the bigger, so 0 <= a <= 1
+	float mx = ax > ay ? ax : ay;
+	float mn = ax < ay ? ax : ay;
+	float a = mx > 0.0f ? mn / mx : 0.0f;
+	// atan (a) = pi/4 + atan ((a - 1) / (a + 1)) gets us down to tan (pi/8)
+	float off = 0.0f;
+	if (a > TAN_PI_8) {
+		a = (a - 1.0f) / (a + 1.0f);
+		off = PI_4;
+	}
+	float z = a * a;
+	float p = ((ATAN_3 * z + ATAN_2) * z + ATAN_1) * z + ATAN_0;
+	float r = off + (p * z * a + a);
+	// unfold: swap the axes back, then the left half-plane, then below the x axis
+	if (ay > ax) {
+		r = PI_2 - r;
+	}
+	if (signbit (x)) {
+		r = PI_1 - r;
+	}
+	return copysignf (r, y);
+}
+
+/*-------------------------------BATCH KERNELS--------------------------------*/
+/* sin and cos come out of the same sum, so there is one kernel for both. the
+outputs that aren't wanted are NULL */
+struct trig_job {
+	const float* in;
+	const float* in2;
+	float* out;
+	float* out2;
+};
+
+typedef void (*trig_fn) (const trig_job& j, size_t begin, size_t end);
+
+static void sincos_scalar (const trig_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float s, c;
+		fast_sincosf (j.in[i], &s, &c);
+		if (j.out) {
+			j.out[i] = s;
+		}
+		if (j.out2) {
+			j.out2[i] = c;
+		}
+	}
+}
+
+static void atan2_scalar (const trig_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		j.out[i] = fast_atan2f (j.in[i], j.in2[i]);
+	}
+}
+
+#if MATHS_SIMD_X86
+__attribute__ ((target ("sse4.1")))
+static inline void sincos_sse41 (__m128 x, __m128* s, __m128* c) {
+	__m128 shifted = _mm_add_ps (_mm_mul_ps (x, _mm_set1_ps (TWO_OVER_PI)),
+		_mm_set1_ps (ROUND_MAGIC));
+	__m128 q = _mm_sub_ps (shifted, _mm_set1_ps (ROUND_MAGIC));
+	__m128 r = _mm_sub_ps (x, _mm_mul_ps (q, _mm_set1_ps (PIO2_1)));
+	r = _mm_sub_ps (r, _mm_mul_ps (q, _mm_set1_ps (PIO2_2)));
+	r = _mm_sub_ps (r, _mm_mul_ps (q, _mm_set1_ps (PIO2_3)));
+	__m128 z = _mm_mul_ps (r, r);
+	__m128 ps = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (SIN_3), z),
+		_mm_set1_ps (SIN_2));
+	ps = _mm_add_ps (_mm_mul_ps (ps, z), _mm_set1_ps (SIN_1));
+	ps = _mm_add_ps (r, _mm_mul_ps (_mm_mul_ps (ps, z), r));
+	__m128 pc = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (COS_3), z),
+		_mm_set1_ps (COS_2));
+	pc = _mm_add_ps (_mm_mul_ps (pc, z), _mm_set1_ps (COS_1));
+	pc = _mm_mul_ps (_mm_mul_ps (pc, z), z);
+	pc = _mm_sub_ps (pc, _mm_mul_ps (_mm_set1_ps (0.5f), z));
+	pc = _mm_add_ps (pc, _mm_set1_ps (1.0f));
+	__m128i qi = _mm_castps_si128 (shifted);
+	__m128 swap = _mm_castsi128_ps (_mm_cmpeq_epi32 (
+		_mm_and_si128 (qi, _mm_set1_epi32 (1)), _mm_set1_epi32 (1)));
+	__m128 rs = _mm_blendv_ps (ps, pc, swap);
+	__m128 rc = _mm_blendv_ps (pc, ps, swap);
+	// move bit 1 of the quadrant up to the sign bit
+	__m128 sign_s = _mm_castsi128_ps (_mm_slli_epi32 (
+		_mm_and_si128 (qi, _mm_set1_epi32 (2)), 30));
+	__m128 sign_c = _mm_castsi128_ps (_mm_slli_epi32 (_mm_and_si128 (
+		_mm_add_epi32 (qi, _mm_set1_epi32 (1)), _mm_set1_epi32 (2)), 30));
+	*s = _mm_xor_ps (rs, sign_s);
+	*c = _mm_xor_ps (rc, sign_c);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void sincos_kernel_sse41 (const trig_job& j, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 s, c;
+		sincos_sse41 (_mm_loadu_ps (j.in + i), &s, &c);
+		if (j.out) {
+			_mm_storeu_ps (j.out + i, s);
+		}
+		if (j.out2) {
+			_mm_storeu_ps (j.out2 + i, c);
+		}
+	}
+	sincos_scalar (j, i, end);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void atan2_kernel_sse41 (const trig_job& j, size_t begin, size_t end) {
+	const __m128 sign_bit = _mm_set1_ps (-0.0f);
+	const __m128 one = _mm_set1_ps (1.0f);
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 y = _mm_loadu_ps (j.in + i);
+		__m128 x = _mm_loadu_ps (j.in2 + i);
+		__m128 ax = _mm_andnot_ps (sign_bit, x);
+		__m128 ay = _mm_andnot_ps (sign_bit, y);
+		__m128 mx = _mm_max_ps (ax, ay);
+		__m128 mn = _mm_min_ps (ax, ay);
+		__m128 a = _mm_and_ps (_mm_div_ps (mn, mx),
+			_mm_cmpgt_ps (mx, _mm_setzero_ps ()));
+		__m128 big = _mm_cmpgt_ps (a, _mm_set1_ps (TAN_PI_8));
+		a = _mm_blendv_ps (a, _mm_div_ps (_mm_sub_ps (a, one), _mm_add_ps (a, one)),
+			big);
+		__m128 off = _mm_and_ps (big, _mm_set1_ps (PI_4));
+		__m128 z = _mm_mul_ps (a, a);
+		__m128 p = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (ATAN_3), z),
+			_mm_set1_ps (ATAN_2));
+		p = _mm_add_ps (_mm_mul_ps (p, z), _mm_set1_ps (ATAN_1));
+		p = _mm_add_ps (_mm_mul_ps (p, z), _mm_set1_ps (ATAN_0));
+		p = _mm_add_ps (_mm_mul_ps (_mm_mul_ps (p, z), a), a);
+		__m128 r = _mm_add_ps (off, p);
+		r = _mm_blendv_ps (r, _mm_sub_ps (_mm_set1_ps (PI_2), r),
+			_mm_cmpgt_ps (ay, ax));
+		// blendv only looks at the sign bit, which is just what we want of x
+		r = _mm_blendv_ps (r, _mm_sub_ps (_mm_set1_ps (PI_1), r), x);
+		r = _mm_or_ps (r, _mm_and_ps (y, sign_bit));
+		_mm_storeu_ps (j.out + i, r);
+	}
+	atan2_scalar (j, i, end);
+}
+
+__attribute__ ((target ("avx2")))
+static inline void sincos_avx2 (__m256 x, __m256* s, __m256* c) {
+	__m256 shifted = _mm256_add_ps (_mm256_mul_ps (x,
+		_mm256_set1_ps (TWO_OVER_PI)), _mm256_set1_ps (ROUND_MAGIC));
+	__m256 q = _mm256_sub_ps (shifted, _mm256_set1_ps (ROUND_MAGIC));
+	__m256 r = _mm256_sub_ps (x, _mm256_mul_ps (q, _mm256_set1_ps (PIO2_1)));
+	r = _mm256_sub_ps (r, _mm256_mul_ps (q, _mm256_set1_ps (PIO2_2)));
+	r = _mm256_sub_ps (r, _mm256_mul_ps (q, _mm256_set1_ps (PIO2_3)));
+	__m256 z = _mm256_mul_ps (r, r);
+	__m256 ps = _mm256_add_ps (_mm256_mul_ps (_mm256_set1_ps (SIN_3), z),
+		_mm256_set1_ps (SIN_2));
+	ps = _mm256_add_ps (_mm256_mul_ps (ps, z), _mm256_set1_ps (SIN_1));
+	ps = _mm256_add_ps (r, _mm256_mul_ps (_mm256_mul_ps (ps, z), r));
+	__m256 pc = _mm256_add_ps (_mm256_mul_ps (_mm256_set1_ps (COS_3), z),
+		_mm256_set1_ps (COS_2));
+	pc = _mm256_add_ps (_mm256_mul_ps (pc, z), _mm256_set1_ps (COS_1));
+	pc = _mm256_mul_ps (_mm256_mul_ps (pc, z), z);
+	pc = _mm256_sub_ps (pc, _mm256_mul_ps (_mm256_set1_ps (0.5f), z));
+	pc = _mm256_add_ps (pc, _mm256_set1_ps (1.0f));
+	__m256i qi = _mm256_castps_si256 (shifted);
+	__m256 swap = _mm256_castsi256_ps (_mm256_cmpeq_epi32 (
+		_mm256_and_si256 (qi, _mm256_set1_epi32 (1)), _mm256_set1_epi32 (1)));
+	__m256 rs = _mm256_blendv_ps (ps, pc, swap);
+	__m256 rc = _mm256_blendv_ps (pc, ps, swap);
+	__m256 sign_s = _mm256_castsi256_ps (_mm256_slli_epi32 (
+		_mm256_and_si256 (qi, _mm256_set1_epi32 (2)), 30));
+	__m256 sign_c = _mm256_castsi256_ps (_mm256_slli_epi32 (_mm256_and_si256 (
+		_mm256_add_epi32 (qi, _mm256_set1_epi32 (1)), _mm256_set1_epi32 (2)), 30));
+	*s = _mm256_xor_ps (rs, sign_s);
+	*c = _mm256_xor_ps (rc, sign_c);
+}
+
+__attribute__ ((target ("avx2")))
+static void sincos_kernel_avx2 (const trig_job& j, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 s, c;
+		sincos_avx2 (_mm256_loadu_ps (j.in + i), &s, &c);
+		if (j.out) {
+			_mm256_storeu_ps (j.out + i, s);
+		}
+		if (j.out2) {
+			_mm256_storeu_ps (j.out2 + i, c);
+		}
+	}
+	sincos_kernel_sse41 (j, i, end);
+}
+
+__attribute__ ((target ("avx2")))
+static void atan2_kernel_avx2 (const trig_job& j, size_t begin, size_t end) {
+	const __m256 sign_bit = _mm256_set1_ps (-0.0f);
+	const __m256 one = _mm256_set1_ps (1.0f);
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 y = _mm256_loadu_ps (j.in + i);
+		__m256 x = _mm256_loadu_ps (j.in2 + i);
+		__m256 ax = _mm256_andnot_ps (sign_bit, x);
+		__m256 ay = _mm256_andnot_ps (sign_bit, y);
+		__m256 mx = _mm256_max_ps (ax, ay);
+		__m256 mn = _mm256_min_ps (ax, ay);
+		__m256 a = _mm256_and_ps (_mm256_div_ps (mn, mx),
+			_mm256_cmp_ps (mx, _mm256_setzero_ps (), _CMP_GT_OQ));
+		__m256 big = _mm256_cmp_ps (a, _mm256_set1_ps (TAN_PI_8), _CMP_GT_OQ);
+		a = _mm256_blendv_ps (a, _mm256_div_ps (_mm256_sub_ps (a, one),
+			_mm256_add_ps (a, one)), big);
+		__m256 off = _mm256_and_ps (big, _mm256_set1_ps (PI_4));
+		__m256 z = _mm256_mul_ps (a, a);
+		__m256 p = _mm256_add_ps (_mm256_mul_ps (_mm256_set1_ps (ATAN_3), z),
+			_mm256_set1_ps (ATAN_2));
+		p = _mm256_add_ps (_mm256_mul_ps (p, z), _mm256_set1_ps (ATAN_1));
+		p = _mm256_add_ps (_mm256_mul_ps (p, z), _mm256_set1_ps (ATAN_0));
+		p = _mm256_add_ps (_mm256_mul_ps (_mm256_mul_ps (p, z), a), a);
+		__m256 r = _mm256_add_ps (off, p);
+		r = _mm256_blendv_ps (r, _mm256_sub_ps (_mm256_set1_ps (PI_2), r),
+			_mm256_cmp_ps (ay, ax, _CMP_GT_OQ));
+		r = _mm256_blendv_ps (r, _mm256_sub_ps (_mm256_set1_ps (PI_1), r), x);
+		r = _mm256_or_ps (r, _mm256_and_ps (y, sign_bit));
+		_mm256_storeu_ps (j.out + i, r);
+	}
+	atan2_kernel_sse41 (j, i, end);
+}
+#endif
+
+/*----------------------------------DISPATCH----------------------------------*/
+struct trig_task {
+	trig_job job;
+	trig_fn fn;
+};
+
+static void trig_range (void* ctx, size_t begin, size_t end) {
+	trig_task* task = (trig_task*)ctx;
+	task->fn (task->job, begin, end);
+}
+
+// avx-512 machines use the avx2 kernels. these are limited by the divides and
+// the polynomial chains, not width
+static void run (bool atan2, const trig_job& job, size_t n) {
+	trig_task task;
+	task.job = job;
+	task.fn = atan2 ? atan2_scalar : sincos_scalar;
+#if MATHS_SIMD_X86
+	simd_level level = get_simd_level ();
+	if (level >= SIMD_AVX2) {
+		task.fn = atan2 ? atan2_kernel_avx2 : sincos_kernel_avx2;
+	} else if (level >= SIMD_SSE41) {
+		task.fn = atan2 ? atan2_kernel_sse41 : sincos_kernel_sse41;
+	}
+#endif
+	parallel_for (n, TRIG_GRAIN, trig_range, &task);
+}
+
+void sin_batch (const float* in, float* out, size_t n) {
+	trig_job job;
+	memset (&job, 0, sizeof (job));
+	job.in = in;
+	job.out = out;
+	run (false, job, n);
+}
+
+void cos_batch (const float* in, float* out, size_t n) {
+	trig_job job;
+	memset (&job, 0, sizeof (job));
+	job.in = in;
+	job.out2 = out;
+	run (false, job, n);
+}
+
+void sincos_batch (const float* in, float* out_sin, float* out_cos, size_t n) {
+	trig_job job;
+	memset (&job, 0, sizeof (job));
+	job.in = in;
+	job.out = out_sin;
+	job.out2 = out_cos;
+	run (false, job, n);
+}
+
+void atan2_batch (const float* y, const float* x, float* out, size_t n) {
+	trig_job job;
+	memset (&job, 0, sizeof (job));
+	job.in = y;
+	job.in2 = x;
+	job.out = out;
+	run (true, job, n);
+}
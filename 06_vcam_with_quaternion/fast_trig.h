@@ -0,0 +1,42 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Float-precision sin, cos, tan and atan2. Polynomials after Cephes' sinf,     |
+| cosf and atanf, all in float, with no libm calls.                            |
+| Max abs error, measured against double-precision libm (see maths_bench.cpp): |
+|  sin, cos    1e-7 for |x| <= 8192 radians. further out the range reduction   |
+|              loses bits, so don't use these for huge angles                  |
+|  tan         3e-7 relative, for |x| <= 8192 where |cos (x)| > 0.01           |
+|  atan2       3e-7 (radians), any finite inputs. atan2 (0, 0) is 0            |
+| The _batch versions do whole arrays with SSE4.1/AVX2, using the dispatch in  |
+| maths_simd.h, and give exactly the same bits as the single-value ones.      |
+| Building with MATHS_FAST_TRIG (make MATHS_FAST_TRIG=1) makes maths_funcs use |
+| these instead of libm for rotations, headings, perspective() and versors.    |
+\******************************************************************************/
+#ifndef _FAST_TRIG_H_
+#define _FAST_TRIG_H_
+
+#include <stddef.h>
+
+// items per thread pool chunk
+#define TRIG_GRAIN 16384
+
+float fast_sinf (float x);
+float fast_cosf (float x);
+// both at once, for about the price of one
+void fast_sincosf (float x, float* s, float* c);
+float fast_tanf (float x);
+float fast_atan2f (float y, float x);
+
+// out[i] = fast_sinf (in[i]) etc. out may be the same array as in
+void sin_batch (const float* in, float* out, size_t n);
+void cos_batch (const float* in, float* out, size_t n);
+void sincos_batch (const float* in, float* out_sin, float* out_cos, size_t n);
+void atan2_batch (const float* y, const float* x, float* out, size_t n);
+
+#endif
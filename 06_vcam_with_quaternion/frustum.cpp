@@ -0,0 +1,519 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| View-frustum culling. Spheres and boxes share the same kernels: a box is     |
+| turned into its centre and half-size, and its "radius" against a plane is    |
+| the half-size projected onto the plane normal. Every kernel adds up the      |
+| plane distances in the same order, so all levels cull exactly the same       |
+| objects. Only the last_plane values they leave behind can differ.            |
+\******************************************************************************/
+#include "frustum.h"
+#include "maths_simd.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#if MATHS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*----------------------------------PLANES------------------------------------*/
+frustum frustum_from_mat4 (const mat4& m) {
+	frustum f;
+	memset (&f, 0, sizeof (f));
+	// row i of the column-major matrix is m[i], m[4 + i], m[8 + i], m[12 + i]
+	for (int p = 0; p < FRUSTUM_NUM_PLANES; p++) {
+		// left/right use row 0, bottom/top row 1, near/far row 2
+		int row = p / 2;
+		float sign = (p & 1) ? -1.0f : 1.0f;
+		float a = m.m[3] + sign * m.m[row];
+		float b = m.m[7] + sign * m.m[4 + row];
+		float c = m.m[11] + sign * m.m[8 + row];
+		float d = m.m[15] + sign * m.m[12 + row];
+		float len = sqrtf (a * a + b * b + c * c);
+		if (0.0f == len) {
+			fprintf (stderr, "WARNING. frustum plane %i is degenerate\n", p);
+			len = 1.0f;
+		}
+		f.a[p] = a / len;
+		f.b[p] = b / len;
+		f.c[p] = c / len;
+		f.d[p] = d / len;
+	}
+	return f;
+}
+
+/*-------------------------------SINGLE OBJECTS-------------------------------*/
+/* distance from plane p to a centre point, with the terms always added up in
+this order */
+static inline float plane_dist (const frustum& f, int p, float x, float y,
+	float z) {
+	return f.a[p] * x + f.b[p] * y + f.c[p] * z + f.d[p];
+}
+
+// half-size of a box, projected onto plane p's normal
+static inline float box_radius (const frustum& f, int p, float ex, float ey,
+	float ez) {
+	return fabsf (f.a[p]) * ex + fabsf (f.b[p]) * ey + fabsf (f.c[p]) * ez;
+}
+
+bool sphere_in_frustum (const frustum& f, const vec3& centre, float radius) {
+	for (int p = 0; p < FRUSTUM_NUM_PLANES; p++) {
+		if (plane_dist (f, p, centre.v[0], centre.v[1], centre.v[2]) < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool aabb_in_frustum (const frustum& f, const vec3& min, const vec3& max) {
+	float cx = (min.v[0] + max.v[0]) * 0.5f;
+	float cy = (min.v[1] + max.v[1]) * 0.5f;
+	float cz = (min.v[2] + max.v[2]) * 0.5f;
+	float ex = (max.v[0] - min.v[0]) * 0.5f;
+	float ey = (max.v[1] - min.v[1]) * 0.5f;
+	float ez = (max.v[2] - min.v[2]) * 0.5f;
+	for (int p = 0; p < FRUSTUM_NUM_PLANES; p++) {
+		if (plane_dist (f, p, cx, cy, cz) < -box_radius (f, p, ex, ey, ez)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*-------------------------------SCALAR KERNEL--------------------------------*/
+/* for spheres x/y/z are the centres and r the radii. for boxes r is NULL,
+x/y/z are the min corners and mx/my/mz the max corners */
+struct cull_job {
+	const frustum* f;
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* r;
+	const float* mx;
+	const float* my;
+	const float* mz;
+	unsigned char* last_plane;
+	unsigned int* visible;
+};
+
+/* culls items begin to end, appending to visible[] after the first count.
+returns the new count */
+typedef size_t (*cull_fn) (const cull_job& j, size_t begin, size_t end,
+	size_t count);
+
+// is item i completely outside plane p? ctr and ext from get_bounds()
+static inline bool outside (const cull_job& j, int p, const float* ctr,
+	const float* ext) {
+	float dist = plane_dist (*j.f, p, ctr[0], ctr[1], ctr[2]);
+	if (j.r) {
+		return dist < -ext[0];
+	}
+	return dist < -box_radius (*j.f, p, ext[0], ext[1], ext[2]);
+}
+
+// centre and half-size of item i. a sphere's radius goes in ext[0]
+static inline void get_bounds (const cull_job& j, size_t i, float* ctr,
+	float* ext) {
+	if (j.r) {
+		ctr[0] = j.x[i];
+		ctr[1] = j.y[i];
+		ctr[2] = j.z[i];
+		ext[0] = j.r[i];
+		return;
+	}
+	ctr[0] = (j.x[i] + j.mx[i]) * 0.5f;
+	ctr[1] = (j.y[i] + j.my[i]) * 0.5f;
+	ctr[2] = (j.z[i] + j.mz[i]) * 0.5f;
+	ext[0] = (j.mx[i] - j.x[i]) * 0.5f;
+	ext[1] = (j.my[i] - j.y[i]) * 0.5f;
+	ext[2] = (j.mz[i] - j.z[i]) * 0.5f;
+}
+
+static size_t cull_scalar (const cull_job& j, size_t begin, size_t end,
+	size_t count) {
+	for (size_t i = begin; i < end; i++) {
+		float ctr[3], ext[3];
+		get_bounds (j, i, ctr, ext);
+		// try whichever plane culled this one last time first
+		int first = j.last_plane ? j.last_plane[i] : 0;
+		if (first >= FRUSTUM_NUM_PLANES) {
+			first = 0;
+		}
+		if (outside (j, first, ctr, ext)) {
+			continue;
+		}
+		int p = 0;
+		for (; p < FRUSTUM_NUM_PLANES; p++) {
+			if (p != first && outside (j, p, ctr, ext)) {
+				break;
+			}
+		}
+		if (p < FRUSTUM_NUM_PLANES) {
+			if (j.last_plane) {
+				j.last_plane[i] = (unsigned char)p;
+			}
+			continue;
+		}
+		j.visible[count++] = (unsigned int)i;
+	}
+	return count;
+}
+
+#if MATHS_SIMD_X86
+/*--------------------------------SSE4.1 KERNEL-------------------------------*/
+/* 4 objects at a time. there's no cheap way to fetch a different plane for
+each lane, so the cached plane is only tried first when all 4 objects have
+the same one - usual enough, as neighbours tend to leave the view together */
+__attribute__ ((target ("sse4.1")))
+static size_t cull_sse41 (const cull_job& j, size_t begin, size_t end,
+	size_t count) {
+	const frustum& f = *j.f;
+	const __m128 sign_bit = _mm_set1_ps (-0.0f);
+	const __m128 half = _mm_set1_ps (0.5f);
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 cx, cy, cz, ex, ey, ez, r;
+		if (j.r) {
+			cx = _mm_loadu_ps (j.x + i);
+			cy = _mm_loadu_ps (j.y + i);
+			cz = _mm_loadu_ps (j.z + i);
+			r = _mm_loadu_ps (j.r + i);
+			ex = ey = ez = _mm_setzero_ps ();
+		} else {
+			__m128 x0 = _mm_loadu_ps (j.x + i), x1 = _mm_loadu_ps (j.mx + i);
+			__m128 y0 = _mm_loadu_ps (j.y + i), y1 = _mm_loadu_ps (j.my + i);
+			__m128 z0 = _mm_loadu_ps (j.z + i), z1 = _mm_loadu_ps (j.mz + i);
+			cx = _mm_mul_ps (_mm_add_ps (x0, x1), half);
+			cy = _mm_mul_ps (_mm_add_ps (y0, y1), half);
+			cz = _mm_mul_ps (_mm_add_ps (z0, z1), half);
+			ex = _mm_mul_ps (_mm_sub_ps (x1, x0), half);
+			ey = _mm_mul_ps (_mm_sub_ps (y1, y0), half);
+			ez = _mm_mul_ps (_mm_sub_ps (z1, z0), half);
+			r = _mm_setzero_ps ();
+		}
+		int first = -1;
+		if (j.last_plane) {
+			unsigned int lp;
+			memcpy (&lp, j.last_plane + i, 4);
+			unsigned int lp0 = lp & 0xFF;
+			if (lp == lp0 * 0x01010101u && lp0 < FRUSTUM_NUM_PLANES) {
+				first = (int)lp0;
+			}
+		}
+		__m128 rejected = _mm_setzero_ps ();
+		// lanes that stay visible keep the plane they had
+		__m128i plane_of = _mm_setzero_si128 ();
+		if (j.last_plane) {
+			int lp;
+			memcpy (&lp, j.last_plane + i, 4);
+			plane_of = _mm_cvtepu8_epi32 (_mm_cvtsi32_si128 (lp));
+		}
+		bool unchanged = false;
+		for (int k = -1; k < FRUSTUM_NUM_PLANES; k++) {
+			// k = -1 is the shared cached plane, if there is one
+			int p = k < 0 ? first : k;
+			if (p < 0 || (k >= 0 && p == first)) {
+				continue;
+			}
+			__m128 a = _mm_set1_ps (f.a[p]), b = _mm_set1_ps (f.b[p]);
+			__m128 c = _mm_set1_ps (f.c[p]), d = _mm_set1_ps (f.d[p]);
+			__m128 dist = _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (a, cx),
+				_mm_mul_ps (b, cy)), _mm_mul_ps (c, cz)), d);
+			__m128 rad = r;
+			if (!j.r) {
+				rad = _mm_add_ps (_mm_add_ps (
+					_mm_mul_ps (_mm_andnot_ps (sign_bit, a), ex),
+					_mm_mul_ps (_mm_andnot_ps (sign_bit, b), ey)),
+					_mm_mul_ps (_mm_andnot_ps (sign_bit, c), ez));
+			}
+			__m128 out = _mm_cmplt_ps (dist, _mm_xor_ps (rad, sign_bit));
+			__m128 fresh = _mm_andnot_ps (rejected, out);
+			plane_of = _mm_blendv_epi8 (plane_of, _mm_set1_epi32 (p),
+				_mm_castps_si128 (fresh));
+			rejected = _mm_or_ps (rejected, out);
+			if (0xF == _mm_movemask_ps (rejected)) {
+				// all culled by last frame's plane: nothing to write back
+				unchanged = k < 0;
+				break;
+			}
+		}
+		int rej = _mm_movemask_ps (rejected);
+		if (j.last_plane && !unchanged) {
+			__m128i packed = _mm_packus_epi32 (plane_of, plane_of);
+			int lp = _mm_cvtsi128_si32 (_mm_packus_epi16 (packed, packed));
+			memcpy (j.last_plane + i, &lp, 4);
+		}
+		int vis = ~rej & 0xF;
+		while (vis) {
+			int k = __builtin_ctz (vis);
+			j.visible[count++] = (unsigned int)(i + k);
+			vis &= vis - 1;
+		}
+	}
+	return cull_scalar (j, i, end, count);
+}
+
+/*---------------------------------AVX2 KERNEL--------------------------------*/
+/* 8 objects at a time. every lane fetches its own cached plane with a
+permute, and if that culls all 8 we're done with them */
+__attribute__ ((target ("avx2")))
+static size_t cull_avx2 (const cull_job& j, size_t begin, size_t end,
+	size_t count) {
+	const frustum& f = *j.f;
+	const __m256 sign_bit = _mm256_set1_ps (-0.0f);
+	const __m256 half = _mm256_set1_ps (0.5f);
+	const __m256 all_a = _mm256_load_ps (f.a), all_b = _mm256_load_ps (f.b);
+	const __m256 all_c = _mm256_load_ps (f.c), all_d = _mm256_load_ps (f.d);
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 cx, cy, cz, ex, ey, ez, r;
+		if (j.r) {
+			cx = _mm256_loadu_ps (j.x + i);
+			cy = _mm256_loadu_ps (j.y + i);
+			cz = _mm256_loadu_ps (j.z + i);
+			r = _mm256_loadu_ps (j.r + i);
+			ex = ey = ez = _mm256_setzero_ps ();
+		} else {
+			__m256 x0 = _mm256_loadu_ps (j.x + i), x1 = _mm256_loadu_ps (j.mx + i);
+			__m256 y0 = _mm256_loadu_ps (j.y + i), y1 = _mm256_loadu_ps (j.my + i);
+			__m256 z0 = _mm256_loadu_ps (j.z + i), z1 = _mm256_loadu_ps (j.mz + i);
+			cx = _mm256_mul_ps (_mm256_add_ps (x0, x1), half);
+			cy = _mm256_mul_ps (_mm256_add_ps (y0, y1), half);
+			cz = _mm256_mul_ps (_mm256_add_ps (z0, z1), half);
+			ex = _mm256_mul_ps (_mm256_sub_ps (x1, x0), half);
+			ey = _mm256_mul_ps (_mm256_sub_ps (y1, y0), half);
+			ez = _mm256_mul_ps (_mm256_sub_ps (z1, z0), half);
+			r = _mm256_setzero_ps ();
+		}
+		__m256 rejected = _mm256_setzero_ps ();
+		// lanes that stay visible keep the plane they had
+		__m256i plane_of = _mm256_setzero_si256 ();
+		if (j.last_plane) {
+			plane_of = _mm256_cvtepu8_epi32 (
+				_mm_loadl_epi64 ((const __m128i*)(j.last_plane + i)));
+		}
+		bool unchanged = false;
+		// the padding planes 6 and 7 are all zero, so they never cull
+		for (int p = -1; p < FRUSTUM_NUM_PLANES; p++) {
+			__m256 a, b, c, d;
+			__m256i which;
+			if (p < 0) {
+				if (!j.last_plane) {
+					continue;
+				}
+				which = plane_of;
+				a = _mm256_permutevar8x32_ps (all_a, which);
+				b = _mm256_permutevar8x32_ps (all_b, which);
+				c = _mm256_permutevar8x32_ps (all_c, which);
+				d = _mm256_permutevar8x32_ps (all_d, which);
+			} else {
+				which = _mm256_set1_epi32 (p);
+				a = _mm256_set1_ps (f.a[p]);
+				b = _mm256_set1_ps (f.b[p]);
+				c = _mm256_set1_ps (f.c[p]);
+				d = _mm256_set1_ps (f.d[p]);
+			}
+			__m256 dist = _mm256_add_ps (_mm256_add_ps (_mm256_add_ps (
+				_mm256_mul_ps (a, cx), _mm256_mul_ps (b, cy)),
+				_mm256_mul_ps (c, cz)), d);
+			__m256 rad = r;
+			if (!j.r) {
+				rad = _mm256_add_ps (_mm256_add_ps (
+					_mm256_mul_ps (_mm256_andnot_ps (sign_bit, a), ex),
+					_mm256_mul_ps (_mm256_andnot_ps (sign_bit, b), ey)),
+					_mm256_mul_ps (_mm256_andnot_ps (sign_bit, c), ez));
+			}
+			__m256 out = _mm256_cmp_ps (dist, _mm256_xor_ps (rad, sign_bit),
+				_CMP_LT_OQ);
+			__m256 fresh = _mm256_andnot_ps (rejected, out);
+			plane_of = _mm256_blendv_epi8 (plane_of, which,
+				_mm256_castps_si256 (fresh));
+			rejected = _mm256_or_ps (rejected, out);
+			if (0xFF == _mm256_movemask_ps (rejected)) {
+				unchanged = p < 0;
+				break;
+			}
+		}
+		int rej = _mm256_movemask_ps (rejected);
+		if (j.last_plane && !unchanged) {
+			__m128i packed = _mm_packus_epi32 (_mm256_castsi256_si128 (plane_of),
+				_mm256_extracti128_si256 (plane_of, 1));
+			_mm_storel_epi64 ((__m128i*)(j.last_plane + i),
+				_mm_packus_epi16 (packed, packed));
+		}
+		int vis = ~rej & 0xFF;
+		while (vis) {
+			int k = __builtin_ctz (vis);
+			j.visible[count++] = (unsigned int)(i + k);
+			vis &= vis - 1;
+		}
+	}
+	return cull_sse41 (j, i, end, count);
+}
+
+/*-------------------------------AVX-512 KERNEL-------------------------------*/
+/* 16 objects at a time, as AVX2, but the visible indices are written with
+one compress-store instead of a bit loop. fp-contract=off stops gcc fusing
+the plane distances into FMAs, which would cull slightly different objects to
+the other levels */
+__attribute__ ((target ("avx512f"), optimize ("fp-contract=off")))
+static size_t cull_avx512 (const cull_job& j, size_t begin, size_t end,
+	size_t count) {
+	const frustum& f = *j.f;
+	const __m512 half = _mm512_set1_ps (0.5f);
+	const __m512i abs_mask = _mm512_set1_epi32 (0x7FFFFFFF);
+	const __m512i sign_mask = _mm512_set1_epi32 ((int)0x80000000u);
+	// planes in the low 8 lanes, zeros above. zero planes never cull
+	const __m512 all_a = _mm512_maskz_loadu_ps (0xFF, f.a);
+	const __m512 all_b = _mm512_maskz_loadu_ps (0xFF, f.b);
+	const __m512 all_c = _mm512_maskz_loadu_ps (0xFF, f.c);
+	const __m512 all_d = _mm512_maskz_loadu_ps (0xFF, f.d);
+	const __m512i lane = _mm512_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+		11, 12, 13, 14, 15);
+	size_t i = begin;
+	for (; i + 16 <= end; i += 16) {
+		__m512 cx, cy, cz, ex, ey, ez, r;
+		if (j.r) {
+			cx = _mm512_loadu_ps (j.x + i);
+			cy = _mm512_loadu_ps (j.y + i);
+			cz = _mm512_loadu_ps (j.z + i);
+			r = _mm512_loadu_ps (j.r + i);
+			ex = ey = ez = _mm512_setzero_ps ();
+		} else {
+			__m512 x0 = _mm512_loadu_ps (j.x + i), x1 = _mm512_loadu_ps (j.mx + i);
+			__m512 y0 = _mm512_loadu_ps (j.y + i), y1 = _mm512_loadu_ps (j.my + i);
+			__m512 z0 = _mm512_loadu_ps (j.z + i), z1 = _mm512_loadu_ps (j.mz + i);
+			cx = _mm512_mul_ps (_mm512_add_ps (x0, x1), half);
+			cy = _mm512_mul_ps (_mm512_add_ps (y0, y1), half);
+			cz = _mm512_mul_ps (_mm512_add_ps (z0, z1), half);
+			ex = _mm512_mul_ps (_mm512_sub_ps (x1, x0), half);
+			ey = _mm512_mul_ps (_mm512_sub_ps (y1, y0), half);
+			ez = _mm512_mul_ps (_mm512_sub_ps (z1, z0), half);
+			r = _mm512_setzero_ps ();
+		}
+		__mmask16 rejected = 0;
+		// lanes that stay visible keep the plane they had. the maskz forms
+		// here and below stop gcc 12 warning about its own undefined vectors
+		__m512i plane_of = _mm512_setzero_si512 ();
+		if (j.last_plane) {
+			plane_of = _mm512_maskz_cvtepu8_epi32 (0xFFFF,
+				_mm_loadu_si128 ((const __m128i*)(j.last_plane + i)));
+		}
+		bool unchanged = false;
+		for (int p = -1; p < FRUSTUM_NUM_PLANES; p++) {
+			__m512 a, b, c, d;
+			__m512i which;
+			if (p < 0) {
+				if (!j.last_plane) {
+					continue;
+				}
+				// anything over 7 picks a zero plane from the top half
+				which = plane_of;
+				a = _mm512_maskz_permutexvar_ps (0xFFFF, which, all_a);
+				b = _mm512_maskz_permutexvar_ps (0xFFFF, which, all_b);
+				c = _mm512_maskz_permutexvar_ps (0xFFFF, which, all_c);
+				d = _mm512_maskz_permutexvar_ps (0xFFFF, which, all_d);
+			} else {
+				which = _mm512_set1_epi32 (p);
+				a = _mm512_set1_ps (f.a[p]);
+				b = _mm512_set1_ps (f.b[p]);
+				c = _mm512_set1_ps (f.c[p]);
+				d = _mm512_set1_ps (f.d[p]);
+			}
+			__m512 dist = _mm512_add_ps (_mm512_add_ps (_mm512_add_ps (
+				_mm512_mul_ps (a, cx), _mm512_mul_ps (b, cy)),
+				_mm512_mul_ps (c, cz)), d);
+			__m512 rad = r;
+			if (!j.r) {
+				// avx512f has no float and/xor, so do the abs on the integer side
+				__m512 abs_a = _mm512_castsi512_ps (_mm512_and_epi32 (
+					_mm512_castps_si512 (a), abs_mask));
+				__m512 abs_b = _mm512_castsi512_ps (_mm512_and_epi32 (
+					_mm512_castps_si512 (b), abs_mask));
+				__m512 abs_c = _mm512_castsi512_ps (_mm512_and_epi32 (
+					_mm512_castps_si512 (c), abs_mask));
+				rad = _mm512_add_ps (_mm512_add_ps (_mm512_mul_ps (abs_a, ex),
+					_mm512_mul_ps (abs_b, ey)), _mm512_mul_ps (abs_c, ez));
+			}
+			__m512 neg_rad = _mm512_castsi512_ps (_mm512_xor_epi32 (
+				_mm512_castps_si512 (rad), sign_mask));
+			__mmask16 out = _mm512_cmp_ps_mask (dist, neg_rad, _CMP_LT_OQ);
+			plane_of = _mm512_mask_mov_epi32 (plane_of, out & ~rejected, which);
+			rejected |= out;
+			if (0xFFFF == rejected) {
+				unchanged = p < 0;
+				break;
+			}
+		}
+		if (j.last_plane && !unchanged) {
+			_mm_storeu_si128 ((__m128i*)(j.last_plane + i),
+				_mm512_maskz_cvtepi32_epi8 (0xFFFF, plane_of));
+		}
+		__mmask16 vis = (__mmask16)~rejected;
+		__m512i idx = _mm512_add_epi32 (_mm512_set1_epi32 ((int)i), lane);
+		_mm512_mask_compressstoreu_epi32 (j.visible + count, vis, idx);
+		count += __builtin_popcount (vis);
+	}
+	return cull_avx2 (j, i, end, count);
+}
+#endif
+
+/*----------------------------------DISPATCH----------------------------------*/
+static size_t run (cull_job& job, size_t n) {
+	cull_fn fn = cull_scalar;
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		case SIMD_AVX512: fn = cull_avx512; break;
+		case SIMD_AVX2: fn = cull_avx2; break;
+		case SIMD_SSE41: fn = cull_sse41; break;
+		default: break;
+	}
+#endif
+	return fn (job, 0, n, 0);
+}
+
+size_t cull_spheres (
+	const frustum& f,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t n,
+	unsigned char* last_plane,
+	unsigned int* visible
+) {
+	cull_job job;
+	memset (&job, 0, sizeof (job));
+	job.f = &f;
+	job.x = x;
+	job.y = y;
+	job.z = z;
+	job.r = radius;
+	job.last_plane = last_plane;
+	job.visible = visible;
+	return run (job, n);
+}
+
+size_t cull_aabbs (
+	const frustum& f,
+	const float* min_x, const float* min_y, const float* min_z,
+	const float* max_x, const float* max_y, const float* max_z,
+	size_t n,
+	unsigned char* last_plane,
+	unsigned int* visible
+) {
+	cull_job job;
+	memset (&job, 0, sizeof (job));
+	job.f = &f;
+	job.x = min_x;
+	job.y = min_y;
+	job.z = min_z;
+	job.mx = max_x;
+	job.my = max_y;
+	job.mz = max_z;
+	job.last_plane = last_plane;
+	job.visible = visible;
+	return run (job, n);
+}
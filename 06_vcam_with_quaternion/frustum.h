@@ -0,0 +1,75 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| View-frustum culling.                                                        |
+| Get the 6 planes out of a proj * view matrix with frustum_from_mat4(), then  |
+| cull whole SoA arrays of bounding spheres or boxes in one call. You get back |
+| a packed list of the indices that are (maybe) visible, ready for the draw    |
+| loop. Tests are conservative: an object is only culled if it is completely  |
+| outside one plane, so big objects near a corner can still get through.       |
+| Temporal coherence: pass a last_plane array (one byte per object, zero it to |
+| start with) and the plane that culled each object last frame gets tried      |
+| first. Objects that stay off-screen then usually cost one plane, not six.    |
+| Kernels use the CPU dispatch from maths_simd.h. Culling is one pass over the |
+| arrays and writes a single output list, so it doesn't use the thread pool.   |
+\******************************************************************************/
+#ifndef _FRUSTUM_H_
+#define _FRUSTUM_H_
+
+#include "maths_funcs.h"
+#include <stddef.h>
+
+enum frustum_plane {
+	FRUSTUM_LEFT = 0,
+	FRUSTUM_RIGHT,
+	FRUSTUM_BOTTOM,
+	FRUSTUM_TOP,
+	FRUSTUM_NEAR,
+	FRUSTUM_FAR,
+	FRUSTUM_NUM_PLANES
+};
+
+/* plane i is a[i] * x + b[i] * y + c[i] * z + d[i] = 0, with (a, b, c)
+normalised and pointing into the frustum, so d is a distance. stored SoA and
+padded to 8 so a whole set of planes fits one AVX register */
+struct alignas (32) frustum {
+	float a[8];
+	float b[8];
+	float c[8];
+	float d[8];
+};
+
+/* extracts the planes from a clip matrix (Gribb & Hartmann). give it
+proj * view for world-space planes, or proj * view * model for object space */
+frustum frustum_from_mat4 (const mat4& m);
+
+// one object at a time. true if it's (maybe) visible
+bool sphere_in_frustum (const frustum& f, const vec3& centre, float radius);
+bool aabb_in_frustum (const frustum& f, const vec3& min, const vec3& max);
+
+/* n spheres in SoA arrays. writes the index of each visible one to visible[]
+(room for n), in order, and returns how many there were. last_plane may be
+NULL if you don't want the coherence */
+size_t cull_spheres (
+	const frustum& f,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t n,
+	unsigned char* last_plane,
+	unsigned int* visible
+);
+// same for n axis-aligned boxes, given by their min and max corners
+size_t cull_aabbs (
+	const frustum& f,
+	const float* min_x, const float* min_y, const float* min_z,
+	const float* max_x, const float* max_y, const float* max_z,
+	size_t n,
+	unsigned char* last_plane,
+	unsigned int* visible
+);
+
+#endif
@@ -9,12 +9,28 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include "obj_parser.h"
+#include "mesh_optimise.h"
+#include "mesh_simplify.h"
+#include "mesh_pack.h"
+#include "mesh_cluster.h"
+#include "asset_loader.h"
+#include "asset_registry.h"
+#include "frustum.h"
+#include "bounds.h"
+#include "transform_tree.h"
 
 #define MESH_FILE "sphere.obj"
 #define VERTEX_SHADER_FILE "test_vs.glsl"
 #define FRAGMENT_SHADER_FILE "test_fs.glsl"
 
 #define NUM_SPHERES 4
+// the coarsest lod is drawn whose error is under this many pixels on screen
+#define LOD_PIXEL_ERROR 1.0f
+// time each frame may spend handing loaded assets to GL
+#define ASSET_UPLOAD_BUDGET_MS 4.0
+// memory the asset registry keeps assets in before evicting
+#define CPU_ASSET_BUDGET (32 * 1024 * 1024)
+#define GPU_ASSET_BUDGET (128 * 1024 * 1024)
 
 /* create a unit quaternion q from an angle in degrees a, and an axis x,y,z */
 void create_versor (float* q, float a, float x, float y, float z) {
@@ -93,6 +109,21 @@ vec3 sphere_pos_wor[] = {
     vec3 (-2.0, 0.0, -2.0),
     vec3 (1.5, 1.0, -1.0)
 };
+// the same spheres as SoA bounding spheres, for culling. set from the mesh's bounds
+float sphere_x[NUM_SPHERES];
+float sphere_y[NUM_SPHERES];
+float sphere_z[NUM_SPHERES];
+float sphere_r[NUM_SPHERES];
+// plane that culled each sphere last frame - tried first next time
+unsigned char sphere_last_plane[NUM_SPHERES];
+// indices of the spheres that survived culling this frame
+unsigned int visible_spheres[NUM_SPHERES];
+/* the camera and the spheres live in a transform hierarchy, so world matrices
+are only rebuilt for what moved. the spheres hang off one root node */
+transform_tree scene;
+int cam_node;
+int spheres_node;
+int sphere_nodes[NUM_SPHERES];
 
 
 
@@ -102,50 +133,250 @@ int g_gl_width = 640;
 int g_gl_height = 480;
 GLFWwindow* g_window = NULL;
 
-int main() {
+/*--------------------------------ASSETS------------------------------------*/
+/* the mesh and the shaders live in the asset registry. they load on the asset
+ loader's threads, so the window is up and drawing straight away, and only the
+ gl calls at the end of each are left for the gl thread. once uploaded their
+ cpu copies can go to stay in budget, and anything evicted loads again */
+
+// everything needed to draw the mesh. zeroed until it has loaded
+struct mesh_asset {
+	// the cpu copy. gone once uploaded if the cpu budget needs the room
+	obj_mesh mesh;
+	packed_mesh packed;
+	// the meshlets stay for culling, only their index buffer copy is dropped
+	meshlet_set meshlets;
+	// the plane that culled each meshlet of each sphere last frame
+	unsigned char* meshlet_last_plane;
+	// what's left after culling, as one multi-draw
+	meshlet_range* meshlet_ranges;
+	GLsizei* range_counts;
+	const GLvoid** range_offsets;
+	// from the mesh, for drawing without it
+	obj_bounds bounds;
+	float lod_error[MAX_MESH_LODS];
+	int lod_count;
+	int index_size;
+	// where the full mesh and each lod are in the element buffer
+	int lod_first[MAX_MESH_LODS + 1];
+	int lod_index_count[MAX_MESH_LODS + 1];
+	GLenum index_type;
+	// the gpu copy
+	GLuint vao;
+	GLuint vertex_vbo;
+	GLuint index_vbo;
+};
 
-	assert(restart_gl_log());
-	assert(start_gl());
+// on a loader thread: parse, build lods and meshlets, and pack the vertices
+bool load_mesh_asset(const char* path, void* data) {
+	mesh_asset& a = *(mesh_asset*)data;
+	obj_mesh& mesh = a.mesh;
+	// shared vertices plus an index buffer, 16-bit when the mesh is small enough
+	if (!load_obj_file_indexed(path, mesh)) {
+		return false;
+	}
+	/* the first run builds the lods and saves them with the optimised mesh in
+	 the mesh cache, so later runs just map it */
+	if (0 == mesh.lod_count) {
+		// only the positions are drawn, so seams don't need keeping
+		const lod_target lod_targets[] = {
+			{ 0.5f, 0.0f }, { 0.25f, 0.0f }, { 0.1f, 0.0f }
+		};
+		// triangle order for the vertex cache, then vertices in the order they're used
+		if (!build_mesh_lods(mesh, lod_targets, 3, false) || !optimise_mesh(mesh)) {
+			return false;
+		}
+		save_mesh_cache(path, mesh);
+	}
+	a.bounds = mesh.bounds;
+	a.lod_count = mesh.lod_count;
+	for (int i = 0; i < mesh.lod_count; i++) {
+		a.lod_error[i] = mesh.lods[i].error;
+	}
+	a.index_size = mesh.index_size;
+	a.index_type = 2 == mesh.index_size ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	/* the full-detail mesh is drawn as meshlets, so the parts off screen or
+	 facing away can be skipped. the lods are small enough to draw whole */
+	if (!build_meshlets(mesh, a.meshlets)) {
+		return false;
+	}
+	printf("cut %s into %i meshlets\n", path, a.meshlets.meshlet_count);
+	int meshlet_count = a.meshlets.meshlet_count;
+	a.meshlet_last_plane = (unsigned char*)calloc(
+			NUM_SPHERES * meshlet_count + 1, 1);
+	a.meshlet_ranges = (meshlet_range*)malloc(
+			(meshlet_count + 1) * sizeof(meshlet_range));
+	a.range_counts = (GLsizei*)malloc((meshlet_count + 1) * sizeof(GLsizei));
+	a.range_offsets = (const GLvoid**)malloc(
+			(meshlet_count + 1) * sizeof(const GLvoid*));
+	if (!a.meshlet_last_plane || !a.meshlet_ranges || !a.range_counts ||
+			!a.range_offsets) {
+		fprintf(stderr, "ERROR: out of memory loading %s\n", path);
+		return false;
+	}
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
+	/* 12 bytes a vertex instead of 32: 16-bit positions in the mesh's box,
+	 8-bit octahedral normals and half float uvs, interleaved */
+	const vertex_format packed_format = {
+		PACK_POSITION_UNORM16, PACK_NORMAL_OCT8, PACK_UV_HALF
+	};
+	if (!pack_mesh_vertices(mesh, packed_format, a.packed)) {
+		return false;
+	}
+	pack_error packed_error = measure_pack_error(mesh, a.packed);
+	printf("packed vertices to %i bytes. error %g units, %.2f degrees, %g uv\n",
+			a.packed.stride, packed_error.position, packed_error.normal_degrees,
+			packed_error.uv);
+
+	/* the full mesh, in meshlet order, and each lod go one after another in
+	 the same element buffer */
+	a.lod_first[0] = 0;
+	a.lod_index_count[0] = mesh.index_count;
+	for (int i = 0; i < mesh.lod_count; i++) {
+		a.lod_first[i + 1] = a.lod_first[i] + a.lod_index_count[i];
+		a.lod_index_count[i + 1] = mesh.lods[i].index_count;
+	}
+	return true;
+}
+
+// on the gl thread: the buffers and the vao
+bool upload_mesh_asset(void* data) {
+	mesh_asset& a = *(mesh_asset*)data;
+	const obj_mesh& mesh = a.mesh;
+	const packed_mesh& packed = a.packed;
+	glGenVertexArrays(1, &a.vao);
+	glBindVertexArray(a.vao);
+
+	glGenBuffers(1, &a.vertex_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, a.vertex_vbo);
+	glBufferData(GL_ARRAY_BUFFER,
+			     packed.vertex_count * packed.stride,
+				 packed.vertices,
+				 GL_STATIC_DRAW);
+	for (int i = 0; i < PACKED_ATTRIBS; i++) {
+		const packed_attrib& at = packed.attribs[i];
+		glVertexAttribPointer(i, at.size, at.type, at.normalised ? GL_TRUE : GL_FALSE,
+				packed.stride, (const GLvoid*)(size_t)at.offset);
+		glEnableVertexAttribArray(i);
+	}
 
-	//--------------Create Geometry-------------------
-	GLfloat* vp = NULL;		// array of vertex points
-	GLfloat* vn = NULL;		// array of vertex normals
-	GLfloat* vt = NULL;		// array of texture coordinates
-	int point_count;
+	// the element buffer binding is part of the vao
+	int total_indices = a.lod_first[a.lod_count] + a.lod_index_count[a.lod_count];
+	glGenBuffers(1, &a.index_vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, a.index_vbo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+			     total_indices * a.index_size,
+				 NULL,
+				 GL_STATIC_DRAW);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
+			a.meshlets.index_count * a.meshlets.index_size, a.meshlets.indices);
+	for (int i = 0; i < a.lod_count; i++) {
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, a.lod_first[i + 1] * a.index_size,
+				a.lod_index_count[i + 1] * a.index_size, mesh.lods[i].indices);
+	}
+	glBindVertexArray(0);
+	return true;
+}
 
-	assert(load_obj_file(MESH_FILE, vp, vt, vn, point_count));
+void drop_mesh_cpu(void* data) {
+	mesh_asset& a = *(mesh_asset*)data;
+	free_obj_mesh(a.mesh);
+	// the unpacking uniforms are still needed
+	free(a.packed.vertices);
+	a.packed.vertices = NULL;
+	drop_meshlet_indices(a.meshlets);
+}
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	GLuint points_vbo;
-	if(NULL != vp){
-		glGenBuffers(1, &points_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-		glBufferData(GL_ARRAY_BUFFER,
-				     3 * point_count * sizeof(GLfloat),
-					 vp,
-					 GL_STATIC_DRAW);
-		glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,0,NULL);
-		glEnableVertexAttribArray(0);
+void drop_mesh_gpu(void* data) {
+	mesh_asset& a = *(mesh_asset*)data;
+	glDeleteVertexArrays(1, &a.vao);
+	glDeleteBuffers(1, &a.vertex_vbo);
+	glDeleteBuffers(1, &a.index_vbo);
+	a.vao = a.vertex_vbo = a.index_vbo = 0;
+}
+
+void unload_mesh(void* data) {
+	mesh_asset& a = *(mesh_asset*)data;
+	free(a.meshlet_last_plane);
+	free(a.meshlet_ranges);
+	free(a.range_counts);
+	free(a.range_offsets);
+	free_meshlets(a.meshlets);
+	free_packed_mesh(a.packed);
+	free_obj_mesh(a.mesh);
+	memset(&a, 0, sizeof(a));
+}
+
+void mesh_sizes(const void* data, size_t* cpu_bytes, size_t* gpu_bytes) {
+	const mesh_asset& a = *(const mesh_asset*)data;
+	const obj_mesh& mesh = a.mesh;
+	int meshlet_count = a.meshlets.meshlet_count;
+	size_t cpu = (size_t)meshlet_count * (sizeof(meshlet) + 4 * sizeof(float) +
+			NUM_SPHERES + sizeof(meshlet_range) + sizeof(GLsizei) +
+			sizeof(const GLvoid*));
+	if (a.meshlets.indices) {
+		cpu += (size_t)a.meshlets.index_count * a.meshlets.index_size;
 	}
+	if (a.packed.vertices) {
+		cpu += (size_t)a.packed.vertex_count * a.packed.stride;
+	}
+	if (mesh.points) {
+		cpu += (size_t)mesh.vertex_count * 8 * sizeof(float);
+		int index_count = mesh.index_count;
+		for (int i = 0; i < mesh.lod_count; i++) {
+			index_count += mesh.lods[i].index_count;
+		}
+		cpu += (size_t)index_count * mesh.index_size;
+	}
+	*cpu_bytes = cpu;
+	*gpu_bytes = 0;
+	if (a.vao) {
+		int total_indices = a.lod_first[a.lod_count] + a.lod_index_count[a.lod_count];
+		*gpu_bytes = (size_t)a.packed.vertex_count * a.packed.stride +
+				(size_t)total_indices * a.index_size;
+	}
+}
+
+const asset_type mesh_asset_type = {
+	"mesh", sizeof(mesh_asset), load_mesh_asset, upload_mesh_asset,
+	drop_mesh_cpu, drop_mesh_gpu, unload_mesh, mesh_sizes
+};
 
-	//-----------------Create Shaders----------------*/
-	char vertex_shader[1024 * 256];
-	char fragmet_shader[1024 * 256];
+// a vertex and a fragment shader, keyed by both files: "vertex.glsl,fragment.glsl"
+struct shader_asset {
+	char vertex_file[256];
+	char fragment_file[256];
+	text_asset vertex_text;
+	text_asset fragment_text;
+	GLuint programme;
+};
+
+// on a loader thread: read both files
+bool load_shader_asset(const char* path, void* data) {
+	shader_asset& a = *(shader_asset*)data;
+	const char* comma = strchr(path, ',');
+	if (!comma || (size_t)(comma - path) >= sizeof(a.vertex_file) ||
+			strlen(comma + 1) >= sizeof(a.fragment_file)) {
+		fprintf(stderr, "ERROR: %s is not \"vertex,fragment\" shader files\n", path);
+		return false;
+	}
+	memcpy(a.vertex_file, path, comma - path);
+	a.vertex_file[comma - path] = 0;
+	strcpy(a.fragment_file, comma + 1);
+	a.vertex_text.file_name = a.vertex_file;
+	a.fragment_text.file_name = a.fragment_file;
+	return load_text_asset(&a.vertex_text) && load_text_asset(&a.fragment_text);
+}
+
+// on the gl thread: compile and link
+bool upload_shader_asset(void* data) {
+	shader_asset& a = *(shader_asset*)data;
 	GLuint vs, fs, shader_programme;
 	const GLchar* p;
 	int params = -1;
-	// Load shaders from files here
-	assert(parse_file_into_str("test_vs.glsl", vertex_shader, 1024 * 256));
-	assert(parse_file_into_str("test_fs.glsl", fragmet_shader, 1024 * 256));
 
 	vs = glCreateShader(GL_VERTEX_SHADER);
-	p = (const GLchar*) vertex_shader;
+	p = (const GLchar*) a.vertex_text.text;
 	glShaderSource(vs, 1, &p, NULL);
 	glCompileShader(vs);
 
@@ -154,11 +385,12 @@ int main() {
 	if (GL_TRUE != params) {
 		fprintf(stderr, "ERROR: GL shader index %i did not compile\n", vs);
 		_print_shader_info_log(vs);
-		return 1; /* or exit or something */
+		glDeleteShader(vs);
+		return false;
 	}
 
 	fs = glCreateShader(GL_FRAGMENT_SHADER);
-	p = (const GLchar*) fragmet_shader;
+	p = (const GLchar*) a.fragment_text.text;
 	glShaderSource(fs, 1, &p, NULL);
 	glCompileShader(fs);
 
@@ -167,13 +399,18 @@ int main() {
 	if (GL_TRUE != params) {
 		fprintf(stderr, "ERROR: GL shader index %i did not compile\n", fs);
 		_print_shader_info_log(fs);
-		return 1; /* or exit or something */
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+		return false;
 	}
 
 	shader_programme = glCreateProgram();
 	glAttachShader(shader_programme, fs);
 	glAttachShader(shader_programme, vs);
 	glLinkProgram(shader_programme);
+	// the programme keeps them until it's deleted
+	glDeleteShader(vs);
+	glDeleteShader(fs);
 
 	/* check for shader linking errors - very important! */
 	glGetProgramiv(shader_programme, GL_LINK_STATUS, &params);
@@ -182,8 +419,62 @@ int main() {
 		stderr, "ERROR: could not link shader programme GL index %i\n",
 				shader_programme);
 		_print_programme_info_log(shader_programme);
-		return 1;
+		glDeleteProgram(shader_programme);
+		return false;
 	}
+	a.programme = shader_programme;
+	return true;
+}
+
+void drop_shader_cpu(void* data) {
+	shader_asset& a = *(shader_asset*)data;
+	free_text_asset(a.vertex_text);
+	free_text_asset(a.fragment_text);
+}
+
+void drop_shader_gpu(void* data) {
+	shader_asset& a = *(shader_asset*)data;
+	glDeleteProgram(a.programme);
+	a.programme = 0;
+}
+
+void unload_shader(void* data) {
+	shader_asset& a = *(shader_asset*)data;
+	drop_shader_cpu(data);
+	memset(&a, 0, sizeof(a));
+}
+
+// gl doesn't say how big a programme is, so it only counts against the cpu
+void shader_sizes(const void* data, size_t* cpu_bytes, size_t* gpu_bytes) {
+	const shader_asset& a = *(const shader_asset*)data;
+	*cpu_bytes = a.vertex_text.length + a.fragment_text.length;
+	*gpu_bytes = 0;
+}
+
+const asset_type shader_asset_type = {
+	"shader", sizeof(shader_asset), load_shader_asset, upload_shader_asset,
+	drop_shader_cpu, drop_shader_gpu, unload_shader, shader_sizes
+};
+
+int main() {
+
+	assert(restart_gl_log());
+	assert(start_gl());
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+
+	//--------------Start loading assets-------------------
+	/* both start loading in the background while the window is already
+	 drawing. they're drawn with once both have their gpu copies */
+	init_asset_registry(CPU_ASSET_BUDGET, GPU_ASSET_BUDGET);
+	registry_asset* mesh_ref = acquire_asset(MESH_FILE, &mesh_asset_type);
+	registry_asset* shader_ref = acquire_asset(
+			VERTEX_SHADER_FILE "," FRAGMENT_SHADER_FILE, &shader_asset_type);
+	assert(mesh_ref && shader_ref);
+	// the programme the uniform locations are from, 0 before there is one
+	GLuint bound_programme = 0;
+	bool spheres_placed = false;
 
 	glEnable(GL_CULL_FACE); // cull face
 	glCullFace(GL_BACK); // cull back face
@@ -203,26 +494,34 @@ int main() {
 	float Sy = near / range;
 	float Sz = -(far + near) / (far - near);
 	float Pz = -(2.0f * far * near) / (far - near);
-	GLfloat proj_mat[] = { Sx, 0.0f, 0.0f, 0.0f, 0.0f, Sy, 0.0f, 0.0f, 0.0f,
-			0.0f, Sz, -1.0f, 0.0f, 0.0f, Pz, 0.0f };
+	proj_mat = mat4(Sx, 0.0f, 0.0f, 0.0f, 0.0f, Sy, 0.0f, 0.0f, 0.0f,
+			0.0f, Sz, -1.0f, 0.0f, 0.0f, Pz, 0.0f);
 
 	/* create view matrix */
 	float cam_speed = 1.0f; // 1 unit per second
 	float cam_yaw_speed = 10.0f; // 10 degrees per second
 	float cam_pos[] = { 0.0f, 0.0f, 2.0f }; // don't start at zero, or we will be too close
 	float cam_yaw = 0.0f; // y-rotation in degrees
-	mat4 T = translate(identity_mat4(),
-			vec3(-cam_pos[0], -cam_pos[1], -cam_pos[2]));
-	mat4 R = rotate_y_deg(identity_mat4(), -cam_yaw);
-	mat4 view_mat = R * T;
-
-	/* get location numbers of matrices in shader */
-	GLint view_mat_location = glGetUniformLocation(shader_programme, "view");
-	GLint proj_mat_location = glGetUniformLocation(shader_programme, "proj");
-	/* use program (make current in state machine) and set default values */
-	glUseProgram(shader_programme);
-	glUniformMatrix4fv(view_mat_location, 1, GL_FALSE, view_mat.m);
-	glUniformMatrix4fv(proj_mat_location, 1, GL_FALSE, proj_mat);
+	assert(init_transform_tree(scene, NUM_SPHERES + 2));
+	cam_node = add_transform(scene, NO_TRANSFORM,
+			vec3(cam_pos[0], cam_pos[1], cam_pos[2]),
+			quat_from_axis_deg(cam_yaw, 0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f));
+	spheres_node = add_transform(scene, NO_TRANSFORM, vec3(0.0f, 0.0f, 0.0f),
+			quat_from_axis_deg(0.0f, 0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f));
+	for (int i = 0; i < NUM_SPHERES; i++) {
+		sphere_nodes[i] = add_transform(scene, spheres_node, sphere_pos_wor[i],
+				quat_from_axis_deg(0.0f, 0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f));
+	}
+	update_transforms(scene);
+	/* the view matrix is the inverse of the camera's world matrix, which is
+	 the same R * T as before but without building it from scratch */
+	view_mat = inverse_rigid(world_mat(scene, cam_node));
+
+	GLint view_mat_location = -1;
+	GLint model_mat_location = -1;
+	GLint pos_scale_location = -1;
+	GLint pos_offset_location = -1;
+	GLint normal_scale_location = -1;
 
 	while (!glfwWindowShouldClose(g_window)) {
 		_update_fps_counter(g_window);
@@ -236,11 +535,112 @@ int main() {
 		double elapsed_seconds = current_seconds - previous_seconds;
 		previous_seconds = current_seconds;
 
-		glUseProgram(shader_programme);
-		glBindVertexArray(vao);
-		/* draw points 0-3 from the currently bound VAO with current in-use
-		 shader */
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+		/* hand whatever has loaded over to gl, and keep to the memory budgets.
+		 until both assets have their gpu copies, the frame is just the clear
+		 colour */
+		update_asset_registry(ASSET_UPLOAD_BUDGET_MS);
+		if (asset_failed(mesh_ref) || asset_failed(shader_ref)) {
+			fprintf(stderr, "ERROR: could not load %s or the shaders\n", MESH_FILE);
+			break;
+		}
+		mesh_asset* mesh = (mesh_asset*)use_asset(mesh_ref);
+		shader_asset* shaders = (shader_asset*)use_asset(shader_ref);
+		if (mesh && !spheres_placed) {
+			// the loader found the mesh's bounding sphere. move it to each instance
+			bounding_sphere mesh_sphere;
+			mesh_sphere.centre = vec3(mesh->bounds.centre[0], mesh->bounds.centre[1],
+					mesh->bounds.centre[2]);
+			mesh_sphere.radius = mesh->bounds.radius;
+			for (int i = 0; i < NUM_SPHERES; i++) {
+				bounding_sphere s = sphere_transform(mesh_sphere,
+						world_mat(scene, sphere_nodes[i]));
+				sphere_x[i] = s.centre.v[0];
+				sphere_y[i] = s.centre.v[1];
+				sphere_z[i] = s.centre.v[2];
+				sphere_r[i] = s.radius;
+				sphere_last_plane[i] = 0;
+			}
+			spheres_placed = true;
+		}
+
+		if (mesh && shaders) {
+			const mesh_asset& sphere_mesh = *mesh;
+			GLuint shader_programme = shaders->programme;
+			/* use program (make current in state machine). a reloaded programme
+			 is a new one, so the locations are looked up again */
+			glUseProgram(shader_programme);
+			if (shader_programme != bound_programme) {
+				/* get location numbers of the uniforms in shader */
+				view_mat_location = glGetUniformLocation(shader_programme, "view");
+				model_mat_location = glGetUniformLocation(shader_programme, "model");
+				pos_scale_location = glGetUniformLocation(shader_programme,
+						"pos_scale");
+				pos_offset_location = glGetUniformLocation(shader_programme,
+						"pos_offset");
+				normal_scale_location = glGetUniformLocation(shader_programme,
+						"normal_scale");
+				glUniformMatrix4fv(glGetUniformLocation(shader_programme, "proj"), 1,
+						GL_FALSE, proj_mat.m);
+				bound_programme = shader_programme;
+			}
+			glUniformMatrix4fv(view_mat_location, 1, GL_FALSE, view_mat.m);
+			// how to unpack the vertices
+			const packed_mesh& packed = sphere_mesh.packed;
+			glUniform3fv(pos_scale_location, 1, packed.pos_scale);
+			glUniform3fv(pos_offset_location, 1, packed.pos_offset);
+			glUniform1f(normal_scale_location, packed.normal_scale);
+			glBindVertexArray(sphere_mesh.vao);
+			/* cull the spheres against the camera's frustum, then draw only the
+			 ones that might be on screen */
+			frustum frust = frustum_from_mat4(proj_mat * view_mat);
+			size_t visible_count = cull_spheres(frust, sphere_x, sphere_y, sphere_z,
+					sphere_r, NUM_SPHERES, sphere_last_plane, visible_spheres);
+			for (size_t i = 0; i < visible_count; i++) {
+				const mat4& model_mat = world_mat(scene,
+						sphere_nodes[visible_spheres[i]]);
+				glUniformMatrix4fv(model_mat_location, 1, GL_FALSE, model_mat.m);
+				/* an error of e at distance d is about e * proj[5] * height / 2d
+				 pixels tall */
+				const mat4& cam_mat = world_mat(scene, cam_node);
+				float dx = model_mat.m[12] - cam_mat.m[12];
+				float dy = model_mat.m[13] - cam_mat.m[13];
+				float dz = model_mat.m[14] - cam_mat.m[14];
+				float dist = sqrtf(dx * dx + dy * dy + dz * dz) + 1e-6f;
+				float px_per_unit = proj_mat.m[5] * g_gl_height * 0.5f / dist;
+				int lod = 0;
+				while (lod < sphere_mesh.lod_count &&
+						sphere_mesh.lod_error[lod] * px_per_unit < LOD_PIXEL_ERROR) {
+					lod++;
+				}
+				if (lod > 0) {
+					glDrawElements(GL_TRIANGLES, sphere_mesh.lod_index_count[lod],
+							sphere_mesh.index_type,
+							(const GLvoid*)(size_t)(sphere_mesh.lod_first[lod] *
+							sphere_mesh.index_size));
+					continue;
+				}
+				/* meshlets are culled in the mesh's own space: the frustum through
+				 the model matrix and the camera through its inverse */
+				frustum model_frust = frustum_from_mat4(proj_mat * view_mat * model_mat);
+				mat4 to_model = inverse_affine(model_mat);
+				vec4 eye = to_model * vec4(cam_mat.m[12], cam_mat.m[13], cam_mat.m[14],
+						1.0f);
+				int range_count = cull_meshlets(sphere_mesh.meshlets, model_frust,
+						vec3(eye.v[0], eye.v[1], eye.v[2]),
+						sphere_mesh.meshlet_last_plane +
+						visible_spheres[i] * sphere_mesh.meshlets.meshlet_count,
+						sphere_mesh.meshlet_ranges, NULL);
+				for (int r = 0; r < range_count; r++) {
+					sphere_mesh.range_counts[r] =
+						sphere_mesh.meshlet_ranges[r].index_count;
+					sphere_mesh.range_offsets[r] = (const GLvoid*)(size_t)(
+							sphere_mesh.meshlet_ranges[r].first_index *
+							sphere_mesh.meshlets.index_size);
+				}
+				glMultiDrawElements(GL_TRIANGLES, sphere_mesh.range_counts,
+						sphere_mesh.index_type, sphere_mesh.range_offsets, range_count);
+			}
+		}
 
 		// Update events like input
 		glfwPollEvents();
@@ -286,16 +686,24 @@ int main() {
 
 		/* update view matrix */
 		if (cam_moved) {
-			mat4 T = translate(identity_mat4(),
-					vec3(-cam_pos[0], -cam_pos[1], -cam_pos[2])); // cam translation
-			mat4 R = rotate_y_deg(identity_mat4(), -cam_yaw); //
-			mat4 view_mat = R * T;
-			glUniformMatrix4fv(view_mat_location, 1, GL_FALSE, view_mat.m);
+			set_transform(scene, cam_node, vec3(cam_pos[0], cam_pos[1], cam_pos[2]),
+					quat_from_axis_deg(cam_yaw, 0.0f, 1.0f, 0.0f),
+					vec3(1.0f, 1.0f, 1.0f));
+		}
+		// only the camera moves for now, so that's all this will recompute
+		if (update_transforms(scene)) {
+			view_mat = inverse_rigid(world_mat(scene, cam_node));
 		}
 		// put the stuff we ve been drawing onto the display
 		glfwSwapBuffers(g_window);
 	}
 
+	free_transform_tree(scene);
+	release_asset(mesh_ref);
+	release_asset(shader_ref);
+	// waits for a load still running, so its data can go
+	free_asset_registry();
+	stop_asset_loader();
 	// close GL context and any other GLFW resources
 	glfwTerminate();
 
@@ -0,0 +1,548 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Transform whole arrays of points/vectors by one mat4.                        |
+| Every kernel works out x' = m0*x + m4*y + m8*z (+ m12) in that order, which  |
+| is the same order as mat4 * vec4, so the SIMD and scalar versions agree bit  |
+| for bit. The AoS kernels shuffle 4 points at a time into SoA registers, do   |
+| the maths, then shuffle back. Wider ISAs just do that in every 128-bit lane. |
+\******************************************************************************/
+#include "maths_batch.h"
+#include "maths_simd.h"
+#include "thread_pool.h"
+#include <string.h>
+#include <math.h>
+#if MATHS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// AoS xyz kernel. w is 1 for points, 0 for vectors. norm re-normalises
+typedef void (*aos3_fn) (
+	const float* m, const float* in, float* out, size_t n, bool w, bool norm);
+// SoA xyz kernel. in and out are 3 pointers each
+typedef void (*soa3_fn) (
+	const float* m, const float* const* in, float* const* out, size_t n,
+	bool w, bool norm);
+// AoS xyzw kernel
+typedef void (*aos4_fn) (const float* m, const float* in, float* out, size_t n);
+
+/*-------------------------------SCALAR KERNELS-------------------------------*/
+static inline void xform3 (const float* m, float x, float y, float z, bool w,
+	bool norm, float* ox, float* oy, float* oz) {
+	float rx = m[0] * x + m[4] * y + m[8] * z;
+	float ry = m[1] * x + m[5] * y + m[9] * z;
+	float rz = m[2] * x + m[6] * y + m[10] * z;
+	if (w) {
+		rx += m[12];
+		ry += m[13];
+		rz += m[14];
+	}
+	if (norm) {
+		float l = sqrtf (rx * rx + ry * ry + rz * rz);
+		if (0.0f == l) {
+			rx = ry = rz = 0.0f;
+		} else {
+			rx = rx / l;
+			ry = ry / l;
+			rz = rz / l;
+		}
+	}
+	*ox = rx;
+	*oy = ry;
+	*oz = rz;
+}
+
+static void aos3_scalar (
+	const float* m, const float* in, float* out, size_t n, bool w, bool norm) {
+	for (size_t i = 0; i < n; i++) {
+		xform3 (m, in[i * 3], in[i * 3 + 1], in[i * 3 + 2], w, norm,
+			&out[i * 3], &out[i * 3 + 1], &out[i * 3 + 2]);
+	}
+}
+
+static void soa3_scalar (
+	const float* m, const float* const* in, float* const* out, size_t n,
+	bool w, bool norm) {
+	for (size_t i = 0; i < n; i++) {
+		xform3 (m, in[0][i], in[1][i], in[2][i], w, norm,
+			&out[0][i], &out[1][i], &out[2][i]);
+	}
+}
+
+static void aos4_scalar (const float* m, const float* in, float* out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		simd_mat4_mul_vec4 (m, in + i * 4, out + i * 4);
+	}
+}
+
+#if MATHS_SIMD_X86
+/*--------------------------------SSE4.1 KERNELS------------------------------*/
+/* mm holds m broadcast into registers: mm[0..2] is column 0 (m0,m1,m2),
+mm[3..5] column 1, mm[6..8] column 2, mm[9..11] the translation */
+__attribute__ ((target ("sse4.1")))
+static inline void xform3_sse41 (const __m128* mm, __m128& x, __m128& y,
+	__m128& z, bool w, bool norm) {
+	__m128 rx = _mm_add_ps (_mm_add_ps (
+		_mm_mul_ps (mm[0], x), _mm_mul_ps (mm[3], y)), _mm_mul_ps (mm[6], z));
+	__m128 ry = _mm_add_ps (_mm_add_ps (
+		_mm_mul_ps (mm[1], x), _mm_mul_ps (mm[4], y)), _mm_mul_ps (mm[7], z));
+	__m128 rz = _mm_add_ps (_mm_add_ps (
+		_mm_mul_ps (mm[2], x), _mm_mul_ps (mm[5], y)), _mm_mul_ps (mm[8], z));
+	if (w) {
+		rx = _mm_add_ps (rx, mm[9]);
+		ry = _mm_add_ps (ry, mm[10]);
+		rz = _mm_add_ps (rz, mm[11]);
+	}
+	if (norm) {
+		__m128 l = _mm_sqrt_ps (_mm_add_ps (_mm_add_ps (
+			_mm_mul_ps (rx, rx), _mm_mul_ps (ry, ry)), _mm_mul_ps (rz, rz)));
+		// zero-length stays zero rather than becoming NaN
+		__m128 ok = _mm_cmpgt_ps (l, _mm_setzero_ps ());
+		rx = _mm_and_ps (ok, _mm_div_ps (rx, l));
+		ry = _mm_and_ps (ok, _mm_div_ps (ry, l));
+		rz = _mm_and_ps (ok, _mm_div_ps (rz, l));
+	}
+	x = rx;
+	y = ry;
+	z = rz;
+}
+
+__attribute__ ((target ("sse4.1")))
+static void aos3_sse41 (
+	const float* m, const float* in, float* out, size_t n, bool w, bool norm) {
+	__m128 mm[12];
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 3; r++) {
+			mm[c * 3 + r] = _mm_set1_ps (m[c * 4 + r]);
+		}
+	}
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+		__m128 a = _mm_loadu_ps (in + i * 3);
+		__m128 b = _mm_loadu_ps (in + i * 3 + 4);
+		__m128 c = _mm_loadu_ps (in + i * 3 + 8);
+		__m128 ab = _mm_shuffle_ps (a, b, _MM_SHUFFLE (1, 0, 2, 1));
+		__m128 bc = _mm_shuffle_ps (b, c, _MM_SHUFFLE (2, 1, 3, 2));
+		__m128 x = _mm_shuffle_ps (a, bc, _MM_SHUFFLE (2, 0, 3, 0));
+		__m128 y = _mm_shuffle_ps (ab, bc, _MM_SHUFFLE (3, 1, 2, 0));
+		__m128 z = _mm_shuffle_ps (ab, c, _MM_SHUFFLE (3, 0, 3, 1));
+		xform3_sse41 (mm, x, y, z, w, norm);
+		// and back again
+		__m128 xy01 = _mm_shuffle_ps (x, y, _MM_SHUFFLE (1, 0, 1, 0));
+		__m128 zx01 = _mm_shuffle_ps (z, x, _MM_SHUFFLE (1, 0, 1, 0));
+		__m128 yz12 = _mm_shuffle_ps (y, z, _MM_SHUFFLE (2, 1, 2, 1));
+		__m128 xy23 = _mm_shuffle_ps (x, y, _MM_SHUFFLE (3, 2, 3, 2));
+		__m128 zx23 = _mm_shuffle_ps (z, x, _MM_SHUFFLE (3, 2, 3, 2));
+		__m128 yz23 = _mm_shuffle_ps (y, z, _MM_SHUFFLE (3, 2, 3, 2));
+		_mm_storeu_ps (out + i * 3,
+			_mm_shuffle_ps (xy01, zx01, _MM_SHUFFLE (3, 0, 2, 0)));
+		_mm_storeu_ps (out + i * 3 + 4,
+			_mm_shuffle_ps (yz12, xy23, _MM_SHUFFLE (2, 0, 2, 0)));
+		_mm_storeu_ps (out + i * 3 + 8,
+			_mm_shuffle_ps (zx23, yz23, _MM_SHUFFLE (3, 1, 3, 0)));
+	}
+	aos3_scalar (m, in + i * 3, out + i * 3, n - i, w, norm);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void soa3_sse41 (
+	const float* m, const float* const* in, float* const* out, size_t n,
+	bool w, bool norm) {
+	__m128 mm[12];
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 3; r++) {
+			mm[c * 3 + r] = _mm_set1_ps (m[c * 4 + r]);
+		}
+	}
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 x = _mm_loadu_ps (in[0] + i);
+		__m128 y = _mm_loadu_ps (in[1] + i);
+		__m128 z = _mm_loadu_ps (in[2] + i);
+		xform3_sse41 (mm, x, y, z, w, norm);
+		_mm_storeu_ps (out[0] + i, x);
+		_mm_storeu_ps (out[1] + i, y);
+		_mm_storeu_ps (out[2] + i, z);
+	}
+	const float* in_tail[3] = { in[0] + i, in[1] + i, in[2] + i };
+	float* out_tail[3] = { out[0] + i, out[1] + i, out[2] + i };
+	soa3_scalar (m, in_tail, out_tail, n - i, w, norm);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void aos4_sse41 (const float* m, const float* in, float* out, size_t n) {
+	__m128 c0 = _mm_loadu_ps (m);
+	__m128 c1 = _mm_loadu_ps (m + 4);
+	__m128 c2 = _mm_loadu_ps (m + 8);
+	__m128 c3 = _mm_loadu_ps (m + 12);
+	for (size_t i = 0; i < n; i++) {
+		__m128 v = _mm_loadu_ps (in + i * 4);
+		__m128 s = _mm_mul_ps (c0, _mm_shuffle_ps (v, v, 0x00));
+		s = _mm_add_ps (s, _mm_mul_ps (c1, _mm_shuffle_ps (v, v, 0x55)));
+		s = _mm_add_ps (s, _mm_mul_ps (c2, _mm_shuffle_ps (v, v, 0xAA)));
+		s = _mm_add_ps (s, _mm_mul_ps (c3, _mm_shuffle_ps (v, v, 0xFF)));
+		_mm_storeu_ps (out + i * 4, s);
+	}
+}
+
+/*---------------------------------AVX2 KERNELS-------------------------------*/
+__attribute__ ((target ("avx2")))
+static inline void xform3_avx2 (const __m256* mm, __m256& x, __m256& y,
+	__m256& z, bool w, bool norm) {
+	__m256 rx = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (mm[0], x),
+		_mm256_mul_ps (mm[3], y)), _mm256_mul_ps (mm[6], z));
+	__m256 ry = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (mm[1], x),
+		_mm256_mul_ps (mm[4], y)), _mm256_mul_ps (mm[7], z));
+	__m256 rz = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (mm[2], x),
+		_mm256_mul_ps (mm[5], y)), _mm256_mul_ps (mm[8], z));
+	if (w) {
+		rx = _mm256_add_ps (rx, mm[9]);
+		ry = _mm256_add_ps (ry, mm[10]);
+		rz = _mm256_add_ps (rz, mm[11]);
+	}
+	if (norm) {
+		__m256 l = _mm256_sqrt_ps (_mm256_add_ps (_mm256_add_ps (
+			_mm256_mul_ps (rx, rx), _mm256_mul_ps (ry, ry)),
+			_mm256_mul_ps (rz, rz)));
+		__m256 ok = _mm256_cmp_ps (l, _mm256_setzero_ps (), _CMP_GT_OQ);
+		rx = _mm256_and_ps (ok, _mm256_div_ps (rx, l));
+		ry = _mm256_and_ps (ok, _mm256_div_ps (ry, l));
+		rz = _mm256_and_ps (ok, _mm256_div_ps (rz, l));
+	}
+	x = rx;
+	y = ry;
+	z = rz;
+}
+
+// two 128-bit loads into the low and high lanes of one register
+__attribute__ ((target ("avx2")))
+static inline __m256 load_lanes (const float* lo, const float* hi) {
+	return _mm256_insertf128_ps (
+		_mm256_castps128_ps256 (_mm_loadu_ps (lo)), _mm_loadu_ps (hi), 1);
+}
+
+__attribute__ ((target ("avx2")))
+static inline void store_lanes (float* lo, float* hi, __m256 v) {
+	_mm_storeu_ps (lo, _mm256_castps256_ps128 (v));
+	_mm_storeu_ps (hi, _mm256_extractf128_ps (v, 1));
+}
+
+/* 8 points per loop: points 0-3 go in the low lanes and 4-7 in the high
+lanes, then it's the same in-lane shuffles as the sse version */
+__attribute__ ((target ("avx2")))
+static void aos3_avx2 (
+	const float* m, const float* in, float* out, size_t n, bool w, bool norm) {
+	__m256 mm[12];
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 3; r++) {
+			mm[c * 3 + r] = _mm256_set1_ps (m[c * 4 + r]);
+		}
+	}
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const float* p = in + i * 3;
+		__m256 a = load_lanes (p, p + 12);
+		__m256 b = load_lanes (p + 4, p + 16);
+		__m256 c = load_lanes (p + 8, p + 20);
+		__m256 ab = _mm256_shuffle_ps (a, b, _MM_SHUFFLE (1, 0, 2, 1));
+		__m256 bc = _mm256_shuffle_ps (b, c, _MM_SHUFFLE (2, 1, 3, 2));
+		__m256 x = _mm256_shuffle_ps (a, bc, _MM_SHUFFLE (2, 0, 3, 0));
+		__m256 y = _mm256_shuffle_ps (ab, bc, _MM_SHUFFLE (3, 1, 2, 0));
+		__m256 z = _mm256_shuffle_ps (ab, c, _MM_SHUFFLE (3, 0, 3, 1));
+		xform3_avx2 (mm, x, y, z, w, norm);
+		__m256 xy01 = _mm256_shuffle_ps (x, y, _MM_SHUFFLE (1, 0, 1, 0));
+		__m256 zx01 = _mm256_shuffle_ps (z, x, _MM_SHUFFLE (1, 0, 1, 0));
+		__m256 yz12 = _mm256_shuffle_ps (y, z, _MM_SHUFFLE (2, 1, 2, 1));
+		__m256 xy23 = _mm256_shuffle_ps (x, y, _MM_SHUFFLE (3, 2, 3, 2));
+		__m256 zx23 = _mm256_shuffle_ps (z, x, _MM_SHUFFLE (3, 2, 3, 2));
+		__m256 yz23 = _mm256_shuffle_ps (y, z, _MM_SHUFFLE (3, 2, 3, 2));
+		float* q = out + i * 3;
+		store_lanes (q, q + 12,
+			_mm256_shuffle_ps (xy01, zx01, _MM_SHUFFLE (3, 0, 2, 0)));
+		store_lanes (q + 4, q + 16,
+			_mm256_shuffle_ps (yz12, xy23, _MM_SHUFFLE (2, 0, 2, 0)));
+		store_lanes (q + 8, q + 20,
+			_mm256_shuffle_ps (zx23, yz23, _MM_SHUFFLE (3, 1, 3, 0)));
+	}
+	aos3_sse41 (m, in + i * 3, out + i * 3, n - i, w, norm);
+}
+
+__attribute__ ((target ("avx2")))
+static void soa3_avx2 (
+	const float* m, const float* const* in, float* const* out, size_t n,
+	bool w, bool norm) {
+	__m256 mm[12];
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 3; r++) {
+			mm[c * 3 + r] = _mm256_set1_ps (m[c * 4 + r]);
+		}
+	}
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps (in[0] + i);
+		__m256 y = _mm256_loadu_ps (in[1] + i);
+		__m256 z = _mm256_loadu_ps (in[2] + i);
+		xform3_avx2 (mm, x, y, z, w, norm);
+		_mm256_storeu_ps (out[0] + i, x);
+		_mm256_storeu_ps (out[1] + i, y);
+		_mm256_storeu_ps (out[2] + i, z);
+	}
+	const float* in_tail[3] = { in[0] + i, in[1] + i, in[2] + i };
+	float* out_tail[3] = { out[0] + i, out[1] + i, out[2] + i };
+	soa3_sse41 (m, in_tail, out_tail, n - i, w, norm);
+}
+
+// two vec4s per register
+__attribute__ ((target ("avx2")))
+static void aos4_avx2 (const float* m, const float* in, float* out, size_t n) {
+	__m256 c0 = _mm256_broadcast_ps ((const __m128*)m);
+	__m256 c1 = _mm256_broadcast_ps ((const __m128*)(m + 4));
+	__m256 c2 = _mm256_broadcast_ps ((const __m128*)(m + 8));
+	__m256 c3 = _mm256_broadcast_ps ((const __m128*)(m + 12));
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m256 v = _mm256_loadu_ps (in + i * 4);
+		__m256 s = _mm256_mul_ps (c0, _mm256_permute_ps (v, 0x00));
+		s = _mm256_add_ps (s, _mm256_mul_ps (c1, _mm256_permute_ps (v, 0x55)));
+		s = _mm256_add_ps (s, _mm256_mul_ps (c2, _mm256_permute_ps (v, 0xAA)));
+		s = _mm256_add_ps (s, _mm256_mul_ps (c3, _mm256_permute_ps (v, 0xFF)));
+		_mm256_storeu_ps (out + i * 4, s);
+	}
+	aos4_sse41 (m, in + i * 4, out + i * 4, n - i);
+}
+
+/*-------------------------------AVX-512 KERNELS------------------------------*/
+// contraction off for the same reason as in maths_simd.cpp
+__attribute__ ((target ("avx512f"), optimize ("fp-contract=off")))
+static void soa3_avx512 (
+	const float* m, const float* const* in, float* const* out, size_t n,
+	bool w, bool norm) {
+	__m512 mm[12];
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 3; r++) {
+			mm[c * 3 + r] = _mm512_set1_ps (m[c * 4 + r]);
+		}
+	}
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512 x = _mm512_loadu_ps (in[0] + i);
+		__m512 y = _mm512_loadu_ps (in[1] + i);
+		__m512 z = _mm512_loadu_ps (in[2] + i);
+		__m512 rx = _mm512_add_ps (_mm512_add_ps (_mm512_mul_ps (mm[0], x),
+			_mm512_mul_ps (mm[3], y)), _mm512_mul_ps (mm[6], z));
+		__m512 ry = _mm512_add_ps (_mm512_add_ps (_mm512_mul_ps (mm[1], x),
+			_mm512_mul_ps (mm[4], y)), _mm512_mul_ps (mm[7], z));
+		__m512 rz = _mm512_add_ps (_mm512_add_ps (_mm512_mul_ps (mm[2], x),
+			_mm512_mul_ps (mm[5], y)), _mm512_mul_ps (mm[8], z));
+		if (w) {
+			rx = _mm512_add_ps (rx, mm[9]);
+			ry = _mm512_add_ps (ry, mm[10]);
+			rz = _mm512_add_ps (rz, mm[11]);
+		}
+		if (norm) {
+			// maskz form only to dodge gcc 12's -Wuninitialized, see maths_simd.cpp
+			__m512 l = _mm512_maskz_sqrt_ps (0xFFFF, _mm512_add_ps (_mm512_add_ps (
+				_mm512_mul_ps (rx, rx), _mm512_mul_ps (ry, ry)),
+				_mm512_mul_ps (rz, rz)));
+			__mmask16 ok = _mm512_cmp_ps_mask (l, _mm512_setzero_ps (), _CMP_GT_OQ);
+			rx = _mm512_maskz_div_ps (ok, rx, l);
+			ry = _mm512_maskz_div_ps (ok, ry, l);
+			rz = _mm512_maskz_div_ps (ok, rz, l);
+		}
+		_mm512_storeu_ps (out[0] + i, rx);
+		_mm512_storeu_ps (out[1] + i, ry);
+		_mm512_storeu_ps (out[2] + i, rz);
+	}
+	const float* in_tail[3] = { in[0] + i, in[1] + i, in[2] + i };
+	float* out_tail[3] = { out[0] + i, out[1] + i, out[2] + i };
+	soa3_avx2 (m, in_tail, out_tail, n - i, w, norm);
+}
+#endif
+
+/*----------------------------------DISPATCH----------------------------------*/
+static aos3_fn pick_aos3 () {
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		// 16 AoS points would need cross-lane shuffles, avx2 is the sweet spot
+		case SIMD_AVX512:
+		case SIMD_AVX2: return aos3_avx2;
+		case SIMD_SSE41: return aos3_sse41;
+		default: break;
+	}
+#endif
+	return aos3_scalar;
+}
+
+static soa3_fn pick_soa3 () {
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		case SIMD_AVX512: return soa3_avx512;
+		case SIMD_AVX2: return soa3_avx2;
+		case SIMD_SSE41: return soa3_sse41;
+		default: break;
+	}
+#endif
+	return soa3_scalar;
+}
+
+static aos4_fn pick_aos4 () {
+#if MATHS_SIMD_X86
+	switch (get_simd_level ()) {
+		case SIMD_AVX512:
+		case SIMD_AVX2: return aos4_avx2;
+		case SIMD_SSE41: return aos4_sse41;
+		default: break;
+	}
+#endif
+	return aos4_scalar;
+}
+
+/*-------------------------------THREADED DRIVERS-----------------------------*/
+struct batch_job {
+	float m[16];
+	const float* in[3];
+	float* out[3];
+	bool w;
+	bool norm;
+	aos3_fn aos3;
+	soa3_fn soa3;
+	aos4_fn aos4;
+};
+
+static void aos3_range (void* ctx, size_t begin, size_t end) {
+	batch_job* job = (batch_job*)ctx;
+	job->aos3 (job->m, job->in[0] + begin * 3, job->out[0] + begin * 3,
+		end - begin, job->w, job->norm);
+}
+
+static void soa3_range (void* ctx, size_t begin, size_t end) {
+	batch_job* job = (batch_job*)ctx;
+	const float* in[3] = {
+		job->in[0] + begin, job->in[1] + begin, job->in[2] + begin
+	};
+	float* out[3] = {
+		job->out[0] + begin, job->out[1] + begin, job->out[2] + begin
+	};
+	job->soa3 (job->m, in, out, end - begin, job->w, job->norm);
+}
+
+static void aos4_range (void* ctx, size_t begin, size_t end) {
+	batch_job* job = (batch_job*)ctx;
+	job->aos4 (job->m, job->in[0] + begin * 4, job->out[0] + begin * 4,
+		end - begin);
+}
+
+static void run_aos3 (const mat4& m, const float* in, float* out, size_t n,
+	bool w, bool norm) {
+	batch_job job;
+	memcpy (job.m, m.m, sizeof (job.m));
+	job.in[0] = in;
+	job.out[0] = out;
+	job.w = w;
+	job.norm = norm;
+	job.aos3 = pick_aos3 ();
+	parallel_for (n, BATCH_GRAIN, aos3_range, &job);
+}
+
+static void run_soa3 (const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z, size_t n, bool w, bool norm) {
+	batch_job job;
+	memcpy (job.m, m.m, sizeof (job.m));
+	job.in[0] = in_x;
+	job.in[1] = in_y;
+	job.in[2] = in_z;
+	job.out[0] = out_x;
+	job.out[1] = out_y;
+	job.out[2] = out_z;
+	job.w = w;
+	job.norm = norm;
+	job.soa3 = pick_soa3 ();
+	parallel_for (n, BATCH_GRAIN, soa3_range, &job);
+}
+
+/*---------------------------------PUBLIC API---------------------------------*/
+/* inverse-transpose of the top-left 3x3 is its cofactor matrix over the
+determinant. we re-normalise afterwards anyway so the scale barely matters, but
+dividing keeps it a proper inverse-transpose for anyone who wants the matrix */
+mat4 normal_matrix (const mat4& m) {
+	const float* a = m.m;
+	float c00 = a[5] * a[10] - a[6] * a[9];
+	float c01 = a[6] * a[8] - a[4] * a[10];
+	float c02 = a[4] * a[9] - a[5] * a[8];
+	float c10 = a[2] * a[9] - a[1] * a[10];
+	float c11 = a[0] * a[10] - a[2] * a[8];
+	float c12 = a[1] * a[8] - a[0] * a[9];
+	float c20 = a[1] * a[6] - a[2] * a[5];
+	float c21 = a[2] * a[4] - a[0] * a[6];
+	float c22 = a[0] * a[5] - a[1] * a[4];
+	float det = a[0] * c00 + a[1] * c01 + a[2] * c02;
+	float inv_det = 0.0f == det ? 1.0f : 1.0f / det;
+	mat4 r = identity_mat4 ();
+	// cij is the cofactor of element (j, i), i.e. already the transpose
+	r.m[0] = c00 * inv_det;
+	r.m[1] = c01 * inv_det;
+	r.m[2] = c02 * inv_det;
+	r.m[4] = c10 * inv_det;
+	r.m[5] = c11 * inv_det;
+	r.m[6] = c12 * inv_det;
+	r.m[8] = c20 * inv_det;
+	r.m[9] = c21 * inv_det;
+	r.m[10] = c22 * inv_det;
+	return r;
+}
+
+void transform_points (const mat4& m, const float* in, float* out, size_t n) {
+	run_aos3 (m, in, out, n, true, false);
+}
+
+void transform_vectors (const mat4& m, const float* in, float* out, size_t n) {
+	run_aos3 (m, in, out, n, false, false);
+}
+
+void transform_normals (const mat4& m, const float* in, float* out, size_t n) {
+	run_aos3 (normal_matrix (m), in, out, n, false, true);
+}
+
+void transform_vec4s (const mat4& m, const float* in, float* out, size_t n) {
+	batch_job job;
+	memcpy (job.m, m.m, sizeof (job.m));
+	job.in[0] = in;
+	job.out[0] = out;
+	job.aos4 = pick_aos4 ();
+	parallel_for (n, BATCH_GRAIN, aos4_range, &job);
+}
+
+void transform_points_soa (
+	const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z,
+	size_t n
+) {
+	run_soa3 (m, in_x, in_y, in_z, out_x, out_y, out_z, n, true, false);
+}
+
+void transform_vectors_soa (
+	const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z,
+	size_t n
+) {
+	run_soa3 (m, in_x, in_y, in_z, out_x, out_y, out_z, n, false, false);
+}
+
+void transform_normals_soa (
+	const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z,
+	size_t n
+) {
+	run_soa3 (normal_matrix (m), in_x, in_y, in_z, out_x, out_y, out_z, n,
+		false, true);
+}
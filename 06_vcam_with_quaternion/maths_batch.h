@@ -0,0 +1,61 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Transform whole arrays of points/vectors by one mat4.                        |
+| Use these instead of a loop of mat4 * vec4 when pre-transforming a mesh on   |
+| the CPU (bounds, picking, baking...). Two layouts are supported:             |
+|  AoS - xyzxyzxyz... exactly what load_obj_file() gives you                   |
+|  SoA - separate x[], y[], z[] arrays. faster, SIMD likes these best          |
+| Kernels are picked with the same CPU dispatch as maths_simd.h, and arrays    |
+| bigger than BATCH_GRAIN items are split across the thread pool.              |
+| 'in' and 'out' may be the same array, but must not partly overlap.           |
+\******************************************************************************/
+#ifndef _MATHS_BATCH_H_
+#define _MATHS_BATCH_H_
+
+#include "maths_funcs.h"
+#include <stddef.h>
+
+// items per thread pool chunk
+#define BATCH_GRAIN 16384
+
+/*---------------------------------AoS STREAMS--------------------------------*/
+// n points of 3 floats each, w taken as 1. good for affine matrices
+void transform_points (const mat4& m, const float* in, float* out, size_t n);
+// n directions of 3 floats each, w taken as 0 (translation ignored)
+void transform_vectors (const mat4& m, const float* in, float* out, size_t n);
+/* n normals of 3 floats each, multiplied by the inverse-transpose of m's top
+3x3 and re-normalised, so they stay perpendicular under non-uniform scale */
+void transform_normals (const mat4& m, const float* in, float* out, size_t n);
+// n full vec4s (xyzw), e.g. for clip-space positions with a projection
+void transform_vec4s (const mat4& m, const float* in, float* out, size_t n);
+
+/*---------------------------------SoA STREAMS--------------------------------*/
+void transform_points_soa (
+	const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z,
+	size_t n
+);
+void transform_vectors_soa (
+	const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z,
+	size_t n
+);
+void transform_normals_soa (
+	const mat4& m,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z,
+	size_t n
+);
+
+// the 3x3 inverse-transpose used for normals, in the top-left of a mat4
+mat4 normal_matrix (const mat4& m);
+
+#endif
@@ -0,0 +1,1194 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Benchmark and accuracy check for the matrix inverses and batched versors.    |
+| No GL needed. build with "make bench" and run ./maths_bench                  |
+| Each fast inverse is timed against inverse() on the kind of matrix it is     |
+| meant for. Both are compared with a double-precision inverse, and we exit    |
+| with 1 if a fast one is less accurate than it should be. The versor batches  |
+| are timed against a loop of the single-versor functions, and slerp is held   |
+| to the error bound given in versor_batch.h. Frustum culling must give the    |
+| same visible list as the one-at-a-time tests. The fast trig functions are    |
+| checked against double libm for the error bounds in fast_trig.h. Bounds from |
+| points and Arvo's box transform must give the same bits on every simd level, |
+| and be the tight box around the points or the 8 transformed corners.         |
+| mat4 * mat4 and mat4 * vec4 must also give the same bits on every level.     |
+| The batch transforms in maths_batch.h, AoS and SoA, in place, must give the  |
+| bits of mat4 * vec4 on every level, and normals must match the normalised    |
+| inverse-transpose. A random 200k-node transform tree, built over several     |
+| updates with nodes moved in between, must match a from-scratch reference.    |
+| "make bench MATHS_HEADER_ONLY=1" builds it on the inline maths instead, and  |
+| then some constexpr vec3 and mat4 maths must also work out at compile time.  |
+\******************************************************************************/
+#include "maths_funcs.h"
+#include "maths_simd.h"
+#include "versor_batch.h"
+#include "frustum.h"
+#include "fast_trig.h"
+#include "bounds.h"
+#include "maths_batch.h"
+#include "transform_tree.h"
+#include "thread_pool.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#define NUM_MATS 4096
+#define NUM_REPS 200
+// max error allowed, relative to the biggest element of the reference
+#define MAX_REL_ERROR 1e-4f
+#define NUM_VERSORS 65536
+// the bound promised in versor_batch.h
+#define MAX_SLERP_ERROR 4e-5
+#define NUM_CULL_OBJECTS 100000
+#define NUM_ANGLES (1 << 20)
+// the bounds promised in fast_trig.h
+#define MAX_SINCOS_ERROR 1e-7
+#define MAX_TAN_ERROR 3e-7
+#define MAX_ATAN2_ERROR 3e-7
+#define NUM_BOUND_POINTS (1 << 20)
+#define NUM_BOUND_BOXES 100000
+// odd, and over two BATCH_GRAINs so it goes through the thread pool
+#define NUM_BATCH_ITEMS (3 * BATCH_GRAIN + 13)
+// short batches, to cover every tail length of every kernel
+#define NUM_BATCH_TAILS 40
+// how far a transformed normal may be from the inverse-transpose reference
+#define MAX_NORMAL_ERROR 1e-5f
+// nodes in the transform tree check, added over several updates
+#define NUM_TREE_NODES 200000
+#define NUM_TREE_BUILDS 4
+
+#ifdef MATHS_HEADER_ONLY
+/* "make bench MATHS_HEADER_ONLY=1". the inline maths must really be constexpr,
+so these are worked out by the compiler or the build fails */
+constexpr vec3 g_x_axis (1.0f, 0.0f, 0.0f);
+constexpr vec3 g_y_axis (0.0f, 1.0f, 0.0f);
+static_assert (cross (g_x_axis, g_y_axis).v[2] == 1.0f, "x cross y isn't z");
+static_assert (dot (vec3 (1.0f, 2.0f, 3.0f), vec3 (4.0f, 5.0f, 6.0f)) == 32.0f,
+	"constexpr dot");
+static_assert (length2 ((g_x_axis + g_y_axis) * 2.0f - 1.0f) == 3.0f,
+	"constexpr vec3 operators");
+static_assert (get_squared_dist (g_x_axis, g_y_axis) == 2.0f,
+	"constexpr get_squared_dist");
+static_assert (identity_mat4 ().m[0] == 1.0f && identity_mat4 ().m[5] == 1.0f &&
+	identity_mat4 ().m[15] == 1.0f && identity_mat4 ().m[4] == 0.0f,
+	"constexpr identity_mat4");
+static_assert (zero_mat4 ().m[10] == 0.0f, "constexpr zero_mat4");
+#endif
+
+typedef mat4 (*inverse_fn) (const mat4& m);
+
+// stops the compiler throwing away results we never look at
+static volatile float g_sink;
+
+static double now_seconds () {
+	timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static float rand_range (float lo, float hi) {
+	return lo + (hi - lo) * ((float)rand () / (float)RAND_MAX);
+}
+
+static vec3 rand_vec3 (float lo, float hi) {
+	return vec3 (rand_range (lo, hi), rand_range (lo, hi), rand_range (lo, hi));
+}
+
+/*-------------------------------TEST MATRICES--------------------------------*/
+static mat4 make_rigid () {
+	vec3 eye = rand_vec3 (-50.0f, 50.0f);
+	vec3 targ = eye + rand_vec3 (-10.0f, 10.0f);
+	return look_at (eye, targ, vec3 (0.0f, 1.0f, 0.0f));
+}
+
+static mat4 make_affine () {
+	mat4 m = scale (identity_mat4 (), rand_vec3 (0.1f, 10.0f));
+	m = rotate_x_deg (m, rand_range (-180.0f, 180.0f));
+	m = rotate_y_deg (m, rand_range (-180.0f, 180.0f));
+	m = rotate_z_deg (m, rand_range (-180.0f, 180.0f));
+	return translate (m, rand_vec3 (-100.0f, 100.0f));
+}
+
+static mat4 make_perspective () {
+	float near = rand_range (0.01f, 1.0f);
+	return perspective (rand_range (30.0f, 110.0f), rand_range (0.5f, 2.5f),
+		near, near + rand_range (10.0f, 1000.0f));
+}
+
+static mat4 make_general () {
+	// a projection times a view times a model, i.e. what we'd pick with
+	return make_perspective () * make_rigid () * make_affine ();
+}
+
+/*---------------------------------MEASURING----------------------------------*/
+static double time_inverse (inverse_fn fn, const mat4* mats) {
+	float sum = 0.0f;
+	double start = now_seconds ();
+	for (int rep = 0; rep < NUM_REPS; rep++) {
+		for (int i = 0; i < NUM_MATS; i++) {
+			mat4 r = fn (mats[i]);
+			sum += r.m[rep & 15];
+		}
+	}
+	double elapsed = now_seconds () - start;
+	g_sink = sum;
+	return elapsed * 1e9 / ((double)NUM_REPS * NUM_MATS);
+}
+
+/* reference inverse in double precision by gauss-jordan with partial
+pivoting, so we can see how far off both inverse() and the fast ones are */
+static void inverse_double (const mat4& mm, double* out) {
+	double a[4][8];
+	for (int row = 0; row < 4; row++) {
+		for (int col = 0; col < 4; col++) {
+			a[row][col] = mm.m[col * 4 + row];
+			a[row][col + 4] = row == col ? 1.0 : 0.0;
+		}
+	}
+	for (int col = 0; col < 4; col++) {
+		int pivot = col;
+		for (int row = col + 1; row < 4; row++) {
+			if (fabs (a[row][col]) > fabs (a[pivot][col])) {
+				pivot = row;
+			}
+		}
+		for (int k = 0; k < 8; k++) {
+			double t = a[col][k];
+			a[col][k] = a[pivot][k];
+			a[pivot][k] = t;
+		}
+		double inv_p = 1.0 / a[col][col];
+		for (int k = 0; k < 8; k++) {
+			a[col][k] *= inv_p;
+		}
+		for (int row = 0; row < 4; row++) {
+			if (row != col) {
+				double f = a[row][col];
+				for (int k = 0; k < 8; k++) {
+					a[row][k] -= f * a[col][k];
+				}
+			}
+		}
+	}
+	for (int row = 0; row < 4; row++) {
+		for (int col = 0; col < 4; col++) {
+			out[col * 4 + row] = a[row][col + 4];
+		}
+	}
+}
+
+// worst error over all the matrices, relative to the largest element
+static float max_rel_error (inverse_fn fn, const mat4* mats) {
+	float worst = 0.0f;
+	for (int i = 0; i < NUM_MATS; i++) {
+		double ref[16];
+		inverse_double (mats[i], ref);
+		mat4 r = fn (mats[i]);
+		double big = 0.0;
+		double diff = 0.0;
+		for (int j = 0; j < 16; j++) {
+			big = fmax (big, fabs (ref[j]));
+			diff = fmax (diff, fabs (ref[j] - r.m[j]));
+		}
+		if (big > 0.0 && diff / big > worst) {
+			worst = (float)(diff / big);
+		}
+	}
+	return worst;
+}
+
+/* a fast inverse passes if it's within MAX_REL_ERROR of the true inverse, or
+no worse than twice inverse()'s own error on badly conditioned matrices */
+static bool run (const char* name, const char* kind, inverse_fn fn,
+	const mat4* mats) {
+	double ref_ns = time_inverse (inverse, mats);
+	double ns = time_inverse (fn, mats);
+	float ref_err = max_rel_error (inverse, mats);
+	float err = max_rel_error (fn, mats);
+	bool ok = err <= MAX_REL_ERROR || err <= 2.0f * ref_err;
+	printf ("%-20s %-12s %7.2f ns %7.2f ns %6.2fx   %.2e  %.2e  %s\n",
+		name, kind, ref_ns, ns, ref_ns / ns, ref_err, err, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+/*----------------------------------VERSORS-----------------------------------*/
+static versor rand_versor () {
+	vec3 axis = normalise (rand_vec3 (-1.0f, 1.0f));
+	return quat_from_axis_deg (rand_range (-360.0f, 360.0f), axis.v[0],
+		axis.v[1], axis.v[2]);
+}
+
+// largest abs difference from a slerp done in doubles, short way round
+static double slerp_error (const const_versor_soa& a, const const_versor_soa& b,
+	const float* t, const versor_soa& r, int n) {
+	double worst = 0.0;
+	for (int i = 0; i < n; i++) {
+		double d = 0.0;
+		for (int k = 0; k < 4; k++) {
+			d += (double)a.q[k][i] * b.q[k][i];
+		}
+		double sign = d < 0.0 ? -1.0 : 1.0;
+		d = fmin (fabs (d), 1.0);
+		double theta = acos (d);
+		double ca = 1.0 - t[i];
+		double cb = t[i];
+		if (theta > 1e-9) {
+			ca = sin ((1.0 - t[i]) * theta) / sin (theta);
+			cb = sin (t[i] * theta) / sin (theta);
+		}
+		for (int k = 0; k < 4; k++) {
+			double ref = ca * a.q[k][i] + sign * cb * b.q[k][i];
+			worst = fmax (worst, fabs (ref - r.q[k][i]));
+		}
+	}
+	return worst;
+}
+
+static bool run_versors () {
+	static float a_data[4][NUM_VERSORS];
+	static float b_data[4][NUM_VERSORS];
+	static float r_data[4][NUM_VERSORS];
+	static float t[NUM_VERSORS];
+	static mat4 mats[NUM_VERSORS];
+	static versor qa[NUM_VERSORS];
+	static versor qb[NUM_VERSORS];
+	versor_soa a, b, r;
+	for (int k = 0; k < 4; k++) {
+		a.q[k] = a_data[k];
+		b.q[k] = b_data[k];
+		r.q[k] = r_data[k];
+	}
+	for (int i = 0; i < NUM_VERSORS; i++) {
+		qa[i] = rand_versor ();
+		qb[i] = rand_versor ();
+		t[i] = rand_range (0.0f, 1.0f);
+		for (int k = 0; k < 4; k++) {
+			a_data[k][i] = qa[i].q[k];
+			b_data[k][i] = qb[i].q[k];
+		}
+	}
+
+	printf ("%-20s %-12s %10s %10s %7s   %-8s  %-8s\n", "function", "versors",
+		"single", "this", "speedup", "", "err(this)");
+	const int reps = 20;
+	float sum = 0.0f;
+	double start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		for (int i = 0; i < NUM_VERSORS; i++) {
+			versor q = qa[i];
+			sum += slerp (q, qb[i], t[i]).q[rep & 3];
+		}
+	}
+	double ref_ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		slerp_versors (a, b, t, r, NUM_VERSORS);
+		sum += r_data[rep & 3][rep];
+	}
+	double ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	double err = slerp_error (a, b, t, r, NUM_VERSORS);
+	bool ok = err <= MAX_SLERP_ERROR;
+	printf ("%-20s %-12s %7.2f ns %7.2f ns %6.2fx   %-8s  %.2e  %s\n",
+		"slerp_versors", "random", ref_ns, ns, ref_ns / ns, "", err,
+		ok ? "ok" : "FAIL");
+
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		// both sides write every matrix out, or it's not a fair race
+		for (int i = 0; i < NUM_VERSORS; i++) {
+			mats[i] = quat_to_mat4 (qa[i]);
+		}
+		sum += mats[rep].m[rep & 15];
+	}
+	ref_ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		quat_to_mat4_batch (a, mats, NUM_VERSORS);
+		sum += mats[rep].m[rep & 15];
+	}
+	ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	printf ("%-20s %-12s %7.2f ns %7.2f ns %6.2fx\n", "quat_to_mat4_batch",
+		"random", ref_ns, ns, ref_ns / ns);
+
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		for (int i = 0; i < NUM_VERSORS; i++) {
+			sum += (qa[i] * qb[i]).q[rep & 3];
+		}
+	}
+	ref_ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		mul_versors (a, b, r, NUM_VERSORS);
+		normalise_versors (r, r, NUM_VERSORS);
+		sum += r_data[rep & 3][rep];
+	}
+	ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	printf ("%-20s %-12s %7.2f ns %7.2f ns %6.2fx\n", "mul+normalise",
+		"random", ref_ns, ns, ref_ns / ns);
+	// a model matrix the old way, vs. make_trs () and the batched builder
+	static float pos[NUM_VERSORS * 3];
+	static float scl[NUM_VERSORS * 3];
+	for (int i = 0; i < NUM_VERSORS * 3; i++) {
+		pos[i] = rand_range (-100.0f, 100.0f);
+		scl[i] = rand_range (0.1f, 10.0f);
+	}
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		for (int i = 0; i < NUM_VERSORS; i++) {
+			vec3 p (pos[i * 3], pos[i * 3 + 1], pos[i * 3 + 2]);
+			vec3 s (scl[i * 3], scl[i * 3 + 1], scl[i * 3 + 2]);
+			mats[i] = translate (quat_to_mat4 (qa[i]) * scale (identity_mat4 (), s), p);
+		}
+		sum += mats[rep].m[rep & 15];
+	}
+	ref_ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		for (int i = 0; i < NUM_VERSORS; i++) {
+			vec3 p (pos[i * 3], pos[i * 3 + 1], pos[i * 3 + 2]);
+			vec3 s (scl[i * 3], scl[i * 3 + 1], scl[i * 3 + 2]);
+			mats[i] = make_trs (p, qa[i], s);
+		}
+		sum += mats[rep].m[rep & 15];
+	}
+	ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	printf ("%-20s %-12s %7.2f ns %7.2f ns %6.2fx\n", "make_trs", "random",
+		ref_ns, ns, ref_ns / ns);
+	start = now_seconds ();
+	for (int rep = 0; rep < reps; rep++) {
+		make_trs_batch (pos, a, scl, mats, NUM_VERSORS);
+		sum += mats[rep].m[rep & 15];
+	}
+	ns = (now_seconds () - start) * 1e9 / ((double)reps * NUM_VERSORS);
+	printf ("%-20s %-12s %7.2f ns %7.2f ns %6.2fx\n", "make_trs_batch", "random",
+		ref_ns, ns, ref_ns / ns);
+
+	g_sink = sum;
+	if (!ok) {
+		fprintf (stderr, "ERROR: slerp_versors error %g is over %g\n", err,
+			MAX_SLERP_ERROR);
+	}
+	return ok;
+}
+
+/*---------------------------------CULLING------------------------------------*/
+/* a camera in the middle of a big field of spheres and boxes, so most of them
+are culled. times a few frames with the camera turning a little each frame,
+which is where last_plane pays off */
+static bool run_culling () {
+	const int n = NUM_CULL_OBJECTS;
+	static float x[NUM_CULL_OBJECTS], y[NUM_CULL_OBJECTS], z[NUM_CULL_OBJECTS];
+	static float r[NUM_CULL_OBJECTS];
+	static float mx[NUM_CULL_OBJECTS], my[NUM_CULL_OBJECTS];
+	static float mz[NUM_CULL_OBJECTS];
+	static unsigned int visible[NUM_CULL_OBJECTS];
+	static unsigned int expected[NUM_CULL_OBJECTS];
+	static unsigned char last_plane[NUM_CULL_OBJECTS];
+	for (int i = 0; i < n; i++) {
+		x[i] = rand_range (-500.0f, 500.0f);
+		y[i] = rand_range (-50.0f, 50.0f);
+		z[i] = rand_range (-500.0f, 500.0f);
+		r[i] = rand_range (0.5f, 5.0f);
+		mx[i] = x[i] + rand_range (0.5f, 10.0f);
+		my[i] = y[i] + rand_range (0.5f, 10.0f);
+		mz[i] = z[i] + rand_range (0.5f, 10.0f);
+	}
+	mat4 proj = perspective (67.0f, 1.333f, 0.1f, 300.0f);
+	const int frames = 100;
+	frustum fr[frames];
+	for (int i = 0; i < frames; i++) {
+		vec3 targ = heading_to_direction ((float)i * 0.5f);
+		fr[i] = frustum_from_mat4 (proj * look_at (vec3 (0.0f, 0.0f, 0.0f), targ,
+			vec3 (0.0f, 1.0f, 0.0f)));
+	}
+
+	// check against the one-object-at-a-time tests
+	bool ok = true;
+	size_t count = 0;
+	for (int i = 0; i < n; i++) {
+		if (sphere_in_frustum (fr[0], vec3 (x[i], y[i], z[i]), r[i])) {
+			expected[count++] = i;
+		}
+	}
+	size_t got = cull_spheres (fr[0], x, y, z, r, n, NULL, visible);
+	ok &= got == count && 0 == memcmp (visible, expected, count * sizeof (int));
+	count = 0;
+	for (int i = 0; i < n; i++) {
+		if (aabb_in_frustum (fr[0], vec3 (x[i], y[i], z[i]),
+			vec3 (mx[i], my[i], mz[i]))) {
+			expected[count++] = i;
+		}
+	}
+	got = cull_aabbs (fr[0], x, y, z, mx, my, mz, n, NULL, visible);
+	ok &= got == count && 0 == memcmp (visible, expected, count * sizeof (int));
+
+	printf ("%-20s %-12s %10s %10s %10s %s\n", "function", "objects",
+		"ms (plain)", "ms (cache)", "visible", "");
+	const char* names[2] = { "cull_spheres", "cull_aabbs" };
+	for (int kind = 0; kind < 2; kind++) {
+		double ms[2];
+		for (int coherent = 0; coherent < 2; coherent++) {
+			memset (last_plane, 0, sizeof (last_plane));
+			unsigned char* lp = coherent ? last_plane : NULL;
+			double start = now_seconds ();
+			for (int i = 0; i < frames; i++) {
+				if (0 == kind) {
+					got = cull_spheres (fr[i], x, y, z, r, n, lp, visible);
+				} else {
+					got = cull_aabbs (fr[i], x, y, z, mx, my, mz, n, lp, visible);
+				}
+			}
+			ms[coherent] = (now_seconds () - start) * 1e3 / frames;
+		}
+		printf ("%-20s %-12i %10.3f %10.3f %10i %s\n", names[kind], n, ms[0],
+			ms[1], (int)got, ok ? "ok" : "FAIL");
+	}
+	if (!ok) {
+		fprintf (stderr, "ERROR: batched culling disagreed with the single tests\n");
+	}
+	return ok;
+}
+
+/*----------------------------------FAST TRIG---------------------------------*/
+// every simd level must give the same bits as the single-value functions
+static bool trig_levels_agree (const float* in, const float* in2, size_t n) {
+	static float s[NUM_ANGLES], c[NUM_ANGLES], a[NUM_ANGLES];
+	static float bs[NUM_ANGLES], bc[NUM_ANGLES], ba[NUM_ANGLES];
+	for (size_t i = 0; i < n; i++) {
+		fast_sincosf (in[i], &s[i], &c[i]);
+		a[i] = fast_atan2f (in[i], in2[i]);
+	}
+	bool ok = true;
+	simd_level prev = get_simd_level ();
+	for (int level = SIMD_SCALAR; level <= (int)detected_simd_level (); level++) {
+		set_simd_level ((simd_level)level);
+		sincos_batch (in, bs, bc, n);
+		atan2_batch (in, in2, ba, n);
+		bool same = 0 == memcmp (s, bs, n * sizeof (float)) &&
+			0 == memcmp (c, bc, n * sizeof (float)) &&
+			0 == memcmp (a, ba, n * sizeof (float));
+		if (!same) {
+			fprintf (stderr, "ERROR: trig batches differ at simd level %s\n",
+				simd_level_name ((simd_level)level));
+		}
+		ok &= same;
+	}
+	set_simd_level (prev);
+	return ok;
+}
+
+static bool run_trig () {
+	const int n = NUM_ANGLES;
+	static float x[NUM_ANGLES], y[NUM_ANGLES], out[NUM_ANGLES], out2[NUM_ANGLES];
+	for (int i = 0; i < n; i++) {
+		// half the angles are small, like the ones we actually use
+		float range = (i & 1) ? 8192.0f : 2.0f * (float)M_PI;
+		x[i] = rand_range (-range, range);
+		y[i] = rand_range (-100.0f, 100.0f);
+	}
+	// the awkward atan2 cases: axes, diagonals, zeros
+	const float edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 1e-30f, 100.0f };
+	int e = 0;
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 6; j++) {
+			y[e] = edges[i];
+			out[e++] = edges[j];
+		}
+	}
+
+	double err_sc = 0.0, err_tan = 0.0, err_atan2 = 0.0;
+	for (int i = 0; i < n; i++) {
+		float s, c;
+		fast_sincosf (x[i], &s, &c);
+		double ds = sin ((double)x[i]);
+		double dc = cos ((double)x[i]);
+		err_sc = fmax (err_sc, fmax (fabs (s - ds), fabs (c - dc)));
+		// relative, and only away from the poles
+		if (fabs (dc) > 1e-2) {
+			double dt = ds / dc;
+			double rel = fabs (fast_tanf (x[i]) - dt) / fmax (1.0, fabs (dt));
+			err_tan = fmax (err_tan, rel);
+		}
+		float xx = i < e ? out[i] : x[i];
+		double da = atan2 ((double)y[i], (double)xx);
+		err_atan2 = fmax (err_atan2, fabs (fast_atan2f (y[i], xx) - da));
+	}
+	bool ok = err_sc <= MAX_SINCOS_ERROR && err_tan <= MAX_TAN_ERROR &&
+		err_atan2 <= MAX_ATAN2_ERROR;
+	if (!ok) {
+		fprintf (stderr, "ERROR: fast trig error sin/cos %g tan %g atan2 %g\n",
+			err_sc, err_tan, err_atan2);
+	}
+	ok &= trig_levels_agree (y, x, n);
+
+	printf ("%-20s %-12s %10s %10s %7s   %-8s\n", "function", "angles", "libm",
+		"this", "speedup", "max err");
+	double start = now_seconds ();
+	for (int i = 0; i < n; i++) {
+		out[i] = sinf (x[i]);
+		out2[i] = cosf (x[i]);
+	}
+	double t_libm = now_seconds () - start;
+	start = now_seconds ();
+	sincos_batch (x, out, out2, n);
+	double t_batch = now_seconds () - start;
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %-8.2g\n", "sincos_batch", n,
+		t_libm * 1e3, t_batch * 1e3, t_libm / t_batch, err_sc);
+	start = now_seconds ();
+	for (int i = 0; i < n; i++) {
+		out[i] = atan2f (y[i], x[i]);
+	}
+	t_libm = now_seconds () - start;
+	start = now_seconds ();
+	atan2_batch (y, x, out, n);
+	t_batch = now_seconds () - start;
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %-8.2g\n", "atan2_batch", n,
+		t_libm * 1e3, t_batch * 1e3, t_libm / t_batch, err_atan2);
+	start = now_seconds ();
+	float sum = 0.0f;
+	for (int i = 0; i < n; i++) {
+		sum += tanf (x[i]);
+	}
+	t_libm = now_seconds () - start;
+	start = now_seconds ();
+	for (int i = 0; i < n; i++) {
+		sum += fast_tanf (x[i]);
+	}
+	t_batch = now_seconds () - start;
+	g_sink = sum;
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %-8.2g\n", "fast_tanf", n,
+		t_libm * 1e3, t_batch * 1e3, t_libm / t_batch, err_tan);
+	return ok;
+}
+
+/*-----------------------------------BOUNDS-----------------------------------*/
+static bool same_aabb (const aabb& a, const aabb& b) {
+	return 0 == memcmp (&a, &b, sizeof (a));
+}
+
+// Arvo against the box around the 8 corners, each put through m
+static bool arvo_is_tight (const aabb& box, const mat4& m, const aabb& arvo) {
+	aabb corners = empty_aabb ();
+	for (int c = 0; c < 8; c++) {
+		float p[3] = {
+			(c & 1) ? box.max.v[0] : box.min.v[0],
+			(c & 2) ? box.max.v[1] : box.min.v[1],
+			(c & 4) ? box.max.v[2] : box.min.v[2]
+		};
+		vec3 q;
+		for (int row = 0; row < 3; row++) {
+			q.v[row] = m.m[row] * p[0] + m.m[4 + row] * p[1] + m.m[8 + row] * p[2] +
+				m.m[12 + row];
+		}
+		corners = aabb_add_point (corners, q);
+	}
+	// a few ulps of the biggest term either way
+	float tol = 1e-5f * (fabsf (m.m[12]) + fabsf (m.m[13]) + fabsf (m.m[14]) +
+		100.0f * (fabsf (m.m[0]) + fabsf (m.m[5]) + fabsf (m.m[10]) + 1.0f));
+	for (int k = 0; k < 3; k++) {
+		if (fabsf (corners.min.v[k] - arvo.min.v[k]) > tol ||
+			fabsf (corners.max.v[k] - arvo.max.v[k]) > tol) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* every simd level must build the same box and sphere as the scalar code, for
+the whole array and for short ones that are all tail, and transform boxes the
+same as aabb_transform() one at a time */
+static bool run_bounds () {
+	const int n = NUM_BOUND_POINTS;
+	static float points[NUM_BOUND_POINTS * 3];
+	for (int i = 0; i < n * 3; i++) {
+		points[i] = rand_range (-100.0f, 100.0f);
+	}
+	// x is never negative, and the low end is a tie between -0 and 0
+	for (int i = 0; i < n; i++) {
+		points[i * 3] = fabsf (points[i * 3]);
+	}
+	points[3 * 17] = -0.0f;
+	points[3 * 5000] = 0.0f;
+	const int nb = NUM_BOUND_BOXES;
+	static float lo[3][NUM_BOUND_BOXES], hi[3][NUM_BOUND_BOXES];
+	static float out_lo[3][NUM_BOUND_BOXES], out_hi[3][NUM_BOUND_BOXES];
+	for (int i = 0; i < nb; i++) {
+		for (int k = 0; k < 3; k++) {
+			lo[k][i] = rand_range (-100.0f, 100.0f);
+			hi[k][i] = lo[k][i] + rand_range (0.0f, 20.0f);
+		}
+	}
+	aabb_soa in_soa, out_soa;
+	for (int k = 0; k < 3; k++) {
+		in_soa.min[k] = lo[k];
+		in_soa.max[k] = hi[k];
+		out_soa.min[k] = out_lo[k];
+		out_soa.max[k] = out_hi[k];
+	}
+	mat4 m = make_affine ();
+
+	simd_level prev = get_simd_level ();
+	set_simd_level (SIMD_SCALAR);
+	aabb box = aabb_from_points (points, n);
+	bounding_sphere sphere = sphere_from_points (points, n);
+	aabb short_boxes[41];
+	bounding_sphere short_spheres[41];
+	for (int c = 0; c <= 40; c++) {
+		short_boxes[c] = aabb_from_points (points + 3, c);
+		short_spheres[c] = sphere_from_points (points + 3, c);
+	}
+
+	// the box by brute force, and every point in the sphere
+	bool ok = 0.0f == box.min.v[0] && !signbit (box.min.v[0]);
+	for (int i = 0; i < n; i++) {
+		for (int k = 0; k < 3; k++) {
+			ok &= points[i * 3 + k] >= box.min.v[k] && points[i * 3 + k] <= box.max.v[k];
+		}
+		vec3 d = vec3 (points[i * 3], points[i * 3 + 1], points[i * 3 + 2]) -
+			sphere.centre;
+		ok &= length (d) <= sphere.radius;
+	}
+	for (int k = 0; k < 3; k++) {
+		bool touched_lo = false, touched_hi = false;
+		for (int i = 0; i < n; i++) {
+			touched_lo |= points[i * 3 + k] == box.min.v[k];
+			touched_hi |= points[i * 3 + k] == box.max.v[k];
+		}
+		ok &= touched_lo && touched_hi;
+	}
+	if (!ok) {
+		fprintf (stderr, "ERROR: aabb_from_points or sphere_from_points is wrong\n");
+	}
+
+	// arvo on every box, against its corners
+	bool tight = true;
+	for (int i = 0; i < nb; i++) {
+		aabb b;
+		b.min = vec3 (lo[0][i], lo[1][i], lo[2][i]);
+		b.max = vec3 (hi[0][i], hi[1][i], hi[2][i]);
+		tight &= arvo_is_tight (b, m, aabb_transform (b, m));
+	}
+	if (!tight) {
+		fprintf (stderr, "ERROR: aabb_transform isn't the box around the corners\n");
+	}
+	ok &= tight;
+
+	// merging and moving spheres
+	bool merged = true;
+	for (int i = 0; i < 1000; i++) {
+		bounding_sphere a, b;
+		a.centre = rand_vec3 (-10.0f, 10.0f);
+		a.radius = rand_range (0.0f, 10.0f);
+		b.centre = rand_vec3 (-10.0f, 10.0f);
+		b.radius = rand_range (0.0f, 10.0f);
+		bounding_sphere s = sphere_merge (a, b);
+		merged &= length (a.centre - s.centre) + a.radius <= s.radius * 1.00001f;
+		merged &= length (b.centre - s.centre) + b.radius <= s.radius * 1.00001f;
+		merged &= s.radius <= fmaxf (a.radius, b.radius) +
+			length (a.centre - b.centre) + 1e-4f;
+	}
+	bounding_sphere moved = sphere_transform (sphere, m);
+	for (int i = 0; i < n; i += 97) {
+		vec3 q;
+		for (int row = 0; row < 3; row++) {
+			q.v[row] = m.m[row] * points[i * 3] + m.m[4 + row] * points[i * 3 + 1] +
+				m.m[8 + row] * points[i * 3 + 2] + m.m[12 + row];
+		}
+		merged &= length (q - moved.centre) <= moved.radius * 1.00001f;
+	}
+	if (!merged) {
+		fprintf (stderr, "ERROR: sphere_merge or sphere_transform lost a point\n");
+	}
+	ok &= merged;
+
+	bool levels_agree = true;
+	for (int level = SIMD_SCALAR; level <= (int)detected_simd_level (); level++) {
+		set_simd_level ((simd_level)level);
+		bool same = same_aabb (box, aabb_from_points (points, n));
+		bounding_sphere s = sphere_from_points (points, n);
+		same &= 0 == memcmp (&s, &sphere, sizeof (s));
+		for (int c = 0; c <= 40; c++) {
+			same &= same_aabb (short_boxes[c], aabb_from_points (points + 3, c));
+			s = sphere_from_points (points + 3, c);
+			same &= 0 == memcmp (&s, &short_spheres[c], sizeof (s));
+		}
+		transform_aabbs (m, in_soa, out_soa, nb);
+		for (int i = 0; i < nb; i++) {
+			aabb b;
+			b.min = vec3 (lo[0][i], lo[1][i], lo[2][i]);
+			b.max = vec3 (hi[0][i], hi[1][i], hi[2][i]);
+			aabb one = aabb_transform (b, m);
+			aabb batch;
+			batch.min = vec3 (out_lo[0][i], out_lo[1][i], out_lo[2][i]);
+			batch.max = vec3 (out_hi[0][i], out_hi[1][i], out_hi[2][i]);
+			same &= same_aabb (one, batch);
+		}
+		if (!same) {
+			fprintf (stderr, "ERROR: bounds differ at simd level %s\n",
+				simd_level_name ((simd_level)level));
+		}
+		levels_agree &= same;
+	}
+	ok &= levels_agree;
+
+	// timings, scalar against the best level
+	const int reps = 20;
+	double t_box[2], t_sphere[2], t_arvo[2];
+	for (int best = 0; best < 2; best++) {
+		set_simd_level (best ? prev : SIMD_SCALAR);
+		float sum = 0.0f;
+		double start = now_seconds ();
+		for (int r = 0; r < reps; r++) {
+			sum += aabb_from_points (points, n).max.v[1];
+		}
+		t_box[best] = (now_seconds () - start) / reps;
+		start = now_seconds ();
+		for (int r = 0; r < reps; r++) {
+			sum += sphere_from_points (points, n).radius;
+		}
+		t_sphere[best] = (now_seconds () - start) / reps;
+		start = now_seconds ();
+		for (int r = 0; r < reps; r++) {
+			transform_aabbs (m, in_soa, out_soa, nb);
+			sum += out_hi[0][r];
+		}
+		t_arvo[best] = (now_seconds () - start) / reps;
+		g_sink = sum;
+	}
+	// and arvo against putting all 8 corners through the matrix
+	float sum = 0.0f;
+	double start = now_seconds ();
+	for (int r = 0; r < reps; r++) {
+		for (int i = 0; i < nb; i++) {
+			aabb corners = empty_aabb ();
+			for (int c = 0; c < 8; c++) {
+				vec4 p ((c & 1) ? hi[0][i] : lo[0][i], (c & 2) ? hi[1][i] : lo[1][i],
+					(c & 4) ? hi[2][i] : lo[2][i], 1.0f);
+				corners = aabb_add_point (corners, vec3 (m * p));
+			}
+			sum += corners.max.v[0];
+		}
+	}
+	double t_corners = (now_seconds () - start) / reps;
+	g_sink = sum;
+	set_simd_level (prev);
+
+	printf ("%-20s %-12s %10s %10s %7s   %s\n", "function", "items",
+		"scalar", "this", "speedup", "");
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %s\n", "aabb_from_points", n,
+		t_box[0] * 1e3, t_box[1] * 1e3, t_box[0] / t_box[1],
+		ok ? "ok" : "FAIL");
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %s\n", "sphere_from_points", n,
+		t_sphere[0] * 1e3, t_sphere[1] * 1e3, t_sphere[0] / t_sphere[1],
+		ok ? "ok" : "FAIL");
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %s\n", "transform_aabbs", nb,
+		t_arvo[0] * 1e3, t_arvo[1] * 1e3, t_arvo[0] / t_arvo[1],
+		ok ? "ok" : "FAIL");
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   %s\n", "  vs 8 corners", nb,
+		t_corners * 1e3, t_arvo[1] * 1e3, t_corners / t_arvo[1], "");
+	return ok;
+}
+
+/*---------------------------------MAT4 LEVELS--------------------------------*/
+/* mat4 * mat4 and mat4 * vec4 on every simd level must give the scalar bits,
+with the result written over either input too */
+/* plain mat4 * vec4, for simd_mat4_mul_vec4() to match. that one isn't
+dispatched, so there's no scalar level to set for it */
+static vec4 mat4_mul_vec4_ref (const mat4& m, const vec4& v) {
+	const float* a = m.m;
+	return vec4 (a[0] * v.v[0] + a[4] * v.v[1] + a[8] * v.v[2] + a[12] * v.v[3],
+		a[1] * v.v[0] + a[5] * v.v[1] + a[9] * v.v[2] + a[13] * v.v[3],
+		a[2] * v.v[0] + a[6] * v.v[1] + a[10] * v.v[2] + a[14] * v.v[3],
+		a[3] * v.v[0] + a[7] * v.v[1] + a[11] * v.v[2] + a[15] * v.v[3]);
+}
+
+static bool run_mat4_levels (const mat4* a, const mat4* b) {
+	static mat4 mul_ref[NUM_MATS];
+	static vec4 vec_ref[NUM_MATS];
+	static vec4 vecs[NUM_MATS];
+	for (int i = 0; i < NUM_MATS; i++) {
+		vecs[i] = vec4 (rand_vec3 (-100.0f, 100.0f), rand_range (-2.0f, 2.0f));
+		vec_ref[i] = mat4_mul_vec4_ref (a[i], vecs[i]);
+	}
+	simd_level prev = get_simd_level ();
+	set_simd_level (SIMD_SCALAR);
+	for (int i = 0; i < NUM_MATS; i++) {
+		mul_ref[i] = mat4 (a[i]) * b[i];
+	}
+	bool ok = true;
+	double t_mul[SIMD_AVX512 + 1];
+	for (int level = SIMD_SCALAR; level <= (int)detected_simd_level (); level++) {
+		set_simd_level ((simd_level)level);
+		bool same = true;
+		for (int i = 0; i < NUM_MATS; i++) {
+			mat4 r = mat4 (a[i]) * b[i];
+			same &= 0 == memcmp (r.m, mul_ref[i].m, sizeof (r.m));
+			vec4 v = mat4 (a[i]) * vecs[i];
+			same &= 0 == memcmp (v.v, vec_ref[i].v, sizeof (v.v));
+			// in place, over each input
+			mat4 x = a[i];
+			simd_mat4_mul (x.m, b[i].m, x.m);
+			same &= 0 == memcmp (x.m, mul_ref[i].m, sizeof (x.m));
+			x = b[i];
+			simd_mat4_mul (a[i].m, x.m, x.m);
+			same &= 0 == memcmp (x.m, mul_ref[i].m, sizeof (x.m));
+			v = vecs[i];
+			simd_mat4_mul_vec4 (a[i].m, v.v, v.v);
+			same &= 0 == memcmp (v.v, vec_ref[i].v, sizeof (v.v));
+		}
+		if (!same) {
+			fprintf (stderr, "ERROR: mat4 products differ at simd level %s\n",
+				simd_level_name ((simd_level)level));
+		}
+		ok &= same;
+		float sum = 0.0f;
+		double start = now_seconds ();
+		for (int rep = 0; rep < NUM_REPS; rep++) {
+			for (int i = 0; i < NUM_MATS; i++) {
+				sum += (mat4 (a[i]) * b[i]).m[rep & 15];
+			}
+		}
+		t_mul[level] = (now_seconds () - start) * 1e9 / ((double)NUM_REPS * NUM_MATS);
+		g_sink = sum;
+	}
+	set_simd_level (prev);
+	// mat4 * vec4 is the same code on every level, so it's timed once
+	float sum = 0.0f;
+	double start = now_seconds ();
+	for (int rep = 0; rep < NUM_REPS; rep++) {
+		for (int i = 0; i < NUM_MATS; i++) {
+			sum += mat4_mul_vec4_ref (a[i], vecs[i]).v[rep & 3];
+		}
+	}
+	double t_vec_ref = (now_seconds () - start) * 1e9 / ((double)NUM_REPS * NUM_MATS);
+	start = now_seconds ();
+	for (int rep = 0; rep < NUM_REPS; rep++) {
+		for (int i = 0; i < NUM_MATS; i++) {
+			sum += (mat4 (a[i]) * vecs[i]).v[rep & 3];
+		}
+	}
+	double t_vec = (now_seconds () - start) * 1e9 / ((double)NUM_REPS * NUM_MATS);
+	g_sink = sum;
+	printf ("%-20s %-12s %10s\n", "simd level", "", "mat4*mat4");
+	for (int level = SIMD_SCALAR; level <= (int)detected_simd_level (); level++) {
+		printf ("%-20s %-12i %8.2fns   %s\n", simd_level_name ((simd_level)level),
+			NUM_MATS, t_mul[level], ok ? "same" : "DIFFERENT");
+	}
+	printf ("%-20s %-12i %8.2fns scalar, %.2fns as built   %s\n", "mat4*vec4",
+		NUM_MATS, t_vec_ref, t_vec, ok ? "same" : "DIFFERENT");
+	return ok;
+}
+
+/*------------------------------BATCH TRANSFORMS------------------------------*/
+// which of maths_batch.h's transforms, with the w each item gets
+enum batch_kind { BATCH_POINTS, BATCH_VECTORS, BATCH_VEC4S, BATCH_NORMALS };
+
+static const char* batch_name (batch_kind kind) {
+	switch (kind) {
+		case BATCH_POINTS: return "points";
+		case BATCH_VECTORS: return "vectors";
+		case BATCH_VEC4S: return "vec4s";
+		default: return "normals";
+	}
+}
+
+/* n items of in (AoS, 3 or 4 floats each) through the batch function, into out.
+soa goes through the SoA version instead, via split copies */
+static void run_batch_kind (batch_kind kind, bool soa, const mat4& m,
+	const float* in, float* out, size_t n) {
+	if (!soa || BATCH_VEC4S == kind) {
+		switch (kind) {
+			case BATCH_POINTS: transform_points (m, in, out, n); break;
+			case BATCH_VECTORS: transform_vectors (m, in, out, n); break;
+			case BATCH_VEC4S: transform_vec4s (m, in, out, n); break;
+			case BATCH_NORMALS: transform_normals (m, in, out, n); break;
+		}
+		return;
+	}
+	float* xyz = (float*)malloc (3 * n * sizeof (float) + 1);
+	float* x = xyz;
+	float* y = xyz + n;
+	float* z = xyz + 2 * n;
+	for (size_t i = 0; i < n; i++) {
+		x[i] = in[i * 3];
+		y[i] = in[i * 3 + 1];
+		z[i] = in[i * 3 + 2];
+	}
+	// in place, like the AoS calls when in == out
+	switch (kind) {
+		case BATCH_POINTS: transform_points_soa (m, x, y, z, x, y, z, n); break;
+		case BATCH_VECTORS: transform_vectors_soa (m, x, y, z, x, y, z, n); break;
+		default: transform_normals_soa (m, x, y, z, x, y, z, n); break;
+	}
+	for (size_t i = 0; i < n; i++) {
+		out[i * 3] = x[i];
+		out[i * 3 + 1] = y[i];
+		out[i * 3 + 2] = z[i];
+	}
+	free (xyz);
+}
+
+/* the reference for item i: mat4 * vec4 with the item's w, or for normals the
+inverse-transpose times it, normalised */
+static vec4 batch_reference (batch_kind kind, const mat4& m, const mat4& normals,
+	const float* in, size_t i) {
+	if (BATCH_VEC4S == kind) {
+		return mat4 (m) * vec4 (in[i * 4], in[i * 4 + 1], in[i * 4 + 2],
+			in[i * 4 + 3]);
+	}
+	vec3 v (in[i * 3], in[i * 3 + 1], in[i * 3 + 2]);
+	if (BATCH_NORMALS == kind) {
+		return vec4 (normalise (vec3 (mat4 (normals) * vec4 (v, 0.0f))), 0.0f);
+	}
+	return mat4 (m) * vec4 (v, BATCH_POINTS == kind ? 1.0f : 0.0f);
+}
+
+/* out must be the reference bit for bit, or for normals within
+MAX_NORMAL_ERROR. returns the biggest normal error, or -1 on a mismatch */
+static float check_batch_items (batch_kind kind, const mat4& m,
+	const float* in, const float* out, size_t n) {
+	mat4 normals = transpose (inverse (m));
+	int stride = BATCH_VEC4S == kind ? 4 : 3;
+	float worst = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		vec4 ref = batch_reference (kind, m, normals, in, i);
+		for (int k = 0; k < stride; k++) {
+			float got = out[i * stride + k];
+			if (BATCH_NORMALS == kind) {
+				worst = fmaxf (worst, fabsf (got - ref.v[k]));
+			} else if (0 != memcmp (&got, &ref.v[k], sizeof (got))) {
+				return -1.0f;
+			}
+		}
+	}
+	return worst > MAX_NORMAL_ERROR ? -1.0f : worst;
+}
+
+/* every batch transform, AoS and SoA, on every simd level, against mat4 * vec4
+(or the inverse-transpose for normals). in place, on every short length and
+on a batch long enough for the thread pool */
+static bool run_batch () {
+	const size_t n = NUM_BATCH_ITEMS;
+	float* in = (float*)malloc (4 * n * sizeof (float));
+	float* work = (float*)malloc (4 * n * sizeof (float));
+	if (!in || !work) {
+		free (in);
+		free (work);
+		return false;
+	}
+	for (size_t i = 0; i < 4 * n; i++) {
+		in[i] = rand_range (-100.0f, 100.0f);
+	}
+	// rotations with non-uniform scale (and a translation), and full P*V*M
+	mat4 mats[2] = { make_affine (), make_general () };
+	// enough threads that the long batch is really split up
+	int workers = get_worker_count ();
+	set_worker_count (4);
+	simd_level prev = get_simd_level ();
+	bool ok = true;
+	float worst_normal = 0.0f;
+	for (int level = SIMD_SCALAR; level <= (int)detected_simd_level (); level++) {
+		set_simd_level ((simd_level)level);
+		bool same = true;
+		for (int kind = BATCH_POINTS; kind <= BATCH_NORMALS; kind++) {
+			int stride = BATCH_VEC4S == kind ? 4 : 3;
+			for (int soa = 0; soa < 2; soa++) {
+				for (int mi = 0; mi < 2; mi++) {
+					// the inverse-transpose of a projection isn't what normals want
+					if (BATCH_NORMALS == kind && 1 == mi) {
+						continue;
+					}
+					for (size_t len = 0; len <= NUM_BATCH_TAILS + 1; len++) {
+						size_t count = len > NUM_BATCH_TAILS ? n : len;
+						memcpy (work, in, count * stride * sizeof (float));
+						run_batch_kind ((batch_kind)kind, soa, mats[mi], work, work,
+							count);
+						float err = check_batch_items ((batch_kind)kind, mats[mi], in,
+							work, count);
+						if (err < 0.0f) {
+							fprintf (stderr, "ERROR: %s%s of %i differ at simd level %s\n",
+								batch_name ((batch_kind)kind), soa ? " (soa)" : "",
+								(int)count, simd_level_name ((simd_level)level));
+							same = false;
+						}
+						worst_normal = fmaxf (worst_normal, err);
+					}
+				}
+			}
+		}
+		ok &= same;
+	}
+	// and timed, scalar against the best level
+	double t[2];
+	for (int best = 0; best < 2; best++) {
+		set_simd_level (best ? prev : SIMD_SCALAR);
+		double start = now_seconds ();
+		for (int r = 0; r < 20; r++) {
+			transform_points (mats[0], in, work, n);
+		}
+		t[best] = (now_seconds () - start) / 20;
+	}
+	g_sink = work[n - 1];
+	set_simd_level (prev);
+	set_worker_count (workers);
+	printf ("%-20s %-12i %8.3fms %8.3fms %6.1fx   normal err %.2e  %s\n",
+		"transform_points", (int)n, t[0] * 1e3, t[1] * 1e3, t[0] / t[1],
+		worst_normal, ok ? "ok" : "FAIL");
+	free (in);
+	free (work);
+	return ok;
+}
+
+/*-------------------------------TRANSFORM TREE-------------------------------*/
+// what a node was given, kept by handle for the reference
+struct tree_node_ref {
+	int parent;
+	vec3 pos;
+	versor rot;
+	vec3 scale;
+};
+
+/* every node's world matrix from scratch, in handle order (parents always have
+lower handles), against the tree's. they must be the same bits */
+static bool tree_matches (const transform_tree& t, const tree_node_ref* nodes,
+	mat4* ref, int count) {
+	bool same = t.count == count;
+	for (int h = 0; same && h < count; h++) {
+		const tree_node_ref& n = nodes[h];
+		mat4 local = make_trs (n.pos, n.rot, n.scale);
+		ref[h] = NO_TRANSFORM == n.parent ? local : ref[n.parent] * local;
+		same = 0 == memcmp (ref[h].m, world_mat (t, h).m, sizeof (ref[h].m));
+	}
+	// and the handles still name every node once
+	for (int i = 0; same && i < count; i++) {
+		same = t.handle_of[t.index_of[i]] == i && world_mat_index (t, i) ==
+			t.index_of[i];
+	}
+	return same;
+}
+
+/* builds a random forest over several updates, so it is re-sorted with nodes
+already in it, and moves a few nodes between updates. every update must agree
+with tree_matches(), and an update with nothing changed must say so */
+static bool run_transform_tree () {
+	static tree_node_ref nodes[NUM_TREE_NODES];
+	static mat4 ref[NUM_TREE_NODES];
+	transform_tree t;
+	if (!init_transform_tree (t, NUM_TREE_NODES)) {
+		return false;
+	}
+	int workers = get_worker_count ();
+	set_worker_count (4);
+	bool ok = true;
+	int count = 0;
+	double t_full = 0.0, t_partial = 0.0;
+	for (int build = 0; build < NUM_TREE_BUILDS; build++) {
+		int target = NUM_TREE_NODES / NUM_TREE_BUILDS * (build + 1);
+		for (; count < target; count++) {
+			tree_node_ref& n = nodes[count];
+			// some roots, long chains off recent nodes, and the rest anywhere
+			int pick = rand () % 100;
+			n.parent = 0 == count || pick < 1 ? NO_TRANSFORM :
+				pick < 50 ? count - 1 - rand () % (count < 16 ? count : 16) :
+				(int)(((unsigned)rand () * RAND_MAX + rand ()) % count);
+			n.pos = rand_vec3 (-2.0f, 2.0f);
+			n.rot = rand_versor ();
+			n.scale = rand_vec3 (0.9f, 1.1f);
+			ok &= count == add_transform (t, n.parent, n.pos, n.rot, n.scale);
+		}
+		// and a move in the same update as the re-sort
+		int moved = rand () % count;
+		nodes[moved].pos = rand_vec3 (-2.0f, 2.0f);
+		set_transform_pos (t, moved, nodes[moved].pos);
+		double start = now_seconds ();
+		ok &= update_transforms (t);
+		t_full = now_seconds () - start;
+		ok &= tree_matches (t, nodes, ref, count);
+
+		// a few nodes anywhere in the forest, so only parts of it are dirty
+		for (int i = 0; i < 100; i++) {
+			int h = rand () % count;
+			tree_node_ref& n = nodes[h];
+			switch (rand () % 3) {
+				case 0:
+					n.pos = rand_vec3 (-2.0f, 2.0f);
+					set_transform_pos (t, h, n.pos);
+					break;
+				case 1:
+					n.rot = rand_versor ();
+					set_transform_rot (t, h, n.rot);
+					break;
+				default:
+					n.scale = rand_vec3 (0.9f, 1.1f);
+					set_transform (t, h, n.pos, n.rot, n.scale);
+					break;
+			}
+		}
+		start = now_seconds ();
+		ok &= update_transforms (t);
+		t_partial = now_seconds () - start;
+		ok &= tree_matches (t, nodes, ref, count);
+		// nothing changed since
+		ok &= !update_transforms (t);
+		ok &= tree_matches (t, nodes, ref, count);
+	}
+	set_worker_count (workers);
+	printf ("%-20s %-12i %8.3fms %8.3fms %7s   %s\n", "update_transforms",
+		count, t_full * 1e3, t_partial * 1e3, "", ok ? "ok" : "FAIL");
+	if (!ok) {
+		fprintf (stderr, "ERROR: the transform tree differs from the reference\n");
+	}
+	free_transform_tree (t);
+	return ok;
+}
+
+int main () {
+	srand (1234);
+	static mat4 rigid[NUM_MATS];
+	static mat4 affine[NUM_MATS];
+	static mat4 persp[NUM_MATS];
+	static mat4 general[NUM_MATS];
+	for (int i = 0; i < NUM_MATS; i++) {
+		rigid[i] = make_rigid ();
+		affine[i] = make_affine ();
+		persp[i] = make_perspective ();
+		general[i] = make_general ();
+	}
+
+	printf ("simd level: %s\n", simd_level_name (get_simd_level ()));
+	printf ("%-20s %-12s %10s %10s %7s   %-8s  %-8s\n",
+		"function", "matrices", "inverse()", "this", "speedup", "err(ref)",
+		"err(this)");
+	bool ok = true;
+	ok &= run ("inverse_rigid", "look_at", inverse_rigid, rigid);
+	ok &= run ("inverse_affine", "TRS", inverse_affine, affine);
+	ok &= run ("inverse_affine", "look_at", inverse_affine, rigid);
+	ok &= run ("inverse_perspective", "perspective", inverse_perspective, persp);
+	ok &= run ("inverse_simd", "P*V*M", inverse_simd, general);
+	ok &= run ("inverse_simd", "TRS", inverse_simd, affine);
+	if (!ok) {
+		fprintf (stderr, "ERROR: an inverse was less accurate than %g\n",
+			MAX_REL_ERROR);
+	}
+	ok &= run_mat4_levels (general, affine);
+	ok &= run_versors ();
+	ok &= run_culling ();
+	ok &= run_trig ();
+	ok &= run_bounds ();
+	ok &= run_batch ();
+	ok &= run_transform_tree ();
+	if (!ok) {
+		return 1;
+	}
+	return 0;
+}
@@ -13,101 +13,41 @@
 | A versor is the proper name for a unit quaternion.                           |
 \******************************************************************************/
 #include "maths_funcs.h"
+#include "maths_simd.h"
 #include <stdio.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-/*--------------------------------CONSTRUCTORS--------------------------------*/
-vec2::vec2 () {}
-
-vec2::vec2 (float x, float y) {
-	v[0] = x;
-	v[1] = y;
-}
-
-vec3::vec3 () {}
-
-vec3::vec3 (float x, float y, float z) {
-	v[0] = x;
-	v[1] = y;
-	v[2] = z;
-}
-
-vec3::vec3 (const vec2& vv, float z) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = z;
-}
-
-vec3::vec3 (const vec4& vv) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = vv.v[2];
-}
-
-vec4::vec4 () {}
-
-vec4::vec4 (float x, float y, float z, float w) {
-	v[0] = x;
-	v[1] = y;
-	v[2] = z;
-	v[3] = w;
-}
-
-vec4::vec4 (const vec2& vv, float z, float w) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = z;
-	v[3] = w;
-}
-
-vec4::vec4 (const vec3& vv, float w) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = vv.v[2];
-	v[3] = w;
-}
-
-mat3::mat3 () {}
-
-/* note: entered in COLUMNS */
-mat3::mat3 (float a, float b, float c,
-						float d, float e, float f,
-						float g, float h, float i) {
-	m[0] = a;
-	m[1] = b;
-	m[2] = c;
-	m[3] = d;
-	m[4] = e;
-	m[5] = f;
-	m[6] = g;
-	m[7] = h;
-	m[8] = i;
-}
-
-mat4::mat4 () {}
-
-/* note: entered in COLUMNS */
-mat4::mat4 (float a, float b, float c, float d,
-						float e, float f, float g, float h,
-						float i, float j, float k, float l,
-						float mm, float n, float o, float p) {
-	m[0] = a;
-	m[1] = b;
-	m[2] = c;
-	m[3] = d;
-	m[4] = e;
-	m[5] = f;
-	m[6] = g;
-	m[7] = h;
-	m[8] = i;
-	m[9] = j;
-	m[10] = k;
-	m[11] = l;
-	m[12] = mm;
-	m[13] = n;
-	m[14] = o;
-	m[15] = p;
+/* constructors, vec3 operators and the other small functions. see the note
+in maths_funcs.h about MATHS_HEADER_ONLY */
+#ifndef MATHS_HEADER_ONLY
+#include "maths_inline.h"
+#endif
+
+/* MATHS_FAST_TRIG swaps libm for the float polynomials in fast_trig.h. the
+default build calls exactly what it always did */
+#ifdef MATHS_FAST_TRIG
+#include "fast_trig.h"
+#endif
+
+// the rotations have always used double sin/cos
+static inline void sin_cos (float rad, float* s, float* c) {
+#ifdef MATHS_FAST_TRIG
+	fast_sincosf (rad, s, c);
+#else
+	*s = sin (rad);
+	*c = cos (rad);
+#endif
+}
+
+// and heading_to_direction() the float ones
+static inline void sinf_cosf (float rad, float* s, float* c) {
+#ifdef MATHS_FAST_TRIG
+	fast_sincosf (rad, s, c);
+#else
+	*s = sinf (rad);
+	*c = cosf (rad);
+#endif
 }
 
 /*-----------------------------PRINT FUNCTIONS--------------------------------*/
@@ -139,169 +79,25 @@ void print (const mat4& m) {
 }
 
 /*------------------------------VECTOR FUNCTIONS------------------------------*/
-float length (const vec3& v) {
-	return sqrt (v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2]);
-}
-
-// squared length
-float length2 (const vec3& v) {
-	return v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2];
-}
-
-// note: proper spelling (hehe)
-vec3 normalise (const vec3& v) {
-	vec3 vb;
-	float l = length (v);
-	if (0.0f == l) {
-		return vec3 (0.0f, 0.0f, 0.0f);
-	}
-	vb.v[0] = v.v[0] / l;
-	vb.v[1] = v.v[1] / l;
-	vb.v[2] = v.v[2] / l;
-	return vb;
-}
-
-vec3 vec3::operator+ (const vec3& rhs) {
-	vec3 vc;
-	vc.v[0] = v[0] + rhs.v[0];
-	vc.v[1] = v[1] + rhs.v[1];
-	vc.v[2] = v[2] + rhs.v[2];
-	return vc;
-}
-
-vec3& vec3::operator+= (const vec3& rhs) {
-	v[0] += rhs.v[0];
-	v[1] += rhs.v[1];
-	v[2] += rhs.v[2];
-	return *this; // return self
-}
-
-vec3 vec3::operator- (const vec3& rhs) {
-	vec3 vc;
-	vc.v[0] = v[0] - rhs.v[0];
-	vc.v[1] = v[1] - rhs.v[1];
-	vc.v[2] = v[2] - rhs.v[2];
-	return vc;
-}
-
-vec3& vec3::operator-= (const vec3& rhs) {
-	v[0] -= rhs.v[0];
-	v[1] -= rhs.v[1];
-	v[2] -= rhs.v[2];
-	return *this;
-}
-
-vec3 vec3::operator+ (float rhs) {
-	vec3 vc;
-	vc.v[0] = v[0] + rhs;
-	vc.v[1] = v[1] + rhs;
-	vc.v[2] = v[2] + rhs;
-	return vc;
-}
-
-vec3 vec3::operator- (float rhs) {
-	vec3 vc;
-	vc.v[0] = v[0] - rhs;
-	vc.v[1] = v[1] - rhs;
-	vc.v[2] = v[2] - rhs;
-	return vc;
-}
-
-vec3 vec3::operator* (float rhs) {
-	vec3 vc;
-	vc.v[0] = v[0] * rhs;
-	vc.v[1] = v[1] * rhs;
-	vc.v[2] = v[2] * rhs;
-	return vc;
-}
-
-vec3 vec3::operator/ (float rhs) {
-	vec3 vc;
-	vc.v[0] = v[0] / rhs;
-	vc.v[1] = v[1] / rhs;
-	vc.v[2] = v[2] / rhs;
-	return vc;
-}
-
-vec3& vec3::operator*= (float rhs) {
-	v[0] = v[0] * rhs;
-	v[1] = v[1] * rhs;
-	v[2] = v[2] * rhs;
-	return *this;
-}
-
-vec3& vec3::operator= (const vec3& rhs) {
-	v[0] = rhs.v[0];
-	v[1] = rhs.v[1];
-	v[2] = rhs.v[2];
-	return *this;
-}
-
-float dot (const vec3& a, const vec3& b) {
-	return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
-}
-
-vec3 cross (const vec3& a, const vec3& b) {
-	float x = a.v[1] * b.v[2] - a.v[2] * b.v[1];
-	float y = a.v[2] * b.v[0] - a.v[0] * b.v[2];
-	float z = a.v[0] * b.v[1] - a.v[1] * b.v[0];
-	return vec3 (x, y, z);
-}
-
-float get_squared_dist (vec3 from, vec3 to) {
-	float x = (to.v[0] - from.v[0]) * (to.v[0] - from.v[0]);
-	float y = (to.v[1] - from.v[1]) * (to.v[1] - from.v[1]);
-	float z = (to.v[2] - from.v[2]) * (to.v[2] - from.v[2]);
-	return x + y + z;
-}
-
 /* converts an un-normalised direction into a heading in degrees
 NB i suspect that the z is backwards here but i've used in in
 several places like this. d'oh! */
 float direction_to_heading (vec3 d) {
+#ifdef MATHS_FAST_TRIG
+	return fast_atan2f (-d.v[0], -d.v[2]) * ONE_RAD_IN_DEG;
+#else
 	return atan2 (-d.v[0], -d.v[2]) * ONE_RAD_IN_DEG;
+#endif
 }
 
 vec3 heading_to_direction (float degrees) {
 	float rad = degrees * ONE_DEG_IN_RAD;
-	return vec3 (-sinf (rad), 0.0f, -cosf (rad));
+	float s, c;
+	sinf_cosf (rad, &s, &c);
+	return vec3 (-s, 0.0f, -c);
 }
 
 /*-----------------------------MATRIX FUNCTIONS-------------------------------*/
-mat3 zero_mat3 () {
-	return mat3 (
-		0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.0f
-	);
-}
-
-mat3 identity_mat3 () {
-	return mat3 (
-		1.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 1.0f
-	);
-}
-
-mat4 zero_mat4 () {
-	return mat4 (
-		0.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 0.0f
-	);
-}
-
-mat4 identity_mat4 () {
-	return mat4 (
-		1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-	);
-}
-
 /* mat4 array layout
  0  4  8 12
  1  5  9 13
@@ -309,44 +105,19 @@ mat4 identity_mat4 () {
  3  7 11 15
 */
 
+/* both multiplies go through maths_simd.h. mat4 * mat4 picks sse4.1 or avx2
+at run-time and falls back to a plain scalar loop, and mat4 * vec4 is plain
+sse, inlined. every kernel adds the terms in the same order as the scalar
+code, so results are identical whatever cpu we're on */
 vec4 mat4::operator* (const vec4& rhs) {
-	// 0x + 4y + 8z + 12w
-	float x =
-		m[0] * rhs.v[0] +
-		m[4] * rhs.v[1] +
-		m[8] * rhs.v[2] +
-		m[12] * rhs.v[3];
-	// 1x + 5y + 9z + 13w
-	float y = m[1] * rhs.v[0] +
-		m[5] * rhs.v[1] +
-		m[9] * rhs.v[2] +
-		m[13] * rhs.v[3];
-	// 2x + 6y + 10z + 14w
-	float z = m[2] * rhs.v[0] +
-		m[6] * rhs.v[1] +
-		m[10] * rhs.v[2] +
-		m[14] * rhs.v[3];
-	// 3x + 7y + 11z + 15w
-	float w = m[3] * rhs.v[0] +
-		m[7] * rhs.v[1] +
-		m[11] * rhs.v[2] +
-		m[15] * rhs.v[3];
-	return vec4 (x, y, z, w);
+	vec4 r;
+	simd_mat4_mul_vec4 (m, rhs.v, r.v);
+	return r;
 }
 
 mat4 mat4::operator* (const mat4& rhs) {
-	mat4 r = zero_mat4 ();
-	int r_index = 0;
-	for (int col = 0; col < 4; col++) {
-		for (int row = 0; row < 4; row++) {
-			float sum = 0.0f;
-			for (int i = 0; i < 4; i++) {
-				sum += rhs.m[i + col * 4] * m[row + i * 4];
-			}
-			r.m[r_index] = sum;
-			r_index++;
-		}
-	}
+	mat4 r;
+	simd_mat4_mul (m, rhs.m, r.m);
 	return r;
 }
 
@@ -483,6 +254,101 @@ mat4 inverse (const mat4& mm) {
 	);
 }
 
+/* inverse of a rotation + translation. the rotation part is orthonormal so
+its inverse is its transpose, and the translation becomes -R^T * t */
+mat4 inverse_rigid (const mat4& mm) {
+	const float* m = mm.m;
+	mat4 r;
+	r.m[0] = m[0];
+	r.m[1] = m[4];
+	r.m[2] = m[8];
+	r.m[3] = 0.0f;
+	r.m[4] = m[1];
+	r.m[5] = m[5];
+	r.m[6] = m[9];
+	r.m[7] = 0.0f;
+	r.m[8] = m[2];
+	r.m[9] = m[6];
+	r.m[10] = m[10];
+	r.m[11] = 0.0f;
+	r.m[12] = -(m[0] * m[12] + m[1] * m[13] + m[2] * m[14]);
+	r.m[13] = -(m[4] * m[12] + m[5] * m[13] + m[6] * m[14]);
+	r.m[14] = -(m[8] * m[12] + m[9] * m[13] + m[10] * m[14]);
+	r.m[15] = 1.0f;
+	return r;
+}
+
+/* inverse of any affine matrix: invert the top 3x3 (cofactors over a 3x3
+determinant - 9 terms, not 24) then the translation becomes -A^-1 * t */
+mat4 inverse_affine (const mat4& mm) {
+	const float* m = mm.m;
+	float c00 = m[5] * m[10] - m[6] * m[9];
+	float c01 = m[6] * m[8] - m[4] * m[10];
+	float c02 = m[4] * m[9] - m[5] * m[8];
+	float det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+	if (0.0f == det) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return mm;
+	}
+	float inv_det = 1.0f / det;
+	mat4 r;
+	r.m[0] = c00 * inv_det;
+	r.m[1] = (m[2] * m[9] - m[1] * m[10]) * inv_det;
+	r.m[2] = (m[1] * m[6] - m[2] * m[5]) * inv_det;
+	r.m[3] = 0.0f;
+	r.m[4] = c01 * inv_det;
+	r.m[5] = (m[0] * m[10] - m[2] * m[8]) * inv_det;
+	r.m[6] = (m[2] * m[4] - m[0] * m[6]) * inv_det;
+	r.m[7] = 0.0f;
+	r.m[8] = c02 * inv_det;
+	r.m[9] = (m[1] * m[8] - m[0] * m[9]) * inv_det;
+	r.m[10] = (m[0] * m[5] - m[1] * m[4]) * inv_det;
+	r.m[11] = 0.0f;
+	r.m[12] = -(r.m[0] * m[12] + r.m[4] * m[13] + r.m[8] * m[14]);
+	r.m[13] = -(r.m[1] * m[12] + r.m[5] * m[13] + r.m[9] * m[14]);
+	r.m[14] = -(r.m[2] * m[12] + r.m[6] * m[13] + r.m[10] * m[14]);
+	r.m[15] = 1.0f;
+	return r;
+}
+
+/* inverse of a projection matrix like the one perspective() makes. only 0, 5,
+8, 9, 10, 11 and 14 are used; 8 and 9 are zero unless it's an off-centre
+frustum. worked out by hand:
+ 1/sx   0     0     a/sx
+ 0      1/sy  0     b/sy
+ 0      0     0     -1
+ 0      0     1/pz  sz/pz */
+mat4 inverse_perspective (const mat4& mm) {
+	const float* m = mm.m;
+	float sx = m[0];
+	float sy = m[5];
+	float sz = m[10];
+	float pz = m[14];
+	if (0.0f == sx || 0.0f == sy || 0.0f == pz) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return mm;
+	}
+	mat4 r = zero_mat4 ();
+	r.m[0] = 1.0f / sx;
+	r.m[5] = 1.0f / sy;
+	r.m[11] = 1.0f / pz;
+	r.m[12] = m[8] / sx;
+	r.m[13] = m[9] / sy;
+	r.m[14] = -1.0f;
+	r.m[15] = sz / pz;
+	return r;
+}
+
+// general inverse using the sse kernel in maths_simd.cpp when we can
+mat4 inverse_simd (const mat4& mm) {
+	mat4 r;
+	if (0.0f != simd_mat4_inverse (mm.m, r.m)) {
+		return r;
+	}
+	// no sse, or singular (in which case inverse() prints the warning)
+	return inverse (mm);
+}
+
 // returns a 16-element array flipped on the main diagonal
 mat4 transpose (const mat4& mm) {
 	return mat4 (
@@ -494,58 +360,170 @@ mat4 transpose (const mat4& mm) {
 }
 
 /*--------------------------AFFINE MATRIX FUNCTIONS---------------------------*/
-// translate a 4d matrix with xyz array
+/* these used to build an identity matrix and do a full mat4 * mat4 with it.
+they now only touch the rows (or, for the _post versions, columns) that
+change. multiplying by the 0s and 1s of the identity is exact, so the results
+are the same as before */
+
+// translate a 4d matrix with xyz array. r = T * m
 mat4 translate (const mat4& m, const vec3& v) {
-	mat4 m_t = identity_mat4 ();
-	m_t.m[12] = v.v[0];
-	m_t.m[13] = v.v[1];
-	m_t.m[14] = v.v[2];
-	return m_t * m;
+	mat4 r = m;
+	for (int col = 0; col < 4; col++) {
+		float w = m.m[col * 4 + 3];
+		r.m[col * 4] = m.m[col * 4] + v.v[0] * w;
+		r.m[col * 4 + 1] = m.m[col * 4 + 1] + v.v[1] * w;
+		r.m[col * 4 + 2] = m.m[col * 4 + 2] + v.v[2] * w;
+	}
+	return r;
 }
 
 // rotate around x axis by an angle in degrees
 mat4 rotate_x_deg (const mat4& m, float deg) {
 	// convert to radians
 	float rad = deg * ONE_DEG_IN_RAD;
-	mat4 m_r = identity_mat4 ();
-	m_r.m[5] = cos (rad);
-	m_r.m[9] = -sin (rad);
-	m_r.m[6] = sin (rad);
-	m_r.m[10] = cos (rad);
-	return m_r * m;
+	float s, c;
+	sin_cos (rad, &s, &c);
+	mat4 r = m;
+	for (int col = 0; col < 4; col++) {
+		float y = m.m[col * 4 + 1];
+		float z = m.m[col * 4 + 2];
+		r.m[col * 4 + 1] = c * y + -s * z;
+		r.m[col * 4 + 2] = s * y + c * z;
+	}
+	return r;
 }
 
 // rotate around y axis by an angle in degrees
 mat4 rotate_y_deg (const mat4& m, float deg) {
 	// convert to radians
 	float rad = deg * ONE_DEG_IN_RAD;
-	mat4 m_r = identity_mat4 ();
-	m_r.m[0] = cos (rad);
-	m_r.m[8] = sin (rad);
-	m_r.m[2] = -sin (rad);
-	m_r.m[10] = cos (rad);
-	return m_r * m;
+	float s, c;
+	sin_cos (rad, &s, &c);
+	mat4 r = m;
+	for (int col = 0; col < 4; col++) {
+		float x = m.m[col * 4];
+		float z = m.m[col * 4 + 2];
+		r.m[col * 4] = c * x + s * z;
+		r.m[col * 4 + 2] = -s * x + c * z;
+	}
+	return r;
 }
 
 // rotate around z axis by an angle in degrees
 mat4 rotate_z_deg (const mat4& m, float deg) {
 	// convert to radians
 	float rad = deg * ONE_DEG_IN_RAD;
-	mat4 m_r = identity_mat4 ();
-	m_r.m[0] = cos (rad);
-	m_r.m[4] = -sin (rad);
-	m_r.m[1] = sin (rad);
-	m_r.m[5] = cos (rad);
-	return m_r * m;
+	float s, c;
+	sin_cos (rad, &s, &c);
+	mat4 r = m;
+	for (int col = 0; col < 4; col++) {
+		float x = m.m[col * 4];
+		float y = m.m[col * 4 + 1];
+		r.m[col * 4] = c * x + -s * y;
+		r.m[col * 4 + 1] = s * x + c * y;
+	}
+	return r;
 }
 
 // scale a matrix by [x, y, z]
 mat4 scale (const mat4& m, const vec3& v) {
-	mat4 a = identity_mat4 ();
-	a.m[0] = v.v[0];
-	a.m[5] = v.v[1];
-	a.m[10] = v.v[2];
-	return a * m;
+	mat4 r = m;
+	for (int col = 0; col < 4; col++) {
+		r.m[col * 4] = v.v[0] * m.m[col * 4];
+		r.m[col * 4 + 1] = v.v[1] * m.m[col * 4 + 1];
+		r.m[col * 4 + 2] = v.v[2] * m.m[col * 4 + 2];
+	}
+	return r;
+}
+
+/* model matrix T * R * S straight from its parts. the rotation is
+quat_to_mat4 (r), with each column multiplied by its scale factor */
+mat4 make_trs (const vec3& t, const versor& r, const vec3& s) {
+	mat4 m = quat_to_mat4 (r);
+	for (int col = 0; col < 3; col++) {
+		m.m[col * 4] *= s.v[col];
+		m.m[col * 4 + 1] *= s.v[col];
+		m.m[col * 4 + 2] *= s.v[col];
+	}
+	m.m[12] = t.v[0];
+	m.m[13] = t.v[1];
+	m.m[14] = t.v[2];
+	return m;
+}
+
+// T * R. same as make_trs () with a scale of 1
+mat4 make_rt (const vec3& t, const versor& r) {
+	mat4 m = quat_to_mat4 (r);
+	m.m[12] = t.v[0];
+	m.m[13] = t.v[1];
+	m.m[14] = t.v[2];
+	return m;
+}
+
+// m = m * T. only the last column changes
+void post_translate (mat4& m, const vec3& v) {
+	for (int row = 0; row < 4; row++) {
+		m.m[12 + row] = m.m[row] * v.v[0] + m.m[4 + row] * v.v[1] +
+			m.m[8 + row] * v.v[2] + m.m[12 + row];
+	}
+}
+
+/* m = m * R for a rotation about one axis. mixes the two columns that
+aren't the axis: a' = c * a + s * b, b' = c * b - s * a */
+static void post_rotate_columns (mat4& m, int a, int b, float c, float s) {
+	for (int row = 0; row < 4; row++) {
+		float ma = m.m[a * 4 + row];
+		float mb = m.m[b * 4 + row];
+		m.m[a * 4 + row] = ma * c + mb * s;
+		m.m[b * 4 + row] = ma * -s + mb * c;
+	}
+}
+
+void post_rotate_x_deg (mat4& m, float deg) {
+	float rad = deg * ONE_DEG_IN_RAD;
+	float s, c;
+	sin_cos (rad, &s, &c);
+	post_rotate_columns (m, 1, 2, c, s);
+}
+
+void post_rotate_y_deg (mat4& m, float deg) {
+	float rad = deg * ONE_DEG_IN_RAD;
+	float s, c;
+	sin_cos (rad, &s, &c);
+	// z then x, going round the axes in order
+	post_rotate_columns (m, 2, 0, c, s);
+}
+
+void post_rotate_z_deg (mat4& m, float deg) {
+	float rad = deg * ONE_DEG_IN_RAD;
+	float s, c;
+	sin_cos (rad, &s, &c);
+	post_rotate_columns (m, 0, 1, c, s);
+}
+
+// m = m * quat_to_mat4 (q). 27 multiplies instead of 64
+void post_rotate (mat4& m, const versor& q) {
+	mat4 r = quat_to_mat4 (q);
+	float cols[12];
+	for (int col = 0; col < 3; col++) {
+		for (int row = 0; row < 4; row++) {
+			cols[col * 4 + row] = m.m[row] * r.m[col * 4] +
+				m.m[4 + row] * r.m[col * 4 + 1] + m.m[8 + row] * r.m[col * 4 + 2];
+		}
+	}
+	for (int i = 0; i < 12; i++) {
+		m.m[i] = cols[i];
+	}
+}
+
+// m = m * S. scales the first three columns
+void post_scale (mat4& m, const vec3& v) {
+	for (int col = 0; col < 3; col++) {
+		m.m[col * 4] *= v.v[col];
+		m.m[col * 4 + 1] *= v.v[col];
+		m.m[col * 4 + 2] *= v.v[col];
+		m.m[col * 4 + 3] *= v.v[col];
+	}
 }
 
 /*-----------------------VIRTUAL CAMERA MATRIX FUNCTIONS----------------------*/
@@ -579,7 +557,11 @@ mat4 look_at (const vec3& cam_pos, vec3 targ_pos, const vec3& up) {
 // returns a perspective function mimicking the opengl projection style.
 mat4 perspective (float fovy, float aspect, float near, float far) {
 	float fov_rad = fovy * ONE_DEG_IN_RAD;
+#ifdef MATHS_FAST_TRIG
+	float range = fast_tanf (fov_rad / 2.0f) * near;
+#else
 	float range = tan (fov_rad / 2.0f) * near;
+#endif
 	float sx = (2.0f * near) / (range * aspect + range * aspect);
 	float sy = near / range;
 	float sz = -(far + near) / (far - near);
@@ -594,8 +576,6 @@ mat4 perspective (float fovy, float aspect, float near, float far) {
 }
 
 /*----------------------------HAMILTON IN DA HOUSE!---------------------------*/
-versor::versor () { }
-
 versor versor::operator/ (float rhs) {
 	versor result;
 	result.q[0] = q[0] / rhs;
@@ -644,10 +624,19 @@ versor versor::operator+ (const versor& rhs) {
 
 versor quat_from_axis_rad (float radians, float x, float y, float z) {
 	versor result;
+#ifdef MATHS_FAST_TRIG
+	float s, c;
+	fast_sincosf (radians * 0.5f, &s, &c);
+	result.q[0] = c;
+	result.q[1] = s * x;
+	result.q[2] = s * y;
+	result.q[3] = s * z;
+#else
 	result.q[0] = cos (radians / 2.0);
 	result.q[1] = sin (radians / 2.0) * x;
 	result.q[2] = sin (radians / 2.0) * y;
 	result.q[3] = sin (radians / 2.0) * z;
+#endif
 	return result;
 }
 
@@ -696,10 +685,6 @@ versor normalise (versor& q) {
 	return q / mag;
 }
 
-float dot (const versor& q, const versor& r) {
-	return q.q[0] * r.q[0] + q.q[1] * r.q[1] + q.q[2] * r.q[2] + q.q[3] * r.q[3];
-}
-
 versor slerp (versor& q, versor& r, float t) {
 	// angle between q0-q1
 	float cos_half_theta = dot (q, r);
@@ -21,55 +21,69 @@
 #define ONE_DEG_IN_RAD (2.0 * M_PI) / 360.0 // 0.017444444
 #define ONE_RAD_IN_DEG 360.0 / (2.0 * M_PI) //57.2957795
 
+/* build everything with -DMATHS_HEADER_ONLY (make MATHS_HEADER_ONLY=1) and
+the constructors, vec3 operators and small vector functions marked below come
+from maths_inline.h as inline/constexpr code, instead of being calls into
+maths_funcs.cpp. then e.g. "constexpr vec3 up (0.0f, 1.0f, 0.0f)" works and
+vec3 maths in hot loops folds away without LTO. don't mix the two in one
+program */
+#ifdef MATHS_HEADER_ONLY
+#define MATHS_INLINE inline
+#define MATHS_CONSTEXPR constexpr
+#else
+#define MATHS_INLINE
+#define MATHS_CONSTEXPR
+#endif
+
 struct vec2;
 struct vec3;
 struct vec4;
 struct versor;
 
 struct vec2 {
-	vec2 ();
-	vec2 (float x, float y);
+	MATHS_INLINE vec2 ();
+	MATHS_CONSTEXPR vec2 (float x, float y);
 	float v[2];
 };
 
 struct vec3 {
-	vec3 ();
+	MATHS_INLINE vec3 ();
 	// create from 3 scalars
-	vec3 (float x, float y, float z);
+	MATHS_CONSTEXPR vec3 (float x, float y, float z);
 	// create from vec2 and a scalar
-	vec3 (const vec2& vv, float z);
+	MATHS_CONSTEXPR vec3 (const vec2& vv, float z);
 	// create from truncated vec4
-	vec3 (const vec4& vv);
+	MATHS_CONSTEXPR vec3 (const vec4& vv);
 	// add vector to vector
-	vec3 operator+ (const vec3& rhs);
+	MATHS_CONSTEXPR vec3 operator+ (const vec3& rhs) const;
 	// add scalar to vector
-	vec3 operator+ (float rhs);
+	MATHS_CONSTEXPR vec3 operator+ (float rhs) const;
 	// because user's expect this too
-	vec3& operator+= (const vec3& rhs);
+	MATHS_CONSTEXPR vec3& operator+= (const vec3& rhs);
 	// subtract vector from vector
-	vec3 operator- (const vec3& rhs);
+	MATHS_CONSTEXPR vec3 operator- (const vec3& rhs) const;
 	// add vector to vector
-	vec3 operator- (float rhs);
+	MATHS_CONSTEXPR vec3 operator- (float rhs) const;
 	// because users expect this too
-	vec3& operator-= (const vec3& rhs);
+	MATHS_CONSTEXPR vec3& operator-= (const vec3& rhs);
 	// multiply with scalar
-	vec3 operator* (float rhs);
+	MATHS_CONSTEXPR vec3 operator* (float rhs) const;
 	// because users expect this too
-	vec3& operator*= (float rhs);
+	MATHS_CONSTEXPR vec3& operator*= (float rhs);
 	// divide vector by scalar
-	vec3 operator/ (float rhs);
+	MATHS_CONSTEXPR vec3 operator/ (float rhs) const;
 	// because users expect this too
-	vec3& operator= (const vec3& rhs);
+	MATHS_CONSTEXPR vec3& operator= (const vec3& rhs);
 	
 	// internal data
 	float v[3];
 };
 
 struct vec4 {
-	vec4 ();
-	vec4 (float x, float y, float z, float w);
-	vec4 (const vec2& vv, float z, float w);
-	vec4 (const vec3& vv, float w);
+	MATHS_INLINE vec4 ();
+	MATHS_CONSTEXPR vec4 (float x, float y, float z, float w);
+	MATHS_CONSTEXPR vec4 (const vec2& vv, float z, float w);
+	MATHS_CONSTEXPR vec4 (const vec3& vv, float w);
 	float v[4];
 };
 
@@ -78,8 +92,8 @@ a d g
 b e h
 c f i */
 struct mat3 {
-	mat3 ();
-	mat3 (float a, float b, float c,
+	MATHS_INLINE mat3 ();
+	MATHS_CONSTEXPR mat3 (float a, float b, float c,
 				float d, float e, float f,
 				float g, float h, float i);
 	float m[9];
@@ -89,11 +103,14 @@ struct mat3 {
 0 4 8  12
 1 5 9  13
 2 6 10 14
-3 7 11 15*/
-struct mat4 {
-	mat4 ();
+3 7 11 15
+aligned to a cache line so the simd kernels in maths_simd.cpp never load a
+matrix that straddles two lines. it's still 16 floats, so arrays of mat4 can
+go straight to glUniformMatrix4fv as before */
+struct alignas (64) mat4 {
+	MATHS_INLINE mat4 ();
 	// note! this is entering components in ROW-major order
-	mat4 (float a, float b, float c, float d,
+	MATHS_CONSTEXPR mat4 (float a, float b, float c, float d,
 				float e, float f, float g, float h,
 				float i, float j, float k, float l,
 				float mm, float n, float o, float p);
@@ -104,7 +121,7 @@ struct mat4 {
 };
 
 struct versor {
-	versor ();
+	MATHS_INLINE versor ();
 	versor operator/ (float rhs);
 	versor operator* (float rhs);
 	versor operator* (const versor& rhs);
@@ -118,21 +135,32 @@ void print (const vec4& v);
 void print (const mat3& m);
 void print (const mat4& m);
 // vector functions
-float length (const vec3& v);
-float length2 (const vec3& v);
-vec3 normalise (const vec3& v);
-float dot (const vec3& a, const vec3& b);
-vec3 cross (const vec3& a, const vec3& b);
-float get_squared_dist (vec3 from, vec3 to);
+MATHS_INLINE float length (const vec3& v);
+MATHS_CONSTEXPR float length2 (const vec3& v);
+MATHS_INLINE vec3 normalise (const vec3& v);
+MATHS_CONSTEXPR float dot (const vec3& a, const vec3& b);
+MATHS_CONSTEXPR vec3 cross (const vec3& a, const vec3& b);
+MATHS_CONSTEXPR float get_squared_dist (vec3 from, vec3 to);
 float direction_to_heading (vec3 d);
 vec3 heading_to_direction (float degrees);
 // matrix functions
-mat3 zero_mat3 ();
-mat3 identity_mat3 ();
-mat4 zero_mat4 ();
-mat4 identity_mat4 ();
+MATHS_CONSTEXPR mat3 zero_mat3 ();
+MATHS_CONSTEXPR mat3 identity_mat3 ();
+MATHS_CONSTEXPR mat4 zero_mat4 ();
+MATHS_CONSTEXPR mat4 identity_mat4 ();
 float determinant (const mat4& mm);
 mat4 inverse (const mat4& mm);
+/* cheaper inverses for the matrices we actually invert. they don't check that
+the matrix really has the right shape - that's up to the caller */
+// rotation + translation only (e.g. look_at). transpose the rotation
+mat4 inverse_rigid (const mat4& mm);
+// any affine matrix (bottom row 0 0 0 1), e.g. a model TRS matrix
+mat4 inverse_affine (const mat4& mm);
+// a projection from perspective(), or an off-centre frustum
+mat4 inverse_perspective (const mat4& mm);
+/* same as inverse() but with SSE where the cpu has it. not bit-identical to
+inverse(), errors are a few ULP. see maths_bench.cpp */
+mat4 inverse_simd (const mat4& mm);
 mat4 transpose (const mat4& mm);
 // affine functions
 mat4 translate (const mat4& m, const vec3& v);
@@ -140,6 +168,19 @@ mat4 rotate_x_deg (const mat4& m, float deg);
 mat4 rotate_y_deg (const mat4& m, float deg);
 mat4 rotate_z_deg (const mat4& m, float deg);
 mat4 scale (const mat4& m, const vec3& v);
+/* build a model matrix T * R * S directly, instead of composing it with the
+functions above. a lot cheaper: no matrix multiplies at all */
+mat4 make_trs (const vec3& t, const versor& r, const vec3& s);
+// T * R, for when there's no scale
+mat4 make_rt (const vec3& t, const versor& r);
+/* in-place post-multiplies, m = m * X. the functions above pre-multiply, i.e.
+apply X after m; these apply X before m, e.g. in the object's local space */
+void post_translate (mat4& m, const vec3& v);
+void post_rotate_x_deg (mat4& m, float deg);
+void post_rotate_y_deg (mat4& m, float deg);
+void post_rotate_z_deg (mat4& m, float deg);
+void post_rotate (mat4& m, const versor& q);
+void post_scale (mat4& m, const vec3& v);
 // camera functions
 mat4 look_at (const vec3& cam_pos, vec3 targ_pos, const vec3& up);
 mat4 perspective (float fovy, float aspect, float near, float far);
@@ -147,10 +188,14 @@ mat4 perspective (float fovy, float aspect, float near, float far);
 versor quat_from_axis_rad (float radians, float x, float y, float z);
 versor quat_from_axis_deg (float degrees, float x, float y, float z);
 mat4 quat_to_mat4 (const versor& q);
-float dot (const versor& q, const versor& r);
+MATHS_CONSTEXPR float dot (const versor& q, const versor& r);
 versor slerp (const versor& q, const versor& r);
 // stupid overloading wouldn't let me use const
 versor normalise (versor& q);
 void print (const versor& q);
 versor slerp (versor& q, versor& r, float t);
+
+#ifdef MATHS_HEADER_ONLY
+#include "maths_inline.h"
+#endif
 #endif
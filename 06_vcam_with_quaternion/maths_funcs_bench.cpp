@@ -0,0 +1,461 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Micro-benchmarks for the functions in maths_funcs.h. No GL needed.           |
+| Each function is run over arrays of random inputs, and the median of several |
+| trials is reported as ns per call and calls per second, in JSON on stdout.   |
+| Compare with a file this program wrote before, and we exit with 1 if         |
+| anything got slower than the baseline by more than the tolerance, or by more |
+| than the noise seen while timing that function, whichever is more:           |
+|   ./maths_funcs_bench --baseline funcs_baseline.json [--tolerance 0.5]       |
+|   ./maths_funcs_bench --write-baseline funcs_baseline.json                   |
+| "make funcs_bench" does the first, "make funcs_baseline" the second. The     |
+| first run records a baseline if there isn't one. Baselines only mean         |
+| anything on the machine that recorded them, so none is checked in. Inverses, |
+| mat4 products, slerp and the other functions maths_bench times are left to   |
+| it.                                                                          |
+\******************************************************************************/
+#include "maths_funcs.h"
+#include "maths_simd.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+// inputs per array. small enough to stay in cache, so we time the maths
+#define NUM_ITEMS 4096
+#define NUM_TRIALS 7
+// each trial runs for at least this long
+#define MIN_TRIAL_SECONDS 0.005
+#define DEFAULT_TOLERANCE 0.5
+// a function is allowed this many times its measured spread, if that's more
+#define SPREAD_FACTOR 3.0
+#define MAX_BENCHES 64
+
+/*-------------------------------INPUTS/OUTPUTS-------------------------------*/
+static mat4 g_affine[NUM_ITEMS];
+static vec3 g_va[NUM_ITEMS], g_vb[NUM_ITEMS];
+static versor g_qa[NUM_ITEMS], g_qb[NUM_ITEMS];
+static float g_f[NUM_ITEMS], g_t[NUM_ITEMS];
+/* results go here. they're not static, and the benches are only called
+through a pointer, so the compiler can't throw the work away */
+mat4 g_out_mat[NUM_ITEMS];
+vec3 g_out_vec3[NUM_ITEMS];
+versor g_out_versor[NUM_ITEMS];
+float g_out_float[NUM_ITEMS];
+
+static float rand_range (float lo, float hi) {
+	return lo + (hi - lo) * ((float)rand () / (float)RAND_MAX);
+}
+
+static vec3 rand_vec3 (float lo, float hi) {
+	return vec3 (rand_range (lo, hi), rand_range (lo, hi), rand_range (lo, hi));
+}
+
+static versor rand_versor () {
+	vec3 axis = normalise (rand_vec3 (-1.0f, 1.0f) + vec3 (0.0f, 0.01f, 0.0f));
+	return quat_from_axis_deg (rand_range (-180.0f, 180.0f), axis.v[0],
+		axis.v[1], axis.v[2]);
+}
+
+static void make_inputs () {
+	srand (1234);
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_va[i] = rand_vec3 (-100.0f, 100.0f);
+		g_vb[i] = rand_vec3 (-100.0f, 100.0f);
+		g_qa[i] = rand_versor ();
+		g_qb[i] = rand_versor ();
+		g_f[i] = rand_range (-360.0f, 360.0f);
+		g_t[i] = rand_range (0.0f, 1.0f);
+		g_affine[i] = make_trs (g_va[i], g_qa[i], rand_vec3 (0.1f, 10.0f));
+	}
+}
+
+/*-----------------------------------BENCHES----------------------------------*/
+// each one does NUM_ITEMS calls
+static void bench_determinant () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_float[i] = determinant (g_affine[i]);
+	}
+}
+
+static void bench_transpose () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = transpose (g_affine[i]);
+	}
+}
+
+static void bench_translate () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = translate (g_affine[i], g_va[i]);
+	}
+}
+
+static void bench_rotate_x_deg () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = rotate_x_deg (g_affine[i], g_f[i]);
+	}
+}
+
+static void bench_rotate_y_deg () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = rotate_y_deg (g_affine[i], g_f[i]);
+	}
+}
+
+static void bench_rotate_z_deg () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = rotate_z_deg (g_affine[i], g_f[i]);
+	}
+}
+
+static void bench_scale () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = scale (g_affine[i], g_va[i]);
+	}
+}
+
+static void bench_make_rt () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = make_rt (g_va[i], g_qa[i]);
+	}
+}
+
+// the post_ functions work in place, so copy the input first
+static void bench_post_translate () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = g_affine[i];
+		post_translate (g_out_mat[i], g_va[i]);
+	}
+}
+
+static void bench_post_rotate_x_deg () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = g_affine[i];
+		post_rotate_x_deg (g_out_mat[i], g_f[i]);
+	}
+}
+
+static void bench_post_rotate () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = g_affine[i];
+		post_rotate (g_out_mat[i], g_qa[i]);
+	}
+}
+
+static void bench_post_scale () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = g_affine[i];
+		post_scale (g_out_mat[i], g_va[i]);
+	}
+}
+
+static void bench_look_at () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = look_at (g_va[i], g_vb[i], vec3 (0.0f, 1.0f, 0.0f));
+	}
+}
+
+static void bench_perspective () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_mat[i] = perspective (67.0f + g_t[i], 1.333f, 0.1f, 100.0f);
+	}
+}
+
+static void bench_quat_from_axis_deg () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_versor[i] = quat_from_axis_deg (g_f[i], 0.0f, 1.0f, 0.0f);
+	}
+}
+
+static void bench_dot_versor () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_float[i] = dot (g_qa[i], g_qb[i]);
+	}
+}
+
+static void bench_vec3_arithmetic () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_vec3[i] = (g_va[i] + g_vb[i]) * 0.5f - g_vb[i] / 3.0f;
+	}
+}
+
+static void bench_normalise_vec3 () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_vec3[i] = normalise (g_va[i]);
+	}
+}
+
+static void bench_length () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_float[i] = length (g_va[i]);
+	}
+}
+
+static void bench_dot () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_float[i] = dot (g_va[i], g_vb[i]);
+	}
+}
+
+static void bench_cross () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_vec3[i] = cross (g_va[i], g_vb[i]);
+	}
+}
+
+static void bench_get_squared_dist () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_float[i] = get_squared_dist (g_va[i], g_vb[i]);
+	}
+}
+
+static void bench_direction_to_heading () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_float[i] = direction_to_heading (g_va[i]);
+	}
+}
+
+static void bench_heading_to_direction () {
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		g_out_vec3[i] = heading_to_direction (g_f[i]);
+	}
+}
+
+typedef void (*bench_fn) ();
+
+struct bench {
+	const char* name;
+	bench_fn fn;
+};
+
+static const bench g_benches[] = {
+	{ "determinant", bench_determinant },
+	{ "transpose", bench_transpose },
+	{ "translate", bench_translate },
+	{ "rotate_x_deg", bench_rotate_x_deg },
+	{ "rotate_y_deg", bench_rotate_y_deg },
+	{ "rotate_z_deg", bench_rotate_z_deg },
+	{ "scale", bench_scale },
+	{ "make_rt", bench_make_rt },
+	{ "post_translate", bench_post_translate },
+	{ "post_rotate_x_deg", bench_post_rotate_x_deg },
+	{ "post_rotate", bench_post_rotate },
+	{ "post_scale", bench_post_scale },
+	{ "look_at", bench_look_at },
+	{ "perspective", bench_perspective },
+	{ "quat_from_axis_deg", bench_quat_from_axis_deg },
+	{ "dot_versor", bench_dot_versor },
+	{ "vec3_arithmetic", bench_vec3_arithmetic },
+	{ "normalise_vec3", bench_normalise_vec3 },
+	{ "length", bench_length },
+	{ "dot", bench_dot },
+	{ "cross", bench_cross },
+	{ "get_squared_dist", bench_get_squared_dist },
+	{ "direction_to_heading", bench_direction_to_heading },
+	{ "heading_to_direction", bench_heading_to_direction }
+};
+#define NUM_BENCHES (int)(sizeof (g_benches) / sizeof (g_benches[0]))
+
+/*---------------------------------MEASURING----------------------------------*/
+static double now_seconds () {
+	timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static int compare_doubles (const void* a, const void* b) {
+	double da = *(const double*)a;
+	double db = *(const double*)b;
+	return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+struct timing {
+	double fastest; // ns per call
+	double median; // ns per call. this is what gets compared with the baseline
+	// spread of the middle half of the trials, as a fraction of the median
+	double spread;
+};
+
+static timing time_bench (bench_fn fn) {
+	// warm up, and work out how many passes fill a trial
+	double start = now_seconds ();
+	fn ();
+	double one = now_seconds () - start;
+	int passes = 1;
+	if (one < MIN_TRIAL_SECONDS) {
+		passes = (int)(MIN_TRIAL_SECONDS / (one > 1e-9 ? one : 1e-9)) + 1;
+	}
+	double ns[NUM_TRIALS];
+	for (int trial = 0; trial < NUM_TRIALS; trial++) {
+		start = now_seconds ();
+		for (int p = 0; p < passes; p++) {
+			fn ();
+		}
+		ns[trial] = (now_seconds () - start) * 1e9 / ((double)passes * NUM_ITEMS);
+	}
+	qsort (ns, NUM_TRIALS, sizeof (double), compare_doubles);
+	timing t;
+	t.fastest = ns[0];
+	t.median = ns[NUM_TRIALS / 2];
+	t.spread = (ns[NUM_TRIALS * 3 / 4] - ns[NUM_TRIALS / 4]) / t.median;
+	return t;
+}
+
+/*----------------------------------BASELINE----------------------------------*/
+struct baseline_entry {
+	char name[64];
+	double median;
+	double spread;
+};
+
+/* reads back the json we write below. it's one result per line, so we don't
+need a real json parser. returns the number of entries, or -1 if there is no
+such file */
+static int read_baseline (const char* file_name, baseline_entry* entries,
+	int max_entries) {
+	FILE* fp = fopen (file_name, "r");
+	if (!fp) {
+		return -1;
+	}
+	int count = 0;
+	char line[512];
+	while (fgets (line, sizeof (line), fp) && count < max_entries) {
+		baseline_entry& e = entries[count];
+		double fastest;
+		if (4 == sscanf (line, " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, "
+			"\"ns_per_op_median\": %lf, \"spread\": %lf", e.name, &fastest,
+			&e.median, &e.spread)) {
+			count++;
+		}
+	}
+	fclose (fp);
+	return count;
+}
+
+static void write_json (FILE* fp, const timing* timings) {
+	fprintf (fp, "{\n");
+	fprintf (fp, "  \"simd_level\": \"%s\",\n",
+		simd_level_name (get_simd_level ()));
+	fprintf (fp, "  \"items\": %i,\n", NUM_ITEMS);
+	fprintf (fp, "  \"trials\": %i,\n", NUM_TRIALS);
+	fprintf (fp, "  \"results\": [\n");
+	for (int i = 0; i < NUM_BENCHES; i++) {
+		fprintf (fp, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, "
+			"\"ns_per_op_median\": %.3f, \"spread\": %.3f, "
+			"\"ops_per_sec\": %.4g}%s\n",
+			g_benches[i].name, timings[i].fastest, timings[i].median,
+			timings[i].spread, 1e9 / timings[i].median,
+			i + 1 < NUM_BENCHES ? "," : "");
+	}
+	fprintf (fp, "  ]\n");
+	fprintf (fp, "}\n");
+}
+
+static bool write_baseline (const char* file_name, const timing* timings) {
+	FILE* fp = fopen (file_name, "w");
+	if (!fp) {
+		fprintf (stderr, "ERROR: could not write baseline %s\n", file_name);
+		return false;
+	}
+	write_json (fp, timings);
+	fclose (fp);
+	return true;
+}
+
+static void print_usage () {
+	fprintf (stderr, "usage: maths_funcs_bench [--baseline FILE] "
+		"[--tolerance FRACTION] [--write-baseline FILE]\n");
+}
+
+int main (int argc, char** argv) {
+	const char* baseline_file = NULL;
+	const char* write_file = NULL;
+	double tolerance = DEFAULT_TOLERANCE;
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp (argv[i], "--baseline") && i + 1 < argc) {
+			baseline_file = argv[++i];
+		} else if (0 == strcmp (argv[i], "--write-baseline") && i + 1 < argc) {
+			write_file = argv[++i];
+		} else if (0 == strcmp (argv[i], "--tolerance") && i + 1 < argc) {
+			tolerance = atof (argv[++i]);
+		} else {
+			print_usage ();
+			return 1;
+		}
+	}
+
+	make_inputs ();
+	timing timings[NUM_BENCHES];
+	for (int i = 0; i < NUM_BENCHES; i++) {
+		timings[i] = time_bench (g_benches[i].fn);
+	}
+	write_json (stdout, timings);
+
+	if (write_file && !write_baseline (write_file, timings)) {
+		return 1;
+	}
+	if (!baseline_file) {
+		return 0;
+	}
+	baseline_entry entries[MAX_BENCHES];
+	int num_entries = read_baseline (baseline_file, entries, MAX_BENCHES);
+	if (num_entries < 0) {
+		// first run on this machine. nothing to compare with yet
+		fprintf (stderr, "no baseline %s yet, recording this run as one\n",
+			baseline_file);
+		return write_baseline (baseline_file, timings) ? 0 : 1;
+	}
+	int regressions = 0;
+	for (int i = 0; i < NUM_BENCHES; i++) {
+		const baseline_entry* e = NULL;
+		for (int j = 0; j < num_entries; j++) {
+			if (0 == strcmp (entries[j].name, g_benches[i].name)) {
+				e = &entries[j];
+				break;
+			}
+		}
+		if (!e) {
+			fprintf (stderr, "WARNING: %s is not in baseline %s\n",
+				g_benches[i].name, baseline_file);
+			continue;
+		}
+		/* a function that was noisy when either run was timed gets more
+		room. short functions are the noisiest, so this is per function */
+		double allowed = tolerance;
+		double spread = e->spread > timings[i].spread ?
+			e->spread : timings[i].spread;
+		if (SPREAD_FACTOR * spread > allowed) {
+			allowed = SPREAD_FACTOR * spread;
+		}
+		double median = timings[i].median;
+		if (median > e->median * (1.0 + allowed)) {
+			// noise only ever makes things slower, so look again before failing
+			timing again = time_bench (g_benches[i].fn);
+			if (again.median < median) {
+				median = again.median;
+			}
+		}
+		if (median > e->median * (1.0 + allowed)) {
+			fprintf (stderr, "ERROR: %s regressed: %.3f ns/op, baseline %.3f "
+				"(+%.0f%%, allowed %.0f%%)\n", g_benches[i].name, median,
+				e->median, (median / e->median - 1.0) * 100.0, allowed * 100.0);
+			regressions++;
+		}
+	}
+	if (regressions > 0) {
+		fprintf (stderr, "ERROR: %i of %i functions slower than baseline %s\n",
+			regressions, NUM_BENCHES, baseline_file);
+		return 1;
+	}
+	fprintf (stderr, "all %i functions within tolerance of baseline %s\n",
+		NUM_BENCHES, baseline_file);
+	return 0;
+}
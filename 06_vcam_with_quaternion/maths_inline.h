@@ -0,0 +1,200 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| The small, hot bits of maths_funcs: constructors, vec3 operators, dot,       |
+| cross, length etc. Don't include this directly.                              |
+| Normally maths_funcs.cpp includes it and these are ordinary out-of-line      |
+| functions. Built with MATHS_HEADER_ONLY, maths_funcs.h includes it instead   |
+| and they are all inline, and constexpr where they can be, so the compiler    |
+| can fold them into the caller and work out constant vectors and matrices at  |
+| compile time. The whole program must be built the same way.                  |
+| Each function is written as one expression or a few locals so that it is a  |
+| valid C++14 constexpr function - results are the same bits either way.       |
+\******************************************************************************/
+#ifndef _MATHS_INLINE_H_
+#define _MATHS_INLINE_H_
+
+#include "maths_funcs.h"
+#include <math.h>
+
+/*--------------------------------CONSTRUCTORS--------------------------------*/
+MATHS_INLINE vec2::vec2 () {}
+
+MATHS_CONSTEXPR vec2::vec2 (float x, float y) : v{ x, y } {}
+
+MATHS_INLINE vec3::vec3 () {}
+
+MATHS_CONSTEXPR vec3::vec3 (float x, float y, float z) : v{ x, y, z } {}
+
+MATHS_CONSTEXPR vec3::vec3 (const vec2& vv, float z) :
+	v{ vv.v[0], vv.v[1], z } {}
+
+MATHS_CONSTEXPR vec3::vec3 (const vec4& vv) :
+	v{ vv.v[0], vv.v[1], vv.v[2] } {}
+
+MATHS_INLINE vec4::vec4 () {}
+
+MATHS_CONSTEXPR vec4::vec4 (float x, float y, float z, float w) :
+	v{ x, y, z, w } {}
+
+MATHS_CONSTEXPR vec4::vec4 (const vec2& vv, float z, float w) :
+	v{ vv.v[0], vv.v[1], z, w } {}
+
+MATHS_CONSTEXPR vec4::vec4 (const vec3& vv, float w) :
+	v{ vv.v[0], vv.v[1], vv.v[2], w } {}
+
+MATHS_INLINE mat3::mat3 () {}
+
+/* note: entered in COLUMNS */
+MATHS_CONSTEXPR mat3::mat3 (float a, float b, float c,
+						float d, float e, float f,
+						float g, float h, float i) :
+	m{ a, b, c, d, e, f, g, h, i } {}
+
+MATHS_INLINE mat4::mat4 () {}
+
+/* note: entered in COLUMNS */
+MATHS_CONSTEXPR mat4::mat4 (float a, float b, float c, float d,
+						float e, float f, float g, float h,
+						float i, float j, float k, float l,
+						float mm, float n, float o, float p) :
+	m{ a, b, c, d, e, f, g, h, i, j, k, l, mm, n, o, p } {}
+
+MATHS_INLINE versor::versor () { }
+
+/*------------------------------VECTOR FUNCTIONS------------------------------*/
+// sqrt isn't constexpr, so this and normalise() can only be inline
+MATHS_INLINE float length (const vec3& v) {
+	return sqrt (v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2]);
+}
+
+// squared length
+MATHS_CONSTEXPR float length2 (const vec3& v) {
+	return v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2];
+}
+
+// note: proper spelling (hehe)
+MATHS_INLINE vec3 normalise (const vec3& v) {
+	float l = length (v);
+	if (0.0f == l) {
+		return vec3 (0.0f, 0.0f, 0.0f);
+	}
+	return vec3 (v.v[0] / l, v.v[1] / l, v.v[2] / l);
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator+ (const vec3& rhs) const {
+	return vec3 (v[0] + rhs.v[0], v[1] + rhs.v[1], v[2] + rhs.v[2]);
+}
+
+MATHS_CONSTEXPR vec3& vec3::operator+= (const vec3& rhs) {
+	v[0] += rhs.v[0];
+	v[1] += rhs.v[1];
+	v[2] += rhs.v[2];
+	return *this; // return self
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator- (const vec3& rhs) const {
+	return vec3 (v[0] - rhs.v[0], v[1] - rhs.v[1], v[2] - rhs.v[2]);
+}
+
+MATHS_CONSTEXPR vec3& vec3::operator-= (const vec3& rhs) {
+	v[0] -= rhs.v[0];
+	v[1] -= rhs.v[1];
+	v[2] -= rhs.v[2];
+	return *this;
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator+ (float rhs) const {
+	return vec3 (v[0] + rhs, v[1] + rhs, v[2] + rhs);
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator- (float rhs) const {
+	return vec3 (v[0] - rhs, v[1] - rhs, v[2] - rhs);
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator* (float rhs) const {
+	return vec3 (v[0] * rhs, v[1] * rhs, v[2] * rhs);
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator/ (float rhs) const {
+	return vec3 (v[0] / rhs, v[1] / rhs, v[2] / rhs);
+}
+
+MATHS_CONSTEXPR vec3& vec3::operator*= (float rhs) {
+	v[0] = v[0] * rhs;
+	v[1] = v[1] * rhs;
+	v[2] = v[2] * rhs;
+	return *this;
+}
+
+MATHS_CONSTEXPR vec3& vec3::operator= (const vec3& rhs) {
+	v[0] = rhs.v[0];
+	v[1] = rhs.v[1];
+	v[2] = rhs.v[2];
+	return *this;
+}
+
+MATHS_CONSTEXPR float dot (const vec3& a, const vec3& b) {
+	return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+}
+
+MATHS_CONSTEXPR vec3 cross (const vec3& a, const vec3& b) {
+	return vec3 (
+		a.v[1] * b.v[2] - a.v[2] * b.v[1],
+		a.v[2] * b.v[0] - a.v[0] * b.v[2],
+		a.v[0] * b.v[1] - a.v[1] * b.v[0]
+	);
+}
+
+MATHS_CONSTEXPR float get_squared_dist (vec3 from, vec3 to) {
+	return (to.v[0] - from.v[0]) * (to.v[0] - from.v[0]) +
+		(to.v[1] - from.v[1]) * (to.v[1] - from.v[1]) +
+		(to.v[2] - from.v[2]) * (to.v[2] - from.v[2]);
+}
+
+/*-----------------------------MATRIX FUNCTIONS-------------------------------*/
+MATHS_CONSTEXPR mat3 zero_mat3 () {
+	return mat3 (
+		0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f
+	);
+}
+
+MATHS_CONSTEXPR mat3 identity_mat3 () {
+	return mat3 (
+		1.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f
+	);
+}
+
+MATHS_CONSTEXPR mat4 zero_mat4 () {
+	return mat4 (
+		0.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 0.0f
+	);
+}
+
+MATHS_CONSTEXPR mat4 identity_mat4 () {
+	return mat4 (
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	);
+}
+
+/*----------------------------HAMILTON IN DA HOUSE!---------------------------*/
+MATHS_CONSTEXPR float dot (const versor& q, const versor& r) {
+	return q.q[0] * r.q[0] + q.q[1] * r.q[1] + q.q[2] * r.q[2] + q.q[3] * r.q[3];
+}
+
+#endif
@@ -0,0 +1,282 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| SIMD kernels behind the maths functions, plus run-time CPU dispatch.         |
+| NB: none of the kernels use fused multiply-add. an FMA rounds differently,   |
+| and we want every level to match the scalar code bit for bit, so it is       |
+| always mul then add, in the same order as the scalar loops.                  |
+\******************************************************************************/
+#include "maths_simd.h"
+#include <pthread.h>
+#include <atomic>
+#include <string.h>
+#if MATHS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*-------------------------------SCALAR KERNELS-------------------------------*/
+static void mat4_mul_scalar (const float* a, const float* b, float* r) {
+	float t[16];
+	int r_index = 0;
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			float sum = 0.0f;
+			for (int i = 0; i < 4; i++) {
+				sum += b[i + col * 4] * a[row + i * 4];
+			}
+			t[r_index] = sum;
+			r_index++;
+		}
+	}
+	memcpy (r, t, sizeof (t));
+}
+
+#if MATHS_SIMD_X86
+/*--------------------------------SSE4.1 KERNELS------------------------------*/
+/* each column of the result is a weighted sum of the columns of a. the sum
+starts from zero like the scalar loop does, so that we even get the same sign
+on zero results */
+__attribute__ ((target ("sse4.1")))
+static void mat4_mul_sse41 (const float* a, const float* b, float* r) {
+	__m128 a0 = _mm_loadu_ps (a);
+	__m128 a1 = _mm_loadu_ps (a + 4);
+	__m128 a2 = _mm_loadu_ps (a + 8);
+	__m128 a3 = _mm_loadu_ps (a + 12);
+	__m128 res[4];
+	for (int col = 0; col < 4; col++) {
+		__m128 bc = _mm_loadu_ps (b + col * 4);
+		__m128 s = _mm_setzero_ps ();
+		s = _mm_add_ps (s, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0x00), a0));
+		s = _mm_add_ps (s, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0x55), a1));
+		s = _mm_add_ps (s, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0xAA), a2));
+		s = _mm_add_ps (s, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0xFF), a3));
+		res[col] = s;
+	}
+	for (int col = 0; col < 4; col++) {
+		_mm_storeu_ps (r + col * 4, res[col]);
+	}
+}
+
+/* general inverse by splitting m into 2x2 blocks [A B; C D] and using the
+adjugates of those, after Eric Zhang's "Fast 4x4 Matrix Inverse with SSE SIMD,
+Explained". it's written for row-major rows, but our columns are just the rows
+of the transpose, and inverse (transpose (m)) = transpose (inverse (m)), so
+feeding it columns gives back the columns of the inverse */
+#define SWIZZLE(v, x, y, z, w) _mm_shuffle_ps (v, v, _MM_SHUFFLE (w, z, y, x))
+#define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps (a, b, _MM_SHUFFLE (w, z, y, x))
+
+// 2x2 A * B
+__attribute__ ((target ("sse4.1")))
+static inline __m128 mat2_mul (__m128 a, __m128 b) {
+	return _mm_add_ps (_mm_mul_ps (a, SWIZZLE (b, 0, 3, 0, 3)),
+		_mm_mul_ps (SWIZZLE (a, 1, 0, 3, 2), SWIZZLE (b, 2, 1, 2, 1)));
+}
+
+// 2x2 adj(A) * B
+__attribute__ ((target ("sse4.1")))
+static inline __m128 mat2_adj_mul (__m128 a, __m128 b) {
+	return _mm_sub_ps (_mm_mul_ps (SWIZZLE (a, 3, 3, 0, 0), b),
+		_mm_mul_ps (SWIZZLE (a, 1, 1, 2, 2), SWIZZLE (b, 2, 3, 0, 1)));
+}
+
+// 2x2 A * adj(B)
+__attribute__ ((target ("sse4.1")))
+static inline __m128 mat2_mul_adj (__m128 a, __m128 b) {
+	return _mm_sub_ps (_mm_mul_ps (a, SWIZZLE (b, 3, 0, 3, 0)),
+		_mm_mul_ps (SWIZZLE (a, 1, 0, 3, 2), SWIZZLE (b, 2, 1, 2, 1)));
+}
+
+__attribute__ ((target ("sse4.1")))
+static float mat4_inverse_sse41 (const float* m, float* r) {
+	__m128 c0 = _mm_loadu_ps (m);
+	__m128 c1 = _mm_loadu_ps (m + 4);
+	__m128 c2 = _mm_loadu_ps (m + 8);
+	__m128 c3 = _mm_loadu_ps (m + 12);
+	__m128 a = _mm_movelh_ps (c0, c1);
+	__m128 b = _mm_movehl_ps (c1, c0);
+	__m128 c = _mm_movelh_ps (c2, c3);
+	__m128 d = _mm_movehl_ps (c3, c2);
+
+	// determinants of the four blocks, all at once
+	__m128 det_sub = _mm_sub_ps (
+		_mm_mul_ps (SHUFFLE (c0, c2, 0, 2, 0, 2), SHUFFLE (c1, c3, 1, 3, 1, 3)),
+		_mm_mul_ps (SHUFFLE (c0, c2, 1, 3, 1, 3), SHUFFLE (c1, c3, 0, 2, 0, 2))
+	);
+	__m128 det_a = SWIZZLE (det_sub, 0, 0, 0, 0);
+	__m128 det_b = SWIZZLE (det_sub, 1, 1, 1, 1);
+	__m128 det_c = SWIZZLE (det_sub, 2, 2, 2, 2);
+	__m128 det_d = SWIZZLE (det_sub, 3, 3, 3, 3);
+
+	__m128 d_c = mat2_adj_mul (d, c);
+	__m128 a_b = mat2_adj_mul (a, b);
+	__m128 x = _mm_sub_ps (_mm_mul_ps (det_d, a), mat2_mul (b, d_c));
+	__m128 w = _mm_sub_ps (_mm_mul_ps (det_a, d), mat2_mul (c, a_b));
+	__m128 y = _mm_sub_ps (_mm_mul_ps (det_b, c), mat2_mul_adj (d, a_b));
+	__m128 z = _mm_sub_ps (_mm_mul_ps (det_c, b), mat2_mul_adj (a, d_c));
+
+	__m128 det_m = _mm_add_ps (_mm_mul_ps (det_a, det_d),
+		_mm_mul_ps (det_b, det_c));
+	__m128 tr = _mm_mul_ps (a_b, SWIZZLE (d_c, 0, 2, 1, 3));
+	tr = _mm_hadd_ps (tr, tr);
+	tr = _mm_hadd_ps (tr, tr);
+	det_m = _mm_sub_ps (det_m, tr);
+	float det = _mm_cvtss_f32 (det_m);
+	if (0.0f == det) {
+		return 0.0f;
+	}
+
+	__m128 r_det = _mm_div_ps (_mm_setr_ps (1.0f, -1.0f, -1.0f, 1.0f), det_m);
+	x = _mm_mul_ps (x, r_det);
+	y = _mm_mul_ps (y, r_det);
+	z = _mm_mul_ps (z, r_det);
+	w = _mm_mul_ps (w, r_det);
+	_mm_storeu_ps (r, SHUFFLE (x, y, 3, 1, 3, 1));
+	_mm_storeu_ps (r + 4, SHUFFLE (x, y, 2, 0, 2, 0));
+	_mm_storeu_ps (r + 8, SHUFFLE (z, w, 3, 1, 3, 1));
+	_mm_storeu_ps (r + 12, SHUFFLE (z, w, 2, 0, 2, 0));
+	return det;
+}
+#undef SWIZZLE
+#undef SHUFFLE
+
+/*---------------------------------AVX2 KERNELS-------------------------------*/
+// same as sse but two result columns per register
+__attribute__ ((target ("avx2")))
+static void mat4_mul_avx2 (const float* a, const float* b, float* r) {
+	__m256 a0 = _mm256_broadcast_ps ((const __m128*)a);
+	__m256 a1 = _mm256_broadcast_ps ((const __m128*)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps ((const __m128*)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps ((const __m128*)(a + 12));
+	__m256 b01 = _mm256_loadu_ps (b);
+	__m256 b23 = _mm256_loadu_ps (b + 8);
+	__m256 s01 = _mm256_setzero_ps ();
+	__m256 s23 = _mm256_setzero_ps ();
+	s01 = _mm256_add_ps (s01, _mm256_mul_ps (_mm256_permute_ps (b01, 0x00), a0));
+	s23 = _mm256_add_ps (s23, _mm256_mul_ps (_mm256_permute_ps (b23, 0x00), a0));
+	s01 = _mm256_add_ps (s01, _mm256_mul_ps (_mm256_permute_ps (b01, 0x55), a1));
+	s23 = _mm256_add_ps (s23, _mm256_mul_ps (_mm256_permute_ps (b23, 0x55), a1));
+	s01 = _mm256_add_ps (s01, _mm256_mul_ps (_mm256_permute_ps (b01, 0xAA), a2));
+	s23 = _mm256_add_ps (s23, _mm256_mul_ps (_mm256_permute_ps (b23, 0xAA), a2));
+	s01 = _mm256_add_ps (s01, _mm256_mul_ps (_mm256_permute_ps (b01, 0xFF), a3));
+	s23 = _mm256_add_ps (s23, _mm256_mul_ps (_mm256_permute_ps (b23, 0xFF), a3));
+	_mm256_storeu_ps (r, s01);
+	_mm256_storeu_ps (r + 8, s23);
+}
+
+#endif
+
+/*----------------------------------DISPATCH----------------------------------*/
+typedef void (*mat4_mul_fn) (const float*, const float*, float*);
+
+static void mat4_mul_first (const float* a, const float* b, float* r);
+
+/* the level is picked once, under pthread_once, the first time anything asks -
+from any thread, and even from a global constructor before main(). the kernel
+starts out as mat4_mul_first(), which does that and then forwards, so once it
+has run a multiply is a plain load of the pointer and a call. only
+set_simd_level() writes them after that */
+static pthread_once_t g_kernels_once = PTHREAD_ONCE_INIT;
+static std::atomic<mat4_mul_fn> g_mat4_mul (mat4_mul_first);
+static std::atomic<int> g_level (SIMD_SCALAR);
+
+static int detect_simd_level () {
+	int level = SIMD_SCALAR;
+#if MATHS_SIMD_X86
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("sse4.1")) {
+		level = SIMD_SSE41;
+	}
+	if (__builtin_cpu_supports ("avx2")) {
+		level = SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports ("avx512f")) {
+		level = SIMD_AVX512;
+	}
+#endif
+	return level;
+}
+
+simd_level detected_simd_level () {
+	// a function-local static is initialised once, thread-safely
+	static const int detected = detect_simd_level ();
+	return (simd_level)detected;
+}
+
+// sets the kernel for a level, and returns the level it really got
+static simd_level use_level (simd_level level) {
+	mat4_mul_fn mul = mat4_mul_scalar;
+#if MATHS_SIMD_X86
+	switch (level) {
+		/* a 4x4 product is too small for 512-bit registers: the lane shuffles
+		cost more than they save, and it ran at half the speed of avx2 */
+		case SIMD_AVX512:
+		case SIMD_AVX2:
+			mul = mat4_mul_avx2;
+			break;
+		case SIMD_SSE41:
+			mul = mat4_mul_sse41;
+			break;
+		default:
+			level = SIMD_SCALAR;
+			break;
+	}
+#else
+	level = SIMD_SCALAR;
+#endif
+	g_mat4_mul.store (mul, std::memory_order_relaxed);
+	g_level.store (level, std::memory_order_relaxed);
+	return level;
+}
+
+static void init_kernels () {
+	use_level (detected_simd_level ());
+}
+
+static void mat4_mul_first (const float* a, const float* b, float* r) {
+	pthread_once (&g_kernels_once, init_kernels);
+	g_mat4_mul.load (std::memory_order_relaxed) (a, b, r);
+}
+
+simd_level set_simd_level (simd_level level) {
+	simd_level best = detected_simd_level ();
+	if (level > best) {
+		level = best;
+	}
+	// so a first use later can't put the detected level back
+	pthread_once (&g_kernels_once, init_kernels);
+	return use_level (level);
+}
+
+simd_level get_simd_level () {
+	pthread_once (&g_kernels_once, init_kernels);
+	return (simd_level)g_level.load (std::memory_order_relaxed);
+}
+
+const char* simd_level_name (simd_level level) {
+	switch (level) {
+		case SIMD_SSE41: return "sse4.1";
+		case SIMD_AVX2: return "avx2";
+		case SIMD_AVX512: return "avx512";
+		default: return "scalar";
+	}
+}
+
+void simd_mat4_mul (const float* a, const float* b, float* r) {
+	g_mat4_mul.load (std::memory_order_relaxed) (a, b, r);
+}
+
+float simd_mat4_inverse (const float* m, float* r) {
+#if MATHS_SIMD_X86
+	if (get_simd_level () >= SIMD_SSE41) {
+		return mat4_inverse_sse41 (m, r);
+	}
+#endif
+	(void)m;
+	(void)r;
+	return 0.0f;
+}
@@ -0,0 +1,79 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| SIMD kernels behind the maths functions.                                     |
+| The best instruction set is picked once, at first use, from the CPU we are   |
+| running on. Everything has a plain scalar version too, so the maths code     |
+| still builds and runs on non-x86 machines. Kernels work on raw float arrays  |
+| in the same column-major layout as mat4::m so they give identical results.   |
+\******************************************************************************/
+#ifndef _MATHS_SIMD_H_
+#define _MATHS_SIMD_H_
+
+// x86 kernels are compiled with per-function target attributes, so we don't
+// need any -m flags in the Makefile to get them
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATHS_SIMD_X86 1
+#else
+#define MATHS_SIMD_X86 0
+#endif
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+enum simd_level {
+	SIMD_SCALAR = 0,
+	SIMD_SSE41,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+// best level the cpu supports. checked once and then cached
+simd_level detected_simd_level ();
+// level the kernels are currently using
+simd_level get_simd_level ();
+/* force a lower level, e.g. to compare against the scalar code. asking for
+more than the cpu has gets clamped. returns the level actually set. mostly
+useful for benchmarks: don't call this while other threads use the maths */
+simd_level set_simd_level (simd_level level);
+const char* simd_level_name (simd_level level);
+
+// r = a * b. all three are 16 floats, column-major. r may alias a or b
+void simd_mat4_mul (const float* a, const float* b, float* r);
+/* r = m * v. m is 16 floats, v and r are 4 floats. r may alias v. a vec4 only
+needs sse, which every x86-64 cpu has, so this isn't dispatched at all: it's
+inlined into the caller, where a call through the kernel table cost as much as
+the 16 multiplies. same order of adds as the scalar version, so same bits */
+inline void simd_mat4_mul_vec4 (const float* m, const float* v, float* r) {
+#if defined(__SSE__)
+	__m128 vv = _mm_loadu_ps (v);
+	__m128 s = _mm_mul_ps (_mm_loadu_ps (m), _mm_shuffle_ps (vv, vv, 0x00));
+	s = _mm_add_ps (s,
+		_mm_mul_ps (_mm_loadu_ps (m + 4), _mm_shuffle_ps (vv, vv, 0x55)));
+	s = _mm_add_ps (s,
+		_mm_mul_ps (_mm_loadu_ps (m + 8), _mm_shuffle_ps (vv, vv, 0xAA)));
+	s = _mm_add_ps (s,
+		_mm_mul_ps (_mm_loadu_ps (m + 12), _mm_shuffle_ps (vv, vv, 0xFF)));
+	_mm_storeu_ps (r, s);
+#else
+	float x = m[0] * v[0] + m[4] * v[1] + m[8] * v[2] + m[12] * v[3];
+	float y = m[1] * v[0] + m[5] * v[1] + m[9] * v[2] + m[13] * v[3];
+	float z = m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14] * v[3];
+	float w = m[3] * v[0] + m[7] * v[1] + m[11] * v[2] + m[15] * v[3];
+	r[0] = x;
+	r[1] = y;
+	r[2] = z;
+	r[3] = w;
+#endif
+}
+/* r = inverse of m, by 2x2 blocks. returns the determinant, and doesn't write
+r if that is 0. returns 0 without touching r when there is no simd, so the
+caller can fall back to its scalar version */
+float simd_mat4_inverse (const float* m, float* r);
+
+#endif
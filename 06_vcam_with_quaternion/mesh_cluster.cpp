@@ -0,0 +1,434 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Meshlets are grown one at a time, like Tipsify's fans: start from the first  |
+| triangle not yet in a meshlet, then keep adding the neighbouring triangle    |
+| that brings in the fewest new vertices, preferring ones whose vertices have  |
+| few triangles left so no stragglers get stranded. A meshlet ends when it is  |
+| full or nothing touching it fits. That part is serial, the spheres and cones |
+| are then worked out on the thread pool.                                      |
+| The cone axis is the average triangle normal, and its half-angle covers the  |
+| normal furthest from it. The apex is pulled back along the axis until it is  |
+| behind every triangle's plane, as in meshoptimizer. Degenerate triangles     |
+| don't draw anything, so they don't count towards the cone.                   |
+\******************************************************************************/
+#include "mesh_cluster.h"
+#include "bounds.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// a meshlet can only cull itself if all its normals are within about 84 degrees
+#define MESHLET_MIN_CONE_DOT 0.1f
+// cull_meshlets() hands this many spheres at a time to cull_spheres()
+#define MESHLET_CULL_BLOCK 256
+
+/*----------------------------------GROWING-----------------------------------*/
+/* writes the triangles of in[] to out[] meshlet by meshlet, and each meshlet's
+distinct vertices to out_verts[]. meshlets gets a malloc'd array with the range
+and vertex count of each */
+static bool grow_meshlets (const unsigned int* in, int index_count,
+	int vertex_count, unsigned int* out, unsigned int* out_verts,
+	meshlet*& meshlets, int& meshlet_count) {
+	int tri_count = index_count / 3;
+	meshlets = NULL;
+	meshlet_count = 0;
+	// the triangles using each vertex are adjacency[offsets[v], offsets[v + 1])
+	int* offsets = (int*)calloc (vertex_count + 1, sizeof (int));
+	int* adjacency = (int*)malloc (index_count * sizeof (int) + 1);
+	// triangles each vertex has left to put in a meshlet
+	int* live = (int*)calloc (vertex_count + 1, sizeof (int));
+	// where each vertex is in the current meshlet, or -1
+	int* slot = (int*)malloc (vertex_count * sizeof (int) + 1);
+	unsigned char* used = (unsigned char*)calloc (tri_count + 1, 1);
+	/* triangles touching the current meshlet, each once. listed_in is the
+	meshlet number + 1 a triangle was last listed for */
+	int* candidates = (int*)malloc (index_count * sizeof (int) + 1);
+	int* listed_in = (int*)calloc (tri_count + 1, sizeof (int));
+	int capacity = tri_count / MESHLET_MAX_TRIANGLES + 16;
+	meshlets = (meshlet*)malloc (capacity * sizeof (meshlet));
+	if (!offsets || !adjacency || !live || !slot || !used || !candidates ||
+		!listed_in || !meshlets) {
+		fprintf (stderr, "ERROR: out of memory building meshlets\n");
+		free (offsets);
+		free (adjacency);
+		free (live);
+		free (slot);
+		free (used);
+		free (candidates);
+		free (listed_in);
+		free (meshlets);
+		meshlets = NULL;
+		return false;
+	}
+	for (int i = 0; i < index_count; i++) {
+		offsets[in[i] + 1]++;
+	}
+	for (int v = 0; v < vertex_count; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+	for (int i = 0; i < index_count; i++) {
+		adjacency[offsets[in[i]] + live[in[i]]++] = i / 3;
+	}
+	memset (slot, 0xFF, vertex_count * sizeof (int));
+
+	bool ok = true;
+	int out_count = 0, out_verts_count = 0;
+	int cursor = 0;
+	int verts[MESHLET_MAX_VERTICES];
+	while (ok) {
+		while (cursor < tri_count && used[cursor]) {
+			cursor++;
+		}
+		if (cursor >= tri_count) {
+			break;
+		}
+		int first_index = out_count;
+		int num_verts = 0, num_tris = 0, num_candidates = 0;
+		int next = cursor;
+		while (next >= 0) {
+			used[next] = 1;
+			num_tris++;
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = in[next * 3 + k];
+				out[out_count++] = v;
+				live[v]--;
+				if (slot[v] >= 0) {
+					continue;
+				}
+				slot[v] = num_verts;
+				verts[num_verts++] = (int)v;
+				for (int a = offsets[v]; a < offsets[v + 1]; a++) {
+					int t = adjacency[a];
+					if (!used[t] && listed_in[t] != meshlet_count + 1) {
+						listed_in[t] = meshlet_count + 1;
+						candidates[num_candidates++] = t;
+					}
+				}
+			}
+			if (num_tris == MESHLET_MAX_TRIANGLES) {
+				break;
+			}
+			/* fewest new vertices, then fewest triangles left on its vertices.
+			drops the used candidates as it goes */
+			next = -1;
+			int best_new = 4, best_live = 0, kept = 0;
+			for (int c = 0; c < num_candidates; c++) {
+				int t = candidates[c];
+				if (used[t]) {
+					continue;
+				}
+				candidates[kept++] = t;
+				const unsigned int* tv = in + t * 3;
+				int fresh = (slot[tv[0]] < 0) + (slot[tv[1]] < 0) + (slot[tv[2]] < 0);
+				if (num_verts + fresh > MESHLET_MAX_VERTICES) {
+					continue;
+				}
+				int left = live[tv[0]] + live[tv[1]] + live[tv[2]];
+				if (fresh < best_new || (fresh == best_new && left < best_live)) {
+					best_new = fresh;
+					best_live = left;
+					next = t;
+				}
+			}
+			num_candidates = kept;
+		}
+		for (int i = 0; i < num_verts; i++) {
+			slot[verts[i]] = -1;
+			out_verts[out_verts_count++] = (unsigned int)verts[i];
+		}
+		if (meshlet_count == capacity) {
+			capacity *= 2;
+			meshlet* grown = (meshlet*)realloc (meshlets,
+				capacity * sizeof (meshlet));
+			if (!grown) {
+				fprintf (stderr, "ERROR: out of memory building meshlets\n");
+				ok = false;
+				break;
+			}
+			meshlets = grown;
+		}
+		meshlet& m = meshlets[meshlet_count++];
+		memset (&m, 0, sizeof (m));
+		m.first_index = first_index;
+		m.index_count = num_tris * 3;
+		m.vertex_count = num_verts;
+	}
+	free (offsets);
+	free (adjacency);
+	free (live);
+	free (slot);
+	free (used);
+	free (candidates);
+	free (listed_in);
+	if (!ok) {
+		free (meshlets);
+		meshlets = NULL;
+		meshlet_count = 0;
+	}
+	return ok;
+}
+
+/*-----------------------------SPHERES AND CONES------------------------------*/
+struct meshlet_job {
+	const obj_mesh* mesh;
+	meshlet_set* set;
+	// each meshlet's distinct vertices start at verts[first_vert[i]]
+	const unsigned int* verts;
+	const int* first_vert;
+};
+
+static void cross3 (const float* a, const float* b, const float* c, float* n) {
+	float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static inline float dot3 (const float* a, const float* b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void meshlet_cone (const obj_mesh& mesh, const meshlet_set& set,
+	meshlet& m) {
+	float normals[MESHLET_MAX_TRIANGLES][3];
+	const float* corner[MESHLET_MAX_TRIANGLES];
+	int count = 0;
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < m.index_count; i += 3) {
+		const float* p[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = mesh.points + 3 * obj_mesh_index (set.indices, set.index_size,
+				m.first_index + i + k);
+		}
+		float* n = normals[count];
+		cross3 (p[0], p[1], p[2], n);
+		float len = sqrtf (dot3 (n, n));
+		if (len <= 0.0f) {
+			continue;
+		}
+		for (int k = 0; k < 3; k++) {
+			n[k] /= len;
+			axis[k] += n[k];
+		}
+		corner[count++] = p[0];
+	}
+	float axis_len = sqrtf (dot3 (axis, axis));
+	// never culled, unless that changes below
+	memcpy (m.cone_apex, m.centre, sizeof (m.cone_apex));
+	memset (m.cone_axis, 0, sizeof (m.cone_axis));
+	m.cone_cutoff = 2.0f;
+	if (0 == count || axis_len <= 0.0f) {
+		return;
+	}
+	float min_dot = 1.0f;
+	for (int k = 0; k < 3; k++) {
+		axis[k] /= axis_len;
+	}
+	for (int i = 0; i < count; i++) {
+		float d = dot3 (axis, normals[i]);
+		min_dot = d < min_dot ? d : min_dot;
+	}
+	if (min_dot <= MESHLET_MIN_CONE_DOT) {
+		return;
+	}
+	// the furthest back along the axis from the centre a triangle's plane is
+	float max_t = 0.0f;
+	for (int i = 0; i < count; i++) {
+		float to_centre[3] = { m.centre[0] - corner[i][0],
+			m.centre[1] - corner[i][1], m.centre[2] - corner[i][2] };
+		float t = dot3 (to_centre, normals[i]) / dot3 (axis, normals[i]);
+		max_t = t > max_t ? t : max_t;
+	}
+	for (int k = 0; k < 3; k++) {
+		m.cone_apex[k] = m.centre[k] - axis[k] * max_t;
+		m.cone_axis[k] = axis[k];
+	}
+	// sin of the widest normal's angle, i.e. cos of 90 degrees minus it
+	m.cone_cutoff = sqrtf (1.0f - min_dot * min_dot);
+}
+
+static void meshlet_bounds (void* ctx, size_t begin, size_t end) {
+	meshlet_job* job = (meshlet_job*)ctx;
+	const obj_mesh& mesh = *job->mesh;
+	meshlet_set& set = *job->set;
+	float points[MESHLET_MAX_VERTICES * 3];
+	for (size_t i = begin; i < end; i++) {
+		meshlet& m = set.meshlets[i];
+		const unsigned int* verts = job->verts + job->first_vert[i];
+		for (int k = 0; k < m.vertex_count; k++) {
+			memcpy (points + k * 3, mesh.points + verts[k] * 3, 3 * sizeof (float));
+		}
+		bounding_sphere sphere = sphere_from_points (points, m.vertex_count);
+		for (int k = 0; k < 3; k++) {
+			m.centre[k] = sphere.centre.v[k];
+		}
+		m.radius = sphere.radius;
+		set.sphere_x[i] = m.centre[0];
+		set.sphere_y[i] = m.centre[1];
+		set.sphere_z[i] = m.centre[2];
+		set.sphere_r[i] = m.radius;
+		meshlet_cone (mesh, set, m);
+	}
+}
+
+/*------------------------------------API-------------------------------------*/
+bool build_meshlets (const obj_mesh& mesh, meshlet_set& set) {
+	memset (&set, 0, sizeof (set));
+	int index_count = mesh.index_count - mesh.index_count % 3;
+	unsigned int* in = (unsigned int*)malloc (index_count * sizeof (int) + 1);
+	unsigned int* out = (unsigned int*)malloc (index_count * sizeof (int) + 1);
+	unsigned int* verts = (unsigned int*)malloc (index_count * sizeof (int) + 1);
+	if (!in || !out || !verts) {
+		fprintf (stderr, "ERROR: out of memory building meshlets\n");
+		free (in);
+		free (out);
+		free (verts);
+		return false;
+	}
+	for (int i = 0; i < index_count; i++) {
+		in[i] = obj_mesh_index (mesh.indices, mesh.index_size, i);
+	}
+	meshlet* grown = NULL;
+	int count = 0;
+	bool ok = grow_meshlets (in, index_count, mesh.vertex_count, out, verts,
+		grown, count);
+	free (in);
+
+	/* one block: the meshlets, then the four sphere arrays, then the index
+	buffer, so free_meshlets() is one free */
+	size_t meshlets_size = (size_t)count * sizeof (meshlet);
+	size_t spheres_size = (size_t)count * 4 * sizeof (float);
+	size_t indices_size = (size_t)index_count * mesh.index_size;
+	char* block = NULL;
+	if (ok) {
+		block = (char*)malloc (meshlets_size + spheres_size + indices_size + 1);
+		if (!block) {
+			fprintf (stderr, "ERROR: out of memory building meshlets\n");
+			ok = false;
+		}
+	}
+	int* first_vert = NULL;
+	if (ok) {
+		first_vert = (int*)malloc ((size_t)count * sizeof (int) + 1);
+		if (!first_vert) {
+			fprintf (stderr, "ERROR: out of memory building meshlets\n");
+			free (block);
+			ok = false;
+		}
+	}
+	if (!ok) {
+		free (grown);
+		free (out);
+		free (verts);
+		return false;
+	}
+	set.meshlets = (meshlet*)block;
+	set.meshlet_count = count;
+	memcpy (set.meshlets, grown, meshlets_size);
+	free (grown);
+	float* spheres = (float*)(block + meshlets_size);
+	set.sphere_x = spheres;
+	set.sphere_y = spheres + count;
+	set.sphere_z = spheres + 2 * count;
+	set.sphere_r = spheres + 3 * count;
+	set.indices = block + meshlets_size + spheres_size;
+	set.index_count = index_count;
+	set.index_size = mesh.index_size;
+	for (int i = 0; i < index_count; i++) {
+		set_obj_mesh_index (set.indices, set.index_size, i, out[i]);
+	}
+	free (out);
+
+	for (int i = 0, next = 0; i < count; i++) {
+		first_vert[i] = next;
+		next += set.meshlets[i].vertex_count;
+	}
+	meshlet_job job = { &mesh, &set, verts, first_vert };
+	parallel_for (count, MESHLET_GRAIN, meshlet_bounds, &job);
+	free (verts);
+	free (first_vert);
+	return true;
+}
+
+void free_meshlets (meshlet_set& set) {
+	free (set.meshlets);
+	memset (&set, 0, sizeof (set));
+}
+
+void drop_meshlet_indices (meshlet_set& set) {
+	if (!set.indices) {
+		return;
+	}
+	// the indices are the end of the block, so it just shrinks
+	int count = set.meshlet_count;
+	size_t keep = (size_t)count * sizeof (meshlet) +
+		(size_t)count * 4 * sizeof (float);
+	char* block = (char*)realloc (set.meshlets, keep + 1);
+	if (block) {
+		set.meshlets = (meshlet*)block;
+		float* spheres = (float*)(block + (size_t)count * sizeof (meshlet));
+		set.sphere_x = spheres;
+		set.sphere_y = spheres + count;
+		set.sphere_z = spheres + 2 * count;
+		set.sphere_r = spheres + 3 * count;
+	}
+	set.indices = NULL;
+}
+
+/*----------------------------------CULLING-----------------------------------*/
+// true if every triangle of m faces away from eye
+static inline bool cone_culled (const meshlet& m, const vec3& eye) {
+	if (m.cone_cutoff > 1.0f) {
+		return false;
+	}
+	float d[3] = { m.cone_apex[0] - eye.v[0], m.cone_apex[1] - eye.v[1],
+		m.cone_apex[2] - eye.v[2] };
+	return dot3 (d, m.cone_axis) >= m.cone_cutoff * sqrtf (dot3 (d, d));
+}
+
+int cull_meshlets (const meshlet_set& set, const frustum& f, const vec3& eye,
+	unsigned char* last_plane, meshlet_range* ranges, meshlet_cull_stats* stats) {
+	meshlet_cull_stats s;
+	memset (&s, 0, sizeof (s));
+	int range_count = 0;
+	unsigned int visible[MESHLET_CULL_BLOCK];
+	for (int base = 0; base < set.meshlet_count; base += MESHLET_CULL_BLOCK) {
+		int n = set.meshlet_count - base;
+		if (n > MESHLET_CULL_BLOCK) {
+			n = MESHLET_CULL_BLOCK;
+		}
+		size_t count = cull_spheres (f, set.sphere_x + base, set.sphere_y + base,
+			set.sphere_z + base, set.sphere_r + base, n,
+			last_plane ? last_plane + base : NULL, visible);
+		s.frustum_culled += n - (int)count;
+		for (size_t i = 0; i < count; i++) {
+			const meshlet& m = set.meshlets[base + visible[i]];
+			if (cone_culled (m, eye)) {
+				s.cone_culled++;
+				continue;
+			}
+			s.visible++;
+			meshlet_range* last = range_count > 0 ? &ranges[range_count - 1] : NULL;
+			if (last && last->first_index + last->index_count == m.first_index) {
+				last->index_count += m.index_count;
+			} else {
+				ranges[range_count].first_index = m.first_index;
+				ranges[range_count].index_count = m.index_count;
+				range_count++;
+			}
+		}
+	}
+	if (stats) {
+		*stats = s;
+	}
+	return range_count;
+}
@@ -0,0 +1,96 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Meshlets: an indexed mesh cut into small clusters of at most 64 vertices and |
+| 124 triangles, so a big mesh can skip the parts that can't be seen instead   |
+| of drawing everything. Each meshlet has a bounding sphere for the frustum    |
+| test and a normal cone for a backface test: if the camera is inside the      |
+| cone's "back" region every triangle in the meshlet faces away from it        |
+| (Zeux, "Optimizing the graphics pipeline with compute", GDC 2016).           |
+| The meshlets' triangles go into a new index buffer one meshlet after         |
+| another, so culling gives back a short list of index ranges for one          |
+| glMultiDrawElements. Neighbouring visible meshlets join into one range.      |
+\******************************************************************************/
+#ifndef _MESH_CLUSTER_H_
+#define _MESH_CLUSTER_H_
+
+#include "obj_parser.h"
+#include "frustum.h"
+
+// limits per meshlet. 124 triangles fit mesh shader outputs of 128
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// meshlets per thread pool chunk when working out their bounds and cones
+#define MESHLET_GRAIN 256
+
+struct meshlet {
+	// its triangles are indices[first_index, first_index + index_count)
+	int first_index;
+	int index_count;
+	// distinct vertices it uses, at most MESHLET_MAX_VERTICES
+	int vertex_count;
+	// bounding sphere, in the mesh's model space
+	float centre[3];
+	float radius;
+	/* normal cone. the meshlet faces away from a camera at eye if
+	dot (normalise (cone_apex - eye), cone_axis) >= cone_cutoff. a cutoff over
+	1 means the normals spread too far to ever cull it */
+	float cone_apex[3];
+	float cone_axis[3];
+	float cone_cutoff;
+};
+
+/* a mesh's base level as meshlets. the spheres are also kept SoA, so culling
+can hand them to cull_spheres() */
+struct meshlet_set {
+	meshlet* meshlets;
+	int meshlet_count;
+	// the mesh's triangles, meshlet by meshlet. same index_size as the mesh
+	void* indices;
+	int index_count;
+	int index_size;
+	float* sphere_x;
+	float* sphere_y;
+	float* sphere_z;
+	float* sphere_r;
+};
+
+/* cuts mesh's full-detail triangles into meshlets. the mesh isn't changed, so
+it can be one mapped from the mesh cache. each meshlet is grown from a seed
+triangle by adding whichever neighbouring triangle needs the fewest new
+vertices, so they come out compact. free with free_meshlets(). false if out of
+memory */
+bool build_meshlets (const obj_mesh& mesh, meshlet_set& set);
+void free_meshlets (meshlet_set& set);
+/* frees set's copy of the index buffer once it has been uploaded. culling only
+needs the meshlets, and index_count stays, so the ranges still line up */
+void drop_meshlet_indices (meshlet_set& set);
+
+// a run of the meshlet index buffer to draw
+struct meshlet_range {
+	int first_index;
+	int index_count;
+};
+
+// what happened to the meshlets in one cull_meshlets() call
+struct meshlet_cull_stats {
+	int frustum_culled;
+	int cone_culled;
+	int visible;
+};
+
+/* culls set's meshlets against frustum f and a camera at eye, both in the
+mesh's model space: f from frustum_from_mat4 (proj * view * model) and eye the
+camera position through the inverse of model. writes the index ranges of the
+visible meshlets to ranges[] (room for meshlet_count), in order, and returns
+how many. last_plane is as for cull_spheres(): one byte per meshlet, zeroed to
+start with, or NULL. stats may be NULL */
+int cull_meshlets (const meshlet_set& set, const frustum& f, const vec3& eye,
+	unsigned char* last_plane, meshlet_range* ranges, meshlet_cull_stats* stats);
+
+#endif
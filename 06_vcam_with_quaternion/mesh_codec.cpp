@@ -0,0 +1,625 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Vertex stream layout: chunk after chunk of VERTEX_CODEC_CHUNK vertices. In   |
+| each chunk, for each component, for each of its 4 byte planes (low byte      |
+| first): a 2-bit mode per 16-byte block, 4 to a byte, then the blocks' bits.  |
+| The delta of a component carries on from one chunk to the next.              |
+| Index stream layout: one code byte per triangle, then the extra bytes some   |
+| codes need, in order. A code is                                              |
+|   eeee rr kk  the triangle has the reverse of edge e (0 = newest) of the     |
+|               edge FIFO at corners r and r + 1. kk says how the third corner |
+|               is coded                                                       |
+|   cc bb 11 aa no shared edge: three corners, coded aa, bb and cc             |
+| and a corner is coded as                                                     |
+|   0  the next vertex no triangle has used yet                                |
+|   1  one of the last 16 coded corners: a byte says which (0 = newest)        |
+|   2  a zigzag varint, the difference from the next unused vertex             |
+| Every triangle then puts its three edges, reversed, on the edge FIFO.        |
+\******************************************************************************/
+#include "mesh_codec.h"
+#include "obj_parser.h"
+#include <stdint.h>
+#include <string.h>
+// SSE2 is part of x86-64, so unlike maths_simd.cpp there's nothing to dispatch
+#if defined(__SSE2__)
+#define CODEC_SSE2 1
+#include <emmintrin.h>
+#else
+#define CODEC_SSE2 0
+#endif
+
+// 16 bytes packed at 0, 2, 4 or 8 bits each
+static const size_t g_block_bytes[4] = { 0, 4, 8, 16 };
+
+/*-------------------------------VERTEX STREAMS-------------------------------*/
+static int chunk_blocks (size_t n) {
+	return (int)((n + 15) / 16);
+}
+
+size_t vertex_stream_bound (size_t vertex_count, int components) {
+	size_t chunks = (vertex_count + VERTEX_CODEC_CHUNK - 1) / VERTEX_CODEC_CHUNK;
+	size_t blocks = vertex_count / 16 + chunks;
+	return (size_t)components * 4 * (blocks * 16 + blocks / 4 + chunks) + 1;
+}
+
+// packs blocks * 16 bytes of one plane. returns the end of what it wrote
+static unsigned char* pack_plane (unsigned char* out, const unsigned char* in,
+	int blocks) {
+	unsigned char* modes = out;
+	out += (blocks + 3) / 4;
+	memset (modes, 0, (blocks + 3) / 4);
+	for (int b = 0; b < blocks; b++) {
+		const unsigned char* block = in + b * 16;
+		unsigned char all = 0;
+		for (int k = 0; k < 16; k++) {
+			all |= block[k];
+		}
+		int mode = 0 == all ? 0 : all < 4 ? 1 : all < 16 ? 2 : 3;
+		modes[b >> 2] |= (unsigned char)(mode << ((b & 3) * 2));
+		if (1 == mode) {
+			for (int k = 0; k < 4; k++) {
+				out[k] = (unsigned char)(block[k * 4] | block[k * 4 + 1] << 2 |
+					block[k * 4 + 2] << 4 | block[k * 4 + 3] << 6);
+			}
+		} else if (2 == mode) {
+			for (int k = 0; k < 8; k++) {
+				out[k] = (unsigned char)(block[k * 2] | block[k * 2 + 1] << 4);
+			}
+		} else if (3 == mode) {
+			memcpy (out, block, 16);
+		}
+		out += g_block_bytes[mode];
+	}
+	return out;
+}
+
+#if CODEC_SSE2
+// 16 bytes from 4, 8 or 16 bytes at 2, 4 or 8 bits each
+static inline __m128i unpack_block (const unsigned char* in, int mode) {
+	const __m128i low2 = _mm_set1_epi8 (3);
+	const __m128i low4 = _mm_set1_epi8 (15);
+	if (1 == mode) {
+		int32_t x;
+		memcpy (&x, in, 4);
+		__m128i v = _mm_cvtsi32_si128 (x);
+		__m128i a = _mm_and_si128 (v, low2);
+		__m128i b = _mm_and_si128 (_mm_srli_epi16 (v, 2), low2);
+		__m128i c = _mm_and_si128 (_mm_srli_epi16 (v, 4), low2);
+		__m128i d = _mm_and_si128 (_mm_srli_epi16 (v, 6), low2);
+		return _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (a, b),
+			_mm_unpacklo_epi8 (c, d));
+	}
+	if (2 == mode) {
+		__m128i v = _mm_loadl_epi64 ((const __m128i*)in);
+		return _mm_unpacklo_epi8 (_mm_and_si128 (v, low4),
+			_mm_and_si128 (_mm_srli_epi16 (v, 4), low4));
+	}
+	if (3 == mode) {
+		return _mm_loadu_si128 ((const __m128i*)in);
+	}
+	return _mm_setzero_si128 ();
+}
+#else
+static inline void unpack_block (unsigned char* out, const unsigned char* in,
+	int mode) {
+	if (1 == mode) {
+		for (int k = 0; k < 4; k++) {
+			unsigned char x = in[k];
+			out[k * 4] = x & 3;
+			out[k * 4 + 1] = (x >> 2) & 3;
+			out[k * 4 + 2] = (x >> 4) & 3;
+			out[k * 4 + 3] = x >> 6;
+		}
+	} else if (2 == mode) {
+		for (int k = 0; k < 8; k++) {
+			unsigned char x = in[k];
+			out[k * 2] = x & 15;
+			out[k * 2 + 1] = x >> 4;
+		}
+	} else if (3 == mode) {
+		memcpy (out, in, 16);
+	} else {
+		memset (out, 0, 16);
+	}
+}
+#endif
+
+// where one byte plane of a chunk is, and how far its decoding has got
+struct plane_cursor {
+	const unsigned char* modes;
+	const unsigned char* data;
+};
+
+/* finds the planes of one chunk of blocks blocks: 4 per component, in order.
+checks up front that all of them fit before end, so decoding them needs no more
+checks. returns the end of the chunk, or NULL */
+static const unsigned char* find_planes (plane_cursor* planes, int count,
+	const unsigned char* in, const unsigned char* end, int blocks) {
+	int mode_bytes = (blocks + 3) / 4;
+	for (int k = 0; k < count; k++) {
+		if (end - in < mode_bytes) {
+			return NULL;
+		}
+		planes[k].modes = in;
+		size_t size = 0;
+		for (int b = 0; b < blocks; b++) {
+			size += g_block_bytes[(in[b >> 2] >> ((b & 3) * 2)) & 3];
+		}
+		in += mode_bytes;
+		if ((size_t)(end - in) < size) {
+			return NULL;
+		}
+		planes[k].data = in;
+		in += size;
+	}
+	return in;
+}
+
+#if CODEC_SSE2
+// the next block of a plane, as 16 bytes
+template <bool near_end>
+static inline __m128i next_block (plane_cursor& plane, int b,
+	const unsigned char* end) {
+	int mode = (plane.modes[b >> 2] >> ((b & 3) * 2)) & 3;
+	const unsigned char* in = plane.data;
+	plane.data += g_block_bytes[mode];
+	if (!near_end || end - in >= 16) {
+		return unpack_block (in, mode);
+	}
+	// the last few bytes of the stream. unpack_block () may read all 16
+	unsigned char tail[16] = { 0 };
+	memcpy (tail, in, g_block_bytes[mode]);
+	return unpack_block (tail, mode);
+}
+
+/* zigzag decodes 4 deltas and adds them up, carrying on from sum, which is
+the last total in every lane. sum moves on to the new last total */
+static inline __m128i add_deltas (__m128i z, __m128i& sum) {
+	__m128i d = _mm_xor_si128 (_mm_srli_epi32 (z, 1), _mm_sub_epi32 (
+		_mm_setzero_si128 (), _mm_and_si128 (z, _mm_set1_epi32 (1))));
+	d = _mm_add_epi32 (d, _mm_slli_si128 (d, 4));
+	d = _mm_add_epi32 (d, _mm_slli_si128 (d, 8));
+	__m128i t = _mm_add_epi32 (sum, d);
+	sum = _mm_shuffle_epi32 (t, _MM_SHUFFLE (3, 3, 3, 3));
+	return t;
+}
+
+// totals of 16 vertices of one component, 4 to a register
+struct group_totals {
+	__m128i t0, t1, t2, t3;
+};
+
+/* decodes block b of one component's 4 planes straight into 16 totals, with
+no plane of bytes in between. written out in full, so the whole thing stays in
+registers */
+template <bool near_end>
+__attribute__ ((always_inline))
+static inline group_totals decode_group (plane_cursor* planes, int b,
+	const unsigned char* end, __m128i& sum) {
+	__m128i b0 = next_block<near_end> (planes[0], b, end);
+	__m128i b1 = next_block<near_end> (planes[1], b, end);
+	__m128i b2 = next_block<near_end> (planes[2], b, end);
+	__m128i b3 = next_block<near_end> (planes[3], b, end);
+	__m128i lo01 = _mm_unpacklo_epi8 (b0, b1);
+	__m128i hi01 = _mm_unpackhi_epi8 (b0, b1);
+	__m128i lo23 = _mm_unpacklo_epi8 (b2, b3);
+	__m128i hi23 = _mm_unpackhi_epi8 (b2, b3);
+	group_totals g;
+	g.t0 = add_deltas (_mm_unpacklo_epi16 (lo01, lo23), sum);
+	g.t1 = add_deltas (_mm_unpackhi_epi16 (lo01, lo23), sum);
+	g.t2 = add_deltas (_mm_unpacklo_epi16 (hi01, hi23), sum);
+	g.t3 = add_deltas (_mm_unpackhi_epi16 (hi01, hi23), sum);
+	return g;
+}
+
+/* interleaves 4 vertices, x holding component 0 and so on, into
+4 * components floats */
+template <int components>
+static inline void store_vertices (float* out, __m128i xi, __m128i yi,
+	__m128i zi, __m128i wi) {
+	__m128 x = _mm_castsi128_ps (xi);
+	__m128 y = _mm_castsi128_ps (yi);
+	__m128 z = _mm_castsi128_ps (zi);
+	__m128 w = _mm_castsi128_ps (wi);
+	if (1 == components) {
+		_mm_storeu_ps (out, x);
+	} else if (2 == components) {
+		_mm_storeu_ps (out, _mm_unpacklo_ps (x, y));
+		_mm_storeu_ps (out + 4, _mm_unpackhi_ps (x, y));
+	} else if (3 == components) {
+		__m128 xy_lo = _mm_unpacklo_ps (x, y);
+		__m128 xy_hi = _mm_unpackhi_ps (x, y);
+		__m128 yz_lo = _mm_unpacklo_ps (y, z);
+		__m128 yz_hi = _mm_unpackhi_ps (y, z);
+		__m128 zx_lo = _mm_unpacklo_ps (z, x);
+		__m128 zx_hi = _mm_unpackhi_ps (z, x);
+		_mm_storeu_ps (out, _mm_shuffle_ps (xy_lo, zx_lo, _MM_SHUFFLE (3, 0, 1, 0)));
+		_mm_storeu_ps (out + 4,
+			_mm_shuffle_ps (yz_lo, xy_hi, _MM_SHUFFLE (1, 0, 3, 2)));
+		_mm_storeu_ps (out + 8,
+			_mm_shuffle_ps (zx_hi, yz_hi, _MM_SHUFFLE (3, 2, 3, 0)));
+	} else {
+		_MM_TRANSPOSE4_PS (x, y, z, w);
+		_mm_storeu_ps (out, x);
+		_mm_storeu_ps (out + 4, y);
+		_mm_storeu_ps (out + 8, z);
+		_mm_storeu_ps (out + 12, w);
+	}
+}
+
+/* decodes one chunk of n vertices from planes, carrying each component's
+total on from prev. out is the chunk's first vertex. near_end is for the last
+chunk, whose blocks may be too close to the end to load 16 bytes at once */
+template <int components, bool near_end>
+static void decode_chunk (float* out, size_t n, plane_cursor* planes,
+	const unsigned char* end, uint32_t* prev) {
+	int blocks = chunk_blocks (n);
+	__m128i sx = _mm_set1_epi32 ((int)prev[0]);
+	__m128i sy = _mm_set1_epi32 ((int)prev[components > 1 ? 1 : 0]);
+	__m128i sz = _mm_set1_epi32 ((int)prev[components > 2 ? 2 : 0]);
+	__m128i sw = _mm_set1_epi32 ((int)prev[components > 3 ? 3 : 0]);
+	group_totals gy = group_totals (), gz = group_totals (), gw = group_totals ();
+	float last[16 * 4];
+	for (int b = 0; b < blocks; b++) {
+		group_totals gx = decode_group<near_end> (planes, b, end, sx);
+		if (components > 1) {
+			gy = decode_group<near_end> (planes + 4, b, end, sy);
+		}
+		if (components > 2) {
+			gz = decode_group<near_end> (planes + 8, b, end, sz);
+		}
+		if (components > 3) {
+			gw = decode_group<near_end> (planes + 12, b, end, sw);
+		}
+		size_t first = (size_t)b * 16;
+		// the chunk can end part way through its last block
+		float* to = n - first >= 16 ? out + first * components : last;
+		store_vertices<components> (to, gx.t0, gy.t0, gz.t0, gw.t0);
+		store_vertices<components> (to + 4 * components, gx.t1, gy.t1, gz.t1,
+			gw.t1);
+		store_vertices<components> (to + 8 * components, gx.t2, gy.t2, gz.t2,
+			gw.t2);
+		store_vertices<components> (to + 12 * components, gx.t3, gy.t3, gz.t3,
+			gw.t3);
+		if (to == last) {
+			memcpy (out + first * components, last,
+				(n - first) * components * sizeof (float));
+		}
+	}
+	/* the totals ran on over the padding at the end of a short block, which is
+	zeros, so the last one is still the last vertex's */
+	prev[0] = (uint32_t)_mm_cvtsi128_si32 (sx);
+	if (components > 1) {
+		prev[1] = (uint32_t)_mm_cvtsi128_si32 (sy);
+	}
+	if (components > 2) {
+		prev[2] = (uint32_t)_mm_cvtsi128_si32 (sz);
+	}
+	if (components > 3) {
+		prev[3] = (uint32_t)_mm_cvtsi128_si32 (sw);
+	}
+}
+
+template <int components>
+static void decode_chunk (float* out, size_t n, plane_cursor* planes,
+	const unsigned char* end, uint32_t* prev, bool near_end) {
+	if (near_end) {
+		decode_chunk<components, true> (out, n, planes, end, prev);
+	} else {
+		decode_chunk<components, false> (out, n, planes, end, prev);
+	}
+}
+#else
+/* decodes one chunk of n vertices from planes, carrying each component's
+total on from prev. out is the chunk's first vertex */
+static void decode_chunk (float* out, size_t n, int components,
+	plane_cursor* planes, uint32_t* prev) {
+	int blocks = chunk_blocks (n);
+	for (int b = 0; b < blocks; b++) {
+		size_t first = (size_t)b * 16;
+		size_t count = n - first < 16 ? n - first : 16;
+		for (int c = 0; c < components; c++) {
+			unsigned char bytes[4][16];
+			for (int k = 0; k < 4; k++) {
+				plane_cursor& plane = planes[c * 4 + k];
+				int mode = (plane.modes[b >> 2] >> ((b & 3) * 2)) & 3;
+				unpack_block (bytes[k], plane.data, mode);
+				plane.data += g_block_bytes[mode];
+			}
+			uint32_t p = prev[c];
+			for (size_t i = 0; i < count; i++) {
+				uint32_t z = bytes[0][i] | (uint32_t)bytes[1][i] << 8 |
+					(uint32_t)bytes[2][i] << 16 | (uint32_t)bytes[3][i] << 24;
+				p += (z >> 1) ^ (0u - (z & 1));
+				memcpy (out + (first + i) * components + c, &p, sizeof (p));
+			}
+			prev[c] = p;
+		}
+	}
+}
+#endif
+
+size_t encode_vertex_stream (unsigned char* out, const float* in,
+	size_t vertex_count, int components) {
+	unsigned char* start = out;
+	unsigned char planes[4][VERTEX_CODEC_CHUNK];
+	uint32_t prev[4] = { 0, 0, 0, 0 };
+	for (size_t base = 0; base < vertex_count; base += VERTEX_CODEC_CHUNK) {
+		size_t n = vertex_count - base < VERTEX_CODEC_CHUNK ?
+			vertex_count - base : VERTEX_CODEC_CHUNK;
+		int blocks = chunk_blocks (n);
+		for (int c = 0; c < components; c++) {
+			memset (planes, 0, sizeof (planes));
+			uint32_t& p = prev[c];
+			for (size_t i = 0; i < n; i++) {
+				uint32_t w;
+				memcpy (&w, in + (base + i) * components + c, sizeof (w));
+				uint32_t d = w - p;
+				uint32_t z = (d << 1) ^ (uint32_t)((int32_t)d >> 31);
+				p = w;
+				planes[0][i] = (unsigned char)z;
+				planes[1][i] = (unsigned char)(z >> 8);
+				planes[2][i] = (unsigned char)(z >> 16);
+				planes[3][i] = (unsigned char)(z >> 24);
+			}
+			for (int k = 0; k < 4; k++) {
+				out = pack_plane (out, planes[k], blocks);
+			}
+		}
+	}
+	return out - start;
+}
+
+bool decode_vertex_stream (float* out, size_t vertex_count, int components,
+	const unsigned char* in, size_t size) {
+	if (components < 1 || components > 4) {
+		return false;
+	}
+	const unsigned char* end = in + size;
+	plane_cursor planes[4 * 4];
+	uint32_t prev[4] = { 0, 0, 0, 0 };
+	for (size_t base = 0; base < vertex_count; base += VERTEX_CODEC_CHUNK) {
+		size_t n = vertex_count - base < VERTEX_CODEC_CHUNK ?
+			vertex_count - base : VERTEX_CODEC_CHUNK;
+		const unsigned char* next = find_planes (planes, components * 4, in, end,
+			chunk_blocks (n));
+		if (!next) {
+			return false;
+		}
+		float* to = out + base * components;
+#if CODEC_SSE2
+		bool near_end = end - next < 16;
+		switch (components) {
+			case 1: decode_chunk<1> (to, n, planes, end, prev, near_end); break;
+			case 2: decode_chunk<2> (to, n, planes, end, prev, near_end); break;
+			case 3: decode_chunk<3> (to, n, planes, end, prev, near_end); break;
+			default: decode_chunk<4> (to, n, planes, end, prev, near_end); break;
+		}
+#else
+		decode_chunk (to, n, components, planes, prev);
+#endif
+		in = next;
+	}
+	return in == end;
+}
+
+/*-------------------------------INDEX STREAMS--------------------------------*/
+#define CODEC_FIFO 16
+
+// what the encoder and decoder both keep track of
+struct index_codec_state {
+	unsigned int edges[CODEC_FIFO][2];
+	// 3 edges a triangle, so a signed count could overflow on the biggest mesh
+	unsigned int edge_count;
+	unsigned int corners[CODEC_FIFO];
+	unsigned int corner_count;
+	uint64_t next;
+};
+
+static void push_corner (index_codec_state& s, unsigned int v) {
+	s.corners[s.corner_count++ & (CODEC_FIFO - 1)] = v;
+}
+
+// (k + 1) % 3, for k up to 3
+static const int g_next_corner[4] = { 1, 2, 0, 1 };
+
+static void push_edges (index_codec_state& s, const unsigned int* tri) {
+	for (int k = 0; k < 3; k++) {
+		unsigned int* edge = s.edges[s.edge_count++ & (CODEC_FIFO - 1)];
+		edge[0] = tri[g_next_corner[k]];
+		edge[1] = tri[k];
+	}
+}
+
+static const unsigned int* recent_edge (const index_codec_state& s, int e) {
+	return s.edges[(s.edge_count - 1 - e) & (CODEC_FIFO - 1)];
+}
+
+static int fifo_size (unsigned int count) {
+	return count < CODEC_FIFO ? (int)count : CODEC_FIFO;
+}
+
+// codes corner v to aux, returning its 2-bit code
+static int encode_corner (index_codec_state& s, unsigned int v,
+	unsigned char*& aux) {
+	int code = 0;
+	if (v == s.next) {
+		s.next++;
+	} else {
+		int found = -1;
+		for (int j = 0; j < fifo_size (s.corner_count) && found < 0; j++) {
+			if (s.corners[(s.corner_count - 1 - j) & (CODEC_FIFO - 1)] == v) {
+				found = j;
+			}
+		}
+		if (found >= 0) {
+			code = 1;
+			*aux++ = (unsigned char)found;
+		} else {
+			code = 2;
+			int64_t d = (int64_t)v - (int64_t)s.next;
+			uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+			while (z >= 0x80) {
+				*aux++ = (unsigned char)(z | 0x80);
+				z >>= 7;
+			}
+			*aux++ = (unsigned char)z;
+			if (v >= s.next) {
+				s.next = (uint64_t)v + 1;
+			}
+		}
+	}
+	push_corner (s, v);
+	return code;
+}
+
+/* the other way round. false if aux runs out or the corner makes no sense */
+static bool decode_corner (index_codec_state& s, int code, uint64_t max_index,
+	const unsigned char*& aux, const unsigned char* end, unsigned int& v) {
+	if (0 == code) {
+		if (s.next > max_index) {
+			return false;
+		}
+		v = (unsigned int)s.next++;
+	} else if (1 == code) {
+		if (aux >= end || *aux >= fifo_size (s.corner_count)) {
+			return false;
+		}
+		v = s.corners[(s.corner_count - 1 - *aux++) & (CODEC_FIFO - 1)];
+	} else if (2 == code) {
+		uint64_t z = 0;
+		for (int shift = 0; ; shift += 7) {
+			if (aux >= end || shift > 35) {
+				return false;
+			}
+			unsigned char byte = *aux++;
+			z |= (uint64_t)(byte & 0x7F) << shift;
+			if (byte < 0x80) {
+				break;
+			}
+		}
+		int64_t d = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+		int64_t w = (int64_t)s.next + d;
+		if (w < 0 || (uint64_t)w > max_index) {
+			return false;
+		}
+		v = (unsigned int)w;
+		if (v >= s.next) {
+			s.next = (uint64_t)v + 1;
+		}
+	} else {
+		return false;
+	}
+	push_corner (s, v);
+	return true;
+}
+
+size_t index_stream_bound (size_t index_count) {
+	// a varint of a 33-bit zigzag is at most 5 bytes
+	return index_count / 3 + index_count * 5 + 1;
+}
+
+size_t encode_index_stream (unsigned char* out, const void* indices,
+	size_t index_count, int index_size) {
+	size_t tri_count = index_count / 3;
+	unsigned char* codes = out;
+	unsigned char* aux = out + tri_count;
+	index_codec_state s;
+	memset (&s, 0, sizeof (s));
+	for (size_t t = 0; t < tri_count; t++) {
+		unsigned int tri[3];
+		for (int k = 0; k < 3; k++) {
+			tri[k] = obj_mesh_index (indices, index_size, t * 3 + k);
+		}
+		int edge = -1, rotation = 0;
+		for (int e = 0; e < fifo_size (s.edge_count) && edge < 0; e++) {
+			const unsigned int* pair = recent_edge (s, e);
+			for (int r = 0; r < 3; r++) {
+				if (tri[r] == pair[0] && tri[(r + 1) % 3] == pair[1]) {
+					edge = e;
+					rotation = r;
+					break;
+				}
+			}
+		}
+		if (edge >= 0) {
+			int third = encode_corner (s, tri[(rotation + 2) % 3], aux);
+			codes[t] = (unsigned char)(edge << 4 | rotation << 2 | third);
+		} else {
+			int a = encode_corner (s, tri[0], aux);
+			int b = encode_corner (s, tri[1], aux);
+			int c = encode_corner (s, tri[2], aux);
+			codes[t] = (unsigned char)(c << 6 | b << 4 | 3 << 2 | a);
+		}
+		push_edges (s, tri);
+	}
+	return aux - out;
+}
+
+// decode_index_stream() for one index type
+template <typename T>
+static bool decode_indices (T* out, size_t tri_count, const unsigned char* in,
+	const unsigned char* end) {
+	const uint64_t max_index = (T)~(T)0;
+	const unsigned char* aux = in + tri_count;
+	index_codec_state s;
+	memset (&s, 0, sizeof (s));
+	for (size_t t = 0; t < tri_count; t++, out += 3) {
+		unsigned int code = in[t];
+		unsigned int tri[3];
+		int rotation = (code >> 2) & 3;
+		if (3 == rotation) {
+			if (!decode_corner (s, code & 3, max_index, aux, end, tri[0]) ||
+				!decode_corner (s, (code >> 4) & 3, max_index, aux, end, tri[1]) ||
+				!decode_corner (s, code >> 6, max_index, aux, end, tri[2])) {
+				return false;
+			}
+		} else {
+			int edge = code >> 4;
+			if (edge >= fifo_size (s.edge_count)) {
+				return false;
+			}
+			const unsigned int* pair = recent_edge (s, edge);
+			tri[rotation] = pair[0];
+			tri[g_next_corner[rotation]] = pair[1];
+			unsigned int& third = tri[g_next_corner[rotation + 1]];
+			// the next unused vertex and a recent one are most common, so inline
+			unsigned int kind = code & 3;
+			if (0 == kind && s.next <= max_index) {
+				third = (unsigned int)s.next++;
+				push_corner (s, third);
+			} else if (1 == kind && aux < end && *aux < fifo_size (s.corner_count)) {
+				third = s.corners[(s.corner_count - 1 - *aux++) & (CODEC_FIFO - 1)];
+				push_corner (s, third);
+			} else if (!decode_corner (s, kind, max_index, aux, end, third)) {
+				return false;
+			}
+		}
+		out[0] = (T)tri[0];
+		out[1] = (T)tri[1];
+		out[2] = (T)tri[2];
+		push_edges (s, tri);
+	}
+	return aux == end;
+}
+
+bool decode_index_stream (void* out, size_t index_count, int index_size,
+	const unsigned char* in, size_t size) {
+	size_t tri_count = index_count / 3;
+	if (index_count % 3 != 0 || size < tri_count) {
+		return false;
+	}
+	if (2 == index_size) {
+		return decode_indices ((unsigned short*)out, tri_count, in, in + size);
+	}
+	if (4 == index_size) {
+		return decode_indices ((unsigned int*)out, tri_count, in, in + size);
+	}
+	return false;
+}
@@ -0,0 +1,55 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Lossless compression of a mesh's vertex and index streams, with no outside   |
+| libraries. The mesh cache doesn't use it: decoding runs at about 2 GB/s, a   |
+| mapped raw cache loads in a few ms, so it only wins off a slow cold disk.    |
+| Vertex streams: each float component is taken as an integer and delta coded  |
+| against the same component of the previous vertex. After vertex fetch        |
+| optimisation neighbouring vertices are close, so the zigzagged deltas have   |
+| mostly-zero high bytes. The deltas are split into byte planes and each plane |
+| is bit-packed 16 bytes at a time at 0, 2, 4 or 8 bits a byte, whichever the  |
+| biggest byte needs. That's the entropy stage: cruder than Huffman, but it    |
+| decodes with no bit-at-a-time work.                                          |
+| Index streams: a byte per triangle. Most triangles share an edge with one of |
+| the last few, so they're coded as that edge plus the third vertex, which is  |
+| usually the next vertex not yet used or one used just before.                |
+| Decoding is exact and checks every read, so a damaged stream just fails.     |
+\******************************************************************************/
+#ifndef _MESH_CODEC_H_
+#define _MESH_CODEC_H_
+
+#include <stddef.h>
+
+// vertices per chunk of a vertex stream. each chunk is decoded in L1 cache
+#define VERTEX_CODEC_CHUNK 1024
+
+// most bytes encode_vertex_stream() can write
+size_t vertex_stream_bound (size_t vertex_count, int components);
+/* encodes vertex_count vertices of components (1 to 4) floats each,
+interleaved as in obj_mesh. out needs vertex_stream_bound() bytes. returns the
+bytes written */
+size_t encode_vertex_stream (unsigned char* out, const float* in,
+	size_t vertex_count, int components);
+/* decodes size bytes from encode_vertex_stream() into out. false if the data
+is damaged or doesn't hold exactly that many vertices */
+bool decode_vertex_stream (float* out, size_t vertex_count, int components,
+	const unsigned char* in, size_t size);
+
+// most bytes encode_index_stream() can write
+size_t index_stream_bound (size_t index_count);
+/* encodes a triangle list of 2 or 4 byte indices. index_count is a multiple
+of 3. returns the bytes written */
+size_t encode_index_stream (unsigned char* out, const void* indices,
+	size_t index_count, int index_size);
+/* decodes size bytes from encode_index_stream(). false if the data is damaged.
+indices aren't checked against the vertex count, that's up to the caller */
+bool decode_index_stream (void* out, size_t index_count, int index_size,
+	const unsigned char* in, size_t size);
+
+#endif
@@ -0,0 +1,248 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Tipsify is linear in the size of the mesh: it fans out around one vertex at  |
+| a time, emitting every triangle still using it, then moves on to whichever   |
+| vertex that fan touched is still in the cache and has triangles left, and    |
+| falls back to a stack of recently used vertices (the "dead-end" stack) and   |
+| finally to the next unfinished vertex in order. The cache is simulated with  |
+| timestamps, so it costs nothing per lookup.                                  |
+\******************************************************************************/
+#include "mesh_optimise.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+vertex_cache_stats analyse_vertex_cache (const obj_mesh& mesh, int cache_size) {
+	vertex_cache_stats stats;
+	memset (&stats, 0, sizeof (stats));
+	if (mesh.index_count < 3 || mesh.vertex_count < 1) {
+		return stats;
+	}
+	// the miss number each vertex was loaded at. FIFO, so hits don't refresh it
+	int* loaded_at = (int*)malloc (mesh.vertex_count * sizeof (int));
+	if (!loaded_at) {
+		return stats;
+	}
+	memset (loaded_at, 0xFF, mesh.vertex_count * sizeof (int));
+	int misses = 0;
+	for (int i = 0; i < mesh.index_count; i++) {
+		unsigned int v = obj_mesh_index (mesh.indices, mesh.index_size, i);
+		if (loaded_at[v] < 0 || misses - loaded_at[v] >= cache_size) {
+			loaded_at[v] = misses++;
+		}
+	}
+	free (loaded_at);
+	stats.acmr = (float)misses / (float)(mesh.index_count / 3);
+	stats.atvr = (float)misses / (float)mesh.vertex_count;
+	return stats;
+}
+
+/*----------------------------------TIPSIFY-----------------------------------*/
+// reorders the triangles of one index buffer in place
+static bool tipsify (void* indices, int index_count, int index_size,
+	int vertex_count, int cache_size) {
+	if (index_count < 3) {
+		return true;
+	}
+	unsigned int* in = (unsigned int*)malloc (index_count * sizeof (unsigned int));
+	// the triangles using each vertex are adjacency[offsets[v], offsets[v + 1])
+	int* offsets = (int*)calloc (vertex_count + 1, sizeof (int));
+	int* adjacency = (int*)malloc (index_count * sizeof (int));
+	// triangles each vertex has left to emit
+	int* live = (int*)calloc (vertex_count, sizeof (int));
+	int* cache_time = (int*)calloc (vertex_count, sizeof (int));
+	unsigned char* emitted = (unsigned char*)calloc (index_count / 3, 1);
+	int* dead_end = (int*)malloc (index_count * sizeof (int));
+	int* candidates = (int*)malloc (index_count * sizeof (int));
+	if (!in || !offsets || !adjacency || !live || !cache_time || !emitted ||
+		!dead_end || !candidates) {
+		fprintf (stderr, "ERROR: out of memory optimising mesh\n");
+		free (in);
+		free (offsets);
+		free (adjacency);
+		free (live);
+		free (cache_time);
+		free (emitted);
+		free (dead_end);
+		free (candidates);
+		return false;
+	}
+	for (int i = 0; i < index_count; i++) {
+		in[i] = obj_mesh_index (indices, index_size, i);
+		offsets[in[i] + 1]++;
+	}
+	for (int v = 0; v < vertex_count; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+	for (int i = 0; i < index_count; i++) {
+		adjacency[offsets[in[i]] + live[in[i]]++] = i / 3;
+	}
+
+	int out_count = 0;
+	int dead_top = 0;
+	int time = cache_size + 1;
+	int cursor = 0;
+	while (cursor < vertex_count && 0 == live[cursor]) {
+		cursor++;
+	}
+	int fan = cursor < vertex_count ? cursor : -1;
+	while (fan >= 0) {
+		// emit every triangle left around the fanning vertex
+		int num_candidates = 0;
+		for (int a = offsets[fan]; a < offsets[fan + 1]; a++) {
+			int t = adjacency[a];
+			if (emitted[t]) {
+				continue;
+			}
+			emitted[t] = 1;
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = in[t * 3 + k];
+				set_obj_mesh_index (indices, index_size, out_count++, v);
+				dead_end[dead_top++] = (int)v;
+				candidates[num_candidates++] = (int)v;
+				live[v]--;
+				if (time - cache_time[v] > cache_size) {
+					cache_time[v] = time++;
+				}
+			}
+		}
+		/* next, the candidate with triangles left that will still be in the
+		cache after emitting them, oldest first. a vertex that won't make it
+		scores 0, so it's only picked if nothing better is left */
+		int best = -1;
+		int best_priority = -1;
+		for (int i = 0; i < num_candidates; i++) {
+			int v = candidates[i];
+			if (live[v] <= 0) {
+				continue;
+			}
+			int priority = 0;
+			if (time - cache_time[v] + 2 * live[v] <= cache_size) {
+				priority = time - cache_time[v];
+			}
+			if (priority > best_priority) {
+				best_priority = priority;
+				best = v;
+			}
+		}
+		while (best < 0 && dead_top > 0) {
+			int v = dead_end[--dead_top];
+			if (live[v] > 0) {
+				best = v;
+			}
+		}
+		if (best < 0) {
+			while (cursor < vertex_count && 0 == live[cursor]) {
+				cursor++;
+			}
+			best = cursor < vertex_count ? cursor : -1;
+		}
+		fan = best;
+	}
+	free (in);
+	free (offsets);
+	free (adjacency);
+	free (live);
+	free (cache_time);
+	free (emitted);
+	free (dead_end);
+	free (candidates);
+	return true;
+}
+
+// the full mesh and every lod
+bool optimise_vertex_cache (obj_mesh& mesh, int cache_size) {
+	if (!detach_obj_mesh (mesh)) {
+		return false;
+	}
+	bool ok = tipsify (mesh.indices, mesh.index_count, mesh.index_size,
+		mesh.vertex_count, cache_size);
+	for (int i = 0; ok && i < mesh.lod_count; i++) {
+		ok = tipsify (mesh.lods[i].indices, mesh.lods[i].index_count,
+			mesh.index_size, mesh.vertex_count, cache_size);
+	}
+	return ok;
+}
+
+/*--------------------------------VERTEX FETCH--------------------------------*/
+/* vertices are numbered in the order the indices first use them. any that no
+triangle uses go on the end, in their old order. lods only use vertices the
+full mesh uses, so they just get the new numbers */
+bool optimise_vertex_fetch (obj_mesh& mesh) {
+	if (mesh.vertex_count < 1) {
+		return true;
+	}
+	// the renumbered mesh is built in a new arena, then swapped in
+	int lod_index_counts[MAX_MESH_LODS];
+	for (int l = 0; l < mesh.lod_count; l++) {
+		lod_index_counts[l] = mesh.lods[l].index_count;
+	}
+	size_t v_count = (size_t)mesh.vertex_count;
+	int* remap = (int*)malloc (v_count * sizeof (int));
+	obj_mesh out;
+	if (!remap || !alloc_obj_mesh (out, mesh.vertex_count, mesh.index_count,
+		mesh.index_size, lod_index_counts, mesh.lod_count)) {
+		fprintf (stderr, "ERROR: out of memory optimising mesh\n");
+		free (remap);
+		return false;
+	}
+	memset (remap, 0xFF, v_count * sizeof (int));
+	int next = 0;
+	for (int i = 0; i < mesh.index_count; i++) {
+		unsigned int v = obj_mesh_index (mesh.indices, mesh.index_size, i);
+		if (remap[v] < 0) {
+			remap[v] = next++;
+		}
+		set_obj_mesh_index (out.indices, mesh.index_size, i,
+			(unsigned int)remap[v]);
+	}
+	for (size_t v = 0; v < v_count; v++) {
+		if (remap[v] < 0) {
+			remap[v] = next++;
+		}
+		size_t to = (size_t)remap[v];
+		memcpy (out.points + to * 3, mesh.points + v * 3, 3 * sizeof (float));
+		memcpy (out.tex_coords + to * 2, mesh.tex_coords + v * 2, 2 * sizeof (float));
+		memcpy (out.normals + to * 3, mesh.normals + v * 3, 3 * sizeof (float));
+	}
+	for (int l = 0; l < mesh.lod_count; l++) {
+		for (int i = 0; i < mesh.lods[l].index_count; i++) {
+			unsigned int v = obj_mesh_index (mesh.lods[l].indices, mesh.index_size,
+				i);
+			set_obj_mesh_index (out.lods[l].indices, mesh.index_size, i,
+				(unsigned int)remap[v]);
+		}
+		out.lods[l].error = mesh.lods[l].error;
+	}
+	out.bounds = mesh.bounds;
+	free (remap);
+	free_obj_mesh (mesh);
+	mesh = out;
+	return true;
+}
+
+bool optimise_mesh (obj_mesh& mesh) {
+	timespec start, end;
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	vertex_cache_stats before = analyse_vertex_cache (mesh, VERTEX_CACHE_SIZE);
+	if (!optimise_vertex_cache (mesh, VERTEX_CACHE_SIZE) ||
+		!optimise_vertex_fetch (mesh)) {
+		return false;
+	}
+	vertex_cache_stats after = analyse_vertex_cache (mesh, VERTEX_CACHE_SIZE);
+	clock_gettime (CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 +
+		(end.tv_nsec - start.tv_nsec) * 1e-6;
+	printf (
+		"optimised mesh in %.1f ms. ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		ms, before.acmr, after.acmr, before.atvr, after.atvr
+	);
+	return true;
+}
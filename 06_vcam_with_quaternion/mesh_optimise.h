@@ -0,0 +1,47 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Reordering an indexed mesh for the GPU, after it's loaded.                   |
+| Triangles come out of an obj in whatever order the exporter wrote them. The  |
+| vertex cache pass reorders them with Tipsify (Sander, Nehab & Barczak 2007)  |
+| so that triangles sharing vertices are drawn close together and their        |
+| vertices are still in the post-transform cache. The vertex fetch pass then   |
+| renumbers the vertices in the order the new index buffer first uses them, so |
+| the vertex shader reads the buffers front to back.                           |
+| Both only change the order of things: the mesh draws the same triangles,     |
+| each with the same winding, from the same vertex data.                       |
+| ACMR is cache misses per triangle (0.5 is about as good as a big regular     |
+| mesh gets, 3 is no reuse at all) and ATVR is misses per vertex (1 is ideal). |
+\******************************************************************************/
+#ifndef _MESH_OPTIMISE_H_
+#define _MESH_OPTIMISE_H_
+
+#include "obj_parser.h"
+
+/* vertices in the simulated post-transform cache. real GPUs vary, and Tipsify
+is not very sensitive to it */
+#define VERTEX_CACHE_SIZE 16
+
+struct vertex_cache_stats {
+	float acmr;
+	float atvr;
+};
+
+/* simulates a FIFO post-transform cache of cache_size vertices over the index
+buffer */
+vertex_cache_stats analyse_vertex_cache (const obj_mesh& mesh, int cache_size);
+
+/* these work on any mesh from load_obj_file_indexed(), lods included. one
+mapped from the mesh cache is copied out of the mapping first. false if out of
+memory */
+bool optimise_vertex_cache (obj_mesh& mesh, int cache_size);
+bool optimise_vertex_fetch (obj_mesh& mesh);
+// both of the above, printing the ACMR and ATVR before and after
+bool optimise_mesh (obj_mesh& mesh);
+
+#endif
@@ -0,0 +1,360 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| The decoding here matches the shader's: positions are unsigned normalised,   |
+| c / 65535, and octahedral codes are read as plain ints, then times 1 / 32767 |
+| or 1 / 127 and clamped to -1.                                                |
+| The octahedral map folds the sphere onto the |x| + |y| + |z| = 1 octahedron, |
+| then the bottom half out over the corners of the top half's square, so       |
+| every code in -1..1 squared is a direction and none are wasted.              |
+\******************************************************************************/
+#include "mesh_pack.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+/*--------------------------------HALF FLOATS---------------------------------*/
+// rounds to nearest even, like the GPU does
+static unsigned short float_to_half (float f) {
+	unsigned int x;
+	memcpy (&x, &f, sizeof (x));
+	unsigned int sign = (x >> 16) & 0x8000;
+	unsigned int exponent = (x >> 23) & 0xFF;
+	unsigned int mantissa = x & 0x7FFFFF;
+	if (0xFF == exponent) {
+		return (unsigned short)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	}
+	int e = (int)exponent - 127 + 15;
+	if (e >= 31) {
+		return (unsigned short)(sign | 0x7C00);
+	}
+	if (e <= 0) {
+		// too small for a normal half, so it's a denormal or 0
+		if (e < -10) {
+			return (unsigned short)sign;
+		}
+		mantissa |= 0x800000;
+		int shift = 14 - e;
+		unsigned int half = mantissa >> shift;
+		unsigned int rest = mantissa & ((1u << shift) - 1);
+		unsigned int middle = 1u << (shift - 1);
+		if (rest > middle || (rest == middle && (half & 1))) {
+			half++;
+		}
+		return (unsigned short)(sign | half);
+	}
+	unsigned int half = ((unsigned int)e << 10) | (mantissa >> 13);
+	unsigned int rest = mantissa & 0x1FFF;
+	// a carry out of the mantissa goes into the exponent, which is right
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+		half++;
+	}
+	return (unsigned short)(sign | half);
+}
+
+static float half_to_float (unsigned short h) {
+	unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	unsigned int exponent = (h >> 10) & 0x1F;
+	unsigned int mantissa = h & 0x3FF;
+	unsigned int x;
+	if (0 == exponent) {
+		float f = (float)mantissa * (1.0f / 16777216.0f);
+		memcpy (&x, &f, sizeof (x));
+		x |= sign;
+	} else if (31 == exponent) {
+		x = sign | 0x7F800000 | (mantissa << 13);
+	} else {
+		x = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	float f;
+	memcpy (&f, &x, sizeof (f));
+	return f;
+}
+
+/*---------------------------------OCTAHEDRAL---------------------------------*/
+// -1 or 1, never 0, so the fold is right on the axes
+static float sign_not_zero (float f) {
+	return f < 0.0f ? -1.0f : 1.0f;
+}
+
+static void oct_decode (float x, float y, float* n) {
+	n[0] = x;
+	n[1] = y;
+	n[2] = 1.0f - fabsf (x) - fabsf (y);
+	if (n[2] < 0.0f) {
+		n[0] = (1.0f - fabsf (y)) * sign_not_zero (x);
+		n[1] = (1.0f - fabsf (x)) * sign_not_zero (y);
+	}
+	float len = sqrtf (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	n[0] /= len;
+	n[1] /= len;
+	n[2] /= len;
+}
+
+static float snorm_to_float (int c, int max) {
+	float f = (float)c / (float)max;
+	return f < -1.0f ? -1.0f : f;
+}
+
+/* the code of n, max 32767 or 127. the nearest code to the projected point
+isn't always the nearest direction, so the 4 codes around it are tried */
+static void oct_encode (const float* n, int max, int* code) {
+	float l1 = fabsf (n[0]) + fabsf (n[1]) + fabsf (n[2]);
+	if (l1 <= 0.0f) {
+		code[0] = code[1] = 0;
+		return;
+	}
+	float x = n[0] / l1;
+	float y = n[1] / l1;
+	if (n[2] < 0.0f) {
+		float fx = (1.0f - fabsf (y)) * sign_not_zero (x);
+		y = (1.0f - fabsf (x)) * sign_not_zero (y);
+		x = fx;
+	}
+	float len = sqrtf (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	int base_x = (int)floorf (x * max);
+	int base_y = (int)floorf (y * max);
+	float best = -2.0f;
+	for (int i = 0; i < 4; i++) {
+		int cx = base_x + (i & 1);
+		int cy = base_y + (i >> 1);
+		cx = cx > max ? max : (cx < -max ? -max : cx);
+		cy = cy > max ? max : (cy < -max ? -max : cy);
+		float d[3];
+		oct_decode (snorm_to_float (cx, max), snorm_to_float (cy, max), d);
+		float dot = (d[0] * n[0] + d[1] * n[1] + d[2] * n[2]) / len;
+		if (dot > best) {
+			best = dot;
+			code[0] = cx;
+			code[1] = cy;
+		}
+	}
+}
+
+/*-----------------------------------LAYOUT-----------------------------------*/
+static void set_attrib (packed_attrib& a, int size, unsigned int type,
+	bool normalised, int& offset) {
+	int bytes = PACK_GL_FLOAT == type ? 4 : (PACK_GL_BYTE == type ? 1 : 2);
+	// each attribute starts on a multiple of its component size, as GL needs
+	offset = (offset + bytes - 1) / bytes * bytes;
+	a.size = size;
+	a.type = type;
+	a.normalised = normalised;
+	a.offset = offset;
+	offset += size * bytes;
+}
+
+/* position, then normal, then uv, so 16-bit positions and 8-bit normals make
+8 bytes together */
+static void layout_vertex (packed_mesh& packed) {
+	int offset = 0;
+	const vertex_format& f = packed.format;
+	if (PACK_POSITION_UNORM16 == f.position) {
+		set_attrib (packed.attribs[PACKED_POSITION], 3, PACK_GL_UNSIGNED_SHORT, true,
+			offset);
+	} else {
+		set_attrib (packed.attribs[PACKED_POSITION], 3, PACK_GL_FLOAT, false, offset);
+	}
+	if (PACK_NORMAL_OCT16 == f.normal) {
+		set_attrib (packed.attribs[PACKED_NORMAL], 2, PACK_GL_SHORT, false, offset);
+		packed.normal_scale = 1.0f / 32767.0f;
+	} else if (PACK_NORMAL_OCT8 == f.normal) {
+		set_attrib (packed.attribs[PACKED_NORMAL], 2, PACK_GL_BYTE, false, offset);
+		packed.normal_scale = 1.0f / 127.0f;
+	} else {
+		set_attrib (packed.attribs[PACKED_NORMAL], 3, PACK_GL_FLOAT, false, offset);
+		packed.normal_scale = 1.0f;
+	}
+	if (PACK_UV_HALF == f.uv) {
+		set_attrib (packed.attribs[PACKED_TEX_COORD], 2, PACK_GL_HALF_FLOAT, false,
+			offset);
+	} else {
+		set_attrib (packed.attribs[PACKED_TEX_COORD], 2, PACK_GL_FLOAT, false,
+			offset);
+	}
+	// keeps every vertex 4-byte aligned
+	packed.stride = (offset + 3) / 4 * 4;
+}
+
+/*----------------------------------PACKING-----------------------------------*/
+struct pack_job {
+	const obj_mesh* mesh;
+	packed_mesh* packed;
+};
+
+static void pack_vertices (void* ctx, size_t begin, size_t end) {
+	const pack_job& job = *(const pack_job*)ctx;
+	const obj_mesh& mesh = *job.mesh;
+	packed_mesh& packed = *job.packed;
+	const packed_attrib* attribs = packed.attribs;
+	for (size_t v = begin; v < end; v++) {
+		unsigned char* out = (unsigned char*)packed.vertices + v * packed.stride;
+		const float* p = mesh.points + v * 3;
+		const float* t = mesh.tex_coords + v * 2;
+		const float* n = mesh.normals + v * 3;
+
+		unsigned char* a = out + attribs[PACKED_POSITION].offset;
+		if (PACK_POSITION_UNORM16 == packed.format.position) {
+			unsigned short c[3];
+			for (int i = 0; i < 3; i++) {
+				float f = packed.pos_scale[i] > 0.0f ?
+					(p[i] - packed.pos_offset[i]) / packed.pos_scale[i] : 0.0f;
+				f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+				c[i] = (unsigned short)(f * 65535.0f + 0.5f);
+			}
+			memcpy (a, c, sizeof (c));
+		} else {
+			memcpy (a, p, 3 * sizeof (float));
+		}
+
+		a = out + attribs[PACKED_NORMAL].offset;
+		if (PACK_NORMAL_FLOAT == packed.format.normal) {
+			memcpy (a, n, 3 * sizeof (float));
+		} else if (PACK_NORMAL_OCT16 == packed.format.normal) {
+			int code[2];
+			oct_encode (n, 32767, code);
+			short c[2] = { (short)code[0], (short)code[1] };
+			memcpy (a, c, sizeof (c));
+		} else {
+			int code[2];
+			oct_encode (n, 127, code);
+			signed char c[2] = { (signed char)code[0], (signed char)code[1] };
+			memcpy (a, c, sizeof (c));
+		}
+
+		a = out + attribs[PACKED_TEX_COORD].offset;
+		if (PACK_UV_HALF == packed.format.uv) {
+			unsigned short c[2] = { float_to_half (t[0]), float_to_half (t[1]) };
+			memcpy (a, c, sizeof (c));
+		} else {
+			memcpy (a, t, 2 * sizeof (float));
+		}
+	}
+}
+
+bool pack_mesh_vertices (const obj_mesh& mesh, vertex_format format,
+	packed_mesh& packed) {
+	memset (&packed, 0, sizeof (packed));
+	packed.format = format;
+	packed.vertex_count = mesh.vertex_count;
+	layout_vertex (packed);
+	for (int i = 0; i < 3; i++) {
+		if (PACK_POSITION_UNORM16 == format.position) {
+			packed.pos_offset[i] = mesh.bounds.min[i];
+			packed.pos_scale[i] = mesh.bounds.max[i] - mesh.bounds.min[i];
+		} else {
+			packed.pos_offset[i] = 0.0f;
+			packed.pos_scale[i] = 1.0f;
+		}
+	}
+	// the padding is zeroed, so the same mesh always packs to the same bytes
+	packed.vertices = calloc ((size_t)mesh.vertex_count * packed.stride + 1, 1);
+	if (!packed.vertices) {
+		fprintf (stderr, "ERROR: out of memory packing mesh\n");
+		return false;
+	}
+	pack_job job = { &mesh, &packed };
+	parallel_for (mesh.vertex_count, PACK_GRAIN, pack_vertices, &job);
+	return true;
+}
+
+void free_packed_mesh (packed_mesh& packed) {
+	free (packed.vertices);
+	memset (&packed, 0, sizeof (packed));
+}
+
+/*----------------------------------DECODING----------------------------------*/
+void unpack_vertex (const packed_mesh& packed, int v, float* point,
+	float* tex_coord, float* normal) {
+	const unsigned char* in = (const unsigned char*)packed.vertices +
+		(size_t)v * packed.stride;
+	const packed_attrib* attribs = packed.attribs;
+	if (point) {
+		const unsigned char* a = in + attribs[PACKED_POSITION].offset;
+		if (PACK_POSITION_UNORM16 == packed.format.position) {
+			unsigned short c[3];
+			memcpy (c, a, sizeof (c));
+			for (int i = 0; i < 3; i++) {
+				point[i] = (float)c[i] / 65535.0f * packed.pos_scale[i] +
+					packed.pos_offset[i];
+			}
+		} else {
+			memcpy (point, a, 3 * sizeof (float));
+		}
+	}
+	if (normal) {
+		const unsigned char* a = in + attribs[PACKED_NORMAL].offset;
+		if (PACK_NORMAL_FLOAT == packed.format.normal) {
+			memcpy (normal, a, 3 * sizeof (float));
+			float len = sqrtf (normal[0] * normal[0] + normal[1] * normal[1] +
+				normal[2] * normal[2]);
+			for (int i = 0; len > 0.0f && i < 3; i++) {
+				normal[i] /= len;
+			}
+		} else if (PACK_NORMAL_OCT16 == packed.format.normal) {
+			short c[2];
+			memcpy (c, a, sizeof (c));
+			oct_decode (snorm_to_float (c[0], 32767), snorm_to_float (c[1], 32767),
+				normal);
+		} else {
+			signed char c[2];
+			memcpy (c, a, sizeof (c));
+			oct_decode (snorm_to_float (c[0], 127), snorm_to_float (c[1], 127),
+				normal);
+		}
+	}
+	if (tex_coord) {
+		const unsigned char* a = in + attribs[PACKED_TEX_COORD].offset;
+		if (PACK_UV_HALF == packed.format.uv) {
+			unsigned short c[2];
+			memcpy (c, a, sizeof (c));
+			tex_coord[0] = half_to_float (c[0]);
+			tex_coord[1] = half_to_float (c[1]);
+		} else {
+			memcpy (tex_coord, a, 2 * sizeof (float));
+		}
+	}
+}
+
+pack_error measure_pack_error (const obj_mesh& mesh, const packed_mesh& packed) {
+	pack_error error;
+	memset (&error, 0, sizeof (error));
+	double max_angle = 0.0;
+	for (int v = 0; v < packed.vertex_count; v++) {
+		float p[3], t[2], n[3];
+		unpack_vertex (packed, v, p, t, n);
+		const float* mp = mesh.points + v * 3;
+		const float* mt = mesh.tex_coords + v * 2;
+		const float* mn = mesh.normals + v * 3;
+		double dx = (double)p[0] - mp[0];
+		double dy = (double)p[1] - mp[1];
+		double dz = (double)p[2] - mp[2];
+		float distance = (float)sqrt (dx * dx + dy * dy + dz * dz);
+		error.position = distance > error.position ? distance : error.position;
+		for (int i = 0; i < 2; i++) {
+			float d = fabsf (t[i] - mt[i]);
+			error.uv = d > error.uv ? d : error.uv;
+		}
+		// acos of the dot is no good for tiny angles, this keeps its precision
+		double cx = (double)n[1] * mn[2] - (double)n[2] * mn[1];
+		double cy = (double)n[2] * mn[0] - (double)n[0] * mn[2];
+		double cz = (double)n[0] * mn[1] - (double)n[1] * mn[0];
+		double dot = (double)n[0] * mn[0] + (double)n[1] * mn[1] +
+			(double)n[2] * mn[2];
+		double cross = sqrt (cx * cx + cy * cy + cz * cz);
+		if (cross > 0.0 || dot != 0.0) {
+			double angle = atan2 (cross, dot);
+			max_angle = angle > max_angle ? angle : max_angle;
+		}
+	}
+	error.normal_degrees = (float)(max_angle * 180.0 / M_PI);
+	return error;
+}
@@ -0,0 +1,112 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Smaller vertices for the GPU. A loaded mesh is 32 bytes a vertex in three    |
+| float arrays; packing interleaves it into one buffer in a smaller format:    |
+| - positions as 16-bit unsigned normalised ints across the mesh's box, so the |
+|   shader gets 0..1 and scales it back with two uniforms                      |
+| - normals octahedral-encoded (Meyer et al. 2010) into 2 signed shorts or     |
+|   bytes. each one is the best of the 4 nearest codes                         |
+| - uvs as half floats                                                         |
+| Every attribute is a float attribute to glVertexAttribPointer, so the decode |
+| is a couple of lines in the vertex shader (see test_vs.glsl). 16 bytes a     |
+| vertex with 16-bit normals, 12 with 8-bit ones.                              |
+\******************************************************************************/
+#ifndef _MESH_PACK_H_
+#define _MESH_PACK_H_
+
+#include "obj_parser.h"
+
+// vertices per thread pool chunk when packing
+#define PACK_GRAIN 16384
+
+enum pack_position {
+	PACK_POSITION_FLOAT,
+	PACK_POSITION_UNORM16
+};
+
+enum pack_normal {
+	PACK_NORMAL_FLOAT,
+	PACK_NORMAL_OCT16,
+	PACK_NORMAL_OCT8
+};
+
+enum pack_uv {
+	PACK_UV_FLOAT,
+	PACK_UV_HALF
+};
+
+struct vertex_format {
+	pack_position position;
+	pack_normal normal;
+	pack_uv uv;
+};
+
+/* the GL type enums the packed attributes use, so this header doesn't need
+the GL headers */
+#define PACK_GL_BYTE 0x1400
+#define PACK_GL_SHORT 0x1402
+#define PACK_GL_UNSIGNED_SHORT 0x1403
+#define PACK_GL_FLOAT 0x1406
+#define PACK_GL_HALF_FLOAT 0x140B
+
+// attribs[] order, which is also the attribute location in test_vs.glsl
+#define PACKED_POSITION 0
+#define PACKED_TEX_COORD 1
+#define PACKED_NORMAL 2
+#define PACKED_ATTRIBS 3
+
+// the arguments to glVertexAttribPointer for one attribute
+struct packed_attrib {
+	int size;
+	unsigned int type;
+	bool normalised;
+	int offset;
+};
+
+/* one interleaved vertex buffer. positions decode as stored * pos_scale +
+pos_offset (scale 1 and offset 0 for float positions). octahedral normals
+aren't normalised by GL, since GL before 4.2 maps signed ints differently: the
+shader gets the raw codes as a vec2, and max (code * normal_scale, -1) is the
+point on the octahedron */
+struct packed_mesh {
+	void* vertices;
+	int vertex_count;
+	int stride;
+	vertex_format format;
+	packed_attrib attribs[PACKED_ATTRIBS];
+	float pos_offset[3];
+	float pos_scale[3];
+	float normal_scale;
+};
+
+// the most any vertex moved in packing
+struct pack_error {
+	// distance, in mesh units
+	float position;
+	// angle between the normals, in degrees
+	float normal_degrees;
+	// largest difference in either coordinate
+	float uv;
+};
+
+/* packs mesh's vertices into format, on the thread pool. the index buffers are
+unchanged. free with free_packed_mesh(). false if out of memory */
+bool pack_mesh_vertices (const obj_mesh& mesh, vertex_format format,
+	packed_mesh& packed);
+void free_packed_mesh (packed_mesh& packed);
+
+/* decodes vertex v the way the shader would. any of the outputs may be NULL.
+normals come out unit length */
+void unpack_vertex (const packed_mesh& packed, int v, float* point,
+	float* tex_coord, float* normal);
+
+// compares every packed vertex with the mesh it came from
+pack_error measure_pack_error (const obj_mesh& mesh, const packed_mesh& packed);
+
+#endif
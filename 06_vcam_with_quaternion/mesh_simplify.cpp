@@ -0,0 +1,560 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| The topology works on positions, not vertices: vertices at the same point    |
+| are welded into one id, so a uv seam isn't mistaken for a hole. Each welded  |
+| id has a quadric - the sum of the squared distances to the planes of the     |
+| triangles around it - and collapsing u onto v costs (Qu + Qv) at v.          |
+| A collapse is skipped if it would flip a triangle or pinch the surface (u    |
+| and v must share exactly the two neighbours across their edge). Within a     |
+| round, nothing next to a collapse may collapse too, so the triangle lists    |
+| built at the start of the round stay right for the whole round.              |
+\******************************************************************************/
+#include "mesh_simplify.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+// a symmetric 4x4 matrix: a2 ab ac ad b2 bc bd c2 cd d2
+struct quadric {
+	double q[10];
+};
+
+static void add_plane (quadric& q, double a, double b, double c, double d) {
+	q.q[0] += a * a;
+	q.q[1] += a * b;
+	q.q[2] += a * c;
+	q.q[3] += a * d;
+	q.q[4] += b * b;
+	q.q[5] += b * c;
+	q.q[6] += b * d;
+	q.q[7] += c * c;
+	q.q[8] += c * d;
+	q.q[9] += d * d;
+}
+
+// sum of the squared distances from p to the planes in a + b
+static double quadric_error (const quadric& a, const quadric& b,
+	const float* p) {
+	double q[10];
+	for (int i = 0; i < 10; i++) {
+		q[i] = a.q[i] + b.q[i];
+	}
+	double x = p[0], y = p[1], z = p[2];
+	double e = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z +
+		2.0 * q[3] * x + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y +
+		q[7] * z * z + 2.0 * q[8] * z + q[9];
+	return e > 0.0 ? e : 0.0;
+}
+
+struct collapse {
+	int u;
+	int v;
+	double cost;
+};
+
+static bool cheaper (const collapse& a, const collapse& b) {
+	if (a.cost != b.cost) {
+		return a.cost < b.cost;
+	}
+	return a.u != b.u ? a.u < b.u : a.v < b.v;
+}
+
+struct simplifier {
+	const float* points;
+	int vertex_count;
+	// vertex -> welded id, and a vertex for each welded id
+	int* weld;
+	int* weld_vertex;
+	int weld_count;
+	unsigned char* locked;
+	quadric* quadrics;
+	// the current triangles, as vertex ids
+	unsigned int* tris;
+	int tri_count;
+	// per round: triangles around each welded id, adjacency[offsets[w] ...]
+	int* offsets;
+	int* adjacency;
+	collapse* collapses;
+	unsigned char* touched;
+	// vertex -> vertex it collapsed onto this round
+	int* collapse_to;
+	bool keep_seams;
+	double max_cost;
+};
+
+static void free_simplifier (simplifier& s) {
+	free (s.weld);
+	free (s.weld_vertex);
+	free (s.locked);
+	free (s.quadrics);
+	free (s.tris);
+	free (s.offsets);
+	free (s.adjacency);
+	free (s.collapses);
+	free (s.touched);
+	free (s.collapse_to);
+	memset (&s, 0, sizeof (s));
+}
+
+static unsigned int hash_position (const float* p) {
+	unsigned int b[3];
+	memcpy (b, p, sizeof (b));
+	unsigned int h = b[0] * 0x9E3779B1u;
+	h ^= b[1] * 0x85EBCA77u + (h << 6) + (h >> 2);
+	h ^= b[2] * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+	return h ^ (h >> 15);
+}
+
+// welds vertices with the same position, with a table like the loader's
+static bool weld_positions (simplifier& s) {
+	size_t table_size = 16;
+	while (table_size < (size_t)s.vertex_count * 2) {
+		table_size *= 2;
+	}
+	int* table = (int*)malloc (table_size * sizeof (int));
+	if (!table) {
+		return false;
+	}
+	memset (table, 0xFF, table_size * sizeof (int));
+	s.weld_count = 0;
+	for (int v = 0; v < s.vertex_count; v++) {
+		const float* p = s.points + v * 3;
+		size_t slot = hash_position (p) & (table_size - 1);
+		while (table[slot] >= 0 &&
+			0 != memcmp (s.points + s.weld_vertex[table[slot]] * 3, p,
+				3 * sizeof (float))) {
+			slot = (slot + 1) & (table_size - 1);
+		}
+		if (table[slot] < 0) {
+			table[slot] = s.weld_count;
+			s.weld_vertex[s.weld_count++] = v;
+		}
+		s.weld[v] = table[slot];
+	}
+	free (table);
+	return true;
+}
+
+/* an edge with other than two triangles is on a hole or is non-manifold. its
+ends stay put */
+static bool lock_open_edges (simplifier& s) {
+	size_t count = (size_t)s.tri_count * 3;
+	unsigned long long* edges = (unsigned long long*)malloc (
+		count * sizeof (unsigned long long) + 1);
+	if (!edges) {
+		return false;
+	}
+	for (int t = 0; t < s.tri_count; t++) {
+		for (int k = 0; k < 3; k++) {
+			unsigned long long a = s.weld[s.tris[t * 3 + k]];
+			unsigned long long b = s.weld[s.tris[t * 3 + (k + 1) % 3]];
+			edges[t * 3 + k] = a < b ? (a << 32) | b : (b << 32) | a;
+		}
+	}
+	std::sort (edges, edges + count);
+	for (size_t i = 0; i < count;) {
+		size_t j = i;
+		while (j < count && edges[j] == edges[i]) {
+			j++;
+		}
+		if (j - i != 2) {
+			s.locked[edges[i] >> 32] = 1;
+			s.locked[edges[i] & 0xFFFFFFFF] = 1;
+		}
+		i = j;
+	}
+	free (edges);
+	return true;
+}
+
+static void add_triangle_planes (simplifier& s) {
+	memset (s.quadrics, 0, s.weld_count * sizeof (quadric));
+	for (int t = 0; t < s.tri_count; t++) {
+		const float* p0 = s.points + s.tris[t * 3] * 3;
+		const float* p1 = s.points + s.tris[t * 3 + 1] * 3;
+		const float* p2 = s.points + s.tris[t * 3 + 2] * 3;
+		double e1[3], e2[3], n[3];
+		for (int i = 0; i < 3; i++) {
+			e1[i] = (double)p1[i] - p0[i];
+			e2[i] = (double)p2[i] - p0[i];
+		}
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		double len = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (len <= 0.0) {
+			continue;
+		}
+		n[0] /= len;
+		n[1] /= len;
+		n[2] /= len;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		for (int k = 0; k < 3; k++) {
+			add_plane (s.quadrics[s.weld[s.tris[t * 3 + k]]], n[0], n[1], n[2], d);
+		}
+	}
+}
+
+static bool init_simplifier (simplifier& s, const obj_mesh& mesh,
+	bool keep_seams) {
+	memset (&s, 0, sizeof (s));
+	s.keep_seams = keep_seams;
+	s.points = mesh.points;
+	s.vertex_count = mesh.vertex_count;
+	s.tri_count = mesh.index_count / 3;
+	size_t v = (size_t)mesh.vertex_count;
+	size_t corners = (size_t)s.tri_count * 3;
+	s.weld = (int*)malloc (v * sizeof (int) + 1);
+	s.weld_vertex = (int*)malloc (v * sizeof (int) + 1);
+	s.locked = (unsigned char*)calloc (v + 1, 1);
+	s.quadrics = (quadric*)malloc (v * sizeof (quadric) + 1);
+	s.tris = (unsigned int*)malloc (corners * sizeof (unsigned int) + 1);
+	s.offsets = (int*)malloc ((v + 1) * sizeof (int));
+	s.adjacency = (int*)malloc (corners * sizeof (int) + 1);
+	s.collapses = (collapse*)malloc (v * sizeof (collapse) + 1);
+	s.touched = (unsigned char*)malloc (v + 1);
+	s.collapse_to = (int*)malloc (v * sizeof (int) + 1);
+	if (!s.weld || !s.weld_vertex || !s.locked || !s.quadrics || !s.tris ||
+		!s.offsets || !s.adjacency || !s.collapses || !s.touched ||
+		!s.collapse_to) {
+		return false;
+	}
+	for (size_t i = 0; i < corners; i++) {
+		s.tris[i] = obj_mesh_index (mesh.indices, mesh.index_size, i);
+	}
+	for (size_t i = 0; i < v; i++) {
+		s.collapse_to[i] = (int)i;
+	}
+	if (!weld_positions (s) || !lock_open_edges (s)) {
+		return false;
+	}
+	add_triangle_planes (s);
+	return true;
+}
+
+/*-----------------------------------ROUNDS-----------------------------------*/
+static void build_adjacency (simplifier& s) {
+	memset (s.offsets, 0, (s.weld_count + 1) * sizeof (int));
+	for (int i = 0; i < s.tri_count * 3; i++) {
+		s.offsets[s.weld[s.tris[i]] + 1]++;
+	}
+	for (int w = 0; w < s.weld_count; w++) {
+		s.offsets[w + 1] += s.offsets[w];
+	}
+	// offsets[w] is used as a cursor while filling, then put back
+	for (int i = 0; i < s.tri_count * 3; i++) {
+		s.adjacency[s.offsets[s.weld[s.tris[i]]]++] = i / 3;
+	}
+	for (int w = s.weld_count; w > 0; w--) {
+		s.offsets[w] = s.offsets[w - 1];
+	}
+	s.offsets[0] = 0;
+}
+
+static void triangle_normal (const float* a, const float* b, const float* c,
+	double* n) {
+	double e1[3], e2[3];
+	for (int i = 0; i < 3; i++) {
+		e1[i] = (double)b[i] - a[i];
+		e2[i] = (double)c[i] - a[i];
+	}
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// is w in one of the triangles of welded id u
+static bool in_ring (const simplifier& s, int u, int w) {
+	for (int a = s.offsets[u]; a < s.offsets[u + 1]; a++) {
+		const unsigned int* t = s.tris + s.adjacency[a] * 3;
+		if (s.weld[t[0]] == w || s.weld[t[1]] == w || s.weld[t[2]] == w) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* can u collapse onto v. only reads, so the whole round can be checked on the
+thread pool. u's vertices go to the vertex of v they share a triangle with, so
+each side of a seam stays on its own side. with keep_seams, a vertex of u with
+no triangle across the edge would drag its seam off the edge, so that isn't
+allowed */
+static bool can_collapse (const simplifier& s, int u, int v) {
+	const float* pv = s.points + s.weld_vertex[v] * 3;
+	int shared = 0;
+	for (int a = s.offsets[u]; a < s.offsets[u + 1]; a++) {
+		const unsigned int* t = s.tris + s.adjacency[a] * 3;
+		int k_u = -1, k_v = -1;
+		for (int k = 0; k < 3; k++) {
+			int w = s.weld[t[k]];
+			k_u = w == u ? k : k_u;
+			k_v = w == v ? k : k_v;
+		}
+		if (k_v >= 0) {
+			shared++;
+			continue;
+		}
+		if (s.keep_seams) {
+			// this triangle's vertex of u needs a triangle across the edge too
+			bool across = false;
+			for (int b = s.offsets[u]; !across && b < s.offsets[u + 1]; b++) {
+				const unsigned int* o = s.tris + s.adjacency[b] * 3;
+				bool has_x = o[0] == t[k_u] || o[1] == t[k_u] || o[2] == t[k_u];
+				bool has_v = s.weld[o[0]] == v || s.weld[o[1]] == v ||
+					s.weld[o[2]] == v;
+				across = has_x && has_v;
+			}
+			if (!across) {
+				return false;
+			}
+		}
+		// moving u to v mustn't flip or flatten this triangle
+		const float* p[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = s.points + t[k] * 3;
+		}
+		double before[3], after[3];
+		triangle_normal (p[0], p[1], p[2], before);
+		p[k_u] = pv;
+		triangle_normal (p[0], p[1], p[2], after);
+		double dot = before[0] * after[0] + before[1] * after[1] +
+			before[2] * after[2];
+		double len2 = after[0] * after[0] + after[1] * after[1] +
+			after[2] * after[2];
+		if (dot <= 0.0 || len2 <= 0.0) {
+			return false;
+		}
+	}
+	if (0 == shared) {
+		return false;
+	}
+	/* the link condition. u and v may only share the neighbours across the
+	edge. each neighbour of v is counted at its first triangle */
+	int common = 0;
+	for (int a = s.offsets[v]; a < s.offsets[v + 1]; a++) {
+		const unsigned int* t = s.tris + s.adjacency[a] * 3;
+		for (int k = 0; k < 3; k++) {
+			int w = s.weld[t[k]];
+			if (w == u || w == v || !in_ring (s, u, w)) {
+				continue;
+			}
+			bool first = true;
+			for (int b = s.offsets[v]; first && b < a; b++) {
+				const unsigned int* o = s.tris + s.adjacency[b] * 3;
+				first = s.weld[o[0]] != w && s.weld[o[1]] != w && s.weld[o[2]] != w;
+			}
+			common += first ? 1 : 0;
+		}
+	}
+	return common == shared;
+}
+
+/* the cheapest collapse for each welded id in [begin, end) that's allowed.
+the neighbours are tried cheapest first, since that one usually is.
+collapses[u].v is -1 if u can't move */
+static void score_collapses (void* ctx, size_t begin, size_t end) {
+	simplifier& s = *(simplifier*)ctx;
+	for (size_t u = begin; u < end; u++) {
+		collapse& c = s.collapses[u];
+		c.u = (int)u;
+		c.v = -1;
+		c.cost = -1.0;
+		while (!s.locked[u]) {
+			// the next cheapest after the one that was just turned down
+			collapse next = { (int)u, -1, HUGE_VAL };
+			for (int a = s.offsets[u]; a < s.offsets[u + 1]; a++) {
+				const unsigned int* t = s.tris + s.adjacency[a] * 3;
+				for (int k = 0; k < 3; k++) {
+					collapse e = { (int)u, s.weld[t[k]], 0.0 };
+					if (e.v == (int)u) {
+						continue;
+					}
+					e.cost = quadric_error (s.quadrics[u], s.quadrics[e.v],
+						s.points + s.weld_vertex[e.v] * 3);
+					if (cheaper (c, e) && (next.v < 0 || cheaper (e, next))) {
+						next = e;
+					}
+				}
+			}
+			c = next;
+			if (c.v < 0 || can_collapse (s, c.u, c.v)) {
+				break;
+			}
+		}
+	}
+}
+
+/* sends each of u's vertices to the vertex of v it shares a triangle with, or
+(without keep_seams) the first vertex of v if it has none */
+static void collapse_vertices (simplifier& s, int u, int v) {
+	int first = -1;
+	for (int a = s.offsets[u]; a < s.offsets[u + 1]; a++) {
+		const unsigned int* t = s.tris + s.adjacency[a] * 3;
+		int k_u = -1, k_v = -1;
+		for (int k = 0; k < 3; k++) {
+			int w = s.weld[t[k]];
+			k_u = w == u ? k : k_u;
+			k_v = w == v ? k : k_v;
+		}
+		if (k_v >= 0 && s.collapse_to[t[k_u]] == (int)t[k_u]) {
+			s.collapse_to[t[k_u]] = (int)t[k_v];
+			first = first < 0 ? (int)t[k_v] : first;
+		}
+	}
+	for (int a = s.offsets[u]; a < s.offsets[u + 1]; a++) {
+		const unsigned int* t = s.tris + s.adjacency[a] * 3;
+		for (int k = 0; k < 3; k++) {
+			if (s.weld[t[k]] == u && s.collapse_to[t[k]] == (int)t[k]) {
+				s.collapse_to[t[k]] = first;
+			}
+		}
+	}
+}
+
+/* one round of collapses, cheapest first, until target_tris is reached or the
+rest cost more than max_cost. returns how many it did */
+static int run_round (simplifier& s, int target_tris, double max_cost) {
+	build_adjacency (s);
+	parallel_for (s.weld_count, SIMPLIFY_GRAIN, score_collapses, &s);
+	int num_collapses = 0;
+	for (int u = 0; u < s.weld_count; u++) {
+		if (s.collapses[u].v >= 0 && s.collapses[u].cost <= max_cost) {
+			s.collapses[num_collapses++] = s.collapses[u];
+		}
+	}
+	std::sort (s.collapses, s.collapses + num_collapses, cheaper);
+
+	memset (s.touched, 0, (size_t)s.vertex_count);
+	int tri_count = s.tri_count;
+	int done = 0;
+	for (int i = 0; i < num_collapses && tri_count > target_tris; i++) {
+		const collapse& c = s.collapses[i];
+		if (s.touched[c.u] || s.touched[c.v]) {
+			continue;
+		}
+		// neither end moved this round, so the check in scoring still holds
+		collapse_vertices (s, c.u, c.v);
+		for (int a = s.offsets[c.u]; a < s.offsets[c.u + 1]; a++) {
+			const unsigned int* t = s.tris + s.adjacency[a] * 3;
+			bool has_v = false;
+			for (int k = 0; k < 3; k++) {
+				s.touched[s.weld[t[k]]] = 1;
+				has_v |= s.weld[t[k]] == c.v;
+			}
+			tri_count -= has_v ? 1 : 0;
+		}
+		for (int q = 0; q < 10; q++) {
+			s.quadrics[c.v].q[q] += s.quadrics[c.u].q[q];
+		}
+		s.max_cost = c.cost > s.max_cost ? c.cost : s.max_cost;
+		done++;
+	}
+
+	// point the triangles at the new vertices and drop the collapsed ones
+	int kept = 0;
+	for (int t = 0; t < s.tri_count; t++) {
+		unsigned int v[3];
+		for (int k = 0; k < 3; k++) {
+			v[k] = (unsigned int)s.collapse_to[s.tris[t * 3 + k]];
+		}
+		int w0 = s.weld[v[0]], w1 = s.weld[v[1]], w2 = s.weld[v[2]];
+		if (w0 == w1 || w1 == w2 || w2 == w0) {
+			continue;
+		}
+		memcpy (s.tris + kept * 3, v, sizeof (v));
+		kept++;
+	}
+	s.tri_count = kept;
+	return done;
+}
+
+/*------------------------------------LODS------------------------------------*/
+static void free_levels (unsigned int** levels, int count) {
+	for (int l = 0; l < count; l++) {
+		free (levels[l]);
+	}
+}
+
+bool build_mesh_lods (obj_mesh& mesh, const lod_target* targets, int count,
+	bool keep_seams) {
+	if (count > MAX_MESH_LODS) {
+		count = MAX_MESH_LODS;
+	}
+	timespec start, end;
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	simplifier s;
+	if (!init_simplifier (s, mesh, keep_seams)) {
+		fprintf (stderr, "ERROR: out of memory simplifying mesh\n");
+		free_simplifier (s);
+		return false;
+	}
+	// each level's triangles, until the new arena can be sized for them all
+	unsigned int* levels[MAX_MESH_LODS];
+	int level_index_counts[MAX_MESH_LODS];
+	float level_errors[MAX_MESH_LODS];
+	int base_tris = s.tri_count;
+	for (int l = 0; l < count; l++) {
+		int target_tris = (int)ceil ((double)targets[l].triangle_ratio * base_tris);
+		double max_cost = targets[l].max_error > 0.0f ?
+			(double)targets[l].max_error * targets[l].max_error : HUGE_VAL;
+		while (s.tri_count > target_tris && run_round (s, target_tris, max_cost) > 0) {
+		}
+		level_index_counts[l] = s.tri_count * 3;
+		level_errors[l] = (float)sqrt (s.max_cost);
+		size_t size = (size_t)level_index_counts[l] * sizeof (unsigned int);
+		levels[l] = (unsigned int*)malloc (size + 1);
+		if (!levels[l]) {
+			fprintf (stderr, "ERROR: out of memory simplifying mesh\n");
+			free_levels (levels, l);
+			free_simplifier (s);
+			return false;
+		}
+		memcpy (levels[l], s.tris, size);
+	}
+	free_simplifier (s);
+
+	// the same mesh with the new lods, in one new arena
+	obj_mesh out;
+	if (!alloc_obj_mesh (out, mesh.vertex_count, mesh.index_count,
+		mesh.index_size, level_index_counts, count)) {
+		free_levels (levels, count);
+		return false;
+	}
+	size_t v = (size_t)mesh.vertex_count;
+	memcpy (out.points, mesh.points, v * 3 * sizeof (float));
+	memcpy (out.tex_coords, mesh.tex_coords, v * 2 * sizeof (float));
+	memcpy (out.normals, mesh.normals, v * 3 * sizeof (float));
+	memcpy (out.indices, mesh.indices, (size_t)mesh.index_count * mesh.index_size);
+	out.bounds = mesh.bounds;
+	for (int l = 0; l < count; l++) {
+		obj_lod& lod = out.lods[l];
+		for (int i = 0; i < lod.index_count; i++) {
+			set_obj_mesh_index (lod.indices, out.index_size, i, levels[l][i]);
+		}
+		lod.error = level_errors[l];
+	}
+	free_levels (levels, count);
+	free_obj_mesh (mesh);
+	mesh = out;
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 +
+		(end.tv_nsec - start.tv_nsec) * 1e-6;
+	printf ("built %i lods in %.1f ms. triangles %i", mesh.lod_count, ms,
+		base_tris);
+	for (int l = 0; l < mesh.lod_count; l++) {
+		printf (" -> %i", mesh.lods[l].index_count / 3);
+	}
+	printf ("\n");
+	return true;
+}
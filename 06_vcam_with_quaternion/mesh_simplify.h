@@ -0,0 +1,49 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Levels of detail for an indexed mesh, by quadric error edge collapse         |
+| (Garland & Heckbert 1997).                                                   |
+| Every collapse moves one vertex onto a neighbour and deletes the triangles   |
+| between them, so a lod never needs new vertices - it's only a smaller index  |
+| buffer into the same vertex buffers as the full mesh.                        |
+| Seams are kept: where the uvs or the normals are split, a vertex may only    |
+| slide along the seam, so the texture and the shading line up on every level. |
+| Nothing on an open edge (a hole, or an edge with three or more triangles)    |
+| moves at all, so the outline stays where it was.                             |
+| Collapses are done in rounds. Each round finds every vertex's cheapest       |
+| collapse on the thread pool, then takes the cheapest ones that don't touch   |
+| each other.                                                                  |
+| save_mesh_cache() stores the lods in the mesh cache with the full mesh.      |
+\******************************************************************************/
+#ifndef _MESH_SIMPLIFY_H_
+#define _MESH_SIMPLIFY_H_
+
+#include "obj_parser.h"
+
+// vertices per thread pool chunk when scoring collapses
+#define SIMPLIFY_GRAIN 4096
+
+/* one level of detail. simplifying stops at whichever comes first: the level
+is down to triangle_ratio of the full mesh's triangles, or the next collapse
+would move the surface by more than max_error (in mesh units, 0 for no limit) */
+struct lod_target {
+	float triangle_ratio;
+	float max_error;
+};
+
+/* replaces mesh's lods with count new ones (at most MAX_MESH_LODS). targets
+go from fine to coarse, and each level carries on from the one before. a
+level that can't get any simpler is the same as the one before it.
+keep_seams false is for meshes drawn with positions only: the uvs and normals
+are ignored and seams may be collapsed across, so it simplifies further.
+the mesh and its new lods are moved into a new arena, so this works on a mesh
+mapped from the mesh cache too. false if out of memory */
+bool build_mesh_lods (obj_mesh& mesh, const lod_target* targets, int count,
+	bool keep_seams);
+
+#endif
@@ -0,0 +1,1488 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Benchmark for the obj loader. No GL needed. build with "make obj_bench" and  |
+| run ./obj_bench [file.obj]. Without a file it writes a big synthetic sphere  |
+| in the same format Blender exports (obj_bench_synthetic.obj, kept for next   |
+| time). The file is loaded with the old fgets/sscanf loader and the mmap one, |
+| their outputs must match exactly, and we print the MB/s of each. The number  |
+| parsers are checked against strtof on every 6-decimal value in [-2, 2] and   |
+| on long random mantissas, and timed against strtof and sscanf. Exits with 1  |
+| if anything doesn't match. The indexed loader is timed too, and its mesh,    |
+| expanded back through the index buffer, must match the un-indexed one. Then  |
+| load_obj_file is run on 1 to 32 threads, and must give the same mesh and     |
+| bounds on all. The bounds must hold every point, the sphere only just.       |
+| The mesh cache is off for all of that. It is then written, mapped back and   |
+| compared, and the cache file is deleted again. stream_obj_file runs first,   |
+| under a small and the default memory budget, with the peak RSS printed, and  |
+| its batches must add up to the same mesh. Last, the indexed mesh is put      |
+| through mesh_optimise.h, as exported and with its triangles shuffled, and    |
+| must still draw the same triangles. Meshlets are built from it and must      |
+| hold the same triangles within the limits; every meshlet a normal cone culls |
+| must really face away, and cull_meshlets must agree with sphere_in_frustum.  |
+| Last, the mesh is loaded several times on asset_loader.h's threads while the |
+| main thread pumps uploads like a frame loop, and must match a plain load.    |
+| Four copies of it then go through asset_registry.h with small budgets.       |
+| Each stream goes through mesh_codec.h, as exported and optimised, and must   |
+| come back bit for bit; cut short it must fail.                               |
+\******************************************************************************/
+#include "obj_parser.h"
+#include "thread_pool.h"
+#include "mesh_optimise.h"
+#include "mesh_simplify.h"
+#include "mesh_pack.h"
+#include "mesh_cluster.h"
+#include "asset_loader.h"
+#include "asset_registry.h"
+#include "mesh_codec.h"
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <algorithm>
+
+#define SYNTHETIC_FILE "obj_bench_synthetic.obj"
+// rings and segments of the synthetic sphere. about 90 MB of text
+#define SYNTHETIC_RINGS 800
+#define SYNTHETIC_SEGMENTS 800
+// numbers in the parse timing
+#define NUM_PARSE_NUMBERS 2000000
+
+static double now_seconds () {
+	timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static size_t file_size (const char* file_name) {
+	struct stat st;
+	if (stat (file_name, &st) != 0) {
+		return 0;
+	}
+	return (size_t)st.st_size;
+}
+
+// a uv sphere, with every number printed "%f" like Blender does
+static bool write_synthetic (const char* file_name) {
+	FILE* fp = fopen (file_name, "w");
+	if (!fp) {
+		fprintf (stderr, "ERROR: could not write %s\n", file_name);
+		return false;
+	}
+	const int rings = SYNTHETIC_RINGS;
+	const int segs = SYNTHETIC_SEGMENTS;
+	fprintf (fp, "# obj_bench synthetic sphere\ng Sphere\n");
+	for (int r = 0; r <= rings; r++) {
+		double theta = M_PI * r / rings;
+		for (int s = 0; s <= segs; s++) {
+			double phi = 2.0 * M_PI * s / segs;
+			fprintf (fp, "v %f %f %f\n", sin (theta) * cos (phi), cos (theta),
+				sin (theta) * sin (phi));
+		}
+	}
+	for (int r = 0; r <= rings; r++) {
+		for (int s = 0; s <= segs; s++) {
+			fprintf (fp, "vt %f %f\n", (double)s / segs, (double)r / rings);
+		}
+	}
+	for (int r = 0; r <= rings; r++) {
+		double theta = M_PI * r / rings;
+		for (int s = 0; s <= segs; s++) {
+			double phi = 2.0 * M_PI * s / segs;
+			fprintf (fp, "vn %f %f %f\n", sin (theta) * cos (phi), cos (theta),
+				sin (theta) * sin (phi));
+		}
+	}
+	fprintf (fp, "s off\n");
+	for (int r = 0; r < rings; r++) {
+		for (int s = 0; s < segs; s++) {
+			int a = r * (segs + 1) + s + 1;
+			int b = a + segs + 1;
+			fprintf (fp, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", a, a, a, b, b, b,
+				a + 1, a + 1, a + 1);
+			fprintf (fp, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", a + 1, a + 1, a + 1,
+				b, b, b, b + 1, b + 1, b + 1);
+		}
+	}
+	fclose (fp);
+	return true;
+}
+
+/*-------------------------------NUMBER PARSING-------------------------------*/
+static bool same_float (float a, float b) {
+	return 0 == memcmp (&a, &b, sizeof (float));
+}
+
+// parse_obj_float must give strtof's bits, and stop where strtof does
+static bool check_float (const char* text, int* failures) {
+	size_t len = strlen (text);
+	char* end = NULL;
+	float expected = strtof (text, &end);
+	float got = 0.0f;
+	const char* got_end = parse_obj_float (text, text + len, &got);
+	if (got_end != end || !same_float (got, expected)) {
+		if (*failures < 10) {
+			fprintf (stderr, "ERROR: parse_obj_float (\"%s\") = %.9g, strtof %.9g\n",
+				text, got, expected);
+		}
+		(*failures)++;
+		return false;
+	}
+	return true;
+}
+
+static bool check_numbers () {
+	int failures = 0;
+	char text[64];
+	// every value Blender can write in [-2, 2]
+	for (int i = -2000000; i <= 2000000; i++) {
+		snprintf (text, sizeof (text), "%f", i * 1e-6);
+		check_float (text, &failures);
+	}
+	// long mantissas and exponents, which take the slow path
+	srand (1234);
+	for (int i = 0; i < 1000000; i++) {
+		double d = ((double)rand () / RAND_MAX - 0.5) * pow (10.0, rand () % 60 - 30);
+		const char* formats[4] = { "%.9g", "%.17g", "%e", "%.12f" };
+		snprintf (text, sizeof (text), formats[i & 3], d);
+		check_float (text, &failures);
+	}
+	const char* odd[] = { "0", "-0", "+1.5", "1.", ".25", "1e", "1e+", "3.4e38",
+		"3.5e38", "1e-46", "-1e-50", "inf", "-nan", "123456789012345678901234",
+		"0.000000000000000000000000000001", "16777217", "0.1e-5", "  \t 7" };
+	for (size_t i = 0; i < sizeof (odd) / sizeof (odd[0]); i++) {
+		check_float (odd[i], &failures);
+	}
+	int v = 0;
+	const char* ints = "  -1234/99";
+	const char* e = parse_obj_int (ints, ints + strlen (ints), &v);
+	if (v != -1234 || e != ints + 7) {
+		fprintf (stderr, "ERROR: parse_obj_int got %i\n", v);
+		failures++;
+	}
+	if (failures > 0) {
+		fprintf (stderr, "ERROR: %i numbers didn't match strtof\n", failures);
+		return false;
+	}
+	return true;
+}
+
+/* parse a buffer of "%f" numbers three ways, and print numbers per second.
+each number has its own terminator, or sscanf would strlen the whole buffer
+every call */
+static void time_numbers () {
+	const int n = NUM_PARSE_NUMBERS;
+	char* buffer = (char*)malloc (n * 16);
+	char** starts = (char**)malloc ((n + 1) * sizeof (char*));
+	char* p = buffer;
+	srand (4321);
+	for (int i = 0; i < n; i++) {
+		starts[i] = p;
+		p += sprintf (p, "%f", ((double)rand () / RAND_MAX - 0.5) * 4.0) + 1;
+	}
+	starts[n] = p;
+	float sum[3] = { 0.0f, 0.0f, 0.0f };
+	double seconds[3];
+	double start = now_seconds ();
+	for (int i = 0; i < n; i++) {
+		float f = 0.0f;
+		sscanf (starts[i], "%f", &f);
+		sum[0] += f;
+	}
+	seconds[0] = now_seconds () - start;
+	start = now_seconds ();
+	for (int i = 0; i < n; i++) {
+		sum[1] += strtof (starts[i], NULL);
+	}
+	seconds[1] = now_seconds () - start;
+	start = now_seconds ();
+	for (int i = 0; i < n; i++) {
+		float f = 0.0f;
+		parse_obj_float (starts[i], starts[i + 1] - 1, &f);
+		sum[2] += f;
+	}
+	seconds[2] = now_seconds () - start;
+	const char* names[3] = { "sscanf", "strtof", "parse_obj_float" };
+	printf ("\n%-20s %10s %12s %8s\n", "parser", "ms", "Mnumbers/s", "speedup");
+	for (int i = 0; i < 3; i++) {
+		printf ("%-20s %10.1f %12.1f %7.1fx%s\n", names[i], seconds[i] * 1e3,
+			n / seconds[i] * 1e-6, seconds[0] / seconds[i],
+			same_float (sum[i], sum[1]) ? "" : " (different sum)");
+	}
+	free (buffer);
+	free (starts);
+}
+
+// FNV-1a over the vertices, so batches can be checked without keeping them
+struct stream_hash {
+	uint64_t h[3];
+	uint64_t count;
+};
+
+static void add_to_hash (uint64_t& h, const void* data, size_t size) {
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		h = (h ^ p[i]) * 0x100000001B3ull;
+	}
+}
+
+static void start_hash (stream_hash& sh) {
+	sh.h[0] = sh.h[1] = sh.h[2] = 0xCBF29CE484222325ull;
+	sh.count = 0;
+}
+
+static void hash_vertices (stream_hash& sh, const float* vp, const float* vt,
+	const float* vn, size_t count) {
+	add_to_hash (sh.h[0], vp, count * 3 * sizeof (float));
+	add_to_hash (sh.h[1], vt, count * 2 * sizeof (float));
+	add_to_hash (sh.h[2], vn, count * 3 * sizeof (float));
+	sh.count += count;
+}
+
+static bool hash_batch (void* ctx, const obj_vertex_batch& batch) {
+	stream_hash* sh = (stream_hash*)ctx;
+	if (batch.first != sh->count) {
+		return false;
+	}
+	hash_vertices (*sh, batch.points, batch.tex_coords, batch.normals,
+		batch.count);
+	return true;
+}
+
+static long peak_rss_kb () {
+	rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+#define NUM_STREAM_BUDGETS 2
+
+/* streams file_name under each budget, hashing the batches. run before anything
+else is loaded, so the peak RSS is the streaming's */
+static bool run_stream (const char* file_name, double mb,
+	stream_hash* hashes) {
+	const size_t budgets[NUM_STREAM_BUDGETS] = { 16 << 20, OBJ_STREAM_BUDGET };
+	double seconds[NUM_STREAM_BUDGETS];
+	obj_stream_info info[NUM_STREAM_BUDGETS];
+	long rss[NUM_STREAM_BUDGETS];
+	bool ok = true;
+	for (int i = 0; i < NUM_STREAM_BUDGETS; i++) {
+		start_hash (hashes[i]);
+		double start = now_seconds ();
+		ok &= stream_obj_file (file_name, OBJ_STREAM_BATCH, budgets[i], hash_batch,
+			&hashes[i], &info[i]);
+		seconds[i] = now_seconds () - start;
+		rss[i] = peak_rss_kb ();
+	}
+	printf ("\n%-20s %10s %10s %10s %10s %12s\n", "stream_obj_file", "ms",
+		"MB/s", "peak MiB", "RSS MiB", "window loads");
+	for (int i = 0; i < NUM_STREAM_BUDGETS; i++) {
+		char label[32];
+		snprintf (label, sizeof (label), "%zu MiB budget", budgets[i] >> 20);
+		printf ("%-20s %10.1f %10.1f %10.1f %10.1f %12llu\n", label,
+			seconds[i] * 1e3, mb / seconds[i],
+			(double)info[i].peak_bytes / (1 << 20), (double)rss[i] / 1024.0,
+			(unsigned long long)info[i].window_loads);
+	}
+	return ok;
+}
+
+/* the box must hold every point, and the sphere must too, with the radius no
+bigger than the rounding allows */
+static bool check_bounds (const obj_bounds& b, const float* vp, int count) {
+	bool ok = true;
+	double most = 0.0;
+	for (int i = 0; i < count; i++) {
+		double d = 0.0;
+		for (int k = 0; k < 3; k++) {
+			float x = vp[i * 3 + k];
+			ok &= x >= b.min[k] && x <= b.max[k];
+			d += ((double)x - b.centre[k]) * ((double)x - b.centre[k]);
+		}
+		if (d > most) {
+			most = d;
+		}
+	}
+	for (int k = 0; k < 3; k++) {
+		ok &= b.centre[k] == (b.min[k] + b.max[k]) * 0.5f;
+	}
+	most = sqrt (most);
+	ok &= b.radius >= most && b.radius <= most * (1.0 + 1e-6) + 1e-30;
+	printf ("\nbounds: (%g %g %g) to (%g %g %g), radius %g %s\n", b.min[0],
+		b.min[1], b.min[2], b.max[0], b.max[1], b.max[2], b.radius,
+		ok ? "ok" : "WRONG");
+	if (!ok) {
+		fprintf (stderr, "ERROR: the loaded bounds don't fit the points\n");
+	}
+	return ok;
+}
+
+/* loads file_name with load_obj_file on 1, 2, 4 ... 32 threads. each must give
+exactly vp/vt/vn and bounds */
+static bool check_scaling (const char* file_name, double mb, const float* vp,
+	const float* vt, const float* vn, int count, const obj_bounds& bounds) {
+	int default_workers = get_worker_count ();
+	double seconds[6];
+	bool same[6];
+	bool all_same = true;
+	for (int i = 0; i < 6; i++) {
+		set_worker_count (1 << i);
+		float* p = NULL;
+		float* t = NULL;
+		float* n = NULL;
+		int c = 0;
+		obj_bounds b;
+		double start = now_seconds ();
+		bool ok = load_obj_file (file_name, p, t, n, c, &b);
+		seconds[i] = now_seconds () - start;
+		same[i] = ok && c == count &&
+			0 == memcmp (&b, &bounds, sizeof (b)) &&
+			0 == memcmp (p, vp, count * 3 * sizeof (float)) &&
+			0 == memcmp (t, vt, count * 2 * sizeof (float)) &&
+			0 == memcmp (n, vn, count * 3 * sizeof (float));
+		all_same &= same[i];
+		free (p);
+		free (t);
+		free (n);
+	}
+	set_worker_count (default_workers);
+	printf ("\n%-20s %10s %10s %8s\n", "load_obj_file", "ms", "MB/s", "speedup");
+	for (int i = 0; i < 6; i++) {
+		char label[32];
+		snprintf (label, sizeof (label), "%i thread%s", 1 << i, i ? "s" : "");
+		printf ("%-20s %10.1f %10.1f %7.1fx %s\n", label, seconds[i] * 1e3,
+			mb / seconds[i], seconds[0] / seconds[i], same[i] ? "same" : "DIFFERENT");
+	}
+	if (!all_same) {
+		fprintf (stderr, "ERROR: load_obj_file depends on the thread count\n");
+	}
+	return all_same;
+}
+
+/* every array of a loaded mesh is on an OBJ_MESH_ALIGN boundary inside its one
+block, the arena or the mapping, in order and without overlapping */
+static bool in_one_block (const obj_mesh& mesh) {
+	const char* base = (const char*)(mesh.mapping ? mesh.mapping : mesh.arena);
+	if (!base || (mesh.arena && mesh.mapping)) {
+		return false;
+	}
+	const void* arrays[4 + MAX_MESH_LODS] = {
+		mesh.points, mesh.tex_coords, mesh.normals, mesh.indices
+	};
+	size_t sizes[4 + MAX_MESH_LODS] = {
+		(size_t)mesh.vertex_count * 3 * sizeof (float),
+		(size_t)mesh.vertex_count * 2 * sizeof (float),
+		(size_t)mesh.vertex_count * 3 * sizeof (float),
+		(size_t)mesh.index_count * mesh.index_size
+	};
+	for (int i = 0; i < mesh.lod_count; i++) {
+		arrays[4 + i] = mesh.lods[i].indices;
+		sizes[4 + i] = (size_t)mesh.lods[i].index_count * mesh.index_size;
+	}
+	const char* end = base;
+	bool ok = 0 == (size_t)base % OBJ_MESH_ALIGN;
+	for (int i = 0; ok && i < 4 + mesh.lod_count; i++) {
+		const char* a = (const char*)arrays[i];
+		ok = a >= end && 0 == (size_t)(a - base) % OBJ_MESH_ALIGN;
+		end = a + sizes[i];
+	}
+	return ok && (!mesh.mapping || end <= base + mesh.mapping_size);
+}
+
+/* loads file_name indexed and expands it back through its indices, which must
+give exactly the un-indexed mesh */
+static bool check_indexed (const char* file_name, double mb, const float* vp,
+	const float* vt, const float* vn, int count) {
+	obj_mesh mesh;
+	double start = now_seconds ();
+	if (!load_obj_file_indexed (file_name, mesh)) {
+		fprintf (stderr, "ERROR: could not load %s indexed\n", file_name);
+		return false;
+	}
+	double seconds = now_seconds () - start;
+	bool same = mesh.index_count == count;
+	for (int i = 0; same && i < count; i++) {
+		int v = (int)obj_mesh_index (mesh.indices, mesh.index_size, i);
+		same = v < mesh.vertex_count &&
+			0 == memcmp (mesh.points + v * 3, vp + i * 3, 3 * sizeof (float)) &&
+			0 == memcmp (mesh.tex_coords + v * 2, vt + i * 2, 2 * sizeof (float)) &&
+			0 == memcmp (mesh.normals + v * 3, vn + i * 3, 3 * sizeof (float));
+	}
+	same &= in_one_block (mesh);
+	size_t flat_bytes = (size_t)count * 8 * sizeof (float);
+	size_t indexed_bytes = (size_t)mesh.vertex_count * 8 * sizeof (float) +
+		(size_t)mesh.index_count * mesh.index_size;
+	printf ("%-20s %10.1f %10.1f %8s %s\n", "load_obj_file_indexed",
+		seconds * 1e3, mb / seconds, "", same ? "same" : "DIFFERENT");
+	printf ("%i vertices for %i points, %i-bit indices. %.1f MB -> %.1f MB\n",
+		mesh.vertex_count, count, mesh.index_size * 8, (double)flat_bytes / 1e6,
+		(double)indexed_bytes / 1e6);
+	free_obj_mesh (mesh);
+	if (!same) {
+		fprintf (stderr, "ERROR: the indexed mesh doesn't expand to the same mesh\n");
+	}
+	return same;
+}
+
+static bool same_mesh (const obj_mesh& a, const obj_mesh& b) {
+	return a.vertex_count == b.vertex_count && a.index_count == b.index_count &&
+		a.index_size == b.index_size &&
+		0 == memcmp (a.points, b.points, a.vertex_count * 3 * sizeof (float)) &&
+		0 == memcmp (a.tex_coords, b.tex_coords,
+			a.vertex_count * 2 * sizeof (float)) &&
+		0 == memcmp (a.normals, b.normals, a.vertex_count * 3 * sizeof (float)) &&
+		0 == memcmp (a.indices, b.indices, (size_t)a.index_count * a.index_size) &&
+		0 == memcmp (&a.bounds, &b.bounds, sizeof (a.bounds));
+}
+
+/* writes the mesh cache, then maps it with both loaders and compares against
+loads from text. touching the obj must keep the cache (same hash) */
+static bool check_cache (const char* file_name, const float* vp,
+	const float* vt, const float* vn, int count, const obj_bounds& bounds) {
+	char cache_name[4096];
+	snprintf (cache_name, sizeof (cache_name), "%s%s", file_name, OBJ_CACHE_EXT);
+	unlink (cache_name);
+	obj_mesh text_mesh, cold, warm, touched;
+	if (!load_obj_file_indexed (file_name, text_mesh)) {
+		return false;
+	}
+	set_obj_cache (true);
+	double start = now_seconds ();
+	bool ok = load_obj_file_indexed (file_name, cold);
+	double cold_seconds = now_seconds () - start;
+	start = now_seconds ();
+	ok &= load_obj_file_indexed (file_name, warm);
+	double warm_seconds = now_seconds () - start;
+	float* p = NULL;
+	float* t = NULL;
+	float* n = NULL;
+	int c = 0;
+	obj_bounds b;
+	start = now_seconds ();
+	ok &= load_obj_file (file_name, p, t, n, c, &b);
+	double flat_seconds = now_seconds () - start;
+	ok &= utimensat (AT_FDCWD, file_name, NULL, 0) == 0;
+	ok &= load_obj_file_indexed (file_name, touched);
+	set_obj_cache (false);
+
+	bool same = ok && same_mesh (text_mesh, cold) && same_mesh (text_mesh, warm) &&
+		in_one_block (warm) && in_one_block (cold) &&
+		same_mesh (text_mesh, touched) && NULL != warm.mapping &&
+		NULL != touched.mapping && c == count &&
+		0 == memcmp (&b, &bounds, sizeof (b)) &&
+		0 == memcmp (&text_mesh.bounds, &bounds, sizeof (bounds)) &&
+		0 == memcmp (p, vp, count * 3 * sizeof (float)) &&
+		0 == memcmp (t, vt, count * 2 * sizeof (float)) &&
+		0 == memcmp (n, vn, count * 3 * sizeof (float));
+	printf ("\n%-30s %10s %s\n", "mesh cache", "ms", "");
+	printf ("%-30s %10.1f\n", "indexed, from text + write", cold_seconds * 1e3);
+	printf ("%-30s %10.1f %s\n", "indexed, mapped", warm_seconds * 1e3,
+		same ? "same" : "DIFFERENT");
+	printf ("%-30s %10.1f %s\n", "load_obj_file, from cache", flat_seconds * 1e3,
+		same ? "same" : "DIFFERENT");
+	free (p);
+	free (t);
+	free (n);
+	free_obj_mesh (text_mesh);
+	free_obj_mesh (cold);
+	free_obj_mesh (warm);
+	free_obj_mesh (touched);
+	unlink (cache_name);
+	if (!same) {
+		fprintf (stderr, "ERROR: the mesh cache doesn't give the same mesh\n");
+	}
+	return same;
+}
+
+/* adds up a hash of each triangle's three vertices, so the sum doesn't depend
+on the order of the triangles or of the vertices in the buffers */
+static uint64_t triangle_sum (const obj_mesh& mesh) {
+	uint64_t sum = 0;
+	for (int t = 0; t < mesh.index_count / 3; t++) {
+		uint64_t h = 0xCBF29CE484222325ull;
+		for (int k = 0; k < 3; k++) {
+			int i = t * 3 + k;
+			unsigned int v = obj_mesh_index (mesh.indices, mesh.index_size, i);
+			add_to_hash (h, mesh.points + v * 3, 3 * sizeof (float));
+			add_to_hash (h, mesh.tex_coords + v * 2, 2 * sizeof (float));
+			add_to_hash (h, mesh.normals + v * 3, 3 * sizeof (float));
+		}
+		sum += h;
+	}
+	return sum;
+}
+
+static void shuffle_triangles (obj_mesh& mesh) {
+	srand (1);
+	int size = mesh.index_size;
+	char* indices = (char*)mesh.indices;
+	for (int t = mesh.index_count / 3 - 1; t > 0; t--) {
+		int u = (int)(((uint64_t)rand () * RAND_MAX + rand ()) % (t + 1));
+		char tmp[12];
+		memcpy (tmp, indices + t * 3 * size, 3 * size);
+		memcpy (indices + t * 3 * size, indices + u * 3 * size, 3 * size);
+		memcpy (indices + u * 3 * size, tmp, 3 * size);
+	}
+}
+
+static bool check_optimise (const char* file_name) {
+	printf ("\n%-20s %10s %8s %8s %8s %8s\n", "optimise_mesh", "ms",
+		"ACMR", "", "ATVR", "");
+	bool ok = true;
+	for (int shuffled = 0; shuffled < 2; shuffled++) {
+		obj_mesh mesh;
+		if (!load_obj_file_indexed (file_name, mesh)) {
+			return false;
+		}
+		if (shuffled) {
+			shuffle_triangles (mesh);
+		}
+		uint64_t sum = triangle_sum (mesh);
+		vertex_cache_stats before = analyse_vertex_cache (mesh, VERTEX_CACHE_SIZE);
+		double start = now_seconds ();
+		bool same = optimise_vertex_cache (mesh, VERTEX_CACHE_SIZE) &&
+			optimise_vertex_fetch (mesh);
+		double seconds = now_seconds () - start;
+		vertex_cache_stats after = analyse_vertex_cache (mesh, VERTEX_CACHE_SIZE);
+		same &= sum == triangle_sum (mesh);
+		printf ("%-20s %10.1f %8.3f %8.3f %8.3f %8.3f %s\n",
+			shuffled ? "shuffled" : "as exported", seconds * 1e3, before.acmr,
+			after.acmr, before.atvr, after.atvr, same ? "same" : "DIFFERENT");
+		free_obj_mesh (mesh);
+		ok &= same;
+	}
+	if (!ok) {
+		fprintf (stderr, "ERROR: optimising changed the mesh\n");
+	}
+	return ok;
+}
+
+struct position_less {
+	const float* points;
+	bool operator() (int a, int b) const {
+		return memcmp (points + a * 3, points + b * 3, 3 * sizeof (float)) < 0;
+	}
+};
+
+/* each lod has fewer triangles than the one before, only uses vertices that are
+in range, has no collapsed triangles, and still has every position on an open
+edge */
+static bool check_lods (const obj_mesh& mesh) {
+	// weld the positions, so uv seams don't look like open edges
+	int n = mesh.vertex_count;
+	int* order = (int*)malloc ((n + 1) * sizeof (int));
+	int* weld = (int*)malloc ((n + 1) * sizeof (int));
+	unsigned long long* edges = (unsigned long long*)malloc (
+		(size_t)mesh.index_count * sizeof (unsigned long long) + 1);
+	unsigned char* open = (unsigned char*)calloc (n + 1, 1);
+	unsigned char* seen = (unsigned char*)calloc (n + 1, 1);
+	bool ok = order && weld && edges && open && seen && mesh.lod_count > 0;
+	for (int v = 0; ok && v < n; v++) {
+		order[v] = v;
+	}
+	position_less less = { mesh.points };
+	if (ok) {
+		std::sort (order, order + n, less);
+	}
+	for (int i = 0; ok && i < n; i++) {
+		bool same = i > 0 && 0 == memcmp (mesh.points + order[i - 1] * 3,
+			mesh.points + order[i] * 3, 3 * sizeof (float));
+		weld[order[i]] = same ? weld[order[i - 1]] : order[i];
+	}
+	for (int i = 0; ok && i < mesh.index_count; i++) {
+		unsigned long long a =
+			weld[obj_mesh_index (mesh.indices, mesh.index_size, i)];
+		int next = i % 3 == 2 ? i - 2 : i + 1;
+		unsigned long long b =
+			weld[obj_mesh_index (mesh.indices, mesh.index_size, next)];
+		edges[i] = a < b ? (a << 32) | b : (b << 32) | a;
+	}
+	if (ok) {
+		std::sort (edges, edges + mesh.index_count);
+	}
+	for (int i = 0; ok && i < mesh.index_count;) {
+		int j = i;
+		while (j < mesh.index_count && edges[j] == edges[i]) {
+			j++;
+		}
+		if (j - i != 2) {
+			open[edges[i] >> 32] = open[edges[i] & 0xFFFFFFFF] = 1;
+		}
+		i = j;
+	}
+	int last_count = mesh.index_count;
+	for (int l = 0; ok && l < mesh.lod_count; l++) {
+		const obj_lod& lod = mesh.lods[l];
+		ok &= lod.index_count % 3 == 0 && lod.index_count <= last_count;
+		last_count = lod.index_count;
+		memset (seen, 0, n);
+		for (int i = 0; ok && i < lod.index_count; i += 3) {
+			unsigned int v[3];
+			for (int k = 0; k < 3; k++) {
+				v[k] = obj_mesh_index (lod.indices, mesh.index_size, i + k);
+				ok &= v[k] < (unsigned int)n;
+			}
+			ok = ok && weld[v[0]] != weld[v[1]] && weld[v[1]] != weld[v[2]] &&
+				weld[v[2]] != weld[v[0]];
+			for (int k = 0; ok && k < 3; k++) {
+				seen[weld[v[k]]] = 1;
+			}
+		}
+		for (int v = 0; ok && v < n; v++) {
+			ok &= !open[v] || seen[v];
+		}
+	}
+	free (order);
+	free (weld);
+	free (edges);
+	free (open);
+	free (seen);
+	return ok;
+}
+
+static bool same_lods (const obj_mesh& a, const obj_mesh& b) {
+	bool same = a.lod_count == b.lod_count;
+	for (int l = 0; same && l < a.lod_count; l++) {
+		same = a.lods[l].index_count == b.lods[l].index_count &&
+			a.lods[l].error == b.lods[l].error &&
+			0 == memcmp (a.lods[l].indices, b.lods[l].indices,
+				(size_t)a.lods[l].index_count * a.index_size);
+	}
+	return same;
+}
+
+/* builds a lod chain each way, checks it, then saves the last to the mesh
+cache and checks the next load maps the same chain */
+static bool check_simplify (const char* file_name) {
+	const lod_target targets[] = {
+		{ 0.5f, 0.0f }, { 0.25f, 0.0f }, { 0.1f, 0.0f }
+	};
+	const int num_targets = sizeof (targets) / sizeof (targets[0]);
+	char cache_name[4096];
+	snprintf (cache_name, sizeof (cache_name), "%s%s", file_name, OBJ_CACHE_EXT);
+	printf ("\n%-20s %10s %10s %10s\n", "build_mesh_lods", "ms", "triangles",
+		"error");
+	bool valid = true;
+	bool cached = false;
+	for (int keep_seams = 1; keep_seams >= 0; keep_seams--) {
+		obj_mesh mesh, mapped;
+		if (!load_obj_file_indexed (file_name, mesh)) {
+			return false;
+		}
+		double start = now_seconds ();
+		bool ok = build_mesh_lods (mesh, targets, num_targets, keep_seams);
+		double seconds = now_seconds () - start;
+		ok = ok && optimise_mesh (mesh);
+		bool lods_ok = ok && check_lods (mesh) && in_one_block (mesh);
+		printf ("%-20s %10.1f %10i %10s %s\n",
+			keep_seams ? "keeping seams" : "positions only", seconds * 1e3,
+			mesh.index_count / 3, "", lods_ok ? "valid" : "INVALID");
+		for (int l = 0; ok && l < mesh.lod_count; l++) {
+			printf ("%-20.2f %10s %10i %10.5f\n", targets[l].triangle_ratio, "",
+				mesh.lods[l].index_count / 3, mesh.lods[l].error);
+		}
+		valid &= lods_ok;
+		if (keep_seams) {
+			free_obj_mesh (mesh);
+			continue;
+		}
+		set_obj_cache (true);
+		ok = ok && save_mesh_cache (file_name, mesh) &&
+			load_obj_file_indexed (file_name, mapped);
+		set_obj_cache (false);
+		cached = ok && NULL != mapped.mapping && same_mesh (mesh, mapped) &&
+			same_lods (mesh, mapped);
+		printf ("%-20s %10s %10s %10s %s\n", "mesh cache", "", "", "",
+			cached ? "same" : "DIFFERENT");
+		if (ok) {
+			free_obj_mesh (mapped);
+		}
+		free_obj_mesh (mesh);
+		unlink (cache_name);
+	}
+	if (!valid || !cached) {
+		fprintf (stderr, "ERROR: the lod chain is wrong\n");
+	}
+	return valid && cached;
+}
+
+/* packs the mesh in each format and checks the decoded vertices are within
+what the format can hold: half a step of the 16-bit grid across the box,
+half an ulp of the biggest uv, and a fixed angle for each normal size */
+static bool check_pack (const char* file_name) {
+	struct pack_case {
+		const char* name;
+		vertex_format format;
+		float max_degrees;
+	};
+	const pack_case cases[] = {
+		{ "float", { PACK_POSITION_FLOAT, PACK_NORMAL_FLOAT, PACK_UV_FLOAT }, 0.01f },
+		{ "16/oct16/half",
+			{ PACK_POSITION_UNORM16, PACK_NORMAL_OCT16, PACK_UV_HALF }, 0.01f },
+		{ "16/oct8/half",
+			{ PACK_POSITION_UNORM16, PACK_NORMAL_OCT8, PACK_UV_HALF }, 1.0f }
+	};
+	obj_mesh mesh;
+	if (!load_obj_file_indexed (file_name, mesh)) {
+		return false;
+	}
+	double extent = 0.0;
+	for (int i = 0; i < 3; i++) {
+		double d = (double)mesh.bounds.max[i] - mesh.bounds.min[i];
+		extent += d * d;
+	}
+	extent = sqrt (extent);
+	float max_uv = 0.0f;
+	for (int i = 0; i < mesh.vertex_count * 2; i++) {
+		max_uv = fabsf (mesh.tex_coords[i]) > max_uv ? fabsf (mesh.tex_coords[i]) :
+			max_uv;
+	}
+	printf ("\n%-20s %8s %8s %8s %12s %10s %10s\n", "pack_mesh_vertices",
+		"bytes", "smaller", "ms", "position", "normal deg", "uv");
+	bool ok = true;
+	for (size_t c = 0; c < sizeof (cases) / sizeof (cases[0]); c++) {
+		packed_mesh packed;
+		double start = now_seconds ();
+		if (!pack_mesh_vertices (mesh, cases[c].format, packed)) {
+			free_obj_mesh (mesh);
+			return false;
+		}
+		double seconds = now_seconds () - start;
+		pack_error error = measure_pack_error (mesh, packed);
+		bool exact_points = PACK_POSITION_FLOAT == cases[c].format.position;
+		bool exact_uvs = PACK_UV_FLOAT == cases[c].format.uv;
+		float max_position = exact_points ? 0.0f :
+			(float)(extent * (0.5 / 65535.0 + 1e-6));
+		float max_uv_error = exact_uvs ? 0.0f : max_uv / 2048.0f;
+		bool within = error.position <= max_position &&
+			error.normal_degrees <= cases[c].max_degrees && error.uv <= max_uv_error;
+		printf ("%-20s %8i %7.2fx %8.1f %12.3g %10.4f %10.3g %s\n", cases[c].name,
+			packed.stride, 32.0 / packed.stride, seconds * 1e3, error.position,
+			error.normal_degrees, error.uv, within ? "within bounds" : "TOO FAR");
+		ok &= within;
+		free_packed_mesh (packed);
+	}
+	free_obj_mesh (mesh);
+	if (!ok) {
+		fprintf (stderr, "ERROR: packed vertices moved too far\n");
+	}
+	return ok;
+}
+
+/*----------------------------------MESHLETS----------------------------------*/
+/* every triangle of meshlet m faces away from eye, or is edge-on to within
+rounding. in double, so it's a check of the float cone */
+static bool all_back_facing (const obj_mesh& mesh, const meshlet_set& set,
+	const meshlet& m, const float* eye) {
+	for (int i = 0; i < m.index_count; i += 3) {
+		const float* p[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = mesh.points + 3 * obj_mesh_index (set.indices, set.index_size,
+				m.first_index + i + k);
+		}
+		double e1[3], e2[3], to_eye[3];
+		for (int k = 0; k < 3; k++) {
+			e1[k] = (double)p[1][k] - p[0][k];
+			e2[k] = (double)p[2][k] - p[0][k];
+			to_eye[k] = (double)eye[k] - p[0][k];
+		}
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+			e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		double d = n[0] * to_eye[0] + n[1] * to_eye[1] + n[2] * to_eye[2];
+		double scale = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) *
+			sqrt (to_eye[0] * to_eye[0] + to_eye[1] * to_eye[1] +
+			to_eye[2] * to_eye[2]);
+		if (d > scale * 1e-4) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// marks the meshlets inside ranges[]
+static void mark_drawn (const meshlet_set& set, const meshlet_range* ranges,
+	int range_count, unsigned char* drawn) {
+	memset (drawn, 0, set.meshlet_count);
+	int m = 0;
+	for (int r = 0; r < range_count; r++) {
+		int end = ranges[r].first_index + ranges[r].index_count;
+		while (m < set.meshlet_count && set.meshlets[m].first_index < end) {
+			drawn[m] = set.meshlets[m].first_index >= ranges[r].first_index;
+			m++;
+		}
+	}
+}
+
+/* builds meshlets for the optimised mesh. they must hold the same triangles,
+within the limits, with spheres around their vertices. then every meshlet the
+cone culls from a ring of cameras must really face away, and culling with a
+frustum must draw what sphere_in_frustum and the cone say */
+static bool check_meshlets (const char* file_name) {
+	obj_mesh mesh;
+	if (!load_obj_file_indexed (file_name, mesh)) {
+		return false;
+	}
+	bool ok = optimise_vertex_cache (mesh, VERTEX_CACHE_SIZE) &&
+		optimise_vertex_fetch (mesh);
+	meshlet_set set;
+	double start = now_seconds ();
+	ok &= build_meshlets (mesh, set);
+	double build_seconds = now_seconds () - start;
+	if (!ok) {
+		free_obj_mesh (mesh);
+		return false;
+	}
+
+	// the same triangles, one meshlet after another, each within the limits
+	obj_mesh view = mesh;
+	view.indices = set.indices;
+	bool valid = triangle_sum (view) == triangle_sum (mesh) &&
+		set.index_count == mesh.index_count;
+	int next_index = 0;
+	int most_verts = 0, most_tris = 0, total_verts = 0;
+	for (int i = 0; i < set.meshlet_count; i++) {
+		const meshlet& m = set.meshlets[i];
+		valid &= m.first_index == next_index && m.index_count > 0 &&
+			m.index_count % 3 == 0 && m.index_count <= 3 * MESHLET_MAX_TRIANGLES;
+		next_index += m.index_count;
+		unsigned int seen[3 * MESHLET_MAX_TRIANGLES];
+		int num_seen = 0;
+		for (int k = 0; k < m.index_count; k++) {
+			unsigned int v = obj_mesh_index (set.indices, set.index_size,
+				m.first_index + k);
+			int s = 0;
+			while (s < num_seen && seen[s] != v) {
+				s++;
+			}
+			if (s == num_seen) {
+				seen[num_seen++] = v;
+			}
+			double d = 0.0;
+			for (int c = 0; c < 3; c++) {
+				double x = (double)mesh.points[v * 3 + c] - m.centre[c];
+				d += x * x;
+			}
+			valid &= sqrt (d) <= m.radius;
+		}
+		valid &= num_seen == m.vertex_count && num_seen <= MESHLET_MAX_VERTICES;
+		valid &= set.sphere_x[i] == m.centre[0] && set.sphere_y[i] == m.centre[1] &&
+			set.sphere_z[i] == m.centre[2] && set.sphere_r[i] == m.radius;
+		total_verts += m.vertex_count;
+		most_verts = std::max (most_verts, m.vertex_count);
+		most_tris = std::max (most_tris, m.index_count / 3);
+	}
+	valid &= next_index == set.index_count;
+
+	/* cameras all round the mesh at 1.5 and 10 radii, and one in the middle.
+	a frustum of zero planes culls nothing, so only the cones cull */
+	meshlet_range* ranges = (meshlet_range*)malloc (
+		(set.meshlet_count + 1) * sizeof (meshlet_range));
+	meshlet_range* expected = (meshlet_range*)malloc (
+		(set.meshlet_count + 1) * sizeof (meshlet_range));
+	unsigned char* drawn = (unsigned char*)malloc (set.meshlet_count + 1);
+	unsigned char* last_plane = (unsigned char*)calloc (set.meshlet_count + 1, 1);
+	frustum everything;
+	memset (&everything, 0, sizeof (everything));
+	const obj_bounds& b = mesh.bounds;
+	bool cones_ok = true;
+	int cone_culled = 0, cone_tested = 0;
+	for (int e = 0; e < 53; e++) {
+		int dir = e % 26 + (e % 26 >= 13);
+		float dist = e < 26 ? 1.5f : 10.0f;
+		float off[3] = { (float)(dir % 3 - 1), (float)(dir / 3 % 3 - 1),
+			(float)(dir / 9 - 1) };
+		if (52 == e) {
+			off[0] = off[1] = off[2] = 0.0f;
+		}
+		float len = sqrtf (off[0] * off[0] + off[1] * off[1] + off[2] * off[2]);
+		float eye[3];
+		for (int k = 0; k < 3; k++) {
+			eye[k] = b.centre[k] + (len > 0.0f ? off[k] / len : 0.0f) * dist *
+				b.radius;
+		}
+		meshlet_cull_stats stats;
+		int count = cull_meshlets (set, everything, vec3 (eye[0], eye[1], eye[2]),
+			NULL, ranges, &stats);
+		mark_drawn (set, ranges, count, drawn);
+		int culled = 0;
+		for (int i = 0; i < set.meshlet_count; i++) {
+			if (!drawn[i]) {
+				culled++;
+				cones_ok &= all_back_facing (mesh, set, set.meshlets[i], eye);
+			}
+		}
+		cones_ok &= culled == stats.cone_culled && 0 == stats.frustum_culled &&
+			stats.visible + culled == set.meshlet_count;
+		if (e < 52) {
+			cone_culled += culled;
+			cone_tested += set.meshlet_count;
+		}
+	}
+
+	/* frustums looking at the mesh from round about. the ranges must be the
+	meshlets sphere_in_frustum keeps, less the ones the cone culls */
+	bool frustum_ok = true;
+	int frustum_culled = 0;
+	double cull_seconds = 0.0;
+	int num_culls = 0;
+	mat4 proj = perspective (40.0f, 1.333f, 0.01f * b.radius, 100.0f * b.radius);
+	for (int e = 0; e < 64; e++) {
+		float yaw = (float)e * 0.7f, pitch = (float)(e % 7 - 3) * 0.3f;
+		vec3 centre (b.centre[0], b.centre[1], b.centre[2]);
+		vec3 eye = centre + vec3 (sinf (yaw) * cosf (pitch), sinf (pitch),
+			cosf (yaw) * cosf (pitch)) * (2.5f * b.radius);
+		// look a little off to the side, so the frustum cuts the mesh
+		vec3 targ = centre + vec3 (cosf (yaw), 0.0f, -sinf (yaw)) *
+			((float)(e % 5) * 0.25f * b.radius);
+		frustum f = frustum_from_mat4 (proj * look_at (eye, targ,
+			vec3 (0.0f, 1.0f, 0.0f)));
+		meshlet_cull_stats stats;
+		start = now_seconds ();
+		int count = cull_meshlets (set, f, eye, last_plane, ranges, &stats);
+		cull_seconds += now_seconds () - start;
+		num_culls++;
+		frustum_culled += stats.frustum_culled;
+		int cone_count = cull_meshlets (set, everything, eye, NULL, expected, NULL);
+		unsigned char* cone_drawn = (unsigned char*)malloc (set.meshlet_count + 1);
+		mark_drawn (set, expected, cone_count, cone_drawn);
+		int num_expected = 0;
+		for (int i = 0; i < set.meshlet_count; i++) {
+			const meshlet& m = set.meshlets[i];
+			if (!cone_drawn[i] || !sphere_in_frustum (f,
+				vec3 (m.centre[0], m.centre[1], m.centre[2]), m.radius)) {
+				continue;
+			}
+			meshlet_range* last = num_expected > 0 ? &expected[num_expected - 1] : NULL;
+			if (last && last->first_index + last->index_count == m.first_index) {
+				last->index_count += m.index_count;
+			} else {
+				expected[num_expected].first_index = m.first_index;
+				expected[num_expected++].index_count = m.index_count;
+			}
+		}
+		free (cone_drawn);
+		frustum_ok &= count == num_expected &&
+			0 == memcmp (ranges, expected, count * sizeof (meshlet_range));
+	}
+
+	printf ("\n%-20s %10s %10s %10s %10s\n", "build_meshlets", "ms", "meshlets",
+		"avg verts", "avg tris");
+	printf ("%-20s %10.1f %10i %10.1f %10.1f %s\n", "", build_seconds * 1e3,
+		set.meshlet_count, set.meshlet_count ? (double)total_verts /
+		set.meshlet_count : 0.0, set.meshlet_count ? (double)next_index / 3.0 /
+		set.meshlet_count : 0.0, valid ? "ok" : "WRONG");
+	printf ("%-20s %10s %10s %10s\n", "cull_meshlets", "us", "cone", "frustum");
+	printf ("%-20s %10.1f %9.1f%% %9.1f%% %s\n", "", num_culls ?
+		cull_seconds * 1e6 / num_culls : 0.0,
+		cone_tested ? 100.0 * cone_culled / cone_tested : 0.0,
+		set.meshlet_count ? 100.0 * frustum_culled / (64.0 * set.meshlet_count) :
+		0.0, cones_ok && frustum_ok ? "ok" : "WRONG");
+	free (ranges);
+	free (expected);
+	free (drawn);
+	free (last_plane);
+	free_meshlets (set);
+	free_obj_mesh (mesh);
+	if (!valid) {
+		fprintf (stderr, "ERROR: the meshlets don't match the mesh (most %i "
+			"vertices, %i triangles)\n", most_verts, most_tris);
+	}
+	if (!cones_ok) {
+		fprintf (stderr, "ERROR: a normal cone culled a front-facing triangle\n");
+	}
+	if (!frustum_ok) {
+		fprintf (stderr, "ERROR: cull_meshlets disagreed with the single tests\n");
+	}
+	return valid && cones_ok && frustum_ok;
+}
+
+/*--------------------------------ASYNC LOADS---------------------------------*/
+#define ASYNC_MESHES 3
+
+// one mesh loaded by the asset loader, and which threads did each step
+struct async_mesh {
+	const char* file_name;
+	obj_mesh mesh;
+	pthread_t main_thread;
+	bool loaded_off_main;
+	bool uploaded_on_main;
+};
+
+static bool load_async_mesh (void* ctx) {
+	async_mesh& a = *(async_mesh*)ctx;
+	a.loaded_off_main = !pthread_equal (pthread_self (), a.main_thread);
+	return load_obj_file_indexed (a.file_name, a.mesh);
+}
+
+static bool upload_async_mesh (void* ctx) {
+	async_mesh& a = *(async_mesh*)ctx;
+	a.uploaded_on_main = pthread_equal (pthread_self (), a.main_thread);
+	return true;
+}
+
+static bool never_loads (void*) {
+	return false;
+}
+
+/* loads the mesh a few times over, and the file as text, on the asset loader
+while this thread pumps uploads as if drawing frames. the meshes must match a
+plain load, and the longest "frame" shows how long the first one would wait */
+static bool check_async (const char* file_name) {
+	obj_mesh expected;
+	double start = now_seconds ();
+	if (!load_obj_file_indexed (file_name, expected)) {
+		return false;
+	}
+	double sync_seconds = now_seconds () - start;
+
+	async_mesh meshes[ASYNC_MESHES];
+	asset_handle* handles[ASYNC_MESHES + 2];
+	memset (meshes, 0, sizeof (meshes));
+	text_asset text = { file_name, NULL, 0 };
+	int failing_ctx = 0;
+	start = now_seconds ();
+	for (int i = 0; i < ASYNC_MESHES; i++) {
+		meshes[i].file_name = file_name;
+		meshes[i].main_thread = pthread_self ();
+		handles[i] = load_asset_async (load_async_mesh, upload_async_mesh,
+			&meshes[i]);
+	}
+	handles[ASYNC_MESHES] = load_asset_async (load_text_asset, NULL, &text);
+	handles[ASYNC_MESHES + 1] = load_asset_async (never_loads, NULL, &failing_ctx);
+	double first_frame = now_seconds () - start;
+	int frames = 0;
+	double longest_frame = 0.0;
+	bool all_done = false;
+	while (!all_done) {
+		double frame_start = now_seconds ();
+		pump_asset_uploads (1.0);
+		all_done = true;
+		for (int i = 0; i < ASYNC_MESHES + 2; i++) {
+			all_done &= NULL != handles[i] && asset_done (handles[i]);
+		}
+		usleep (1000);
+		frames++;
+		longest_frame = std::max (longest_frame, now_seconds () - frame_start);
+	}
+	double async_seconds = now_seconds () - start;
+
+	bool ok = true;
+	for (int i = 0; i < ASYNC_MESHES; i++) {
+		ok &= ASSET_READY == asset_status (handles[i]) &&
+			same_mesh (expected, meshes[i].mesh) && meshes[i].loaded_off_main &&
+			meshes[i].uploaded_on_main;
+	}
+	struct stat st;
+	ok &= ASSET_READY == asset_status (handles[ASYNC_MESHES]) &&
+		0 == stat (file_name, &st) && text.length == (size_t)st.st_size &&
+		0 == text.text[text.length];
+	ok &= ASSET_FAILED == asset_status (handles[ASYNC_MESHES + 1]);
+	for (int i = 0; i < ASYNC_MESHES + 2; i++) {
+		free_asset_handle (handles[i]);
+	}
+	for (int i = 0; i < ASYNC_MESHES; i++) {
+		free_obj_mesh (meshes[i].mesh);
+	}
+	free_text_asset (text);
+
+	/* freeing handles straight away cancels what hasn't started, and the
+	loader stops cleanly with loads still queued */
+	for (int i = 0; i < ASYNC_MESHES; i++) {
+		handles[i] = load_asset_async (load_async_mesh, upload_async_mesh,
+			&meshes[i]);
+	}
+	free_asset_handle (handles[ASYNC_MESHES - 1]);
+	stop_asset_loader ();
+	for (int i = 0; i < ASYNC_MESHES - 1; i++) {
+		asset_state state = asset_status (handles[i]);
+		ok &= ASSET_LOADED == state || ASSET_FAILED == state;
+		free_asset_handle (handles[i]);
+	}
+	ok &= 0 == pump_asset_uploads (1.0);
+	for (int i = 0; i < ASYNC_MESHES; i++) {
+		free_obj_mesh (meshes[i].mesh);
+	}
+	free_obj_mesh (expected);
+
+	printf ("\n%-20s %10s %10s %10s %10s %10s\n", "asset_loader", "sync ms",
+		"async ms", "1st frame", "max frame", "frames");
+	printf ("%-20s %10.1f %10.1f %10.3f %10.1f %10i %s\n", "", sync_seconds * 1e3,
+		async_seconds * 1e3, first_frame * 1e3, longest_frame * 1e3, frames,
+		ok ? "ok" : "WRONG");
+	if (!ok) {
+		fprintf (stderr, "ERROR: assets loaded in the background didn't match\n");
+	}
+	return ok;
+}
+
+/*--------------------------------RESIDENCY-----------------------------------*/
+/* a mesh asset whose "gpu copy" is a malloc'd copy of its points and indices,
+so the registry can be run without GL. "file.obj#2" loads file.obj, so one
+file can be several assets */
+struct resident_mesh {
+	obj_mesh mesh;
+	void* gpu;
+	size_t gpu_size;
+};
+
+static bool load_resident (const char* path, void* data) {
+	char file_name[1024];
+	size_t length = strcspn (path, "#");
+	if (length >= sizeof (file_name)) {
+		return false;
+	}
+	memcpy (file_name, path, length);
+	file_name[length] = 0;
+	return load_obj_file_indexed (file_name, ((resident_mesh*)data)->mesh);
+}
+
+static bool upload_resident (void* data) {
+	resident_mesh& r = *(resident_mesh*)data;
+	size_t points = (size_t)r.mesh.vertex_count * 3 * sizeof (float);
+	size_t indices = (size_t)r.mesh.index_count * r.mesh.index_size;
+	r.gpu = malloc (points + indices + 1);
+	if (!r.gpu) {
+		return false;
+	}
+	memcpy (r.gpu, r.mesh.points, points);
+	memcpy ((char*)r.gpu + points, r.mesh.indices, indices);
+	r.gpu_size = points + indices;
+	return true;
+}
+
+static void drop_resident_cpu (void* data) {
+	free_obj_mesh (((resident_mesh*)data)->mesh);
+}
+
+static void drop_resident_gpu (void* data) {
+	resident_mesh& r = *(resident_mesh*)data;
+	free (r.gpu);
+	r.gpu = NULL;
+	r.gpu_size = 0;
+}
+
+static void unload_resident (void* data) {
+	drop_resident_cpu (data);
+	drop_resident_gpu (data);
+}
+
+static size_t resident_cpu_size (const obj_mesh& mesh) {
+	return (size_t)mesh.vertex_count * 8 * sizeof (float) +
+		(size_t)mesh.index_count * mesh.index_size;
+}
+
+static void resident_sizes (const void* data, size_t* cpu_bytes,
+	size_t* gpu_bytes) {
+	const resident_mesh& r = *(const resident_mesh*)data;
+	*cpu_bytes = r.mesh.points ? resident_cpu_size (r.mesh) : 0;
+	*gpu_bytes = r.gpu_size;
+}
+
+static const asset_type resident_type = {
+	"mesh", sizeof (resident_mesh), load_resident, upload_resident,
+	drop_resident_cpu, drop_resident_gpu, unload_resident, resident_sizes
+};
+
+/* runs frames, using assets[0, count), until they all have gpu copies. false
+if that takes too long */
+static bool run_frames (registry_asset** assets, int count) {
+	for (int frame = 0; frame < 100000; frame++) {
+		update_asset_registry (1.0);
+		bool all = true;
+		for (int i = 0; i < count; i++) {
+			all &= NULL != use_asset (assets[i]);
+		}
+		if (all) {
+			return true;
+		}
+		usleep (500);
+	}
+	return false;
+}
+
+static bool resident_matches (registry_asset* asset, const obj_mesh& expected) {
+	const resident_mesh* r = (const resident_mesh*)use_asset (asset);
+	size_t points = (size_t)expected.vertex_count * 3 * sizeof (float);
+	return r && r->gpu_size == points +
+		(size_t)expected.index_count * expected.index_size &&
+		0 == memcmp (r->gpu, expected.points, points) &&
+		0 == memcmp ((const char*)r->gpu + points, expected.indices,
+		r->gpu_size - points);
+}
+
+/* four copies of the mesh in budgets of 2.5 cpu copies and 3.5 gpu copies.
+while all are referenced only cpu shadows can go. released ones then lose
+their gpu copies least recently used first, and one acquired again must come
+back the same */
+static bool check_registry (const char* file_name) {
+	obj_mesh expected;
+	if (!load_obj_file_indexed (file_name, expected)) {
+		return false;
+	}
+	size_t cpu_size = resident_cpu_size (expected);
+	size_t gpu_size = (size_t)expected.vertex_count * 3 * sizeof (float) +
+		(size_t)expected.index_count * expected.index_size;
+	init_asset_registry (cpu_size * 5 / 2, gpu_size * 7 / 2);
+	registry_asset* assets[4];
+	char paths[4][1100];
+	bool ok = true;
+	for (int i = 0; i < 4; i++) {
+		snprintf (paths[i], sizeof (paths[i]), "%s#%i", file_name, i);
+		assets[i] = acquire_asset (paths[i], &resident_type);
+		ok &= NULL != assets[i];
+	}
+	if (!ok) {
+		free_asset_registry ();
+		free_obj_mesh (expected);
+		return false;
+	}
+	ok &= acquire_asset (paths[0], &resident_type) == assets[0];
+	release_asset (assets[0]);
+
+	// everything referenced: the gpu budget can't be kept, the cpu one can
+	ok &= run_frames (assets, 4);
+	update_asset_registry (1.0);
+	asset_registry_stats loaded = get_asset_registry_stats ();
+	int cpu_resident = 0;
+	for (int i = 0; i < 4; i++) {
+		ok &= resident_matches (assets[i], expected) &&
+			asset_gpu_resident (assets[i]);
+		cpu_resident += asset_cpu_resident (assets[i]);
+	}
+	ok &= 4 == loaded.loads && 4 == loaded.uploads &&
+		loaded.gpu_bytes == 4 * gpu_size && loaded.cpu_bytes <= loaded.cpu_budget &&
+		2 == cpu_resident && 0 == loaded.gpu_evictions;
+
+	// 0 and 1 released, 1 still drawn: only 0 has to go
+	release_asset (assets[0]);
+	release_asset (assets[1]);
+	ok &= run_frames (assets + 1, 3);
+	update_asset_registry (1.0);
+	asset_registry_stats released = get_asset_registry_stats ();
+	ok &= !asset_gpu_resident (assets[0]) && !asset_cpu_resident (assets[0]) &&
+		asset_gpu_resident (assets[1]) && 1 == released.gpu_evictions &&
+		released.gpu_bytes == 3 * gpu_size;
+
+	// 0 comes back from disk, pushing out 1, the only other one unreferenced
+	registry_asset* again = acquire_asset (paths[0], &resident_type);
+	ok &= again == assets[0] && run_frames (assets, 1);
+	ok &= resident_matches (assets[0], expected);
+	update_asset_registry (1.0);
+	asset_registry_stats reloaded = get_asset_registry_stats ();
+	ok &= 5 == reloaded.loads && !asset_gpu_resident (assets[1]) &&
+		2 == reloaded.gpu_evictions && reloaded.gpu_bytes <= reloaded.gpu_budget &&
+		reloaded.cpu_bytes <= reloaded.cpu_budget;
+
+	free_asset_registry ();
+	free_obj_mesh (expected);
+	printf ("\n%-20s %10s %10s %10s %10s %10s\n", "asset_registry", "loads",
+		"uploads", "cpu evict", "gpu evict", "MiB");
+	printf ("%-20s %10i %10i %10i %10i %10.1f %s\n", "", reloaded.loads,
+		reloaded.uploads, reloaded.cpu_evictions, reloaded.gpu_evictions,
+		(reloaded.cpu_bytes + reloaded.gpu_bytes) / (1024.0 * 1024.0),
+		ok ? "ok" : "WRONG");
+	if (!ok) {
+		fprintf (stderr, "ERROR: the asset registry didn't keep to its budgets\n");
+	}
+	return ok;
+}
+
+/*----------------------------------CODEC-------------------------------------*/
+// best of this many runs of each encode and decode
+#define CODEC_RUNS 5
+
+struct codec_totals {
+	size_t raw;
+	size_t packed;
+	double encode_seconds;
+	double decode_seconds;
+};
+
+/* encodes and decodes one stream of count vertices, or indices if components
+is 0. it must come back exact, and cut short or scribbled on it must fail or
+at least not crash */
+static bool round_trip_stream (const char* name, const void* data, size_t count,
+	int components, int index_size, codec_totals& totals) {
+	size_t raw = components ? count * components * sizeof (float) :
+		count * index_size;
+	size_t bound = components ? vertex_stream_bound (count, components) :
+		index_stream_bound (count);
+	unsigned char* packed = (unsigned char*)malloc (bound);
+	unsigned char* out = (unsigned char*)malloc (raw + 1);
+	if (!packed || !out) {
+		free (packed);
+		free (out);
+		return false;
+	}
+	size_t size = 0;
+	bool ok = true;
+	double encode = 1e9, decode = 1e9;
+	for (int run = 0; run < CODEC_RUNS; run++) {
+		double start = now_seconds ();
+		size = components ?
+			encode_vertex_stream (packed, (const float*)data, count, components) :
+			encode_index_stream (packed, data, count, index_size);
+		encode = std::min (encode, now_seconds () - start);
+		start = now_seconds ();
+		ok &= components ?
+			decode_vertex_stream ((float*)out, count, components, packed, size) :
+			decode_index_stream (out, count, index_size, packed, size);
+		decode = std::min (decode, now_seconds () - start);
+	}
+	ok = ok && size <= bound && 0 == memcmp (out, data, raw);
+	bool short_fails = 0 == size || !(components ?
+		decode_vertex_stream ((float*)out, count, components, packed, size - 1) :
+		decode_index_stream (out, count, index_size, packed, size - 1));
+	srand (1);
+	for (size_t i = 0; i < size; i += 1 + rand () % 64) {
+		packed[i] = (unsigned char)rand ();
+	}
+	if (components) {
+		decode_vertex_stream ((float*)out, count, components, packed, size);
+	} else {
+		decode_index_stream (out, count, index_size, packed, size);
+	}
+	printf ("%-20s %10.2f %8.2f %10.0f %10.2f %s\n", name, (double)raw / 1e6,
+		size ? (double)raw / size : 0.0, (double)raw / 1e6 / encode,
+		(double)raw / 1e9 / decode, ok && short_fails ? "same" : "DIFFERENT");
+	totals.raw += raw;
+	totals.packed += size;
+	totals.encode_seconds += encode;
+	totals.decode_seconds += decode;
+	free (packed);
+	free (out);
+	return ok && short_fails;
+}
+
+// every stream through mesh_codec.h, as exported and optimised
+static bool check_codec (const char* file_name) {
+	bool ok = true;
+	obj_mesh mesh;
+	if (!load_obj_file_indexed (file_name, mesh)) {
+		return false;
+	}
+	for (int optimised = 0; optimised < 2; optimised++) {
+		if (optimised) {
+			ok &= optimise_vertex_cache (mesh, VERTEX_CACHE_SIZE) &&
+				optimise_vertex_fetch (mesh);
+		}
+		printf ("\n%-20s %10s %8s %10s %10s\n",
+			optimised ? "codec, optimised" : "codec, as exported", "raw MB", "ratio",
+			"enc MB/s", "dec GB/s");
+		codec_totals totals;
+		memset (&totals, 0, sizeof (totals));
+		size_t n = (size_t)mesh.vertex_count;
+		ok &= round_trip_stream ("points", mesh.points, n, 3, 0, totals);
+		ok &= round_trip_stream ("tex coords", mesh.tex_coords, n, 2, 0, totals);
+		ok &= round_trip_stream ("normals", mesh.normals, n, 3, 0, totals);
+		ok &= round_trip_stream ("indices", mesh.indices,
+			(size_t)mesh.index_count, 0, mesh.index_size, totals);
+		printf ("%-20s %10.2f %8.2f %10.0f %10.2f\n", "all",
+			(double)totals.raw / 1e6,
+			totals.packed ? (double)totals.raw / totals.packed : 0.0,
+			(double)totals.raw / 1e6 / totals.encode_seconds,
+			(double)totals.raw / 1e9 / totals.decode_seconds);
+	}
+
+	free_obj_mesh (mesh);
+	if (!ok) {
+		fprintf (stderr, "ERROR: the mesh codec doesn't give the same mesh back\n");
+	}
+	return ok;
+}
+
+int main (int argc, char** argv) {
+	const char* file_name = SYNTHETIC_FILE;
+	if (argc > 1) {
+		file_name = argv[1];
+	} else if (0 == file_size (SYNTHETIC_FILE)) {
+		printf ("writing %s...\n", SYNTHETIC_FILE);
+		if (!write_synthetic (SYNTHETIC_FILE)) {
+			return 1;
+		}
+	}
+	double mb = (double)file_size (file_name) / 1e6;
+	// everything is timed from text. check_cache turns it on for itself
+	set_obj_cache (false);
+	stream_hash stream_hashes[NUM_STREAM_BUDGETS];
+	bool stream_ok = run_stream (file_name, mb, stream_hashes);
+
+	float* vp[2] = { NULL, NULL };
+	float* vt[2] = { NULL, NULL };
+	float* vn[2] = { NULL, NULL };
+	int count[2] = { 0, 0 };
+	obj_bounds bounds;
+	double seconds[2];
+	double start = now_seconds ();
+	bool ok = load_obj_file_stdio (file_name, vp[0], vt[0], vn[0], count[0]);
+	seconds[0] = now_seconds () - start;
+	start = now_seconds ();
+	ok &= load_obj_file (file_name, vp[1], vt[1], vn[1], count[1], &bounds);
+	seconds[1] = now_seconds () - start;
+	if (!ok) {
+		fprintf (stderr, "ERROR: could not load %s\n", file_name);
+		return 1;
+	}
+
+	bool same = count[0] == count[1] &&
+		0 == memcmp (vp[0], vp[1], count[0] * 3 * sizeof (float)) &&
+		0 == memcmp (vt[0], vt[1], count[0] * 2 * sizeof (float)) &&
+		0 == memcmp (vn[0], vn[1], count[0] * 3 * sizeof (float));
+	printf ("\n%s: %.1f MB, %i points\n", file_name, mb, count[1]);
+	printf ("%-20s %10s %10s %8s\n", "loader", "ms", "MB/s", "speedup");
+	printf ("%-20s %10.1f %10.1f %8s\n", "load_obj_file_stdio", seconds[0] * 1e3,
+		mb / seconds[0], "");
+	printf ("%-20s %10.1f %10.1f %7.1fx %s\n", "load_obj_file", seconds[1] * 1e3,
+		mb / seconds[1], seconds[0] / seconds[1], same ? "same" : "DIFFERENT");
+	bool bounds_ok = check_bounds (bounds, vp[1], count[1]);
+	bool indexed_ok = check_indexed (file_name, mb, vp[1], vt[1], vn[1],
+		count[1]);
+	bool scaling_ok = check_scaling (file_name, mb, vp[1], vt[1], vn[1],
+		count[1], bounds);
+	bool cache_ok = check_cache (file_name, vp[1], vt[1], vn[1], count[1],
+		bounds);
+	stream_hash expected;
+	start_hash (expected);
+	hash_vertices (expected, vp[1], vt[1], vn[1], count[1]);
+	for (int i = 0; i < NUM_STREAM_BUDGETS; i++) {
+		stream_ok &= 0 == memcmp (&expected, &stream_hashes[i], sizeof (expected));
+	}
+	if (!stream_ok) {
+		fprintf (stderr, "ERROR: stream_obj_file gave a different mesh\n");
+	}
+	for (int i = 0; i < 2; i++) {
+		free (vp[i]);
+		free (vt[i]);
+		free (vn[i]);
+	}
+	if (!same) {
+		fprintf (stderr, "ERROR: the loaders gave different meshes\n");
+	}
+	bool optimise_ok = check_optimise (file_name);
+	bool simplify_ok = check_simplify (file_name);
+	bool pack_ok = check_pack (file_name);
+	bool meshlets_ok = check_meshlets (file_name);
+	bool async_ok = check_async (file_name);
+	bool registry_ok = check_registry (file_name);
+	bool codec_ok = check_codec (file_name);
+	bool numbers_ok = check_numbers ();
+	time_numbers ();
+	if (!same || !bounds_ok || !indexed_ok || !scaling_ok || !cache_ok ||
+		!stream_ok || !optimise_ok || !simplify_ok || !pack_ok || !meshlets_ok ||
+		!async_ok || !registry_ok || !codec_ok || !numbers_ok) {
+		return 1;
+	}
+	return 0;
+}
@@ -1,10 +1,22 @@
 
 #include "obj_parser.h"
+#include "thread_pool.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <math.h>
+#include <stdint.h>
+#include <float.h>
+#include <charconv>
 
-bool load_obj_file  (const char* file_name,
+/* the original loader. reads the file twice with fgets and parses each line
+with sscanf. kept so the fast one can be checked against it */
+bool load_obj_file_stdio  (const char* file_name,
 					 float*& points,
 					 float*& tex_coords,
 					 float*& normals,
@@ -47,19 +59,25 @@ bool load_obj_file  (const char* file_name,
 		"found %i vp %i vt %i vn unique in obj. allocating memory...\n",
 		unsorted_vp_count, unsorted_vt_count, unsorted_vn_count
 	);
-	unsorted_vp_array = (float*)malloc (unsorted_vp_count * 3 * sizeof (float));
-	unsorted_vt_array = (float*)malloc (unsorted_vt_count * 2 * sizeof (float));
-	unsorted_vn_array = (float*)malloc (unsorted_vn_count * 3 * sizeof (float));
-	points = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	tex_coords = (float*)malloc (3 * face_count * 2 * sizeof (float));
-	normals = (float*)malloc (3 * face_count * 3 * sizeof (float));
+	unsorted_vp_array = (float*)malloc (unsorted_vp_count * 3 * sizeof (float) + 1);
+	unsorted_vt_array = (float*)malloc (unsorted_vt_count * 2 * sizeof (float) + 1);
+	unsorted_vn_array = (float*)malloc (unsorted_vn_count * 3 * sizeof (float) + 1);
+	points = (float*)malloc (3 * face_count * 3 * sizeof (float) + 1);
+	tex_coords = (float*)malloc (3 * face_count * 2 * sizeof (float) + 1);
+	normals = (float*)malloc (3 * face_count * 3 * sizeof (float) + 1);
 	printf (
 		"allocated %i bytes for mesh\n",
 		(int)(3 * face_count * 8 * sizeof (float))
 	);
+	// every error from here on goes through the clean-up at the end
+	bool ok = unsorted_vp_array && unsorted_vt_array && unsorted_vn_array &&
+		points && tex_coords && normals;
+	if (!ok) {
+		fprintf (stderr, "ERROR: out of memory loading obj\n");
+	}
 	
 	rewind (fp);
-	while (fgets (line, 1024, fp)) {
+	while (ok && fgets (line, 1024, fp)) {
 		// vertex
 		if (line[0] == 'v') {
 		
@@ -110,7 +128,8 @@ bool load_obj_file  (const char* file_name,
 					make sure exported mesh is triangulated and contains vertex points, \
 					texture coordinates, and normals\n"
 				);
-				return false;
+				ok = false;
+				break;
 			}
 
 			int vp[3], vt[3], vn[3];
@@ -126,15 +145,18 @@ bool load_obj_file  (const char* file_name,
 			for (int i = 0; i < 3; i++) {
 				if ((vp[i] - 1 < 0) || (vp[i] - 1 >= unsorted_vp_count)) {
 					fprintf (stderr, "ERROR: invalid vertex position index in face\n");
-					return false;
+					ok = false;
+					break;
 				}
 				if ((vt[i] - 1 < 0) || (vt[i] - 1 >= unsorted_vt_count)) {
 					fprintf (stderr, "ERROR: invalid texture coord index %i in face.\n", vt[i]);
-					return false;
+					ok = false;
+					break;
 				}
 				if ((vn[i] - 1 < 0) || (vn[i] - 1 >= unsorted_vn_count)) {
 					printf ("ERROR: invalid vertex normal index in face\n");
-					return false;
+					ok = false;
+					break;
 				}
 				points[point_count * 3] = unsorted_vp_array[(vp[i] - 1) * 3];
 				points[point_count * 3 + 1] = unsorted_vp_array[(vp[i] - 1) * 3 + 1];
@@ -152,9 +174,1774 @@ bool load_obj_file  (const char* file_name,
 	free (unsorted_vp_array);
 	free (unsorted_vn_array);
 	free (unsorted_vt_array);
+	if (!ok) {
+		free (points);
+		free (tex_coords);
+		free (normals);
+		points = tex_coords = normals = NULL;
+		point_count = 0;
+		return false;
+	}
 	printf (
 		"allocated %i points\n",
 		point_count
 	);
 	return true;
 }
+
+/*---------------------------------FAST LOADER--------------------------------*/
+/* one pass over the mmapped file (or over each chunk of it, see CHUNKED
+PARSING). memchr finds each newline (it's SSE2/AVX2 in glibc), v/vt/vn go into
+arrays that double when they fill up, and faces are kept as indices until the
+end, when they're expanded exactly like above */
+
+// a growable array of floats or ints
+struct obj_array {
+	void* data;
+	size_t count;
+	size_t capacity;
+};
+
+static bool push_obj_array (obj_array& a, const void* items, size_t n,
+	size_t item_size) {
+	if (a.count + n > a.capacity) {
+		size_t capacity = a.capacity ? a.capacity * 2 : 4096;
+		while (capacity < a.count + n) {
+			capacity *= 2;
+		}
+		void* data = realloc (a.data, capacity * item_size);
+		if (!data) {
+			fprintf (stderr, "ERROR: out of memory loading obj\n");
+			return false;
+		}
+		a.data = data;
+		a.capacity = capacity;
+	}
+	memcpy ((char*)a.data + a.count * item_size, items, n * item_size);
+	a.count += n;
+	return true;
+}
+
+/*-------------------------------NUMBER PARSING-------------------------------*/
+/* strtof and sscanf look up the locale on every call, and are most of the load
+time. most numbers in an obj are short ("%f" from Blender is 6 decimals), so
+we gather the digits into an integer m and a power of ten, and when m fits in
+a float's 24 bits and the power is at most 10, m / 10^k is one correctly-
+rounded float division of two exact values - the same answer strtof gives.
+anything longer goes to std::from_chars, which is also correctly rounded and
+ignores the locale */
+static const float g_pow10f[11] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const char* skip_blanks (const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	return p;
+}
+
+const char* parse_obj_float (const char* p, const char* end, float* out) {
+	p = skip_blanks (p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	const char* number = p;
+	unsigned long long m = 0;
+	int digits = 0; // significant digits in m
+	int exp10 = 0;
+	bool any_digits = false;
+	while (p < end && *p >= '0' && *p <= '9') {
+		if (digits < 19) {
+			m = m * 10 + (*p - '0');
+			digits += m > 0;
+		} else {
+			exp10++;
+		}
+		any_digits = true;
+		p++;
+	}
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (digits < 19) {
+				m = m * 10 + (*p - '0');
+				digits += m > 0;
+				exp10--;
+			}
+			any_digits = true;
+			p++;
+		}
+	}
+	if (!any_digits) {
+		// maybe inf or nan
+		goto slow;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool exp_negative = false;
+		if (q < end && (*q == '-' || *q == '+')) {
+			exp_negative = *q == '-';
+			q++;
+		}
+		if (q < end && *q >= '0' && *q <= '9') {
+			int e = 0;
+			while (q < end && *q >= '0' && *q <= '9') {
+				if (e < 100000) {
+					e = e * 10 + (*q - '0');
+				}
+				q++;
+			}
+			exp10 += exp_negative ? -e : e;
+			p = q;
+		}
+	}
+	if (digits >= 19 || m >= (1u << 24) || exp10 < -10 || exp10 > 10) {
+		goto slow;
+	}
+	{
+		float f = (float)m;
+		f = exp10 < 0 ? f / g_pow10f[-exp10] : f * g_pow10f[exp10];
+		*out = negative ? -f : f;
+	}
+	return p;
+
+slow:
+	{
+		float f = 0.0f;
+		std::from_chars_result r = std::from_chars (number, end, f);
+		if (r.ec == std::errc::invalid_argument || r.ptr == number) {
+			return NULL;
+		}
+		// out of range leaves f alone. give inf or 0 like strtof does
+		if (r.ec == std::errc::result_out_of_range) {
+			f = exp10 < 0 ? 0.0f : HUGE_VALF;
+		}
+		*out = negative ? -f : f;
+		return r.ptr;
+	}
+}
+
+// like parse_obj_int, for indices past 2^31 in huge streamed files
+static const char* parse_obj_long (const char* p, const char* end,
+	long long* out) {
+	p = skip_blanks (p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	const char* digits = p;
+	long long v = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		if (v < 100000000000000000LL) {
+			v = v * 10 + (*p - '0');
+		}
+		p++;
+	}
+	if (p == digits) {
+		return NULL;
+	}
+	*out = negative ? -v : v;
+	return p;
+}
+
+const char* parse_obj_int (const char* p, const char* end, int* out) {
+	long long v = 0;
+	p = parse_obj_long (p, end, &v);
+	if (!p) {
+		return NULL;
+	}
+	if (v > 2147483647LL) {
+		v = 2147483647LL;
+	} else if (v < -2147483647LL) {
+		v = -2147483647LL;
+	}
+	*out = (int)v;
+	return p;
+}
+
+static const char* parse_obj_index (const char* p, const char* end, int* out) {
+	return parse_obj_int (p, end, out);
+}
+
+static const char* parse_obj_index (const char* p, const char* end,
+	long long* out) {
+	return parse_obj_long (p, end, out);
+}
+
+/* reads up to n floats from [p, eol). missing ones stay 0, like sscanf
+leaving its defaults */
+static void parse_floats (const char* p, const char* eol, float* out, int n) {
+	for (int i = 0; i < n; i++) {
+		p = parse_obj_float (p, eol, &out[i]);
+		if (!p) {
+			return;
+		}
+	}
+}
+
+static void print_face_error () {
+	fprintf (
+		stderr,
+		"ERROR: file contains quads or does not match v vp/vt/vn layout - \
+		make sure exported mesh is triangulated and contains vertex points, \
+		texture coordinates, and normals\n"
+	);
+}
+
+/* "f v/t/n v/t/n v/t/n" into 9 ints, in the same order as sscanf's. false if
+it isn't a triangle with all three of v/t/n. T is int, or long long when
+streaming */
+template <typename T>
+static bool parse_face (const char* p, const char* eol, T* out) {
+	int slash_count = 0;
+	for (const char* c = p; c < eol; c++) {
+		if (*c == '/') {
+			slash_count++;
+		}
+	}
+	if (slash_count != 6) {
+		return false;
+	}
+	p++;
+	for (int i = 0; i < 9; i++) {
+		out[i] = 0;
+	}
+	for (int i = 0; i < 9; i++) {
+		p = parse_obj_index (p, eol, &out[i]);
+		if (!p) {
+			break;
+		}
+		// the slashes between v/t/n
+		if (i % 3 != 2) {
+			if (*p != '/') {
+				break;
+			}
+			p++;
+		}
+	}
+	return true;
+}
+
+struct obj_text {
+	obj_array vp;
+	obj_array vt;
+	obj_array vn;
+	obj_array faces;
+	// box around the v lines so far. only set once vp.count > 0
+	float vp_min[3];
+	float vp_max[3];
+	// parsing stopped at a face that wasn't v/t/n triangle
+	bool bad_face;
+};
+
+enum obj_line_kind { OBJ_LINE_OTHER, OBJ_LINE_V, OBJ_LINE_VT, OBJ_LINE_VN,
+	OBJ_LINE_F };
+
+static obj_line_kind classify_obj_line (const char* line, const char* eol) {
+	if (line[0] == 'v' && line + 1 < eol) {
+		if (line[1] == ' ') {
+			return OBJ_LINE_V;
+		} else if (line[1] == 't') {
+			return OBJ_LINE_VT;
+		} else if (line[1] == 'n') {
+			return OBJ_LINE_VN;
+		}
+	} else if (line < eol && line[0] == 'f') {
+		return OBJ_LINE_F;
+	}
+	return OBJ_LINE_OTHER;
+}
+
+/* grows a box to take in the box lo..hi (a point has lo == hi). empty is
+true if the box has nothing in it yet */
+static void grow_obj_box (float* box_min, float* box_max, bool empty,
+	const float* lo, const float* hi) {
+	for (int i = 0; i < 3; i++) {
+		if (empty || lo[i] < box_min[i]) {
+			box_min[i] = lo[i];
+		}
+		if (empty || hi[i] > box_max[i]) {
+			box_max[i] = hi[i];
+		}
+	}
+}
+
+static bool parse_obj_line (const char* line, const char* eol, obj_text& t) {
+	float f[3] = { 0.0f, 0.0f, 0.0f };
+	switch (classify_obj_line (line, eol)) {
+	case OBJ_LINE_V:
+		parse_floats (line + 1, eol, f, 3);
+		grow_obj_box (t.vp_min, t.vp_max, 0 == t.vp.count, f, f);
+		return push_obj_array (t.vp, f, 3, sizeof (float));
+	case OBJ_LINE_VT:
+		parse_floats (line + 2, eol, f, 2);
+		return push_obj_array (t.vt, f, 2, sizeof (float));
+	case OBJ_LINE_VN:
+		parse_floats (line + 2, eol, f, 3);
+		return push_obj_array (t.vn, f, 3, sizeof (float));
+	case OBJ_LINE_F: {
+		int corners[9];
+		if (!parse_face (line, eol, corners)) {
+			t.bad_face = true;
+			return false;
+		}
+		return push_obj_array (t.faces, corners, 9, sizeof (int));
+	}
+	default:
+		return true;
+	}
+}
+
+/* parses every line in [data, data + size). stops at the first bad one. the
+face message is left to the caller, so chunks parsed on other threads don't
+all print it */
+static bool parse_obj_lines (const char* data, size_t size, obj_text& t) {
+	const char* p = data;
+	const char* end = data + size;
+	while (p < end) {
+		const char* eol = (const char*)memchr (p, '\n', end - p);
+		if (!eol) {
+			/* last line has no newline. the number parsers need something to
+			stop at, and the mapping may end right after it, so use a copy */
+			size_t len = end - p;
+			char* copy = (char*)malloc (len + 1);
+			if (!copy) {
+				return false;
+			}
+			memcpy (copy, p, len);
+			copy[len] = '\n';
+			bool ok = parse_obj_line (copy, copy + len, t);
+			free (copy);
+			return ok;
+		}
+		if (!parse_obj_line (p, eol, t)) {
+			return false;
+		}
+		p = eol + 1;
+	}
+	return true;
+}
+
+/*-------------------------------CHUNKED PARSING------------------------------*/
+/* big files are cut into OBJ_CHUNK_BYTES pieces, each moved on to just after a
+newline, and the chunks are parsed on the thread pool into their own arrays.
+then the counts are prefix-summed so every chunk knows where its v/vt/vn/f
+go in the merged arrays, and the chunks are copied there, again in parallel.
+obj indices are absolute (counted from the start of the file), so once the
+arrays are merged in file order the faces need no fixing up, and the result
+is the same bytes as parsing the whole file in one go, for any thread count */
+
+// start of the first line that begins at or after offset
+static size_t chunk_line_start (const char* data, size_t size, size_t offset) {
+	if (offset == 0) {
+		return 0;
+	}
+	if (offset >= size) {
+		return size;
+	}
+	const char* nl = (const char*)memchr (data + offset - 1, '\n',
+		size - (offset - 1));
+	return nl ? (size_t)(nl + 1 - data) : size;
+}
+
+struct obj_chunk_job {
+	const char* data;
+	size_t size;
+	obj_text* chunks;
+	bool* ok;
+	obj_text* merged;
+	// per chunk, where its items start in each of the merged arrays
+	size_t* vp_start;
+	size_t* vt_start;
+	size_t* vn_start;
+	size_t* faces_start;
+};
+
+static void parse_chunks (void* ctx, size_t begin, size_t end) {
+	obj_chunk_job* job = (obj_chunk_job*)ctx;
+	for (size_t c = begin; c < end; c++) {
+		size_t first = chunk_line_start (job->data, job->size, c * OBJ_CHUNK_BYTES);
+		size_t last = chunk_line_start (job->data, job->size,
+			(c + 1) * OBJ_CHUNK_BYTES);
+		job->ok[c] = parse_obj_lines (job->data + first, last - first,
+			job->chunks[c]);
+	}
+}
+
+static void copy_obj_array (obj_array& dst, size_t start, const obj_array& src,
+	size_t item_size) {
+	if (src.count > 0) {
+		memcpy ((char*)dst.data + start * item_size, src.data,
+			src.count * item_size);
+	}
+}
+
+static void merge_chunks (void* ctx, size_t begin, size_t end) {
+	obj_chunk_job* job = (obj_chunk_job*)ctx;
+	for (size_t c = begin; c < end; c++) {
+		const obj_text& t = job->chunks[c];
+		copy_obj_array (job->merged->vp, job->vp_start[c], t.vp, sizeof (float));
+		copy_obj_array (job->merged->vt, job->vt_start[c], t.vt, sizeof (float));
+		copy_obj_array (job->merged->vn, job->vn_start[c], t.vn, sizeof (float));
+		copy_obj_array (job->merged->faces, job->faces_start[c], t.faces,
+			sizeof (int));
+	}
+}
+
+static void free_obj_text (obj_text& text);
+
+// allocates a merged array of count items. false if out of memory
+static bool alloc_obj_array (obj_array& a, size_t count, size_t item_size) {
+	a.data = malloc (count * item_size + 1);
+	a.count = a.capacity = count;
+	if (!a.data) {
+		fprintf (stderr, "ERROR: out of memory loading obj\n");
+		return false;
+	}
+	return true;
+}
+
+static bool parse_obj_chunks (const char* data, size_t size, obj_text& t) {
+	size_t num_chunks = (size + OBJ_CHUNK_BYTES - 1) / OBJ_CHUNK_BYTES;
+	obj_text* chunks = (obj_text*)calloc (num_chunks, sizeof (obj_text));
+	bool* ok = (bool*)calloc (num_chunks, sizeof (bool));
+	size_t* starts = (size_t*)malloc (4 * num_chunks * sizeof (size_t));
+	if (!chunks || !ok || !starts) {
+		fprintf (stderr, "ERROR: out of memory loading obj\n");
+		free (chunks);
+		free (ok);
+		free (starts);
+		return false;
+	}
+	obj_chunk_job job;
+	job.data = data;
+	job.size = size;
+	job.chunks = chunks;
+	job.ok = ok;
+	job.merged = &t;
+	job.vp_start = starts;
+	job.vt_start = starts + num_chunks;
+	job.vn_start = starts + 2 * num_chunks;
+	job.faces_start = starts + 3 * num_chunks;
+	parallel_for (num_chunks, 1, parse_chunks, &job);
+
+	// the first chunk that failed is where a single pass would have stopped
+	bool all_ok = true;
+	for (size_t c = 0; c < num_chunks && all_ok; c++) {
+		if (!ok[c]) {
+			if (chunks[c].bad_face) {
+				t.bad_face = true;
+			}
+			all_ok = false;
+		}
+	}
+	size_t vp = 0, vt = 0, vn = 0, faces = 0;
+	for (size_t c = 0; c < num_chunks && all_ok; c++) {
+		if (chunks[c].vp.count > 0) {
+			grow_obj_box (t.vp_min, t.vp_max, 0 == vp, chunks[c].vp_min,
+				chunks[c].vp_max);
+		}
+		job.vp_start[c] = vp;
+		job.vt_start[c] = vt;
+		job.vn_start[c] = vn;
+		job.faces_start[c] = faces;
+		vp += chunks[c].vp.count;
+		vt += chunks[c].vt.count;
+		vn += chunks[c].vn.count;
+		faces += chunks[c].faces.count;
+	}
+	if (all_ok) {
+		all_ok = alloc_obj_array (t.vp, vp, sizeof (float)) &&
+			alloc_obj_array (t.vt, vt, sizeof (float)) &&
+			alloc_obj_array (t.vn, vn, sizeof (float)) &&
+			alloc_obj_array (t.faces, faces, sizeof (int));
+	}
+	if (all_ok) {
+		parallel_for (num_chunks, 1, merge_chunks, &job);
+	}
+	for (size_t c = 0; c < num_chunks; c++) {
+		free_obj_text (chunks[c]);
+	}
+	free (chunks);
+	free (ok);
+	free (starts);
+	return all_ok;
+}
+
+/* one pass on this thread for small files or a single worker, otherwise in
+chunks across the thread pool. the output is identical either way */
+static bool parse_obj_text (const char* data, size_t size, obj_text& t) {
+	bool ok;
+	if (get_worker_count () > 1 && size > OBJ_CHUNK_BYTES) {
+		ok = parse_obj_chunks (data, size, t);
+	} else {
+		ok = parse_obj_lines (data, size, t);
+	}
+	if (!ok && t.bad_face) {
+		print_face_error ();
+	}
+	return ok;
+}
+
+/*-------------------------------FACE EXPANSION-------------------------------*/
+// which of a corner's v/t/n indices is out of range: 0, 1 or 2, or -1 if none
+template <typename T>
+static int bad_corner_part (const T* c, int64_t vp_count, int64_t vt_count,
+	int64_t vn_count) {
+	if (c[0] < 1 || c[0] > vp_count) {
+		return 0;
+	}
+	if (c[1] < 1 || c[1] > vt_count) {
+		return 1;
+	}
+	if (c[2] < 1 || c[2] > vn_count) {
+		return 2;
+	}
+	return -1;
+}
+
+template <typename T>
+static void print_bad_corner (const T* c, int part) {
+	if (0 == part) {
+		fprintf (stderr, "ERROR: invalid vertex position index in face\n");
+	} else if (1 == part) {
+		fprintf (stderr, "ERROR: invalid texture coord index %lli in face.\n",
+			(long long)c[1]);
+	} else {
+		fprintf (stderr, "ERROR: invalid vertex normal index in face\n");
+	}
+}
+
+/*-----------------------------------BOUNDS-----------------------------------*/
+/* the box from parsing, with the sphere centred in it and a radius of 0 for
+now. -0 and 0 tie, and which one a chunk kept depends on the chunking, so
+both come out as 0 to keep the bounds the same for any thread count */
+static void start_obj_bounds (const obj_text& t, obj_bounds& b) {
+	memset (&b, 0, sizeof (b));
+	if (0 == t.vp.count) {
+		return;
+	}
+	for (int i = 0; i < 3; i++) {
+		b.min[i] = t.vp_min[i] + 0.0f;
+		b.max[i] = t.vp_max[i] + 0.0f;
+		b.centre[i] = (b.min[i] + b.max[i]) * 0.5f;
+	}
+}
+
+// squared distance from the sphere's centre to a point
+static inline float obj_dist_sq (const obj_bounds& b, const float* p) {
+	float dx = p[0] - b.centre[0];
+	float dy = p[1] - b.centre[1];
+	float dz = p[2] - b.centre[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+/* the radius for the largest squared distance, nudged up a few ulps for
+rounding the same way as bounds.cpp, so they agree */
+static float obj_radius (float dist_sq) {
+	return sqrtf (dist_sq) * (1.0f + 4.0f * FLT_EPSILON);
+}
+
+struct obj_expand_job {
+	const obj_text* t;
+	float* points;
+	float* tex_coords;
+	float* normals;
+	int corner_count;
+	// per block of OBJ_EXPAND_GRAIN corners, the first bad corner or -1
+	int* first_bad;
+	// sphere centre in, and per block the furthest squared distance out
+	const obj_bounds* bounds;
+	float* dist_sq;
+};
+
+static void expand_blocks (void* ctx, size_t begin, size_t end) {
+	obj_expand_job* job = (obj_expand_job*)ctx;
+	const obj_text& t = *job->t;
+	const float* vp = (const float*)t.vp.data;
+	const float* vt = (const float*)t.vt.data;
+	const float* vn = (const float*)t.vn.data;
+	const int* faces = (const int*)t.faces.data;
+	int vp_count = (int)t.vp.count / 3;
+	int vt_count = (int)t.vt.count / 2;
+	int vn_count = (int)t.vn.count / 3;
+	for (size_t b = begin; b < end; b++) {
+		size_t first = b * OBJ_EXPAND_GRAIN;
+		size_t last = first + OBJ_EXPAND_GRAIN;
+		if (last > (size_t)job->corner_count) {
+			last = (size_t)job->corner_count;
+		}
+		job->first_bad[b] = -1;
+		float most = 0.0f;
+		for (size_t i = first; i < last; i++) {
+			const int* c = faces + i * 3;
+			if (bad_corner_part (c, vp_count, vt_count, vn_count) >= 0) {
+				job->first_bad[b] = (int)i;
+				break;
+			}
+			memcpy (job->points + i * 3, vp + (size_t)(c[0] - 1) * 3,
+				3 * sizeof (float));
+			memcpy (job->tex_coords + i * 2, vt + (size_t)(c[1] - 1) * 2,
+				2 * sizeof (float));
+			memcpy (job->normals + i * 3, vn + (size_t)(c[2] - 1) * 3,
+				3 * sizeof (float));
+			float d = obj_dist_sq (*job->bounds, job->points + i * 3);
+			if (d > most) {
+				most = d;
+			}
+		}
+		job->dist_sq[b] = most;
+	}
+}
+
+/* turn the faces into un-indexed points, tex coords and normals, and find
+their bounds. blocks of corners are done in parallel, and an out-of-range
+index is reported for the first bad corner in the file, as a single pass
+would */
+static bool expand_obj_faces (const obj_text& t, float*& points,
+	float*& tex_coords, float*& normals, int& point_count, obj_bounds& bounds) {
+	int vp_count = (int)t.vp.count / 3;
+	int vt_count = (int)t.vt.count / 2;
+	int vn_count = (int)t.vn.count / 3;
+	points = tex_coords = normals = NULL;
+	// point_count is an int. anything bigger has to be streamed
+	if (t.faces.count / 3 > 2147483647u) {
+		fprintf (stderr, "ERROR: obj has over 2^31 points. use stream_obj_file\n");
+		return false;
+	}
+	int face_count = (int)(t.faces.count / 9);
+	printf (
+		"found %i vp %i vt %i vn unique in obj. allocating memory...\n",
+		vp_count, vt_count, vn_count
+	);
+	points = (float*)malloc ((size_t)face_count * 3 * 3 * sizeof (float));
+	tex_coords = (float*)malloc ((size_t)face_count * 3 * 2 * sizeof (float));
+	normals = (float*)malloc ((size_t)face_count * 3 * 3 * sizeof (float));
+	printf (
+		"allocated %zu bytes for mesh\n",
+		(size_t)face_count * 3 * 8 * sizeof (float)
+	);
+	point_count = 0;
+	obj_expand_job job;
+	job.t = &t;
+	job.points = points;
+	job.tex_coords = tex_coords;
+	job.normals = normals;
+	job.corner_count = face_count * 3;
+	size_t num_blocks = ((size_t)job.corner_count + OBJ_EXPAND_GRAIN - 1) /
+		OBJ_EXPAND_GRAIN;
+	job.first_bad = (int*)malloc (num_blocks * sizeof (int) + 1);
+	job.dist_sq = (float*)malloc (num_blocks * sizeof (float) + 1);
+	start_obj_bounds (t, bounds);
+	job.bounds = &bounds;
+	bool ok = points && tex_coords && normals && job.first_bad && job.dist_sq;
+	if (!ok) {
+		fprintf (stderr, "ERROR: out of memory loading obj\n");
+	} else {
+		parallel_for (num_blocks, 1, expand_blocks, &job);
+	}
+	for (size_t b = 0; ok && b < num_blocks; b++) {
+		if (job.first_bad[b] >= 0) {
+			const int* c = (const int*)t.faces.data + (size_t)job.first_bad[b] * 3;
+			print_bad_corner (c, bad_corner_part (c, vp_count, vt_count, vn_count));
+			ok = false;
+		}
+	}
+	float most = 0.0f;
+	for (size_t b = 0; ok && b < num_blocks; b++) {
+		if (job.dist_sq[b] > most) {
+			most = job.dist_sq[b];
+		}
+	}
+	bounds.radius = obj_radius (most);
+	free (job.first_bad);
+	free (job.dist_sq);
+	if (!ok) {
+		free (points);
+		free (tex_coords);
+		free (normals);
+		points = tex_coords = normals = NULL;
+		return false;
+	}
+	point_count = job.corner_count;
+	return true;
+}
+
+static double obj_now_seconds () {
+	timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+// what the mesh cache remembers about the obj it was made from
+struct obj_source {
+	uint64_t size;
+	int64_t mtime_ns;
+	uint64_t hash;
+};
+
+static bool g_obj_cache = true;
+
+void set_obj_cache (bool enabled) {
+	g_obj_cache = enabled;
+}
+
+/* 8 bytes at a time, multiply and fold. not cryptographic, it only has to
+notice that a file changed */
+static uint64_t hash_obj_bytes (const char* data, size_t size) {
+	uint64_t h = 0x84222325CBF29CE4ull ^ (uint64_t)size;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t w;
+		memcpy (&w, data + i, 8);
+		h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+		h ^= h >> 32;
+	}
+	for (; i < size; i++) {
+		h = (h ^ (unsigned char)data[i]) * 0x100000001B3ull;
+	}
+	return h ^ (h >> 29);
+}
+
+static void stat_to_source (const struct stat& st, obj_source* src) {
+	src->size = (uint64_t)st.st_size;
+	src->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 +
+		(int64_t)st.st_mtim.tv_nsec;
+	src->hash = 0;
+}
+
+/* maps the file and parses it into text. src gets the file's size and mtime,
+and its hash when the mesh cache is on */
+static bool read_obj_text (const char* file_name, obj_text& text,
+	obj_source* src) {
+	memset (&text, 0, sizeof (text));
+	memset (src, 0, sizeof (*src));
+	int fd = open (file_name, O_RDONLY);
+	if (fd < 0) {
+		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
+		return false;
+	}
+	struct stat st;
+	if (fstat (fd, &st) != 0) {
+		fprintf (stderr, "ERROR: could not stat file %s\n", file_name);
+		close (fd);
+		return false;
+	}
+	stat_to_source (st, src);
+	size_t size = (size_t)st.st_size;
+	const char* data = NULL;
+	// mmap won't do 0 bytes. an empty file is just an empty mesh
+	if (size > 0) {
+		void* map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED == map) {
+			fprintf (stderr, "ERROR: could not map file %s\n", file_name);
+			close (fd);
+			return false;
+		}
+		data = (const char*)map;
+		madvise (map, size, MADV_SEQUENTIAL);
+	}
+	close (fd);
+	if (g_obj_cache) {
+		src->hash = hash_obj_bytes (data, size);
+	}
+	bool ok = parse_obj_text (data, size, text);
+	if (data) {
+		munmap ((void*)data, size);
+	}
+	return ok;
+}
+
+static void free_obj_text (obj_text& text) {
+	free (text.vp.data);
+	free (text.vt.data);
+	free (text.vn.data);
+	free (text.faces.data);
+	memset (&text, 0, sizeof (text));
+}
+
+static void print_obj_speed (const char* what, int count, size_t size,
+	double seconds) {
+	printf (
+		"allocated %i %s. read %.1f MB in %.1f ms (%.0f MB/s)\n",
+		count, what, (double)size / 1e6, seconds * 1e3,
+		(double)size / 1e6 / (seconds > 0.0 ? seconds : 1e-9)
+	);
+}
+
+/*-------------------------------INDEXED LOADER-------------------------------*/
+/* each distinct v/t/n corner becomes one vertex. corners are looked up in an
+open-addressed hash table of vertex numbers, sized to at least twice the
+number of corners so probes stay short */
+static unsigned int hash_corner (const int* c) {
+	unsigned int h = (unsigned int)c[0] * 0x9E3779B1u;
+	h ^= (unsigned int)c[1] * 0x85EBCA77u + (h << 6) + (h >> 2);
+	h ^= (unsigned int)c[2] * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+	return h ^ (h >> 15);
+}
+
+static bool index_obj_faces (const obj_text& t, obj_mesh& mesh) {
+	const float* vp = (const float*)t.vp.data;
+	const float* vt = (const float*)t.vt.data;
+	const float* vn = (const float*)t.vn.data;
+	const int* faces = (const int*)t.faces.data;
+	int vp_count = (int)t.vp.count / 3;
+	int vt_count = (int)t.vt.count / 2;
+	int vn_count = (int)t.vn.count / 3;
+	int corner_count = (int)t.faces.count / 3;
+
+	size_t table_size = 16;
+	while (table_size < (size_t)corner_count * 2) {
+		table_size *= 2;
+	}
+	int* table = (int*)malloc (table_size * sizeof (int));
+	unsigned int* indices = (unsigned int*)malloc (
+		(corner_count > 0 ? corner_count : 1) * sizeof (unsigned int));
+	// the first corner that made each vertex, so we can compare keys
+	int* first_corner = (int*)malloc (
+		(corner_count > 0 ? corner_count : 1) * sizeof (int));
+	if (!table || !indices || !first_corner) {
+		fprintf (stderr, "ERROR: out of memory indexing obj\n");
+		free (table);
+		free (indices);
+		free (first_corner);
+		return false;
+	}
+	memset (table, 0xFF, table_size * sizeof (int));
+	int vertex_count = 0;
+	bool ok = true;
+	for (int i = 0; i < corner_count; i++) {
+		const int* c = faces + i * 3;
+		int bad = bad_corner_part (c, vp_count, vt_count, vn_count);
+		if (bad >= 0) {
+			print_bad_corner (c, bad);
+			ok = false;
+			break;
+		}
+		size_t slot = hash_corner (c) & (table_size - 1);
+		while (table[slot] >= 0) {
+			const int* other = faces + first_corner[table[slot]] * 3;
+			if (other[0] == c[0] && other[1] == c[1] && other[2] == c[2]) {
+				break;
+			}
+			slot = (slot + 1) & (table_size - 1);
+		}
+		if (table[slot] < 0) {
+			table[slot] = vertex_count;
+			first_corner[vertex_count++] = i;
+		}
+		indices[i] = (unsigned int)table[slot];
+	}
+	free (table);
+	if (!ok) {
+		free (indices);
+		free (first_corner);
+		return false;
+	}
+
+	// 16-bit indices whenever they reach, which halves the index buffer
+	int index_size = vertex_count <= 65536 ? 2 : 4;
+	if (!alloc_obj_mesh (mesh, vertex_count, corner_count, index_size, NULL, 0)) {
+		free (indices);
+		free (first_corner);
+		return false;
+	}
+	start_obj_bounds (t, mesh.bounds);
+	float most = 0.0f;
+	for (int v = 0; v < vertex_count; v++) {
+		const int* c = faces + first_corner[v] * 3;
+		memcpy (mesh.points + v * 3, vp + (c[0] - 1) * 3, 3 * sizeof (float));
+		memcpy (mesh.tex_coords + v * 2, vt + (c[1] - 1) * 2, 2 * sizeof (float));
+		memcpy (mesh.normals + v * 3, vn + (c[2] - 1) * 3, 3 * sizeof (float));
+		float d = obj_dist_sq (mesh.bounds, mesh.points + v * 3);
+		if (d > most) {
+			most = d;
+		}
+	}
+	mesh.bounds.radius = obj_radius (most);
+	free (first_corner);
+	if (2 == index_size) {
+		unsigned short* shorts = (unsigned short*)mesh.indices;
+		for (int i = 0; i < corner_count; i++) {
+			shorts[i] = (unsigned short)indices[i];
+		}
+	} else {
+		memcpy (mesh.indices, indices, (size_t)corner_count * sizeof (unsigned int));
+	}
+	free (indices);
+	return true;
+}
+
+/*---------------------------------MESH CACHE---------------------------------*/
+/* the indexed mesh is saved next to the obj as file_name OBJ_CACHE_EXT:
+  a mesh_cache_header, then the points, tex coords, normals and indices, then
+  the index buffer of each lod, each starting on an OBJ_MESH_ALIGN boundary
+  so it can go straight to glBufferData out of the mapping.
+the header has the obj's size, mtime and hash. a cache is used if the size and
+mtime match, or if only the mtime changed but the hash is the same (the obj was
+touched or copied), in which case the cache is rewritten with the new mtime.
+caches are written to a temporary file and renamed over the old one, which is
+atomic, so another process either maps the old complete file or the new one -
+never half a file. once written a cache is never modified, and it's mapped
+read-only, so any number of processes can share it */
+#define MESH_CACHE_MAGIC "OBJMESH"
+#define MESH_CACHE_VERSION 3
+// written as a native uint32. reads back differently on the other endianness
+#define MESH_CACHE_ENDIAN 0x01020304u
+
+struct mesh_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	uint64_t header_size;
+	uint64_t file_size;
+	uint64_t source_size;
+	int64_t source_mtime_ns;
+	uint64_t source_hash;
+	uint64_t vertex_count;
+	uint64_t index_count;
+	uint64_t index_size;
+	obj_bounds bounds;
+	// from the start of the file
+	uint64_t points_offset;
+	uint64_t tex_coords_offset;
+	uint64_t normals_offset;
+	uint64_t indices_offset;
+	uint64_t lod_count;
+	uint64_t lod_index_count[MAX_MESH_LODS];
+	uint64_t lod_offset[MAX_MESH_LODS];
+	float lod_error[MAX_MESH_LODS];
+};
+
+static uint64_t align_cache_offset (uint64_t offset) {
+	return (offset + OBJ_MESH_ALIGN - 1) & ~(uint64_t)(OBJ_MESH_ALIGN - 1);
+}
+
+static void mesh_cache_name (const char* file_name, char* out, size_t size) {
+	snprintf (out, size, "%s%s", file_name, OBJ_CACHE_EXT);
+}
+
+/* lays the streams out from offset and puts the end in file_size. a mesh's
+arena is laid out the same, from 0 */
+static void layout_mesh_streams (mesh_cache_header& h, uint64_t offset) {
+	offset = align_cache_offset (offset);
+	h.points_offset = offset;
+	offset = align_cache_offset (offset + h.vertex_count * 3 * sizeof (float));
+	h.tex_coords_offset = offset;
+	offset = align_cache_offset (offset + h.vertex_count * 2 * sizeof (float));
+	h.normals_offset = offset;
+	offset = align_cache_offset (offset + h.vertex_count * 3 * sizeof (float));
+	h.indices_offset = offset;
+	offset += h.index_count * h.index_size;
+	for (uint64_t i = 0; i < MAX_MESH_LODS; i++) {
+		offset = align_cache_offset (offset);
+		h.lod_offset[i] = i < h.lod_count ? offset : 0;
+		offset += i < h.lod_count ? h.lod_index_count[i] * h.index_size : 0;
+	}
+	h.file_size = offset;
+}
+
+// lays the streams out after the header and works out the file size
+static void layout_mesh_cache (mesh_cache_header& h) {
+	layout_mesh_streams (h, sizeof (h));
+}
+
+static bool write_cache_stream (int fd, uint64_t offset, const void* data,
+	uint64_t size) {
+	const char* p = (const char*)data;
+	while (size > 0) {
+		ssize_t n = pwrite (fd, p, size, (off_t)offset);
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		offset += n;
+		size -= n;
+	}
+	return true;
+}
+
+/* a failed write only costs the next load a parse, so it's a warning. the
+gaps between streams are left as holes, which read back as zeros */
+static bool write_mesh_cache (const char* file_name, const obj_source& src,
+	const obj_mesh& mesh) {
+	char cache_name[4096], tmp_name[4096 + 32];
+	mesh_cache_name (file_name, cache_name, sizeof (cache_name));
+	snprintf (tmp_name, sizeof (tmp_name), "%s.tmp%ld", cache_name,
+		(long)getpid ());
+	mesh_cache_header h;
+	memset (&h, 0, sizeof (h));
+	memcpy (h.magic, MESH_CACHE_MAGIC, sizeof (MESH_CACHE_MAGIC));
+	h.version = MESH_CACHE_VERSION;
+	h.endian = MESH_CACHE_ENDIAN;
+	h.header_size = sizeof (h);
+	h.source_size = src.size;
+	h.source_mtime_ns = src.mtime_ns;
+	h.source_hash = src.hash;
+	h.vertex_count = (uint64_t)mesh.vertex_count;
+	h.index_count = (uint64_t)mesh.index_count;
+	h.index_size = (uint64_t)mesh.index_size;
+	h.bounds = mesh.bounds;
+	h.lod_count = (uint64_t)mesh.lod_count;
+	for (int i = 0; i < mesh.lod_count; i++) {
+		h.lod_index_count[i] = (uint64_t)mesh.lods[i].index_count;
+		h.lod_error[i] = mesh.lods[i].error;
+	}
+	layout_mesh_cache (h);
+
+	int fd = open (tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf (stderr, "WARNING: could not write mesh cache %s\n", cache_name);
+		return false;
+	}
+	bool ok = 0 == ftruncate (fd, (off_t)h.file_size) &&
+		write_cache_stream (fd, 0, &h, sizeof (h)) &&
+		write_cache_stream (fd, h.points_offset, mesh.points,
+			h.vertex_count * 3 * sizeof (float)) &&
+		write_cache_stream (fd, h.tex_coords_offset, mesh.tex_coords,
+			h.vertex_count * 2 * sizeof (float)) &&
+		write_cache_stream (fd, h.normals_offset, mesh.normals,
+			h.vertex_count * 3 * sizeof (float)) &&
+		write_cache_stream (fd, h.indices_offset, mesh.indices,
+			h.index_count * h.index_size);
+	for (int i = 0; ok && i < mesh.lod_count; i++) {
+		ok = write_cache_stream (fd, h.lod_offset[i], mesh.lods[i].indices,
+			h.lod_index_count[i] * h.index_size);
+	}
+	ok &= 0 == close (fd);
+	if (ok) {
+		ok = 0 == rename (tmp_name, cache_name);
+	}
+	if (!ok) {
+		unlink (tmp_name);
+		fprintf (stderr, "WARNING: could not write mesh cache %s\n", cache_name);
+	}
+	return ok;
+}
+
+static bool hash_obj_file (const char* file_name, uint64_t size, uint64_t* hash) {
+	if (0 == size) {
+		*hash = hash_obj_bytes (NULL, 0);
+		return true;
+	}
+	int fd = open (file_name, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	void* map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (MAP_FAILED == map) {
+		return false;
+	}
+	*hash = hash_obj_bytes ((const char*)map, size);
+	munmap (map, size);
+	return true;
+}
+
+template <typename T>
+static bool indices_in_range (const T* indices, int count, int vertex_count) {
+	T max = 0;
+	for (int i = 0; i < count; i++) {
+		max = indices[i] > max ? indices[i] : max;
+	}
+	return 0 == count || (int64_t)max < (int64_t)vertex_count;
+}
+
+// everything in the header that doesn't depend on the obj
+static bool mesh_cache_header_ok (const mesh_cache_header& h, uint64_t size) {
+	if (0 != memcmp (h.magic, MESH_CACHE_MAGIC, sizeof (MESH_CACHE_MAGIC)) ||
+		h.version != MESH_CACHE_VERSION || h.endian != MESH_CACHE_ENDIAN ||
+		h.header_size != sizeof (h) || h.file_size != size) {
+		return false;
+	}
+	if ((h.index_size != 2 && h.index_size != 4) ||
+		h.vertex_count > 0x7FFFFFFF || h.index_count > 0x7FFFFFFF ||
+		h.index_count % 3 != 0 || (2 == h.index_size && h.vertex_count > 65536) ||
+		h.lod_count > MAX_MESH_LODS) {
+		return false;
+	}
+	for (uint64_t i = 0; i < h.lod_count; i++) {
+		if (h.lod_index_count[i] > 0x7FFFFFFF || h.lod_index_count[i] % 3 != 0) {
+			return false;
+		}
+	}
+	// the streams must be exactly where we'd have put them
+	mesh_cache_header expected = h;
+	layout_mesh_cache (expected);
+	return expected.points_offset == h.points_offset &&
+		expected.tex_coords_offset == h.tex_coords_offset &&
+		expected.normals_offset == h.normals_offset &&
+		expected.indices_offset == h.indices_offset &&
+		0 == memcmp (expected.lod_offset, h.lod_offset, sizeof (h.lod_offset)) &&
+		expected.file_size == h.file_size;
+}
+
+static bool index_buffer_ok (const void* indices, int count, int index_size,
+	int vertex_count) {
+	if (2 == index_size) {
+		return indices_in_range ((const unsigned short*)indices, count,
+			vertex_count);
+	}
+	return indices_in_range ((const unsigned int*)indices, count, vertex_count);
+}
+
+
+/* maps a fresh cache of file_name into mesh. false, quietly, if there isn't one
+or it's stale or damaged */
+static bool map_mesh_cache (const char* file_name, obj_mesh& mesh) {
+	memset (&mesh, 0, sizeof (mesh));
+	struct stat st;
+	if (0 != stat (file_name, &st)) {
+		return false;
+	}
+	obj_source src;
+	stat_to_source (st, &src);
+	char cache_name[4096];
+	mesh_cache_name (file_name, cache_name, sizeof (cache_name));
+	int fd = open (cache_name, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat cache_st;
+	if (0 != fstat (fd, &cache_st) ||
+		(uint64_t)cache_st.st_size < sizeof (mesh_cache_header)) {
+		close (fd);
+		return false;
+	}
+	size_t size = (size_t)cache_st.st_size;
+	void* map = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (MAP_FAILED == map) {
+		return false;
+	}
+	mesh_cache_header h;
+	memcpy (&h, map, sizeof (h));
+	bool ok = mesh_cache_header_ok (h, size) && h.source_size == src.size;
+	bool touched = ok && h.source_mtime_ns != src.mtime_ns;
+	if (touched) {
+		ok = hash_obj_file (file_name, src.size, &src.hash) &&
+			src.hash == h.source_hash;
+	}
+	if (ok) {
+		const char* base = (const char*)map;
+		mesh.points = (float*)(base + h.points_offset);
+		mesh.tex_coords = (float*)(base + h.tex_coords_offset);
+		mesh.normals = (float*)(base + h.normals_offset);
+		mesh.indices = (void*)(base + h.indices_offset);
+		mesh.vertex_count = (int)h.vertex_count;
+		mesh.index_count = (int)h.index_count;
+		mesh.index_size = (int)h.index_size;
+		mesh.bounds = h.bounds;
+		mesh.mapping = map;
+		mesh.mapping_size = size;
+		mesh.lod_count = (int)h.lod_count;
+		for (int i = 0; i < mesh.lod_count; i++) {
+			mesh.lods[i].indices = (void*)(base + h.lod_offset[i]);
+			mesh.lods[i].index_count = (int)h.lod_index_count[i];
+			mesh.lods[i].error = h.lod_error[i];
+		}
+		// a bad index would have GL read past the buffers
+		ok = index_buffer_ok (mesh.indices, mesh.index_count, mesh.index_size,
+			mesh.vertex_count);
+		for (int i = 0; ok && i < mesh.lod_count; i++) {
+			ok = index_buffer_ok (mesh.lods[i].indices, mesh.lods[i].index_count,
+				mesh.index_size, mesh.vertex_count);
+		}
+	}
+	if (!ok) {
+		munmap (map, size);
+		memset (&mesh, 0, sizeof (mesh));
+		return false;
+	}
+	// same contents, new mtime. save re-hashing it next time
+	if (touched) {
+		write_mesh_cache (file_name, src, mesh);
+	}
+	return true;
+}
+
+bool save_mesh_cache (const char* file_name, const obj_mesh& mesh) {
+	struct stat st;
+	if (0 != stat (file_name, &st)) {
+		fprintf (stderr, "ERROR: could not stat file %s\n", file_name);
+		return false;
+	}
+	obj_source src;
+	stat_to_source (st, &src);
+	if (!hash_obj_file (file_name, src.size, &src.hash)) {
+		fprintf (stderr, "ERROR: could not read file %s\n", file_name);
+		return false;
+	}
+	return write_mesh_cache (file_name, src, mesh);
+}
+
+/*-----------------------------------LOADERS----------------------------------*/
+static void print_cache_speed (const char* what, int count, size_t size,
+	double seconds) {
+	printf (
+		"mapped %i %s from mesh cache (%.1f MB) in %.1f ms\n",
+		count, what, (double)size / 1e6, seconds * 1e3
+	);
+}
+
+bool load_obj_file (const char* file_name,
+					float*& points,
+					float*& tex_coords,
+					float*& normals,
+					int& point_count,
+					obj_bounds* bounds) {
+	double start = obj_now_seconds ();
+	obj_mesh cached;
+	if (g_obj_cache && map_mesh_cache (file_name, cached)) {
+		// expand the shared vertices back out through the indices
+		point_count = cached.index_count;
+		points = (float*)malloc (3 * point_count * sizeof (float) + 1);
+		tex_coords = (float*)malloc (2 * point_count * sizeof (float) + 1);
+		normals = (float*)malloc (3 * point_count * sizeof (float) + 1);
+		for (int i = 0; points && tex_coords && normals && i < point_count; i++) {
+			int v = (int)obj_mesh_index (cached.indices, cached.index_size, i);
+			memcpy (points + i * 3, cached.points + v * 3, 3 * sizeof (float));
+			memcpy (tex_coords + i * 2, cached.tex_coords + v * 2, 2 * sizeof (float));
+			memcpy (normals + i * 3, cached.normals + v * 3, 3 * sizeof (float));
+		}
+		size_t cache_size = cached.mapping_size;
+		if (bounds) {
+			*bounds = cached.bounds;
+		}
+		free_obj_mesh (cached);
+		if (points && tex_coords && normals) {
+			print_cache_speed ("points", point_count, cache_size,
+				obj_now_seconds () - start);
+			return true;
+		}
+		fprintf (stderr, "ERROR: out of memory loading obj\n");
+		free (points);
+		free (tex_coords);
+		free (normals);
+		points = tex_coords = normals = NULL;
+		return false;
+	}
+
+	obj_text text;
+	obj_source src;
+	obj_bounds parsed_bounds;
+	bool ok = read_obj_text (file_name, text, &src);
+	if (ok) {
+		ok = expand_obj_faces (text, points, tex_coords, normals, point_count,
+			parsed_bounds);
+	}
+	if (ok && bounds) {
+		*bounds = parsed_bounds;
+	}
+	// the first load pays for indexing too, so the next one needn't parse
+	obj_mesh mesh;
+	if (ok && g_obj_cache && index_obj_faces (text, mesh)) {
+		write_mesh_cache (file_name, src, mesh);
+		free_obj_mesh (mesh);
+	}
+	free_obj_text (text);
+	if (!ok) {
+		return false;
+	}
+	print_obj_speed ("points", point_count, src.size, obj_now_seconds () - start);
+	return true;
+}
+
+bool load_obj_file_indexed (const char* file_name, obj_mesh& mesh) {
+	double start = obj_now_seconds ();
+	if (g_obj_cache && map_mesh_cache (file_name, mesh)) {
+		print_cache_speed ("vertices", mesh.vertex_count, mesh.mapping_size,
+			obj_now_seconds () - start);
+		return true;
+	}
+	memset (&mesh, 0, sizeof (mesh));
+	obj_text text;
+	obj_source src;
+	bool ok = read_obj_text (file_name, text, &src);
+	if (ok) {
+		ok = index_obj_faces (text, mesh);
+	}
+	int corner_count = (int)text.faces.count / 3;
+	free_obj_text (text);
+	if (!ok) {
+		return false;
+	}
+	if (g_obj_cache) {
+		write_mesh_cache (file_name, src, mesh);
+	}
+	printf (
+		"%i corners share %i unique vertices (%.1fx), %i-bit indices\n",
+		corner_count, mesh.vertex_count,
+		mesh.vertex_count > 0 ? (double)corner_count / mesh.vertex_count : 0.0,
+		mesh.index_size * 8
+	);
+	print_obj_speed ("vertices", mesh.vertex_count, src.size,
+		obj_now_seconds () - start);
+	return true;
+}
+
+bool alloc_obj_mesh (obj_mesh& mesh, int vertex_count, int index_count,
+	int index_size, const int* lod_index_counts, int lod_count) {
+	memset (&mesh, 0, sizeof (mesh));
+	mesh_cache_header h;
+	memset (&h, 0, sizeof (h));
+	h.vertex_count = (uint64_t)vertex_count;
+	h.index_count = (uint64_t)index_count;
+	h.index_size = (uint64_t)index_size;
+	h.lod_count = (uint64_t)lod_count;
+	for (int i = 0; i < lod_count; i++) {
+		h.lod_index_count[i] = (uint64_t)lod_index_counts[i];
+	}
+	layout_mesh_streams (h, 0);
+	void* arena = NULL;
+	if (0 != posix_memalign (&arena, OBJ_MESH_ALIGN, (size_t)h.file_size + 1)) {
+		fprintf (stderr, "ERROR: out of memory allocating mesh\n");
+		return false;
+	}
+	char* base = (char*)arena;
+	mesh.arena = arena;
+	mesh.points = (float*)(base + h.points_offset);
+	mesh.tex_coords = (float*)(base + h.tex_coords_offset);
+	mesh.normals = (float*)(base + h.normals_offset);
+	mesh.indices = (void*)(base + h.indices_offset);
+	mesh.vertex_count = vertex_count;
+	mesh.index_count = index_count;
+	mesh.index_size = index_size;
+	mesh.lod_count = lod_count;
+	for (int i = 0; i < lod_count; i++) {
+		mesh.lods[i].indices = (void*)(base + h.lod_offset[i]);
+		mesh.lods[i].index_count = lod_index_counts[i];
+	}
+	return true;
+}
+
+bool detach_obj_mesh (obj_mesh& mesh) {
+	if (!mesh.mapping) {
+		return true;
+	}
+	int lod_index_counts[MAX_MESH_LODS];
+	for (int i = 0; i < mesh.lod_count; i++) {
+		lod_index_counts[i] = mesh.lods[i].index_count;
+	}
+	obj_mesh owned;
+	if (!alloc_obj_mesh (owned, mesh.vertex_count, mesh.index_count,
+		mesh.index_size, lod_index_counts, mesh.lod_count)) {
+		return false;
+	}
+	size_t v = (size_t)mesh.vertex_count;
+	memcpy (owned.points, mesh.points, v * 3 * sizeof (float));
+	memcpy (owned.tex_coords, mesh.tex_coords, v * 2 * sizeof (float));
+	memcpy (owned.normals, mesh.normals, v * 3 * sizeof (float));
+	memcpy (owned.indices, mesh.indices, (size_t)mesh.index_count * mesh.index_size);
+	for (int i = 0; i < mesh.lod_count; i++) {
+		memcpy (owned.lods[i].indices, mesh.lods[i].indices,
+			(size_t)mesh.lods[i].index_count * mesh.index_size);
+		owned.lods[i].error = mesh.lods[i].error;
+	}
+	owned.bounds = mesh.bounds;
+	free_obj_mesh (mesh);
+	mesh = owned;
+	return true;
+}
+
+void free_obj_mesh (obj_mesh& mesh) {
+	if (mesh.mapping) {
+		munmap (mesh.mapping, mesh.mapping_size);
+	}
+	free (mesh.arena);
+	memset (&mesh, 0, sizeof (mesh));
+}
+
+/*---------------------------------STREAMING----------------------------------*/
+/* memory doesn't grow with the file. the file is read through a fixed buffer
+with pread rather than mapped, so untouched pages never count against us.
+  pass 1 reads the whole file once, counts each kind of line, checks the
+  faces' layout, and notes the file offset of every window's first line.
+  pass 2 reads the faces in order a batch at a time. each corner's v, vt and
+  vn are looked up in a window of that kind - a run of consecutive entries
+  parsed again from the file at the offset noted in pass 1. a kind small
+  enough to fit in one window is only ever parsed once.
+whatever budget is left after the read buffers and the batch is shared by the
+three windows. meshes that are mostly in file order (like Blender's) use each
+window for a long stretch of faces before moving on */
+
+// bytes per read buffer. a line can't be longer than this
+#define OBJ_STREAM_READ_BYTES (1 << 20)
+// the smallest window worth having, in entries
+#define OBJ_STREAM_MIN_WINDOW 1024
+/* windows per kind the budget reserves offsets for. more still works, but the
+offsets then grow past the budget, by 8 bytes a window */
+#define OBJ_STREAM_STARTS 4096
+
+struct obj_reader {
+	int fd;
+	uint64_t file_size;
+	char* buf;
+	// file offset of buf[0], bytes in buf, and where the next line starts
+	uint64_t buf_offset;
+	size_t len;
+	size_t pos;
+	bool failed;
+};
+
+static void seek_obj_reader (obj_reader& r, uint64_t offset) {
+	r.buf_offset = offset;
+	r.len = r.pos = 0;
+}
+
+/* the next line as [*line, *eol), with the file offset it starts at. valid
+until the next call. false at the end of the file, or with failed set on an
+error */
+static bool read_obj_line (obj_reader& r, const char** line, const char** eol,
+	uint64_t* offset) {
+	for (;;) {
+		char* start = r.buf + r.pos;
+		char* nl = (char*)memchr (start, '\n', r.len - r.pos);
+		if (nl) {
+			*line = start;
+			*eol = nl;
+			*offset = r.buf_offset + r.pos;
+			r.pos = nl + 1 - r.buf;
+			return true;
+		}
+		if (r.buf_offset + r.len >= r.file_size) {
+			if (r.pos == r.len) {
+				return false;
+			}
+			// last line has no newline. there's a spare byte to give it one
+			r.buf[r.len] = '\n';
+			*line = start;
+			*eol = r.buf + r.len;
+			*offset = r.buf_offset + r.pos;
+			r.pos = r.len;
+			return true;
+		}
+		// keep the partial line and read more after it
+		size_t keep = r.len - r.pos;
+		if (keep == OBJ_STREAM_READ_BYTES) {
+			fprintf (stderr, "ERROR: obj line longer than %i bytes\n",
+				OBJ_STREAM_READ_BYTES);
+			r.failed = true;
+			return false;
+		}
+		memmove (r.buf, start, keep);
+		r.buf_offset += r.pos;
+		r.pos = 0;
+		r.len = keep;
+		ssize_t n = pread (r.fd, r.buf + keep, OBJ_STREAM_READ_BYTES - keep,
+			(off_t)(r.buf_offset + keep));
+		if (n <= 0) {
+			fprintf (stderr, "ERROR: could not read obj\n");
+			r.failed = true;
+			return false;
+		}
+		r.len += (size_t)n;
+	}
+}
+
+// entries [first, first + count) of one kind of line, parsed from the file
+struct obj_window {
+	obj_line_kind kind;
+	int floats;
+	float* data;
+	uint64_t capacity;
+	uint64_t first;
+	uint64_t count;
+	// file offset of the first line of each window
+	obj_array starts;
+	uint64_t total;
+	uint64_t loads;
+};
+
+// parses window number w of this kind into the window, from the file
+static bool load_obj_window (obj_window& win, obj_reader& r, uint64_t w) {
+	if (win.count > 0 && win.first == w * win.capacity) {
+		return true;
+	}
+	seek_obj_reader (r, ((const uint64_t*)win.starts.data)[w]);
+	win.first = w * win.capacity;
+	win.count = 0;
+	win.loads++;
+	uint64_t want = win.total - win.first;
+	if (want > win.capacity) {
+		want = win.capacity;
+	}
+	const char* line;
+	const char* eol;
+	uint64_t offset;
+	while (win.count < want && read_obj_line (r, &line, &eol, &offset)) {
+		if (classify_obj_line (line, eol) == win.kind) {
+			float* f = win.data + win.count * win.floats;
+			memset (f, 0, win.floats * sizeof (float));
+			parse_floats (line + (OBJ_LINE_V == win.kind ? 1 : 2), eol, f,
+				win.floats);
+			win.count++;
+		}
+	}
+	return win.count == want;
+}
+
+// copies the corners whose entry is in the loaded window. returns how many
+static size_t fill_from_obj_window (const obj_window& win,
+	const long long* corners, size_t corner_count, float* out) {
+	size_t filled = 0;
+	for (size_t i = 0; i < corner_count; i++) {
+		uint64_t e = (uint64_t)(corners[i * 3] - 1);
+		if (e >= win.first && e < win.first + win.count) {
+			memcpy (out + i * win.floats, win.data + (e - win.first) * win.floats,
+				win.floats * sizeof (float));
+			filled++;
+		}
+	}
+	return filled;
+}
+
+/* out[i] = entry corners[i * 3] - 1, for every corner in the batch. the window
+already loaded goes first, then any others the batch needs, in file order */
+static bool gather_obj_window (obj_window& win, obj_reader& r,
+	const long long* corners, size_t corner_count, float* out) {
+	if (0 == corner_count) {
+		return true;
+	}
+	uint64_t lo = UINT64_MAX, hi = 0;
+	for (size_t i = 0; i < corner_count; i++) {
+		uint64_t w = (uint64_t)(corners[i * 3] - 1) / win.capacity;
+		lo = w < lo ? w : lo;
+		hi = w > hi ? w : hi;
+	}
+	size_t filled = 0;
+	bool have_loaded = win.count > 0;
+	uint64_t loaded = win.first / win.capacity;
+	if (have_loaded) {
+		filled = fill_from_obj_window (win, corners, corner_count, out);
+	}
+	for (uint64_t w = lo; w <= hi && filled < corner_count; w++) {
+		if (have_loaded && w == loaded) {
+			continue;
+		}
+		bool needed = false;
+		for (size_t i = 0; i < corner_count && !needed; i++) {
+			needed = (uint64_t)(corners[i * 3] - 1) / win.capacity == w;
+		}
+		if (!needed) {
+			continue;
+		}
+		if (!load_obj_window (win, r, w)) {
+			return false;
+		}
+		filled += fill_from_obj_window (win, corners, corner_count, out);
+	}
+	return filled == corner_count;
+}
+
+static void free_obj_stream (obj_reader* readers, obj_window* windows,
+	long long* corners, float* out) {
+	for (int i = 0; i < 2; i++) {
+		free (readers[i].buf);
+	}
+	for (int i = 0; i < 3; i++) {
+		free (windows[i].data);
+		free (windows[i].starts.data);
+	}
+	free (corners);
+	free (out);
+}
+
+bool stream_obj_file (const char* file_name, size_t batch_vertices,
+	size_t memory_budget, obj_batch_fn fn, void* ctx, obj_stream_info* info) {
+	double start = obj_now_seconds ();
+	obj_stream_info stats;
+	memset (&stats, 0, sizeof (stats));
+	if (info) {
+		*info = stats;
+	}
+	batch_vertices -= batch_vertices % 3;
+	if (0 == batch_vertices) {
+		fprintf (stderr, "ERROR: obj batches need room for at least 3 vertices\n");
+		return false;
+	}
+	// 8 floats out and 3 indices in per vertex of the batch
+	uint64_t batch_bytes = (uint64_t)batch_vertices *
+		(8 * sizeof (float) + 3 * sizeof (long long));
+	uint64_t fixed = 2 * (OBJ_STREAM_READ_BYTES + 1) + batch_bytes +
+		3 * OBJ_STREAM_STARTS * sizeof (uint64_t);
+	// each window entry is 3 + 2 + 3 floats across the three windows
+	uint64_t window_entries = memory_budget > fixed ?
+		(memory_budget - fixed) / (8 * sizeof (float)) : 0;
+	if (window_entries < OBJ_STREAM_MIN_WINDOW) {
+		fprintf (stderr,
+			"ERROR: memory budget of %zu bytes is too small for batches of %zu \
+vertices\n", memory_budget, batch_vertices);
+		return false;
+	}
+
+	int fd = open (file_name, O_RDONLY);
+	if (fd < 0) {
+		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
+		return false;
+	}
+	struct stat st;
+	if (fstat (fd, &st) != 0) {
+		fprintf (stderr, "ERROR: could not stat file %s\n", file_name);
+		close (fd);
+		return false;
+	}
+	posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	obj_reader readers[2];
+	obj_window windows[3];
+	memset (readers, 0, sizeof (readers));
+	memset (windows, 0, sizeof (windows));
+	for (int i = 0; i < 2; i++) {
+		readers[i].fd = fd;
+		readers[i].file_size = (uint64_t)st.st_size;
+		readers[i].buf = (char*)malloc (OBJ_STREAM_READ_BYTES + 1);
+	}
+	obj_reader& face_reader = readers[0];
+	obj_reader& window_reader = readers[1];
+	const obj_line_kind kinds[3] = { OBJ_LINE_V, OBJ_LINE_VT, OBJ_LINE_VN };
+	const int floats[3] = { 3, 2, 3 };
+	for (int k = 0; k < 3; k++) {
+		windows[k].kind = kinds[k];
+		windows[k].floats = floats[k];
+		windows[k].capacity = window_entries;
+	}
+	long long* corners = (long long*)malloc (batch_vertices * 3 *
+		sizeof (long long));
+	float* out = (float*)malloc (batch_vertices * 8 * sizeof (float));
+	bool ok = readers[0].buf && readers[1].buf && corners && out;
+	if (!ok) {
+		fprintf (stderr, "ERROR: out of memory streaming obj\n");
+	}
+
+	// pass 1: counts, face layout, and where each window starts
+	const char* line;
+	const char* eol;
+	uint64_t offset;
+	uint64_t face_count = 0;
+	while (ok && read_obj_line (face_reader, &line, &eol, &offset)) {
+		obj_line_kind kind = classify_obj_line (line, eol);
+		if (OBJ_LINE_F == kind) {
+			if (!parse_face (line, eol, corners)) {
+				print_face_error ();
+				ok = false;
+			}
+			face_count++;
+			continue;
+		}
+		for (int k = 0; k < 3; k++) {
+			obj_window& win = windows[k];
+			if (kind != win.kind) {
+				continue;
+			}
+			if (0 == win.total % win.capacity) {
+				if (0 == win.starts.capacity) {
+					win.starts.data = malloc (OBJ_STREAM_STARTS * sizeof (uint64_t));
+					win.starts.capacity = OBJ_STREAM_STARTS;
+				}
+				ok = win.starts.data &&
+					push_obj_array (win.starts, &offset, 1, sizeof (uint64_t));
+			}
+			win.total++;
+		}
+	}
+	ok &= !face_reader.failed;
+	// a kind that fits in one window gets only what it needs
+	uint64_t peak = fixed;
+	for (int k = 0; ok && k < 3; k++) {
+		obj_window& win = windows[k];
+		uint64_t entries = win.total < win.capacity ? win.total : win.capacity;
+		win.data = (float*)malloc (entries * win.floats * sizeof (float) + 1);
+		peak += entries * win.floats * sizeof (float);
+		if (win.starts.capacity > OBJ_STREAM_STARTS) {
+			peak += (win.starts.capacity - OBJ_STREAM_STARTS) * sizeof (uint64_t);
+		}
+		if (!win.data) {
+			fprintf (stderr, "ERROR: out of memory streaming obj\n");
+			ok = false;
+		}
+	}
+	stats.vp_count = windows[0].total;
+	stats.vt_count = windows[1].total;
+	stats.vn_count = windows[2].total;
+	stats.point_count = face_count * 3;
+	stats.file_size = (uint64_t)st.st_size;
+	stats.peak_bytes = peak;
+
+	// pass 2: the faces in order, a batch at a time
+	seek_obj_reader (face_reader, 0);
+	obj_vertex_batch batch;
+	memset (&batch, 0, sizeof (batch));
+	batch.points = out;
+	batch.tex_coords = out + batch_vertices * 3;
+	batch.normals = out + batch_vertices * 5;
+	batch.total = stats.point_count;
+	bool more = ok;
+	while (more) {
+		size_t n = 0;
+		while (n < batch_vertices &&
+			(more = read_obj_line (face_reader, &line, &eol, &offset))) {
+			if (OBJ_LINE_F != classify_obj_line (line, eol)) {
+				continue;
+			}
+			long long* c = corners + n * 3;
+			parse_face (line, eol, c);
+			for (int i = 0; i < 3 && more; i++) {
+				int bad = bad_corner_part (c + i * 3, (int64_t)stats.vp_count,
+					(int64_t)stats.vt_count, (int64_t)stats.vn_count);
+				if (bad >= 0) {
+					print_bad_corner (c + i * 3, bad);
+					more = ok = false;
+				}
+			}
+			n += 3;
+		}
+		ok &= !face_reader.failed;
+		if (!ok || 0 == n) {
+			break;
+		}
+		float* points = (float*)batch.points;
+		float* tex_coords = (float*)batch.tex_coords;
+		float* normals = (float*)batch.normals;
+		ok = gather_obj_window (windows[0], window_reader, corners, n, points) &&
+			gather_obj_window (windows[1], window_reader, corners + 1, n,
+				tex_coords) &&
+			gather_obj_window (windows[2], window_reader, corners + 2, n,
+				normals);
+		if (!ok) {
+			fprintf (stderr, "ERROR: could not read obj entries back\n");
+			break;
+		}
+		batch.count = n;
+		stats.batch_count++;
+		if (!fn (ctx, batch)) {
+			ok = false;
+			break;
+		}
+		batch.first += n;
+	}
+	close (fd);
+	for (int k = 0; k < 3; k++) {
+		stats.window_loads += windows[k].loads;
+	}
+	free_obj_stream (readers, windows, corners, out);
+	if (info) {
+		*info = stats;
+	}
+	if (!ok) {
+		return false;
+	}
+	double seconds = obj_now_seconds () - start;
+	printf (
+		"streamed %llu points in %llu batches. read %.1f MB in %.1f ms \
+(%.0f MB/s) using %.1f MiB\n",
+		(unsigned long long)stats.point_count,
+		(unsigned long long)stats.batch_count, (double)stats.file_size / 1e6,
+		seconds * 1e3, (double)stats.file_size / 1e6 / (seconds > 0.0 ? seconds :
+		1e-9), (double)stats.peak_bytes / (1 << 20)
+	);
+	return true;
+}
@@ -9,13 +9,181 @@
 #define OBJ_PARSER_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+// bytes of text per parse chunk, when a file is parsed on the thread pool
+#define OBJ_CHUNK_BYTES (1 << 20)
+// face corners per thread pool chunk when expanding faces
+#define OBJ_EXPAND_GRAIN 65536
+// the binary mesh cache of "mesh.obj" is "mesh.obj.meshcache"
+#define OBJ_CACHE_EXT ".meshcache"
+
+/* a box and a sphere around a mesh. the box is grown as the v lines are
+parsed, so it's around every position in the file, used by a face or not. the
+sphere is centred on the box and reaches the furthest point a face uses, found
+while the faces are copied out. neither costs a pass of its own. bounds.h has
+the same thing as aabb and bounding_sphere, and the maths on them */
+struct obj_bounds {
+	float min[3];
+	float max[3];
+	float centre[3];
+	float radius;
+};
+
+/* loads a triangulated obj with positions, texture coordinates and normals
+into un-indexed arrays, 3 points per face, and their bounds if bounds isn't
+NULL. the file is memory-mapped, files
+over OBJ_CHUNK_BYTES are parsed in chunks on the thread pool (see
+thread_pool.h, set_worker_count (1) for one thread), and the load speed is
+printed. the output is the same for any number of threads.
+the first load also writes a binary mesh cache next to the file, and later
+loads of the same, unchanged obj map that instead of parsing any text */
 bool load_obj_file(const char* file_name,
+				   float* &points,
+				   float* &tex_coords,
+				   float* &normals,
+				   int& point_count,
+				   obj_bounds* bounds = NULL);
+
+/* the original two-pass fgets/sscanf loader. same output, much slower. kept as
+a reference for checking the fast one */
+bool load_obj_file_stdio(const char* file_name,
 				   float* &points,
 				   float* &tex_coords,
 				   float* &normals,
 				   int& point_count);
 
+// most levels of detail a mesh can carry
+#define MAX_MESH_LODS 8
+
+/* a simpler version of the mesh. just an index buffer (of index_size) into the
+same vertices, see mesh_simplify.h */
+struct obj_lod {
+	void* indices;
+	int index_count;
+	// about how far the surface moved from the full mesh, in mesh units
+	float error;
+};
+
+// every array of an obj_mesh starts on a multiple of this many bytes
+#define OBJ_MESH_ALIGN 64
+
+/* one vertex per distinct v/t/n corner, and an index buffer of 3 indices per
+face. indices are unsigned shorts (index_size 2) when vertex_count <= 65536,
+otherwise unsigned ints (index_size 4), ready for glDrawElements.
+all of a mesh's arrays, lods included, are in one block: a malloc'd arena, or
+a read-only mapping of the mesh cache (mapping is non-NULL, so don't write to
+its arrays). either way free_obj_mesh() releases it in one go. the arrays are
+laid out the same in both, so loading many meshes costs one allocation each */
+struct obj_mesh {
+	float* points;
+	float* tex_coords;
+	float* normals;
+	int vertex_count;
+	void* indices;
+	int index_count;
+	int index_size;
+	// lods[0] is the first level below the full mesh
+	obj_lod lods[MAX_MESH_LODS];
+	int lod_count;
+	obj_bounds bounds;
+	void* arena;
+	void* mapping;
+	size_t mapping_size;
+};
+
+// index i of an index buffer of index_size 2 or 4, like obj_mesh's and its lods'
+inline unsigned int obj_mesh_index(const void* indices, int index_size,
+	size_t i) {
+	if (2 == index_size) {
+		return ((const unsigned short*)indices)[i];
+	}
+	return ((const unsigned int*)indices)[i];
+}
+
+inline void set_obj_mesh_index(void* indices, int index_size, size_t i,
+	unsigned int v) {
+	if (2 == index_size) {
+		((unsigned short*)indices)[i] = (unsigned short)v;
+	} else {
+		((unsigned int*)indices)[i] = v;
+	}
+}
+
+/* loads a triangulated obj like load_obj_file, but merges identical corners
+into shared vertices. uses and writes the mesh cache the same way. free the
+result with free_obj_mesh() */
+bool load_obj_file_indexed(const char* file_name, obj_mesh& mesh);
+void free_obj_mesh(obj_mesh& mesh);
+/* a mesh mapped from the mesh cache is read-only. this swaps its arrays for a
+copy in an arena so it can be changed. does nothing to any other mesh. false if
+out of memory */
+bool detach_obj_mesh(obj_mesh& mesh);
+/* gives mesh a new arena with room for the given counts, lod_index_counts
+having lod_count entries (it may be NULL if lod_count is 0). the arrays aren't
+initialised, the bounds and lod errors are 0. for code that builds a mesh, e.g.
+to change the lods of one, then swap it in after free_obj_mesh() on the old.
+false if out of memory */
+bool alloc_obj_mesh(obj_mesh& mesh, int vertex_count, int index_count,
+	int index_size, const int* lod_index_counts, int lod_count);
+
+/* rewrites file_name's mesh cache from mesh, e.g. after building lods or
+optimising it, so the next load maps that. false if it couldn't */
+bool save_mesh_cache(const char* file_name, const obj_mesh& mesh);
+
+/* turns the mesh cache on or off (it's on by default). when off, nothing is
+read from or written to cache files */
+void set_obj_cache(bool enabled);
+
+// one run of un-indexed vertices from stream_obj_file(), 3 per face
+struct obj_vertex_batch {
+	const float* points;
+	const float* tex_coords;
+	const float* normals;
+	// vertices in this batch, and where it starts in the whole mesh
+	size_t count;
+	uint64_t first;
+	// vertices in the whole mesh, known before the first batch
+	uint64_t total;
+};
+
+/* gets each batch in order. the arrays are reused for the next batch, so copy
+or upload them before returning. return false to stop loading */
+typedef bool (*obj_batch_fn)(void* ctx, const obj_vertex_batch& batch);
+
+struct obj_stream_info {
+	uint64_t point_count;
+	uint64_t vp_count;
+	uint64_t vt_count;
+	uint64_t vn_count;
+	uint64_t file_size;
+	uint64_t batch_count;
+	// times a run of v, vt or vn had to be parsed again from the file
+	uint64_t window_loads;
+	// the most the loader had allocated at once
+	uint64_t peak_bytes;
+};
+
+// a sensible memory_budget and batch size for stream_obj_file()
+#define OBJ_STREAM_BUDGET (64 << 20)
+#define OBJ_STREAM_BATCH 65535
+
+/* loads an obj like load_obj_file, but hands the vertices to fn in batches of
+batch_vertices (rounded down to a multiple of 3) instead of returning them,
+e.g. to fill a GL buffer with glBufferSubData. it allocates at most
+memory_budget bytes however big the file is, and counts are 64-bit, so it
+works for meshes that won't fit in memory. the bigger the budget the fewer
+times parts of the file are re-read. returns false on an error, or if fn
+asked to stop. info, if not NULL, gets the counts either way */
+bool stream_obj_file(const char* file_name, size_t batch_vertices,
+	size_t memory_budget, obj_batch_fn fn, void* ctx, obj_stream_info* info);
 
+/* the locale-free number parsers the loader uses. each skips spaces and tabs,
+reads one number from [p, end) and returns a pointer just past it, or NULL if
+there wasn't one. floats are correctly rounded, so they match strtof. ints are
+decimal only */
+const char* parse_obj_float(const char* p, const char* end, float* out);
+const char* parse_obj_int(const char* p, const char* end, int* out);
 
 #endif /* OBJ_PARSER_H_ */
@@ -1,12 +1,32 @@
 #version 410
 
+// a packed vertex, see mesh_pack.h. positions are 0..1 across the mesh's box
 layout(location = 0) in vec3 vertex_position;
+layout(location = 1) in vec2 vertex_tex_coord;
+// octahedral normal, as the raw signed ints
+layout(location = 2) in vec2 vertex_normal_oct;
 uniform mat4 view, proj, model;
+uniform vec3 pos_scale, pos_offset;
+uniform float normal_scale;
 
 // Use z postion to shader darker to help perception of  distance
 out float dist;
+out vec2 texture_coordinates;
+out vec3 normal;
+
+vec3 oct_decode (vec2 e) {
+	vec3 n = vec3 (e, 1.0 - abs (e.x) - abs (e.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs (n.yx)) * vec2 (n.x < 0.0 ? -1.0 : 1.0,
+			n.y < 0.0 ? -1.0 : 1.0);
+	}
+	return normalize (n);
+}
 
 void main() { 
-	gl_Position = proj * view * model * vec4(vertex_position, 1.0);
-	dist = vertex_position.z; //1.0 - (-pos_eye.z / 10.0)
+	vec3 position = vertex_position * pos_scale + pos_offset;
+	gl_Position = proj * view * model * vec4(position, 1.0);
+	dist = position.z; //1.0 - (-pos_eye.z / 10.0)
+	texture_coordinates = vertex_tex_coord;
+	normal = oct_decode (max (vertex_normal_oct * normal_scale, -1.0));
 }
@@ -0,0 +1,194 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| A tiny pool of worker threads for splitting big loops across cores.          |
+| Only one loop runs on the pool at a time. Chunks are handed out under a      |
+| mutex, which is fine because a chunk is meant to be thousands of items.      |
+\******************************************************************************/
+#include "thread_pool.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+
+#define MAX_WORKERS 64
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cond = PTHREAD_COND_INITIALIZER;
+// held by whoever is running a loop, so two threads can't both use the pool
+static pthread_mutex_t g_job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t g_threads[MAX_WORKERS];
+static int g_thread_count = 0; // workers actually started
+/* workers + caller. set to the cpu count under g_wanted_once, and only
+written with g_job_lock held after that, but parallel_for reads it without the
+lock to skip small jobs, hence atomic */
+static std::atomic<int> g_wanted (1);
+static pthread_once_t g_wanted_once = PTHREAD_ONCE_INIT;
+static bool g_quit = false;
+
+// the loop currently being run. all protected by g_lock
+static parallel_fn g_fn = NULL;
+static void* g_ctx = NULL;
+static size_t g_count = 0;
+static size_t g_grain = 1;
+static size_t g_next = 0;
+static size_t g_chunks_done = 0;
+static size_t g_chunks_total = 0;
+static unsigned int g_generation = 0;
+
+// true on pool threads, and on the caller while it is running a loop
+static thread_local bool g_in_parallel = false;
+
+/* grab chunks of the current loop until there are none left. returns with
+g_lock unlocked */
+static void run_chunks () {
+	pthread_mutex_lock (&g_lock);
+	while (g_next < g_count) {
+		size_t begin = g_next;
+		size_t end = begin + g_grain < g_count ? begin + g_grain : g_count;
+		g_next = end;
+		parallel_fn fn = g_fn;
+		void* ctx = g_ctx;
+		pthread_mutex_unlock (&g_lock);
+		fn (ctx, begin, end);
+		pthread_mutex_lock (&g_lock);
+		g_chunks_done++;
+		if (g_chunks_done == g_chunks_total) {
+			pthread_cond_signal (&g_done_cond);
+		}
+	}
+	pthread_mutex_unlock (&g_lock);
+}
+
+/* arg is the generation when the thread was created, so a thread that is slow
+to start still joins in on the loop that started it */
+static void* worker_main (void* arg) {
+	g_in_parallel = true;
+	unsigned int seen = (unsigned int)(uintptr_t)arg;
+	pthread_mutex_lock (&g_lock);
+	while (true) {
+		while (!g_quit && seen == g_generation) {
+			pthread_cond_wait (&g_work_cond, &g_lock);
+		}
+		if (g_quit) {
+			break;
+		}
+		seen = g_generation;
+		pthread_mutex_unlock (&g_lock);
+		run_chunks ();
+		pthread_mutex_lock (&g_lock);
+	}
+	pthread_mutex_unlock (&g_lock);
+	return NULL;
+}
+
+static int cpu_count () {
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+	if (n < 1) {
+		return 1;
+	}
+	return n > MAX_WORKERS ? MAX_WORKERS : (int)n;
+}
+
+static void init_wanted () {
+	g_wanted.store (cpu_count ());
+}
+
+int get_worker_count () {
+	pthread_once (&g_wanted_once, init_wanted);
+	return g_wanted.load ();
+}
+
+// call with g_job_lock held
+static void start_threads () {
+	int wanted = get_worker_count () - 1;
+	while (g_thread_count < wanted) {
+		if (0 != pthread_create (
+			&g_threads[g_thread_count], NULL, worker_main,
+			(void*)(uintptr_t)g_generation)) {
+			fprintf (stderr, "WARNING: could not start worker thread\n");
+			g_wanted.store (g_thread_count + 1);
+			break;
+		}
+		g_thread_count++;
+	}
+}
+
+static void stop_threads () {
+	pthread_mutex_lock (&g_lock);
+	g_quit = true;
+	pthread_cond_broadcast (&g_work_cond);
+	pthread_mutex_unlock (&g_lock);
+	for (int i = 0; i < g_thread_count; i++) {
+		pthread_join (g_threads[i], NULL);
+	}
+	g_thread_count = 0;
+	g_quit = false;
+}
+
+void set_worker_count (int count) {
+	// so a first get_worker_count() later can't put the cpu count back
+	pthread_once (&g_wanted_once, init_wanted);
+	pthread_mutex_lock (&g_job_lock);
+	stop_threads ();
+	if (count < 1) {
+		count = 1;
+	}
+	g_wanted.store (count > MAX_WORKERS ? MAX_WORKERS : count);
+	pthread_mutex_unlock (&g_job_lock);
+}
+
+void parallel_for (size_t count, size_t grain, parallel_fn fn, void* ctx) {
+	if (0 == grain) {
+		grain = 1;
+	}
+	if (g_in_parallel || count < 2 * grain || get_worker_count () < 2) {
+		if (count > 0) {
+			fn (ctx, 0, count);
+		}
+		return;
+	}
+	pthread_mutex_lock (&g_job_lock);
+	start_threads ();
+	/* the count may have dropped since we looked: set_worker_count() ran, or
+	no thread would start. then there's nobody to share with */
+	if (0 == g_thread_count) {
+		pthread_mutex_unlock (&g_job_lock);
+		fn (ctx, 0, count);
+		return;
+	}
+	g_in_parallel = true;
+
+	pthread_mutex_lock (&g_lock);
+	g_fn = fn;
+	g_ctx = ctx;
+	g_count = count;
+	g_grain = grain;
+	g_next = 0;
+	g_chunks_done = 0;
+	g_chunks_total = (count + grain - 1) / grain;
+	g_generation++;
+	pthread_cond_broadcast (&g_work_cond);
+	pthread_mutex_unlock (&g_lock);
+
+	run_chunks ();
+
+	pthread_mutex_lock (&g_lock);
+	while (g_chunks_done < g_chunks_total) {
+		pthread_cond_wait (&g_done_cond, &g_lock);
+	}
+	g_fn = NULL;
+	g_ctx = NULL;
+	pthread_mutex_unlock (&g_lock);
+
+	g_in_parallel = false;
+	pthread_mutex_unlock (&g_job_lock);
+}
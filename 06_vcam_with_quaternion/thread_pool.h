@@ -0,0 +1,34 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| A tiny pool of worker threads for splitting big loops across cores.          |
+| The threads are started the first time they are needed and then sleep until  |
+| there is work. The calling thread always does a share of the work too, so a  |
+| pool of N workers runs a loop on N threads in total.                         |
+\******************************************************************************/
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <stddef.h>
+
+/* called with a range [begin, end) of the loop. ranges are handed out in
+chunks of 'grain' so the function should do all the items in its range */
+typedef void (*parallel_fn) (void* ctx, size_t begin, size_t end);
+
+/* run fn over [0, count). returns when every item is done. loops shorter than
+two grains, or calls made from inside another parallel_for, just run on the
+calling thread */
+void parallel_for (size_t count, size_t grain, parallel_fn fn, void* ctx);
+
+// threads used by parallel_for, including the caller. defaults to cpu count
+int get_worker_count ();
+/* change the number of threads (1 = run everything on the caller). mostly
+useful for benchmarks. don't call this while a parallel_for is running */
+void set_worker_count (int count);
+
+#endif
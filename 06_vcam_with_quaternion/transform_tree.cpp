@@ -0,0 +1,236 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Transform hierarchy. New nodes are just appended. The first update after     |
+| that counting-sorts every array by depth (stable, so siblings keep the order |
+| they were added in) and works out where each level starts. After that an     |
+| update walks the levels from the shallowest dirty one down. A node is        |
+| recomputed if it, or its parent this update, was dirty.                      |
+\******************************************************************************/
+#include "transform_tree.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <string.h>
+
+bool init_transform_tree (transform_tree& t, int max_nodes) {
+	memset (&t, 0, sizeof (t));
+	if (max_nodes < 1) {
+		fprintf (stderr, "ERROR: transform tree needs room for at least 1 node\n");
+		return false;
+	}
+	t.capacity = max_nodes;
+	t.parent = new int[max_nodes];
+	t.depth = new int[max_nodes];
+	t.pos = new vec3[max_nodes];
+	t.rot = new versor[max_nodes];
+	t.scale = new vec3[max_nodes];
+	t.world = new mat4[max_nodes];
+	t.dirty = new unsigned char[max_nodes];
+	t.index_of = new int[max_nodes];
+	t.handle_of = new int[max_nodes];
+	t.level_start = new int[max_nodes + 1];
+	t.order = new int[max_nodes];
+	t.scratch = new mat4[max_nodes];
+	t.level_start[0] = 0;
+	t.min_dirty_depth = max_nodes;
+	return true;
+}
+
+void free_transform_tree (transform_tree& t) {
+	delete[] t.parent;
+	delete[] t.depth;
+	delete[] t.pos;
+	delete[] t.rot;
+	delete[] t.scale;
+	delete[] t.world;
+	delete[] t.dirty;
+	delete[] t.index_of;
+	delete[] t.handle_of;
+	delete[] t.level_start;
+	delete[] t.order;
+	delete[] t.scratch;
+	memset (&t, 0, sizeof (t));
+}
+
+static void mark_dirty (transform_tree& t, int index) {
+	t.dirty[index] = 1;
+	if (t.depth[index] < t.min_dirty_depth) {
+		t.min_dirty_depth = t.depth[index];
+	}
+}
+
+int add_transform (transform_tree& t, int parent, const vec3& pos,
+	const versor& rot, const vec3& scale) {
+	if (t.count >= t.capacity) {
+		fprintf (stderr, "ERROR: transform tree is full (%i nodes)\n", t.capacity);
+		return NO_TRANSFORM;
+	}
+	if (parent != NO_TRANSFORM && (parent < 0 || parent >= t.count)) {
+		fprintf (stderr, "ERROR: %i is not a transform node\n", parent);
+		return NO_TRANSFORM;
+	}
+	// handles are given out in order, and nodes go on the end until the sort
+	int handle = t.count;
+	int index = t.count++;
+	t.parent[index] = NO_TRANSFORM;
+	t.depth[index] = 0;
+	if (parent != NO_TRANSFORM) {
+		t.parent[index] = t.index_of[parent];
+		t.depth[index] = t.depth[t.parent[index]] + 1;
+	}
+	t.pos[index] = pos;
+	t.rot[index] = rot;
+	t.scale[index] = scale;
+	t.world[index] = identity_mat4 ();
+	t.index_of[handle] = index;
+	t.handle_of[index] = handle;
+	mark_dirty (t, index);
+	t.needs_sort = true;
+	return handle;
+}
+
+void set_transform (transform_tree& t, int node, const vec3& pos,
+	const versor& rot, const vec3& scale) {
+	int index = t.index_of[node];
+	t.pos[index] = pos;
+	t.rot[index] = rot;
+	t.scale[index] = scale;
+	mark_dirty (t, index);
+}
+
+void set_transform_pos (transform_tree& t, int node, const vec3& pos) {
+	int index = t.index_of[node];
+	t.pos[index] = pos;
+	mark_dirty (t, index);
+}
+
+void set_transform_rot (transform_tree& t, int node, const versor& rot) {
+	int index = t.index_of[node];
+	t.rot[index] = rot;
+	mark_dirty (t, index);
+}
+
+int world_mat_index (const transform_tree& t, int node) {
+	return t.index_of[node];
+}
+
+const mat4& world_mat (const transform_tree& t, int node) {
+	return t.world[t.index_of[node]];
+}
+
+/*-----------------------------------SORTING----------------------------------*/
+// data[i] = old data[order[i]], for n elements of size bytes each
+static void permute (void* data, size_t size, const int* order, int n,
+	void* scratch) {
+	unsigned char* src = (unsigned char*)data;
+	unsigned char* dst = (unsigned char*)scratch;
+	for (int i = 0; i < n; i++) {
+		memcpy (dst + i * size, src + order[i] * size, size);
+	}
+	memcpy (data, scratch, n * size);
+}
+
+static void sort_by_depth (transform_tree& t) {
+	int n = t.count;
+	int num_levels = 0;
+	bool sorted = true;
+	for (int i = 0; i < n; i++) {
+		if (t.depth[i] + 1 > num_levels) {
+			num_levels = t.depth[i] + 1;
+		}
+		if (i > 0 && t.depth[i] < t.depth[i - 1]) {
+			sorted = false;
+		}
+	}
+	// count each level, then turn the counts into starts
+	int* start = t.level_start;
+	memset (start, 0, (num_levels + 1) * sizeof (int));
+	for (int i = 0; i < n; i++) {
+		start[t.depth[i] + 1]++;
+	}
+	for (int d = 0; d < num_levels; d++) {
+		start[d + 1] += start[d];
+	}
+	t.num_levels = num_levels;
+	t.needs_sort = false;
+	// appending deeper and deeper nodes doesn't need anything moved
+	if (sorted) {
+		return;
+	}
+
+	int* order = t.order;
+	int* next = t.index_of; // borrowed, it's rebuilt below
+	memcpy (next, start, num_levels * sizeof (int));
+	for (int i = 0; i < n; i++) {
+		order[next[t.depth[i]]++] = i;
+	}
+	for (int i = 0; i < n; i++) {
+		t.index_of[t.handle_of[order[i]]] = i;
+	}
+	// parents still hold old indices. handle_of hasn't moved yet
+	for (int i = 0; i < n; i++) {
+		if (t.parent[i] != NO_TRANSFORM) {
+			t.parent[i] = t.index_of[t.handle_of[t.parent[i]]];
+		}
+	}
+	permute (t.parent, sizeof (int), order, n, t.scratch);
+	permute (t.depth, sizeof (int), order, n, t.scratch);
+	permute (t.pos, sizeof (vec3), order, n, t.scratch);
+	permute (t.rot, sizeof (versor), order, n, t.scratch);
+	permute (t.scale, sizeof (vec3), order, n, t.scratch);
+	permute (t.world, sizeof (mat4), order, n, t.scratch);
+	permute (t.dirty, sizeof (unsigned char), order, n, t.scratch);
+	permute (t.handle_of, sizeof (int), order, n, t.scratch);
+}
+
+/*-----------------------------------UPDATING---------------------------------*/
+struct level_job {
+	transform_tree* t;
+	int first;
+};
+
+static void update_range (void* ctx, size_t begin, size_t end) {
+	level_job* job = (level_job*)ctx;
+	transform_tree& t = *job->t;
+	for (int i = job->first + (int)begin; i < job->first + (int)end; i++) {
+		int p = t.parent[i];
+		// a dirty parent has been recomputed already, so we must be too
+		if (p != NO_TRANSFORM && t.dirty[p]) {
+			t.dirty[i] = 1;
+		}
+		if (!t.dirty[i]) {
+			continue;
+		}
+		mat4 local = make_trs (t.pos[i], t.rot[i], t.scale[i]);
+		if (p == NO_TRANSFORM) {
+			t.world[i] = local;
+		} else {
+			t.world[i] = t.world[p] * local;
+		}
+	}
+}
+
+bool update_transforms (transform_tree& t) {
+	if (t.needs_sort) {
+		sort_by_depth (t);
+	}
+	if (t.min_dirty_depth >= t.num_levels) {
+		return false;
+	}
+	level_job job;
+	job.t = &t;
+	for (int d = t.min_dirty_depth; d < t.num_levels; d++) {
+		job.first = t.level_start[d];
+		size_t level_size = (size_t)(t.level_start[d + 1] - job.first);
+		parallel_for (level_size, TRANSFORM_GRAIN, update_range, &job);
+	}
+	int first = t.level_start[t.min_dirty_depth];
+	memset (t.dirty + first, 0, t.count - first);
+	t.min_dirty_depth = t.capacity;
+	return true;
+}
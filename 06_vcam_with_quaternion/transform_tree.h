@@ -0,0 +1,80 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Parent/child transform hierarchy.                                            |
+| Each node has a local position, rotation and scale, and a world matrix that  |
+| is parent's world * make_trs (pos, rot, scale). Setting a local transform    |
+| only marks the node dirty, and update_transforms() then recomputes the dirty |
+| nodes and everything under them - nothing else.                              |
+| Nodes are kept in flat arrays sorted by depth (roots first, then their       |
+| children, and so on), so a parent is always done before its children and a   |
+| whole depth level can be split across the thread pool. The world matrices    |
+| end up in one contiguous array, ready for glUniformMatrix4fv or a buffer.    |
+| Nodes are named by the handle add_transform() gives back. Adding nodes can   |
+| re-sort the arrays, so use world_mat_index() to find a node's matrix again   |
+| after the next update rather than keeping an index.                          |
+\******************************************************************************/
+#ifndef _TRANSFORM_TREE_H_
+#define _TRANSFORM_TREE_H_
+
+#include "maths_funcs.h"
+
+// parent of a root node
+#define NO_TRANSFORM -1
+// nodes per thread pool chunk, within one level
+#define TRANSFORM_GRAIN 2048
+
+struct transform_tree {
+	int capacity;
+	int count;
+	// per node, in depth order. parent is an index into these arrays
+	int* parent;
+	int* depth;
+	vec3* pos;
+	versor* rot;
+	vec3* scale;
+	mat4* world;
+	unsigned char* dirty;
+	// handle -> index, and index -> handle
+	int* index_of;
+	int* handle_of;
+	// level d is [level_start[d], level_start[d + 1])
+	int* level_start;
+	int num_levels;
+	// shallowest level with a dirty node, or capacity if none are
+	int min_dirty_depth;
+	// nodes were added since the levels were worked out
+	bool needs_sort;
+	/* used while sorting. order[new index] = old index, and a mat4 per node is
+	room for any of the arrays above */
+	int* order;
+	mat4* scratch;
+};
+
+// space for up to max_nodes. nothing else allocates
+bool init_transform_tree (transform_tree& t, int max_nodes);
+void free_transform_tree (transform_tree& t);
+
+/* parent is a handle, or NO_TRANSFORM for a root. returns the new node's
+handle, or NO_TRANSFORM if the tree is full */
+int add_transform (transform_tree& t, int parent, const vec3& pos,
+	const versor& rot, const vec3& scale);
+// change a node's local transform. the world matrices change at the next update
+void set_transform (transform_tree& t, int node, const vec3& pos,
+	const versor& rot, const vec3& scale);
+void set_transform_pos (transform_tree& t, int node, const vec3& pos);
+void set_transform_rot (transform_tree& t, int node, const versor& rot);
+
+/* recomputes the world matrix of every dirty node and its descendants. returns
+true if any world matrix changed, so callers know to re-upload */
+bool update_transforms (transform_tree& t);
+// where a node's world matrix is in t.world. valid until nodes are added
+int world_mat_index (const transform_tree& t, int node);
+const mat4& world_mat (const transform_tree& t, int node);
+
+#endif
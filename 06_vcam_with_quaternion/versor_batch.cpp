@@ -0,0 +1,652 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Versor maths over SoA arrays. Each operation has a scalar, an SSE4.1 (4 at a |
+| time) and an AVX2 (8 at a time) kernel. AVX-512 machines use the AVX2 ones - |
+| these are all load/store bound long before the extra width would help.       |
+\******************************************************************************/
+#include "versor_batch.h"
+#include "maths_simd.h"
+#include "thread_pool.h"
+#include "fast_trig.h"
+#include <string.h>
+#include <math.h>
+#if MATHS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+const_versor_soa::const_versor_soa () {
+	q[0] = q[1] = q[2] = q[3] = NULL;
+}
+
+const_versor_soa::const_versor_soa (const versor_soa& v) {
+	for (int i = 0; i < 4; i++) {
+		q[i] = v.q[i];
+	}
+}
+
+/* everything a kernel might need. t is read as t[i * t_stride], so a stride of
+0 gives every versor the same factor. pos and scale are the optional xyz
+arrays for make_trs_batch() */
+struct versor_job {
+	const float* a[4];
+	const float* b[4];
+	const float* t;
+	size_t t_stride;
+	float* out[4];
+	mat4* mats;
+	const float* pos;
+	const float* scale;
+};
+
+typedef void (*versor_fn) (const versor_job& job, size_t begin, size_t end);
+
+/* Eberly's coefficients for 8 terms. the last pair is scaled by 1 + mu, which
+soaks up most of the truncation error of the series */
+#define SLERP_TERMS 8
+#define SLERP_ONE_PLUS_MU 1.85298109240830f
+static const float g_slerp_u[SLERP_TERMS] = {
+	1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+	1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15),
+	SLERP_ONE_PLUS_MU / (8 * 17)
+};
+static const float g_slerp_v[SLERP_TERMS] = {
+	1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15,
+	SLERP_ONE_PLUS_MU * 8 / 17
+};
+
+/*-------------------------------SCALAR KERNELS-------------------------------*/
+static void mul_scalar (const versor_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float aw = j.a[0][i], ax = j.a[1][i], ay = j.a[2][i], az = j.a[3][i];
+		float bw = j.b[0][i], bx = j.b[1][i], by = j.b[2][i], bz = j.b[3][i];
+		j.out[0][i] = bw * aw - bx * ax - by * ay - bz * az;
+		j.out[1][i] = bw * ax + bx * aw - by * az + bz * ay;
+		j.out[2][i] = bw * ay + bx * az + by * aw - bz * ax;
+		j.out[3][i] = bw * az - bx * ay + by * ax + bz * aw;
+	}
+}
+
+static void normalise_scalar (const versor_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float w = j.a[0][i], x = j.a[1][i], y = j.a[2][i], z = j.a[3][i];
+		float sum = w * w + x * x + y * y + z * z;
+		float inv = sum > 0.0f ? 1.0f / sqrtf (sum) : 0.0f;
+		j.out[0][i] = w * inv;
+		j.out[1][i] = x * inv;
+		j.out[2][i] = y * inv;
+		j.out[3][i] = z * inv;
+	}
+}
+
+static void nlerp_scalar (const versor_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float t = j.t[i * j.t_stride];
+		float a[4], b[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = j.a[k][i];
+			b[k] = j.b[k][i];
+		}
+		float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+		// short way round
+		float tb = d < 0.0f ? -t : t;
+		float r[4];
+		float sum = 0.0f;
+		for (int k = 0; k < 4; k++) {
+			r[k] = (1.0f - t) * a[k] + tb * b[k];
+			sum += r[k] * r[k];
+		}
+		float inv = sum > 0.0f ? 1.0f / sqrtf (sum) : 0.0f;
+		for (int k = 0; k < 4; k++) {
+			j.out[k][i] = r[k] * inv;
+		}
+	}
+}
+
+static void slerp_scalar (const versor_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float t = j.t[i * j.t_stride];
+		float a[4], b[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = j.a[k][i];
+			b[k] = j.b[k][i];
+		}
+		float x = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+		float sign = 1.0f;
+		if (x < 0.0f) {
+			x = -x;
+			sign = -1.0f;
+		}
+		float xm1 = x - 1.0f;
+		float d = 1.0f - t;
+		float sqr_t = t * t;
+		float sqr_d = d * d;
+		// horner form of the series, from the last term in
+		float ct = 1.0f;
+		float cd = 1.0f;
+		for (int k = SLERP_TERMS - 1; k >= 0; k--) {
+			ct = 1.0f + (g_slerp_u[k] * sqr_t - g_slerp_v[k]) * xm1 * ct;
+			cd = 1.0f + (g_slerp_u[k] * sqr_d - g_slerp_v[k]) * xm1 * cd;
+		}
+		ct *= sign * t;
+		cd *= d;
+		for (int k = 0; k < 4; k++) {
+			j.out[k][i] = a[k] * cd + b[k] * ct;
+		}
+	}
+}
+
+/* same expressions, in the same order, as quat_to_mat4() in maths_funcs.cpp,
+then the scale and translation the same way as make_trs () */
+static void to_mat4_scalar (const versor_job& j, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float w = j.a[0][i], x = j.a[1][i], y = j.a[2][i], z = j.a[3][i];
+		float* m = j.mats[i].m;
+		m[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
+		m[1] = 2.0f * x * y + 2.0f * w * z;
+		m[2] = 2.0f * x * z - 2.0f * w * y;
+		m[3] = 0.0f;
+		m[4] = 2.0f * x * y - 2.0f * w * z;
+		m[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
+		m[6] = 2.0f * y * z + 2.0f * w * x;
+		m[7] = 0.0f;
+		m[8] = 2.0f * x * z + 2.0f * w * y;
+		m[9] = 2.0f * y * z - 2.0f * w * x;
+		m[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
+		m[11] = 0.0f;
+		m[12] = 0.0f;
+		m[13] = 0.0f;
+		m[14] = 0.0f;
+		m[15] = 1.0f;
+		if (j.scale) {
+			for (int col = 0; col < 3; col++) {
+				m[col * 4] *= j.scale[i * 3 + col];
+				m[col * 4 + 1] *= j.scale[i * 3 + col];
+				m[col * 4 + 2] *= j.scale[i * 3 + col];
+			}
+		}
+		if (j.pos) {
+			m[12] = j.pos[i * 3];
+			m[13] = j.pos[i * 3 + 1];
+			m[14] = j.pos[i * 3 + 2];
+		}
+	}
+}
+
+#if MATHS_SIMD_X86
+/*--------------------------------SSE4.1 KERNELS------------------------------*/
+__attribute__ ((target ("sse4.1")))
+static void mul_sse41 (const versor_job& j, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 aw = _mm_loadu_ps (j.a[0] + i), ax = _mm_loadu_ps (j.a[1] + i);
+		__m128 ay = _mm_loadu_ps (j.a[2] + i), az = _mm_loadu_ps (j.a[3] + i);
+		__m128 bw = _mm_loadu_ps (j.b[0] + i), bx = _mm_loadu_ps (j.b[1] + i);
+		__m128 by = _mm_loadu_ps (j.b[2] + i), bz = _mm_loadu_ps (j.b[3] + i);
+		__m128 rw = _mm_sub_ps (_mm_sub_ps (_mm_sub_ps (_mm_mul_ps (bw, aw),
+			_mm_mul_ps (bx, ax)), _mm_mul_ps (by, ay)), _mm_mul_ps (bz, az));
+		__m128 rx = _mm_add_ps (_mm_sub_ps (_mm_add_ps (_mm_mul_ps (bw, ax),
+			_mm_mul_ps (bx, aw)), _mm_mul_ps (by, az)), _mm_mul_ps (bz, ay));
+		__m128 ry = _mm_sub_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (bw, ay),
+			_mm_mul_ps (bx, az)), _mm_mul_ps (by, aw)), _mm_mul_ps (bz, ax));
+		__m128 rz = _mm_add_ps (_mm_add_ps (_mm_sub_ps (_mm_mul_ps (bw, az),
+			_mm_mul_ps (bx, ay)), _mm_mul_ps (by, ax)), _mm_mul_ps (bz, aw));
+		_mm_storeu_ps (j.out[0] + i, rw);
+		_mm_storeu_ps (j.out[1] + i, rx);
+		_mm_storeu_ps (j.out[2] + i, ry);
+		_mm_storeu_ps (j.out[3] + i, rz);
+	}
+	mul_scalar (j, i, end);
+}
+
+/* 1 / sqrt (sum) by rsqrt plus one newton-raphson step. zero stays zero */
+__attribute__ ((target ("sse4.1")))
+static inline __m128 inv_length_sse41 (__m128 sum) {
+	__m128 y = _mm_rsqrt_ps (sum);
+	__m128 yy_sum = _mm_mul_ps (_mm_mul_ps (y, y), sum);
+	y = _mm_mul_ps (_mm_mul_ps (_mm_set1_ps (0.5f), y),
+		_mm_sub_ps (_mm_set1_ps (3.0f), yy_sum));
+	return _mm_and_ps (y, _mm_cmpgt_ps (sum, _mm_setzero_ps ()));
+}
+
+__attribute__ ((target ("sse4.1")))
+static inline __m128 dot4_sse41 (const __m128* a, const __m128* b) {
+	return _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (a[0], b[0]),
+		_mm_mul_ps (a[1], b[1])), _mm_mul_ps (a[2], b[2])),
+		_mm_mul_ps (a[3], b[3]));
+}
+
+__attribute__ ((target ("sse4.1")))
+static inline __m128 load_t_sse41 (const versor_job& j, size_t i) {
+	if (0 == j.t_stride) {
+		return _mm_set1_ps (j.t[0]);
+	}
+	return _mm_loadu_ps (j.t + i);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void normalise_sse41 (const versor_job& j, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 a[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = _mm_loadu_ps (j.a[k] + i);
+		}
+		__m128 inv = inv_length_sse41 (dot4_sse41 (a, a));
+		for (int k = 0; k < 4; k++) {
+			_mm_storeu_ps (j.out[k] + i, _mm_mul_ps (a[k], inv));
+		}
+	}
+	normalise_scalar (j, i, end);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void nlerp_sse41 (const versor_job& j, size_t begin, size_t end) {
+	const __m128 sign_bit = _mm_set1_ps (-0.0f);
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 a[4], b[4], r[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = _mm_loadu_ps (j.a[k] + i);
+			b[k] = _mm_loadu_ps (j.b[k] + i);
+		}
+		__m128 t = load_t_sse41 (j, i);
+		// flip the sign of t wherever the dot product is negative
+		__m128 d = dot4_sse41 (a, b);
+		__m128 tb = _mm_xor_ps (t, _mm_and_ps (d, sign_bit));
+		__m128 ta = _mm_sub_ps (_mm_set1_ps (1.0f), t);
+		for (int k = 0; k < 4; k++) {
+			r[k] = _mm_add_ps (_mm_mul_ps (ta, a[k]), _mm_mul_ps (tb, b[k]));
+		}
+		__m128 inv = inv_length_sse41 (dot4_sse41 (r, r));
+		for (int k = 0; k < 4; k++) {
+			_mm_storeu_ps (j.out[k] + i, _mm_mul_ps (r[k], inv));
+		}
+	}
+	nlerp_scalar (j, i, end);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void slerp_sse41 (const versor_job& j, size_t begin, size_t end) {
+	const __m128 sign_bit = _mm_set1_ps (-0.0f);
+	const __m128 one = _mm_set1_ps (1.0f);
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 a[4], b[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = _mm_loadu_ps (j.a[k] + i);
+			b[k] = _mm_loadu_ps (j.b[k] + i);
+		}
+		__m128 t = load_t_sse41 (j, i);
+		__m128 x = dot4_sse41 (a, b);
+		__m128 sign = _mm_and_ps (x, sign_bit);
+		x = _mm_andnot_ps (sign_bit, x);
+		__m128 xm1 = _mm_sub_ps (x, one);
+		__m128 d = _mm_sub_ps (one, t);
+		__m128 sqr_t = _mm_mul_ps (t, t);
+		__m128 sqr_d = _mm_mul_ps (d, d);
+		__m128 ct = one;
+		__m128 cd = one;
+		for (int k = SLERP_TERMS - 1; k >= 0; k--) {
+			__m128 u = _mm_set1_ps (g_slerp_u[k]);
+			__m128 v = _mm_set1_ps (g_slerp_v[k]);
+			ct = _mm_add_ps (one, _mm_mul_ps (_mm_mul_ps (
+				_mm_sub_ps (_mm_mul_ps (u, sqr_t), v), xm1), ct));
+			cd = _mm_add_ps (one, _mm_mul_ps (_mm_mul_ps (
+				_mm_sub_ps (_mm_mul_ps (u, sqr_d), v), xm1), cd));
+		}
+		ct = _mm_mul_ps (ct, _mm_xor_ps (t, sign));
+		cd = _mm_mul_ps (cd, d);
+		for (int k = 0; k < 4; k++) {
+			_mm_storeu_ps (j.out[k] + i,
+				_mm_add_ps (_mm_mul_ps (a[k], cd), _mm_mul_ps (b[k], ct)));
+		}
+	}
+	slerp_scalar (j, i, end);
+}
+
+/* works out 4 matrices' worth of each element, then transposes groups of 4
+elements back into the 4 matrices */
+__attribute__ ((target ("sse4.1")))
+static void to_mat4_sse41 (const versor_job& j, size_t begin, size_t end) {
+	const __m128 one = _mm_set1_ps (1.0f);
+	const __m128 two = _mm_set1_ps (2.0f);
+	const __m128 zero = _mm_setzero_ps ();
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 w = _mm_loadu_ps (j.a[0] + i), x = _mm_loadu_ps (j.a[1] + i);
+		__m128 y = _mm_loadu_ps (j.a[2] + i), z = _mm_loadu_ps (j.a[3] + i);
+		__m128 w2 = _mm_mul_ps (two, w), x2 = _mm_mul_ps (two, x);
+		__m128 y2 = _mm_mul_ps (two, y), z2 = _mm_mul_ps (two, z);
+		__m128 e[16];
+		e[0] = _mm_sub_ps (_mm_sub_ps (one, _mm_mul_ps (y2, y)), _mm_mul_ps (z2, z));
+		e[1] = _mm_add_ps (_mm_mul_ps (x2, y), _mm_mul_ps (w2, z));
+		e[2] = _mm_sub_ps (_mm_mul_ps (x2, z), _mm_mul_ps (w2, y));
+		e[3] = zero;
+		e[4] = _mm_sub_ps (_mm_mul_ps (x2, y), _mm_mul_ps (w2, z));
+		e[5] = _mm_sub_ps (_mm_sub_ps (one, _mm_mul_ps (x2, x)), _mm_mul_ps (z2, z));
+		e[6] = _mm_add_ps (_mm_mul_ps (y2, z), _mm_mul_ps (w2, x));
+		e[7] = zero;
+		e[8] = _mm_add_ps (_mm_mul_ps (x2, z), _mm_mul_ps (w2, y));
+		e[9] = _mm_sub_ps (_mm_mul_ps (y2, z), _mm_mul_ps (w2, x));
+		e[10] = _mm_sub_ps (_mm_sub_ps (one, _mm_mul_ps (x2, x)), _mm_mul_ps (y2, y));
+		e[11] = zero;
+		e[12] = zero;
+		e[13] = zero;
+		e[14] = zero;
+		e[15] = one;
+		// xyz of 4 instances at a time
+		if (j.scale) {
+			const float* s = j.scale + i * 3;
+			for (int col = 0; col < 3; col++) {
+				__m128 sc = _mm_setr_ps (s[col], s[3 + col], s[6 + col], s[9 + col]);
+				e[col * 4] = _mm_mul_ps (e[col * 4], sc);
+				e[col * 4 + 1] = _mm_mul_ps (e[col * 4 + 1], sc);
+				e[col * 4 + 2] = _mm_mul_ps (e[col * 4 + 2], sc);
+			}
+		}
+		if (j.pos) {
+			const float* p = j.pos + i * 3;
+			for (int row = 0; row < 3; row++) {
+				e[12 + row] = _mm_setr_ps (p[row], p[3 + row], p[6 + row], p[9 + row]);
+			}
+		}
+		for (int col = 0; col < 4; col++) {
+			_MM_TRANSPOSE4_PS (e[col * 4], e[col * 4 + 1], e[col * 4 + 2],
+				e[col * 4 + 3]);
+			for (int k = 0; k < 4; k++) {
+				_mm_storeu_ps (j.mats[i + k].m + col * 4, e[col * 4 + k]);
+			}
+		}
+	}
+	to_mat4_scalar (j, i, end);
+}
+
+/*---------------------------------AVX2 KERNELS-------------------------------*/
+__attribute__ ((target ("avx2")))
+static void mul_avx2 (const versor_job& j, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 aw = _mm256_loadu_ps (j.a[0] + i), ax = _mm256_loadu_ps (j.a[1] + i);
+		__m256 ay = _mm256_loadu_ps (j.a[2] + i), az = _mm256_loadu_ps (j.a[3] + i);
+		__m256 bw = _mm256_loadu_ps (j.b[0] + i), bx = _mm256_loadu_ps (j.b[1] + i);
+		__m256 by = _mm256_loadu_ps (j.b[2] + i), bz = _mm256_loadu_ps (j.b[3] + i);
+		__m256 rw = _mm256_sub_ps (_mm256_sub_ps (_mm256_sub_ps (
+			_mm256_mul_ps (bw, aw), _mm256_mul_ps (bx, ax)),
+			_mm256_mul_ps (by, ay)), _mm256_mul_ps (bz, az));
+		__m256 rx = _mm256_add_ps (_mm256_sub_ps (_mm256_add_ps (
+			_mm256_mul_ps (bw, ax), _mm256_mul_ps (bx, aw)),
+			_mm256_mul_ps (by, az)), _mm256_mul_ps (bz, ay));
+		__m256 ry = _mm256_sub_ps (_mm256_add_ps (_mm256_add_ps (
+			_mm256_mul_ps (bw, ay), _mm256_mul_ps (bx, az)),
+			_mm256_mul_ps (by, aw)), _mm256_mul_ps (bz, ax));
+		__m256 rz = _mm256_add_ps (_mm256_add_ps (_mm256_sub_ps (
+			_mm256_mul_ps (bw, az), _mm256_mul_ps (bx, ay)),
+			_mm256_mul_ps (by, ax)), _mm256_mul_ps (bz, aw));
+		_mm256_storeu_ps (j.out[0] + i, rw);
+		_mm256_storeu_ps (j.out[1] + i, rx);
+		_mm256_storeu_ps (j.out[2] + i, ry);
+		_mm256_storeu_ps (j.out[3] + i, rz);
+	}
+	mul_sse41 (j, i, end);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256 inv_length_avx2 (__m256 sum) {
+	__m256 y = _mm256_rsqrt_ps (sum);
+	__m256 yy_sum = _mm256_mul_ps (_mm256_mul_ps (y, y), sum);
+	y = _mm256_mul_ps (_mm256_mul_ps (_mm256_set1_ps (0.5f), y),
+		_mm256_sub_ps (_mm256_set1_ps (3.0f), yy_sum));
+	return _mm256_and_ps (y,
+		_mm256_cmp_ps (sum, _mm256_setzero_ps (), _CMP_GT_OQ));
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256 dot4_avx2 (const __m256* a, const __m256* b) {
+	return _mm256_add_ps (_mm256_add_ps (_mm256_add_ps (
+		_mm256_mul_ps (a[0], b[0]), _mm256_mul_ps (a[1], b[1])),
+		_mm256_mul_ps (a[2], b[2])), _mm256_mul_ps (a[3], b[3]));
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256 load_t_avx2 (const versor_job& j, size_t i) {
+	if (0 == j.t_stride) {
+		return _mm256_set1_ps (j.t[0]);
+	}
+	return _mm256_loadu_ps (j.t + i);
+}
+
+__attribute__ ((target ("avx2")))
+static void normalise_avx2 (const versor_job& j, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 a[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = _mm256_loadu_ps (j.a[k] + i);
+		}
+		__m256 inv = inv_length_avx2 (dot4_avx2 (a, a));
+		for (int k = 0; k < 4; k++) {
+			_mm256_storeu_ps (j.out[k] + i, _mm256_mul_ps (a[k], inv));
+		}
+	}
+	normalise_sse41 (j, i, end);
+}
+
+__attribute__ ((target ("avx2")))
+static void nlerp_avx2 (const versor_job& j, size_t begin, size_t end) {
+	const __m256 sign_bit = _mm256_set1_ps (-0.0f);
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 a[4], b[4], r[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = _mm256_loadu_ps (j.a[k] + i);
+			b[k] = _mm256_loadu_ps (j.b[k] + i);
+		}
+		__m256 t = load_t_avx2 (j, i);
+		__m256 d = dot4_avx2 (a, b);
+		__m256 tb = _mm256_xor_ps (t, _mm256_and_ps (d, sign_bit));
+		__m256 ta = _mm256_sub_ps (_mm256_set1_ps (1.0f), t);
+		for (int k = 0; k < 4; k++) {
+			r[k] = _mm256_add_ps (_mm256_mul_ps (ta, a[k]),
+				_mm256_mul_ps (tb, b[k]));
+		}
+		__m256 inv = inv_length_avx2 (dot4_avx2 (r, r));
+		for (int k = 0; k < 4; k++) {
+			_mm256_storeu_ps (j.out[k] + i, _mm256_mul_ps (r[k], inv));
+		}
+	}
+	nlerp_sse41 (j, i, end);
+}
+
+__attribute__ ((target ("avx2")))
+static void slerp_avx2 (const versor_job& j, size_t begin, size_t end) {
+	const __m256 sign_bit = _mm256_set1_ps (-0.0f);
+	const __m256 one = _mm256_set1_ps (1.0f);
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 a[4], b[4];
+		for (int k = 0; k < 4; k++) {
+			a[k] = _mm256_loadu_ps (j.a[k] + i);
+			b[k] = _mm256_loadu_ps (j.b[k] + i);
+		}
+		__m256 t = load_t_avx2 (j, i);
+		__m256 x = dot4_avx2 (a, b);
+		__m256 sign = _mm256_and_ps (x, sign_bit);
+		x = _mm256_andnot_ps (sign_bit, x);
+		__m256 xm1 = _mm256_sub_ps (x, one);
+		__m256 d = _mm256_sub_ps (one, t);
+		__m256 sqr_t = _mm256_mul_ps (t, t);
+		__m256 sqr_d = _mm256_mul_ps (d, d);
+		__m256 ct = one;
+		__m256 cd = one;
+		for (int k = SLERP_TERMS - 1; k >= 0; k--) {
+			__m256 u = _mm256_set1_ps (g_slerp_u[k]);
+			__m256 v = _mm256_set1_ps (g_slerp_v[k]);
+			ct = _mm256_add_ps (one, _mm256_mul_ps (_mm256_mul_ps (
+				_mm256_sub_ps (_mm256_mul_ps (u, sqr_t), v), xm1), ct));
+			cd = _mm256_add_ps (one, _mm256_mul_ps (_mm256_mul_ps (
+				_mm256_sub_ps (_mm256_mul_ps (u, sqr_d), v), xm1), cd));
+		}
+		ct = _mm256_mul_ps (ct, _mm256_xor_ps (t, sign));
+		cd = _mm256_mul_ps (cd, d);
+		for (int k = 0; k < 4; k++) {
+			_mm256_storeu_ps (j.out[k] + i, _mm256_add_ps (
+				_mm256_mul_ps (a[k], cd), _mm256_mul_ps (b[k], ct)));
+		}
+	}
+	slerp_sse41 (j, i, end);
+}
+#endif
+
+/*----------------------------------DISPATCH----------------------------------*/
+enum versor_op {
+	OP_MUL = 0,
+	OP_NORMALISE,
+	OP_NLERP,
+	OP_SLERP,
+	OP_TO_MAT4,
+	NUM_OPS
+};
+
+// by op then by level: scalar, sse4.1, avx2
+static const versor_fn g_kernels[NUM_OPS][3] = {
+#if MATHS_SIMD_X86
+	{ mul_scalar, mul_sse41, mul_avx2 },
+	{ normalise_scalar, normalise_sse41, normalise_avx2 },
+	{ nlerp_scalar, nlerp_sse41, nlerp_avx2 },
+	{ slerp_scalar, slerp_sse41, slerp_avx2 },
+	// 8-wide would only add more transposing, so sse all the way up
+	{ to_mat4_scalar, to_mat4_sse41, to_mat4_sse41 }
+#else
+	{ mul_scalar, mul_scalar, mul_scalar },
+	{ normalise_scalar, normalise_scalar, normalise_scalar },
+	{ nlerp_scalar, nlerp_scalar, nlerp_scalar },
+	{ slerp_scalar, slerp_scalar, slerp_scalar },
+	{ to_mat4_scalar, to_mat4_scalar, to_mat4_scalar }
+#endif
+};
+
+struct versor_task {
+	versor_job job;
+	versor_fn fn;
+};
+
+static void versor_range (void* ctx, size_t begin, size_t end) {
+	versor_task* task = (versor_task*)ctx;
+	task->fn (task->job, begin, end);
+}
+
+static void run (versor_op op, versor_job& job, size_t n) {
+	int level = get_simd_level ();
+	if (level > 2) {
+		level = 2;
+	}
+	versor_task task;
+	task.job = job;
+	task.fn = g_kernels[op][level];
+	parallel_for (n, VERSOR_GRAIN, versor_range, &task);
+}
+
+static versor_job make_job (const const_versor_soa* a,
+	const const_versor_soa* b, versor_soa* out) {
+	versor_job job;
+	memset (&job, 0, sizeof (job));
+	for (int k = 0; k < 4; k++) {
+		job.a[k] = a ? a->q[k] : NULL;
+		job.b[k] = b ? b->q[k] : NULL;
+		job.out[k] = out ? out->q[k] : NULL;
+	}
+	return job;
+}
+
+/*---------------------------------PUBLIC API---------------------------------*/
+void mul_versors (const const_versor_soa& a, const const_versor_soa& b,
+	versor_soa& out, size_t n) {
+	versor_job job = make_job (&a, &b, &out);
+	run (OP_MUL, job, n);
+}
+
+void normalise_versors (const const_versor_soa& a, versor_soa& out, size_t n) {
+	versor_job job = make_job (&a, NULL, &out);
+	run (OP_NORMALISE, job, n);
+}
+
+void nlerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	const float* t, versor_soa& out, size_t n) {
+	versor_job job = make_job (&a, &b, &out);
+	job.t = t;
+	job.t_stride = 1;
+	run (OP_NLERP, job, n);
+}
+
+void nlerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	float t, versor_soa& out, size_t n) {
+	versor_job job = make_job (&a, &b, &out);
+	job.t = &t;
+	job.t_stride = 0;
+	run (OP_NLERP, job, n);
+}
+
+void slerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	const float* t, versor_soa& out, size_t n) {
+	versor_job job = make_job (&a, &b, &out);
+	job.t = t;
+	job.t_stride = 1;
+	run (OP_SLERP, job, n);
+}
+
+void slerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	float t, versor_soa& out, size_t n) {
+	versor_job job = make_job (&a, &b, &out);
+	job.t = &t;
+	job.t_stride = 0;
+	run (OP_SLERP, job, n);
+}
+
+void quat_to_mat4_batch (const const_versor_soa& a, mat4* out, size_t n) {
+	versor_job job = make_job (&a, NULL, NULL);
+	job.mats = out;
+	run (OP_TO_MAT4, job, n);
+}
+
+void make_trs_batch (const float* pos, const const_versor_soa& rot,
+	const float* scale, mat4* out, size_t n) {
+	versor_job job = make_job (&rot, NULL, NULL);
+	job.mats = out;
+	job.pos = pos;
+	job.scale = scale;
+	run (OP_TO_MAT4, job, n);
+}
+
+/* half angles go in the w array first, then sincos_batch() writes the sines
+to x and the cosines over the half angles */
+void versors_from_axis_rad (const float* radians, const float* axes,
+	versor_soa& out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out.q[0][i] = radians[i] * 0.5f;
+	}
+	sincos_batch (out.q[0], out.q[1], out.q[0], n);
+	for (size_t i = 0; i < n; i++) {
+		float s = out.q[1][i];
+		out.q[1][i] = s * axes[i * 3];
+		out.q[2][i] = s * axes[i * 3 + 1];
+		out.q[3][i] = s * axes[i * 3 + 2];
+	}
+}
+
+void versors_from_heading_deg (const float* degrees, versor_soa& out,
+	size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out.q[0][i] = (float)(ONE_DEG_IN_RAD * degrees[i]) * 0.5f;
+	}
+	sincos_batch (out.q[0], out.q[2], out.q[0], n);
+	for (size_t i = 0; i < n; i++) {
+		out.q[1][i] = 0.0f;
+		out.q[3][i] = 0.0f;
+	}
+}
@@ -0,0 +1,75 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Versor (unit quaternion) maths over whole arrays, for animating thousands of |
+| rotations per frame. The arrays are SoA: one array each of w, x, y and z, in |
+| the same order as versor::q. None of these modify their inputs, and none of  |
+| them re-normalise unless they say so - call normalise_versors() every so     |
+| often instead of paying for a sqrt on every multiply.                        |
+| Kernels use the CPU dispatch from maths_simd.h, and arrays bigger than       |
+| VERSOR_GRAIN are split across the thread pool. Outputs may be the same       |
+| arrays as an input.                                                          |
+\******************************************************************************/
+#ifndef _VERSOR_BATCH_H_
+#define _VERSOR_BATCH_H_
+
+#include "maths_funcs.h"
+#include <stddef.h>
+
+// items per thread pool chunk
+#define VERSOR_GRAIN 8192
+
+// q[0] is the array of w components, q[1] x, q[2] y, q[3] z
+struct versor_soa {
+	float* q[4];
+};
+
+// read-only view of the same thing, so inputs can be passed as const
+struct const_versor_soa {
+	const_versor_soa ();
+	const_versor_soa (const versor_soa& v);
+	const float* q[4];
+};
+
+// out[i] = a[i] * b[i], same convention as versor::operator*
+void mul_versors (const const_versor_soa& a, const const_versor_soa& b,
+	versor_soa& out, size_t n);
+// out[i] = a[i] / |a[i]|. one rsqrt and a newton step, ~1e-7 error
+void normalise_versors (const const_versor_soa& a, versor_soa& out, size_t n);
+/* normalised linear interpolation, taking the short way round. t is one
+factor per versor. cheap, but the speed along the arc isn't constant */
+void nlerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	const float* t, versor_soa& out, size_t n);
+void nlerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	float t, versor_soa& out, size_t n);
+/* spherical interpolation, taking the short way round, without acos or sin.
+uses Eberly's polynomial ("A Fast and Accurate Algorithm for Computing SLERP",
+2011) with 8 terms. max abs error per component against a double-precision
+slerp is under 4e-5, worst when the versors are 90 degrees apart, and much
+smaller for the small steps of an animation. maths_bench checks the bound */
+void slerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	const float* t, versor_soa& out, size_t n);
+void slerp_versors (const const_versor_soa& a, const const_versor_soa& b,
+	float t, versor_soa& out, size_t n);
+// out[i] = quat_to_mat4 (a[i]). gives the same bits as quat_to_mat4()
+void quat_to_mat4_batch (const const_versor_soa& a, mat4* out, size_t n);
+/* model matrices for a whole array of instances, out[i] = make_trs (pos[i],
+rot[i], scale[i]) with the same bits. pos and scale are 3 floats per instance,
+xyzxyz..., like the mesh arrays. scale may be NULL for make_rt () */
+void make_trs_batch (const float* pos, const const_versor_soa& rot,
+	const float* scale, mat4* out, size_t n);
+/* out[i] = quat_from_axis_rad (radians[i], axes[i]) for a whole array of
+instance orientations, using sincos_batch() from fast_trig.h. axes are 3 floats
+per versor, xyzxyz..., and should be unit length. same bits as a
+MATHS_FAST_TRIG build of quat_from_axis_rad () */
+void versors_from_axis_rad (const float* radians, const float* axes,
+	versor_soa& out, size_t n);
+// out[i] = a heading in degrees around the y axis, like quat_from_axis_deg()
+void versors_from_heading_deg (const float* degrees, versor_soa& out, size_t n);
+
+#endif